@@ -21,6 +21,7 @@
  *
  ****************************************************************************/
 
+#include <stdint.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
@@ -62,7 +63,8 @@ static int aagridnum(mimetex_ctx *mctx, raster *rp, int irow, int icol)
     /* local rp->pixmap ptr */
     pixbyte *bitmap = rp->pixmap;
     int width = rp->width, height = rp->height, /* width, height of raster */
-        imap = icol + irow * width; /* pixel index = icol + irow*width */
+        stride = rp->stride,    /* #pixels per row of pixmap */
+        imap = PIXDEX(rp, irow, icol); /* pixel index in rp->pixmap */
     int bitval = 0,         /* value of rp bit at irow,icol */
         nnbitval = 0, nebitval = 0, eebitval = 0, sebitval = 0, /*adjacent vals*/
         ssbitval = 0, swbitval = 0, wwbitval = 0, nwbitval = 0, /*compass pt names*/
@@ -82,27 +84,27 @@ static int aagridnum(mimetex_ctx *mctx, raster *rp, int irow, int icol)
     /* --- get 8 surrounding bits --- */
     if (irow > 0)                /* nn (north) bit available */
         /* nn bit value */
-        nnbitval = getlongbit(bitmap, imap - width);
+        nnbitval = getlongbit(bitmap, imap - stride);
     if (irow < height - 1)           /* ss (south) bit available */
         /* ss bit value */
-        ssbitval = getlongbit(bitmap, imap + width);
+        ssbitval = getlongbit(bitmap, imap + stride);
     if (icol > 0) {              /* ww (west) bit available */
         /* ww bit value */
         wwbitval = getlongbit(bitmap, imap - 1);
         if (irow > 0)             /* nw bit available */
             /* nw bit value */
-            nwbitval = getlongbit(bitmap, imap - width - 1);
+            nwbitval = getlongbit(bitmap, imap - stride - 1);
         if (irow < height - 1)        /* sw bit available */
-            swbitval = getlongbit(bitmap, imap + width - 1);
+            swbitval = getlongbit(bitmap, imap + stride - 1);
     } /* sw bit value */
     if (icol < width - 1) {          /* ee (east) bit available */
         /* ee bit value */
         eebitval = getlongbit(bitmap, imap + 1);
         if (irow > 0)             /* ne bit available */
             /* ne bit value */
-            nebitval = getlongbit(bitmap, imap - width + 1);
+            nebitval = getlongbit(bitmap, imap - stride + 1);
         if (irow < height - 1)        /* se bit available */
-            sebitval = getlongbit(bitmap, imap + width + 1);
+            sebitval = getlongbit(bitmap, imap + stride + 1);
     } /* se bit value */
     /* --- set gridnum --- */
     /* clear all bits */
@@ -331,8 +333,8 @@ static int aafollowline(mimetex_ctx *mctx, raster *rp, int irow, int icol, int d
     ------------------------------------------------------------ */
     /* local rp->pixmap ptr */
     pixbyte *bitmap = rp->pixmap;
-    /* width, height of raster */
-    int width = rp->width, height = rp->height;
+    /* width, height of raster, #pixels per row of pixmap */
+    int width = rp->width, height = rp->height, stride = rp->stride;
     int drow = 0, dcol = 0,     /* delta row,col to follow line */
         jrow = irow, jcol = icol; /* current row,col following line */
     int bitval = 1, /* value of rp bit at irow,icol */
@@ -351,7 +353,7 @@ static int aafollowline(mimetex_ctx *mctx, raster *rp, int irow, int icol, int d
             ||   icol < 0 || icol >= width) goto end_of_job;
     /* --- starting bit -- see if we're following a fg (usual), or bg line --- */
     /* starting pixel (bg or fg)*/
-    bitval = getlongbit(bitmap, (icol + irow * width));
+    bitval = getlongbit(bitmap, (icol + irow * stride));
     fgval = bitval;
     /* define "fg" as whatever bitval is*/
     bgval = (1 - bitval);
@@ -378,18 +380,18 @@ static int aafollowline(mimetex_ctx *mctx, raster *rp, int irow, int icol, int d
     }    /* left/west */
     /* --- set bitminus and bitplus --- */
     if (drow == 0) {             /* we're following line right/left */
-        if (irow < height)             /* there's a pixel below current */
+        if (irow < height - 1)         /* there's a pixel below current */
             /* get it */
-            bitminus = getlongbit(bitmap, (icol + (irow + 1) * width));
+            bitminus = getlongbit(bitmap, (icol + (irow + 1) * stride));
         if (irow > 0)              /* there's a pixel above current */
-            bitplus = getlongbit(bitmap, (icol + (irow - 1) * width));
+            bitplus = getlongbit(bitmap, (icol + (irow - 1) * stride));
     } /* get it */
     if (dcol == 0) {             /* we're following line up/down */
-        if (icol < width)              /* there's a pixel to the right */
+        if (icol < width - 1)          /* there's a pixel to the right */
             /* get it */
-            bitplus = getlongbit(bitmap, (icol + 1 + irow * width));
+            bitplus = getlongbit(bitmap, (icol + 1 + irow * stride));
         if (icol > 0)              /* there's a pixel to the left */
-            bitminus = getlongbit(bitmap, (icol - 1 + irow * width));
+            bitminus = getlongbit(bitmap, (icol - 1 + irow * stride));
     } /* get it */
     /* --- check for lack of line to follow --- */
     if (bitval == bitplus            /* starting pixel same as above */
@@ -429,21 +431,21 @@ static int aafollowline(mimetex_ctx *mctx, raster *rp, int irow, int icol, int d
         }
         /* --- set current bit (dbitval) --- */
         /*value of jrow,jcol bit*/
-        dbitval = getlongbit(bitmap, (jcol + jrow * width));
+        dbitval = getlongbit(bitmap, (jcol + jrow * stride));
         /* --- set dbitminus and dbitplus --- */
         if (drow == 0) {           /* we're following line right/left */
-            if (irow < height)       /* there's a pixel below current */
+            if (irow < height - 1)   /* there's a pixel below current */
                 /* get it */
-                dbitminus = getlongbit(bitmap, (jcol + (irow + 1) * width));
+                dbitminus = getlongbit(bitmap, (jcol + (irow + 1) * stride));
             if (irow > 0)            /* there's a pixel above current */
-                dbitplus = getlongbit(bitmap, (jcol + (irow - 1) * width));
+                dbitplus = getlongbit(bitmap, (jcol + (irow - 1) * stride));
         } /* get it */
         if (dcol == 0) {           /* we're following line up/down */
-            if (icol < width)            /* there's a pixel to the right */
+            if (icol < width - 1)        /* there's a pixel to the right */
                 /* get it */
-                dbitplus = getlongbit(bitmap, (icol + 1 + jrow * width));
+                dbitplus = getlongbit(bitmap, (icol + 1 + jrow * stride));
             if (icol > 0)            /* there's a pixel to the left */
-                dbitminus = getlongbit(bitmap, (icol - 1 + jrow * width));
+                dbitminus = getlongbit(bitmap, (icol - 1 + jrow * stride));
         } /* get it */
         /* --- first check for abrupt end-of-line, or for T or Y --- */
         if (isline != 0)           /* abrupt end or T,Y must be a line*/
@@ -553,8 +555,8 @@ static int aapattern1124(mimetex_ctx *mctx, raster *rp, int irow, int icol,
     int patternum = 24;
     /* local rp->pixmap ptr */
     pixbyte *bitmap = rp->pixmap;
-    /* width, height of raster */
-    int width = rp->width, height = rp->height;
+    /* width, height of raster, #pixels per row of pixmap */
+    int width = rp->width, height = rp->height, stride = rp->stride;
     /* corner or diagonal row,col */
     int jrow = irow, jcol = icol;
     int vertcornval = 0, horzcornval = 0,   /* vertical, horizontal corner bits*/
@@ -579,14 +581,14 @@ static int aapattern1124(mimetex_ctx *mctx, raster *rp, int irow, int icol,
         /* directions to follow corner */
         vdirection = -1;
         if ((jrow = irow + 2) < height) {  /* vert corner below center pixel */
-            vertcornval = getlongbit(bitmap, (icol + jrow * width));
+            vertcornval = getlongbit(bitmap, (icol + jrow * stride));
             if ((icol - 1) >= 0)       /* lower diag left of center */
-                botdiagval = getlongbit(bitmap, ((icol - 1) + jrow * width));
+                botdiagval = getlongbit(bitmap, ((icol - 1) + jrow * stride));
         }
         if ((jcol = icol + 2) < width) { /* horz corner right of center */
-            horzcornval = getlongbit(bitmap, (jcol + irow * width));
+            horzcornval = getlongbit(bitmap, (jcol + irow * stride));
             if ((irow - 1) >= 0)       /* upper diag above center */
-                topdiagval = getlongbit(bitmap, (jcol + (irow - 1) * width));
+                topdiagval = getlongbit(bitmap, (jcol + (irow - 1) * stride));
         }
         break;
     case 18:
@@ -596,14 +598,14 @@ static int aapattern1124(mimetex_ctx *mctx, raster *rp, int irow, int icol,
         /* directions to follow corner */
         vdirection = -1;
         if ((jrow = irow + 2) < height) {  /* vert corner below center pixel */
-            vertcornval = getlongbit(bitmap, (icol + jrow * width));
+            vertcornval = getlongbit(bitmap, (icol + jrow * stride));
             if ((icol + 1) < width)        /* lower diag right of center */
-                botdiagval = getlongbit(bitmap, ((icol + 1) + jrow * width));
+                botdiagval = getlongbit(bitmap, ((icol + 1) + jrow * stride));
         }
         if ((jcol = icol - 2) >= 0) {    /* horz corner left of center */
-            horzcornval = getlongbit(bitmap, (jcol + irow * width));
+            horzcornval = getlongbit(bitmap, (jcol + irow * stride));
             if ((irow - 1) >= 0)       /* upper diag above center */
-                topdiagval = getlongbit(bitmap, (jcol + (irow - 1) * width));
+                topdiagval = getlongbit(bitmap, (jcol + (irow - 1) * stride));
         }
         break;
     case 72:
@@ -613,14 +615,14 @@ static int aapattern1124(mimetex_ctx *mctx, raster *rp, int irow, int icol,
         /* directions to follow corner */
         vdirection = 1;
         if ((jrow = irow - 2) >= 0) {    /* vert corner above center pixel */
-            vertcornval = getlongbit(bitmap, (icol + jrow * width));
+            vertcornval = getlongbit(bitmap, (icol + jrow * stride));
             if ((icol - 1) >= 0)       /* upper diag left of center */
-                topdiagval = getlongbit(bitmap, ((icol - 1) + jrow * width));
+                topdiagval = getlongbit(bitmap, ((icol - 1) + jrow * stride));
         }
         if ((jcol = icol + 2) < width) { /* horz corner right of center */
-            horzcornval = getlongbit(bitmap, (jcol + irow * width));
+            horzcornval = getlongbit(bitmap, (jcol + irow * stride));
             if ((irow + 1) < height)       /* lower diag below center */
-                botdiagval = getlongbit(bitmap, (jcol + (irow + 1) * width));
+                botdiagval = getlongbit(bitmap, (jcol + (irow + 1) * stride));
         }
         break;
     case 80:
@@ -630,14 +632,14 @@ static int aapattern1124(mimetex_ctx *mctx, raster *rp, int irow, int icol,
         /* directions to follow corner */
         vdirection = 1;
         if ((jrow = irow - 2) >= 0) {    /* vert corner above center pixel */
-            vertcornval = getlongbit(bitmap, (icol + jrow * width));
+            vertcornval = getlongbit(bitmap, (icol + jrow * stride));
             if ((icol + 1) < width)        /* upper diag right of center */
-                topdiagval = getlongbit(bitmap, ((icol + 1) + jrow * width));
+                topdiagval = getlongbit(bitmap, ((icol + 1) + jrow * stride));
         }
         if ((jcol = icol - 2) >= 0) {    /* horz corner left of center */
-            horzcornval = getlongbit(bitmap, (jcol + irow * width));
+            horzcornval = getlongbit(bitmap, (jcol + irow * stride));
             if ((irow + 1) < height)       /* lower diag below center */
-                botdiagval = getlongbit(bitmap, (jcol + (irow + 1) * width));
+                botdiagval = getlongbit(bitmap, (jcol + (irow + 1) * stride));
         }
         break;
     } /* --- end-of-switch(gridnum/2) --- */
@@ -1086,6 +1088,150 @@ static int aapatterns(mimetex_ctx *mctx, raster *rp, int irow, int icol,
 
 
 
+/* --------------------------------------------------------------------------
+aalookupcol(nnrow,row,ssrow,icol,width) returns the 3 pixels of column icol
+of bitmap rows nnrow (north, or NULL), row, and ssrow (south, or NULL)
+as window bits 0100,010,01, i.e., as the east column of an aalookupinit()
+window (pixels outside the bitmap are unset).  It's a macro because it's
+evaluated for every pixel the window slides across.
+-------------------------------------------------------------------------- */
+#define aalookupcol(nnrow,row,ssrow,icol,width) ( (icol) >= (width) ? 0 : \
+    ( ((nnrow) != NULL && getlongbit((nnrow),(icol)) ? 0100 : 0) \
+    | (getlongbit((row),(icol)) ? 010 : 0) \
+    | ((ssrow) != NULL && getlongbit((ssrow),(icol)) ? 01 : 0) ) )
+
+
+/* ==========================================================================
+ * Function:    aawindowgridnum ( window )
+ * Purpose: converts a 3x3 window, as slid along rows by
+ *      aawindowmap(), to the corresponding aagridnum()
+ * --------------------------------------------------------------------------
+ * Arguments:   window (I)  int containing 0-511 window, whose bits
+ *              876 543 210 are its north, center,
+ *              and south rows (west to east)
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     0-511 gridnum, as per aagridnum()
+ * --------------------------------------------------------------------------
+ * Notes:     o
+ * ======================================================================= */
+/* --- entry point --- */
+static int aawindowgridnum(int window)
+{
+    int nn = (window >> 6) & 7, cc = (window >> 3) & 7, ss = window & 7; /* rows */
+    return ((nn << 6)               /* nw,nn,ne are gridnum's 256,128,64 */
+            | ((cc & 4) << 3) | ((cc & 1) << 4) /* ww is 32, ee is 16 */
+            | ((cc >> 1) & 1)       /* center is 1 */
+            | (ss << 1));           /* sw,ss,se are 8,4,2 */
+} /* --- end-of-function aawindowgridnum() --- */
+
+
+/* ==========================================================================
+ * Function:    aauniformword ( nnrow, row, ssrow, icol, width )
+ * Purpose: checks whether every pixel in cols icol...icol+63
+ *      of a bitmap row has a uniform (all unset or all set)
+ *      3x3 grid, so the whole word can be filled at once
+ * --------------------------------------------------------------------------
+ * Arguments:   nnrow (I)   pixbyte * to row north of row, or NULL
+ *      row (I)     pixbyte * to row
+ *      ssrow (I)   pixbyte * to row south of row, or NULL
+ *      icol (I)    int containing first col of the word
+ *      width (I)   int containing #pixels in each row
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     0 if cols icol-1...icol+64 of all three rows
+ *              are unset, 0777 if they're all set,
+ *              or -1 otherwise
+ * --------------------------------------------------------------------------
+ * Notes:     o icol must start a whole word of the (padded) rows,
+ *      i.e., icol%64==0 and icol+64<=width, or -1 is returned
+ *        o pixels outside the bitmap are unset, so words along
+ *      the border are never returned as all set
+ * ======================================================================= */
+/* --- entry point --- */
+static int aauniformword(const pixbyte *nnrow, const pixbyte *row,
+                         const pixbyte *ssrow, int icol, int width)
+{
+    uint64_t nnword = 0, word = 0, ssword = 0; /* cols icol...icol+63 */
+    int westcol = 0, eastcol = 0; /* cols icol-1 and icol+64 */
+    if (icol % 64 != 0 || icol + 64 > width) return (-1); /* not a whole word */
+    if (icol > 0) westcol = aalookupcol(nnrow, row, ssrow, icol - 1, width);
+    if (westcol != 0 && westcol != 0111) return (-1); /* west col mixed */
+    /* --- get the word from each row --- */
+    memcpy((void *)&word, (const void *)(row + icol / 8), 8);
+    if (nnrow != NULL) memcpy((void *)&nnword, (const void *)(nnrow + icol / 8), 8);
+    if (ssrow != NULL) memcpy((void *)&ssword, (const void *)(ssrow + icol / 8), 8);
+    eastcol = aalookupcol(nnrow, row, ssrow, icol + 64, width);
+    /* --- check for all unset or all set --- */
+    if (westcol == 0 && eastcol == 0 && (nnword | word | ssword) == 0)
+        return (0);             /* whole word is blank */
+    if (westcol == 0111 && eastcol == 0111 /* all three rows in bitmap */
+            &&   (nnword & word & ssword) == ~((uint64_t)0))
+        return (0777);          /* whole word is ink */
+    return (-1);
+} /* --- end-of-function aauniformword() --- */
+
+
+/* ==========================================================================
+ * Function:    aawindowmap ( rp, table, bytemap )
+ * Purpose: sets each bytemap pixel to the table entry for the
+ *      3x3 grid of rp->bitmap pixels centered on it
+ * --------------------------------------------------------------------------
+ * Arguments:   rp (I)      raster *  to raster whose bitmap
+ *              is to be anti-aliased
+ *      table (I)   intbyte * to 512 bytemap values, indexed
+ *              by 3x3 grid as in aalookupinit()
+ *      bytemap (O) intbyte * to bytemap, in 1-to-1
+ *              correspondence with rp->bitmap
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1=success, 0=any error
+ * --------------------------------------------------------------------------
+ * Notes:     o pixels outside the bitmap count as unset
+ *        o the window slides east a pixel at a time, except across
+ *      words of the (word-aligned) rows that aauniformword()
+ *      finds all blank or all ink, which are filled with
+ *      table[0] or table[0777] 64 pixels at a time
+ * ======================================================================= */
+/* --- entry point --- */
+static int aawindowmap(raster *rp, const intbyte *table, intbyte *bytemap)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    int width = rp->width, height = rp->height, /* width, height of raster */
+        icol = 0, irow = 0, imap = 0; /* row, col, bytemap indexes */
+    int window = 0;  /* table[] index for 3x3 grid at irow,icol */
+    /* ------------------------------------------------------------
+    look up each pixel's grid as the window slides along its row
+    ------------------------------------------------------------ */
+    if (rp->pixsz != 1 || rp->stride < 1) return (0); /* not a padded bitmap */
+    for (irow = 0; irow < height; irow++) {
+        /* --- rows north of, at, and south of irow --- */
+        const pixbyte *nnrow = (irow > 0 ? bitmaprow(rp, irow - 1) : NULL),
+                      *row = bitmaprow(rp, irow),
+                      *ssrow = (irow < height - 1 ? bitmaprow(rp, irow + 1) : NULL);
+        /* --- window starts with col 0 at its east edge --- */
+        window = aalookupcol(nnrow, row, ssrow, 0, width);
+        for (icol = 0; icol < width; icol++) {
+            /* --- fill 64 pixels at once if their grids are all uniform --- */
+            if (icol % 64 == 0) {      /* at a whole word */
+                int uniform = aauniformword(nnrow, row, ssrow, icol, width);
+                if (uniform >= 0) {     /* all blank or all ink */
+                    memset((void *)(bytemap + imap), table[uniform], 64);
+                    imap += 64;
+                    icol += 63;        /* next col is icol+64 */
+                    window = uniform;  /* with cols icol+62...icol+64 same */
+                    continue;
+                }
+            } /* --- end-of-if(icol%64==0) --- */
+            /* --- slide window east, so icol is at its center --- */
+            window = ((window << 1) & 0666)
+                     | aalookupcol(nnrow, row, ssrow, icol + 1, width);
+            bytemap[imap++] = table[window];
+        } /* --- end-of-for(icol) --- */
+    } /* --- end-of-for(irow) --- */
+    return (1);
+} /* --- end-of-function aawindowmap() --- */
+
+
 /* ==========================================================================
  * Function:    aalowpass ( rp, bytemap, grayscale )
  * Purpose: calculates a lowpass anti-aliased bytemap
@@ -1113,6 +1259,9 @@ static int aapatterns(mimetex_ctx *mctx, raster *rp, int irow, int icol,
  *      A higher weight sharpens the resulting anti-aliased image;
  *      lower weights blur it out more (but keep the "center" black
  *      as per the preceding note).
+ *        o A pixel's average depends only on its 3x3 grid, so it's
+ *      calculated once for each of the 512 possible grids,
+ *      and aawindowmap() looks up every pixel's.
  * ======================================================================= */
 /* --- entry point --- */
 int aalowpass(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
@@ -1122,10 +1271,9 @@ int aalowpass(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
     ------------------------------------------------------------ */
     /* 1=success, 0=failure to caller */
     int status = 1;
-    /*local rp->pixmap ptr*/
-    pixbyte *bitmap = (rp == NULL ? NULL : rp->pixmap);
-    /* rp->height, rp->width indexes */
-    int irow = 0, icol = 0;
+    /* bytemap value for each 3x3 grid, indexed as in aalookupinit() */
+    intbyte table[512];
+    int window = 0;         /* table[] index */
     /* matrix of weights */
     int weights[9] = { 1, 3, 1, 3, 0, 3, 1, 3, 1 };
     /*clockwise from upper-left*/
@@ -1146,86 +1294,74 @@ int aalowpass(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
     /* tot is center plus neighbors */
     totwts = mctx->centerwt + 4 * (1 + mctx->adjacentwt);
     /* ------------------------------------------------------------
-    Calculate bytemap as 9-point weighted average over bitmap
+    Calculate 9-point weighted average for every possible 3x3 grid
     ------------------------------------------------------------ */
-    for (irow = 0; irow < rp->height; irow++) {
-        for (icol = 0; icol < rp->width; icol++) {
-            /* center pixel index */
-            int   ipixel = icol + irow * (rp->width);
-            int   jrow = 0, jcol = 0,     /* box around ipixel */
-                  bitval = 0,         /* value of bit/pixel at jrow,jcol */
-                  iscenter = 0,           /* set true if center pixel black */
-                  nadjacent = 0, wadjacent = 0,   /* #adjacent black pixels, their wts*/
-                  ngaps = 0,          /* #gaps in 8 pixels around center */
-                  iwt = (-1), sumwts = 0; /* weights index, sum in-bound wts */
-            /* adjacency "matrix" */
-            char  adjmatrix[8];
-            /* zero out adjacency matrix */
-            memset(adjmatrix, 0, 8);
-            /* init pixel white */
-            bytemap[ipixel] = 0;
-            /*--- for ipixel at irow,icol, get weighted average of adjacent pixels ---*/
-            for (jrow = irow - 1; jrow <= irow + 1; jrow++)  /* jrow = irow-1...irow+1 */
-                for (jcol = icol - 1; jcol <= icol + 1; jcol++) { /* jcol = icol-1...icol+1 */
-                    /* averaging index */
-                    int jpixel = jcol + jrow * (rp->width);
-                    /*always bump weight index*/
-                    iwt++;
-                    if (jrow < 0 || jrow >= rp->height  /* if row out pf bounds */
-                            ||   jcol < 0 || jcol >= rp->width) /* or col out of bounds */
-                        /* ignore this point */
-                        continue;
-                    /* value of bit at jrow,jcol */
-                    bitval = (int)getlongbit(bitmap, jpixel);
-                    if (bitval) {            /* this is a black pixel */
-                        if (jrow == irow && jcol == icol)  /* and this is center point */
-                            /* set flag for center point black */
-                            iscenter = 1;
-                        else {              /* adjacent point black */
-                            /* bump adjacent black count */
-                            nadjacent++;
-                            adjmatrix[adjindex[iwt]] = 1;
-                        } /*set "bit" in adjacency matrix*/
-                        wadjacent += weights[iwt];
-                    }    /* sum weights for black pixels */
-                    /* and sum weights for all pixels */
-                    sumwts += weights[iwt];
-                } /* --- end-of-for(jrow,jcol) --- */
-            /* --- count gaps --- */
-            /* init count */
-            ngaps = (adjmatrix[7] != adjmatrix[0] ? 1 : 0);
-            for (iwt = 0; iwt < 7; iwt++)      /* clockwise around adjacency */
-                if (adjmatrix[iwt] != adjmatrix[iwt+1]) ngaps++;   /* black/white flip */
-            ngaps /= 2;               /*each gap has 2 black/white flips*/
-            /* --- anti-alias pixel, but leave it black if it was already black --- */
-            if (isforceavg && iscenter)        /* force avg if center point black */
-                /* so force grayscale-1=black */
-                bytemap[ipixel] = grayscale - 1;
-            else
-            /* center point not black */
-                if (ngaps <= 2) {         /*don't darken checkerboarded pixel*/
-                    bytemap[ipixel] =         /* 0=white ... grayscale-1=black */
-                        ((totwts / 2 - 1) + (grayscale - 1) * wadjacent) / totwts; /* not /sumwts; */
-                    if (blackscale > 0         /* blackscale kludge turned on */
-                            &&   bytemap[ipixel] > blackscale)  /* weighted avg > blackscale */
-                        bytemap[ipixel] = grayscale - 1;
-                } /* so force it entirely black */
-            /*--- only anti-alias pixels whose adjacent pixels fall within bounds ---*/
-            if (!iscenter) {           /* apply min/mctx->maxadjacent test */
-                if (isminmaxwts) {            /* min/max refer to adjacent weights*/
-                    if (wadjacent < mctx->minadjacent    /* wts of adjacent points too low */
-                            ||   wadjacent > mctx->maxadjacent)     /* or too high */
-                        /* so leave point white */
-                        bytemap[ipixel] = 0;
-                } else {               /* min/max refer to #adjacent points*/
-                    if (nadjacent < mctx->minadjacent    /* too few adjacent points black */
-                            ||   nadjacent > mctx->maxadjacent)     /* or too many */
-                        /* so leave point white */
-                        bytemap[ipixel] = 0;
-                }
+    for (window = 0; window < 512; window++) {
+        int   bitval = 0,         /* value of bit/pixel at iwt */
+              iscenter = 0,           /* set true if center pixel black */
+              nadjacent = 0, wadjacent = 0,   /* #adjacent black pixels, their wts*/
+              ngaps = 0,          /* #gaps in 8 pixels around center */
+              iwt = (-1); /* weights index */
+        /* adjacency "matrix" */
+        char  adjmatrix[8];
+        /* zero out adjacency matrix */
+        memset(adjmatrix, 0, 8);
+        /* init pixel white */
+        table[window] = 0;
+        /*--- get weighted average of adjacent pixels, upper-left first ---*/
+        for (iwt = 0; iwt < 9; iwt++) {
+            /* value of bit at iwt (pixels outside rp are white) */
+            bitval = get1bit(window, 8 - iwt);
+            if (bitval) {            /* this is a black pixel */
+                if (iwt == 4)           /* and this is center point */
+                    /* set flag for center point black */
+                    iscenter = 1;
+                else {              /* adjacent point black */
+                    /* bump adjacent black count */
+                    nadjacent++;
+                    adjmatrix[adjindex[iwt]] = 1;
+                } /*set "bit" in adjacency matrix*/
+                wadjacent += weights[iwt];
+            }    /* sum weights for black pixels */
+        } /* --- end-of-for(iwt) --- */
+        /* --- count gaps --- */
+        /* init count */
+        ngaps = (adjmatrix[7] != adjmatrix[0] ? 1 : 0);
+        for (iwt = 0; iwt < 7; iwt++)      /* clockwise around adjacency */
+            if (adjmatrix[iwt] != adjmatrix[iwt+1]) ngaps++;   /* black/white flip */
+        ngaps /= 2;               /*each gap has 2 black/white flips*/
+        /* --- anti-alias pixel, but leave it black if it was already black --- */
+        if (isforceavg && iscenter)        /* force avg if center point black */
+            /* so force grayscale-1=black */
+            table[window] = grayscale - 1;
+        else
+        /* center point not black */
+            if (ngaps <= 2) {         /*don't darken checkerboarded pixel*/
+                table[window] =         /* 0=white ... grayscale-1=black */
+                    ((totwts / 2 - 1) + (grayscale - 1) * wadjacent) / totwts; /* not /sumwts; */
+                if (blackscale > 0         /* blackscale kludge turned on */
+                        &&   table[window] > blackscale)  /* weighted avg > blackscale */
+                    table[window] = grayscale - 1;
+            } /* so force it entirely black */
+        /*--- only anti-alias pixels whose adjacent pixels fall within bounds ---*/
+        if (!iscenter) {           /* apply min/mctx->maxadjacent test */
+            if (isminmaxwts) {            /* min/max refer to adjacent weights*/
+                if (wadjacent < mctx->minadjacent    /* wts of adjacent points too low */
+                        ||   wadjacent > mctx->maxadjacent)     /* or too high */
+                    /* so leave point white */
+                    table[window] = 0;
+            } else {               /* min/max refer to #adjacent points*/
+                if (nadjacent < mctx->minadjacent    /* too few adjacent points black */
+                        ||   nadjacent > mctx->maxadjacent)     /* or too many */
+                    /* so leave point white */
+                    table[window] = 0;
             }
-        } /* --- end-of-for(irow,icol) --- */
-    }
+        }
+    } /* --- end-of-for(window) --- */
+    /* ------------------------------------------------------------
+    Calculate bytemap by looking up each pixel's 3x3 grid
+    ------------------------------------------------------------ */
+    status = aawindowmap(rp, table, bytemap);
     /* ------------------------------------------------------------
     Back to caller with gray-scale anti-aliased bytemap
     ------------------------------------------------------------ */
@@ -1254,6 +1390,9 @@ int aalowpass(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
  * --------------------------------------------------------------------------
  * Notes:    o  Based on the pnmalias.c algorithm in the netpbm package
  *      on sourceforge.
+ *       o  A pixel's value depends only on its 3x3 grid, so it's
+ *      calculated once for each of the 512 possible grids,
+ *      and aawindowmap() looks up every pixel's.
  * ======================================================================= */
 /* --- entry point --- */
 int aapnm(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
@@ -1261,11 +1400,16 @@ int aapnm(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
-    /* local rp->pixmap ptr */
-    pixbyte *bitmap = rp->pixmap;
+    /* 1=success, 0=failure to caller */
+    int status = 1;
     int width = rp->width, height = rp->height, /* width, height of raster */
         icol = 0,  irow = 0,  /* width, height indexes */
         imap = (-1); /* pixel index = icol + irow*width */
+    /* bytemap value for each 3x3 grid, indexed as in aalookupinit() */
+    intbyte table[512];
+    /* each grid's weighted val, or -1 if not antialiased */
+    double aawtvals[512];
+    int window = 0;         /* table[] index */
     /* background, foreground bitval */
     int bgbitval = 0, fgbitval = 1;
     /*debugging switch signals 1st pixel*/
@@ -1319,196 +1463,196 @@ int aapnm(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
         isbgonly = mctx->bgonly;
     }        /* set isbgonly */
     /* ------------------------------------------------------------
-    Calculate bytemap as 9-point weighted average over bitmap
+    Calculate 9-point weighted average for every possible 3x3 grid
     ------------------------------------------------------------ */
-    for (irow = 0; irow < height; irow++)
+    for (window = 0; window < 512; window++) {
+        /* --- local allocations and declarations --- */
+        int   bitval = get1bit(window, 4), /* value of center bit */
+              nnbitval = get1bit(window, 7), nebitval = get1bit(window, 6), /*adjacent vals*/
+              eebitval = get1bit(window, 3), sebitval = get1bit(window, 0), /*compass pt names*/
+              ssbitval = get1bit(window, 1), swbitval = get1bit(window, 2),
+              wwbitval = get1bit(window, 5), nwbitval = get1bit(window, 8);
+        /*does pixel border a bg or fg edge*/
+        int   isbgedge = 0, isfgedge = 0;
+        /* antialiased (or unchanged) value*/
+        int   aabyteval = 0;
+        /* default aa val */
+        aabyteval = (intbyte)(bitval == bgbitval ? 0 : grayscale - 1);
+        /* init antialiased pixel */
+        table[window] = (intbyte)(aabyteval);
+        /* not antialiased */
+        aawtvals[window] = (-1.0);
+        /* --- check if we're antialiasing this pixel --- */
+        if ((isbgonly && bitval == fgbitval)   /* only antialias background bit */
+                || (isfgonly && bitval == bgbitval))  /* only antialias foreground bit */
+            /* leave default and do next grid */
+            continue;
+        /* --- check for edges --- */
+        isbgedge =                /* current pixel borders a bg edge */
+            (nnbitval == bgbitval && eebitval == bgbitval) ||   /*upper-right edge*/
+            (eebitval == bgbitval && ssbitval == bgbitval) ||   /*lower-right edge*/
+            (ssbitval == bgbitval && wwbitval == bgbitval) ||   /*lower-left  edge*/
+            /*upper-left  edge*/
+            (wwbitval == bgbitval && nnbitval == bgbitval) ;
+        isfgedge =                /* current pixel borders an fg edge*/
+            (nnbitval == fgbitval && eebitval == fgbitval) ||   /*upper-right edge*/
+            (eebitval == fgbitval && ssbitval == fgbitval) ||   /*lower-right edge*/
+            (ssbitval == fgbitval && wwbitval == fgbitval) ||   /*lower-left  edge*/
+            /*upper-left  edge*/
+            (wwbitval == fgbitval && nnbitval == fgbitval) ;
+        /* ---check top/bot left/right edges for corners (added by j.forkosh)--- */
+        if (1) {               /* true to perform test */
+            int isbghorz = 0, isfghorz = 0, isbgvert = 0, isfgvert = 0; /* horz/vert edges */
+            isbghorz =              /* top or bottom edge is all bg */
+                (nwbitval + nnbitval + nebitval == 3 * bgbitval) ||   /* top edge bg */
+                /* bottom edge bg */
+                (swbitval + ssbitval + sebitval == 3 * bgbitval) ;
+            isfghorz =              /* top or bottom edge is all fg */
+                (nwbitval + nnbitval + nebitval == 3 * fgbitval) ||   /* top edge fg */
+                /* bottom edge fg */
+                (swbitval + ssbitval + sebitval == 3 * fgbitval) ;
+            isbgvert =              /* left or right edge is all bg */
+                (nwbitval + wwbitval + swbitval == 3 * bgbitval) ||   /* left edge bg */
+                /* right edge bg */
+                (nebitval + eebitval + sebitval == 3 * bgbitval) ;
+            isfgvert =              /* left or right edge is all bg */
+                (nwbitval + wwbitval + swbitval == 3 * fgbitval) ||   /* left edge fg */
+                /* right edge fg */
+                (nebitval + eebitval + sebitval == 3 * fgbitval) ;
+            if ((isbghorz && isbgvert && (bitval == fgbitval))   /* we're at an...*/
+                    || (isfghorz && isfgvert && (bitval == bgbitval)))  /*...inside corner */
+                /* don't antialias */
+                continue;
+        } /* --- end-of-if(1) --- */
+        /* --- check #gaps for checkerboard (added by j.forkosh) --- */
+        if (0) {               /* true to perform test */
+            int ngaps = 0, mingaps = 1, maxgaps = 2;   /* count #fg/bg flips (max=4 noop) */
+            /* upper-left =? upper */
+            if (nwbitval != nnbitval) ngaps++;
+            /* upper =? upper-right */
+            if (nnbitval != nebitval) ngaps++;
+            /* upper-right =? right */
+            if (nebitval != eebitval) ngaps++;
+            /* right =? lower-right */
+            if (eebitval != sebitval) ngaps++;
+            /* lower-right =? lower */
+            if (sebitval != ssbitval) ngaps++;
+            /* lower =? lower-left */
+            if (ssbitval != swbitval) ngaps++;
+            /* lower-left =? left */
+            if (swbitval != wwbitval) ngaps++;
+            /* left =? upper-left */
+            if (wwbitval != nwbitval) ngaps++;
+            if (ngaps > 0) ngaps /= 2;   /* each gap has 2 bg/fg flips */
+            if (ngaps < mingaps || ngaps > maxgaps) continue;
+        } /* --- end-of-if(1) --- */
+        /* --- antialias if necessary --- */
+        if ((isbgalias && isbgedge)        /* alias pixel surrounding bg */
+                || (isfgalias && isfgedge)        /* alias pixel surrounding fg */
+                || (isbgedge  && isfgedge)) {     /* neighboring fg and bg pixel */
+            int aasumval =          /* sum wts[]*bitmap[] */
+                wts[0] * nwbitval + wts[1] * nnbitval + wts[2] * nebitval +
+                wts[3] * wwbitval +  wts[4] * bitval  + wts[5] * eebitval +
+                wts[6] * swbitval + wts[7] * ssbitval + wts[8] * sebitval ;
+            /* weighted val */
+            double aawtval = ((double)aasumval) / ((double)totwts);
+            /*0...grayscale-1*/
+            aabyteval = (int)(((double)(grayscale - 1)) * aawtval + 0.5);
+            /* set antialiased pixel */
+            table[window] = (intbyte)(aabyteval);
+            /* and save weighted val for diagnostics */
+            aawtvals[window] = aawtval;
+        } /* --- end-of-if(isedge) --- */
+    } /* --- end-of-for(window) --- */
+    /* ------------------------------------------------------------
+    Calculate bytemap by looking up each pixel's 3x3 grid
+    ------------------------------------------------------------ */
+    if (mctx->msglevel < 99 || mctx->msgfp == NULL) { /* no diagnostics wanted */
+        status = aawindowmap(rp, table, bytemap);
+        goto end_of_job;
+    }
+    for (irow = 0; irow < height; irow++) {
+        /* --- rows north of, at, and south of irow --- */
+        const pixbyte *nnrow = (irow > 0 ? bitmaprow(rp, irow - 1) : NULL),
+                      *row = bitmaprow(rp, irow),
+                      *ssrow = (irow < height - 1 ? bitmaprow(rp, irow + 1) : NULL);
+        /* --- window starts with col 0 at its east edge --- */
+        window = aalookupcol(nnrow, row, ssrow, 0, width);
         for (icol = 0; icol < width; icol++) {
-            /* --- local allocations and declarations --- */
-            int   bitval = 0,         /* value of rp bit at irow,icol */
-                           nnbitval = 0, nebitval = 0, eebitval = 0, sebitval = 0, /*adjacent vals*/
-                                                                  /*compass pt names*/
-                                                                  ssbitval = 0, swbitval = 0, wwbitval = 0, nwbitval = 0;
-            /*does pixel border a bg or fg edge*/
-            int   isbgedge = 0, isfgedge = 0;
-            /* antialiased (or unchanged) value*/
-            int   aabyteval = 0;
-            /* --- bump imap index and get center bit value --- */
+            /* --- slide window east, so icol is at its center --- */
+            window = ((window << 1) & 0666)
+                     | aalookupcol(nnrow, row, ssrow, icol + 1, width);
             /* imap = icol + irow*width */
             imap++;
-            /* value of rp input bit at imap */
-            bitval = getlongbit(bitmap, imap);
-            /* default aa val */
-            aabyteval = (intbyte)(bitval == bgbitval ? 0 : grayscale - 1);
-            /* init antialiased pixel */
-            bytemap[imap] = (intbyte)(aabyteval);
-            /* --- check if we're antialiasing this pixel --- */
-            if ((isbgonly && bitval == fgbitval)   /* only antialias background bit */
-                    || (isfgonly && bitval == bgbitval))  /* only antialias foreground bit */
-                /* leave default and do next bit */
-                continue;
-            /* --- get surrounding bits --- */
-            if (irow > 0)              /* nn (north) bit available */
-                /* nn bit value */
-                nnbitval = getlongbit(bitmap, imap - width);
-            if (irow < height - 1)     /* ss (south) bit available */
-                /* ss bit value */
-                ssbitval = getlongbit(bitmap, imap + width);
-            if (icol > 0) {            /* ww (west) bit available */
-                /* ww bit value */
-                wwbitval = getlongbit(bitmap, imap - 1);
-                if (irow > 0)           /* nw bit available */
-                    /* nw bit value */
-                    nwbitval = getlongbit(bitmap, imap - width - 1);
-                if (irow < height - 1)      /* sw bit available */
-                    swbitval = getlongbit(bitmap, imap + width - 1);
-            } /* sw bit value */
-            if (icol < width - 1) {        /* ee (east) bit available */
-                /* ee bit value */
-                eebitval = getlongbit(bitmap, imap + 1);
-                if (irow > 0)           /* ne bit available */
-                    /* ne bit value */
-                    nebitval = getlongbit(bitmap, imap - width + 1);
-                if (irow < height - 1)      /* se bit available */
-                    sebitval = getlongbit(bitmap, imap + width + 1);
-            } /* se bit value */
-            /* --- check for edges --- */
-            isbgedge =                /* current pixel borders a bg edge */
-                (nnbitval == bgbitval && eebitval == bgbitval) ||   /*upper-right edge*/
-                (eebitval == bgbitval && ssbitval == bgbitval) ||   /*lower-right edge*/
-                (ssbitval == bgbitval && wwbitval == bgbitval) ||   /*lower-left  edge*/
-                /*upper-left  edge*/
-                (wwbitval == bgbitval && nnbitval == bgbitval) ;
-            isfgedge =                /* current pixel borders an fg edge*/
-                (nnbitval == fgbitval && eebitval == fgbitval) ||   /*upper-right edge*/
-                (eebitval == fgbitval && ssbitval == fgbitval) ||   /*lower-right edge*/
-                (ssbitval == fgbitval && wwbitval == fgbitval) ||   /*lower-left  edge*/
-                /*upper-left  edge*/
-                (wwbitval == fgbitval && nnbitval == fgbitval) ;
-            /* ---check top/bot left/right edges for corners (added by j.forkosh)--- */
-            if (1) {               /* true to perform test */
-                int isbghorz = 0, isfghorz = 0, isbgvert = 0, isfgvert = 0; /* horz/vert edges */
-                isbghorz =              /* top or bottom edge is all bg */
-                    (nwbitval + nnbitval + nebitval == 3 * bgbitval) ||   /* top edge bg */
-                    /* bottom edge bg */
-                    (swbitval + ssbitval + sebitval == 3 * bgbitval) ;
-                isfghorz =              /* top or bottom edge is all fg */
-                    (nwbitval + nnbitval + nebitval == 3 * fgbitval) ||   /* top edge fg */
-                    /* bottom edge fg */
-                    (swbitval + ssbitval + sebitval == 3 * fgbitval) ;
-                isbgvert =              /* left or right edge is all bg */
-                    (nwbitval + wwbitval + swbitval == 3 * bgbitval) ||   /* left edge bg */
-                    /* right edge bg */
-                    (nebitval + eebitval + sebitval == 3 * bgbitval) ;
-                isfgvert =              /* left or right edge is all bg */
-                    (nwbitval + wwbitval + swbitval == 3 * fgbitval) ||   /* left edge fg */
-                    /* right edge fg */
-                    (nebitval + eebitval + sebitval == 3 * fgbitval) ;
-                if ((isbghorz && isbgvert && (bitval == fgbitval))   /* we're at an...*/
-                        || (isfghorz && isfgvert && (bitval == bgbitval)))  /*...inside corner */
-                    /* don't antialias */
-                    continue;
-            } /* --- end-of-if(1) --- */
-            /* --- check #gaps for checkerboard (added by j.forkosh) --- */
-            if (0) {               /* true to perform test */
-                int ngaps = 0, mingaps = 1, maxgaps = 2;   /* count #fg/bg flips (max=4 noop) */
-                /* upper-left =? upper */
-                if (nwbitval != nnbitval) ngaps++;
-                /* upper =? upper-right */
-                if (nnbitval != nebitval) ngaps++;
-                /* upper-right =? right */
-                if (nebitval != eebitval) ngaps++;
-                /* right =? lower-right */
-                if (eebitval != sebitval) ngaps++;
-                /* lower-right =? lower */
-                if (sebitval != ssbitval) ngaps++;
-                /* lower =? lower-left */
-                if (ssbitval != swbitval) ngaps++;
-                /* lower-left =? left */
-                if (swbitval != wwbitval) ngaps++;
-                /* left =? upper-left */
-                if (wwbitval != nwbitval) ngaps++;
-                if (ngaps > 0) ngaps /= 2;   /* each gap has 2 bg/fg flips */
-                if (ngaps < mingaps || ngaps > maxgaps) continue;
-            } /* --- end-of-if(1) --- */
-            /* --- antialias if necessary --- */
-            if ((isbgalias && isbgedge)        /* alias pixel surrounding bg */
-                    || (isfgalias && isfgedge)        /* alias pixel surrounding fg */
-                    || (isbgedge  && isfgedge)) {     /* neighboring fg and bg pixel */
-                int aasumval =          /* sum wts[]*bitmap[] */
-                    wts[0] * nwbitval + wts[1] * nnbitval + wts[2] * nebitval +
-                    wts[3] * wwbitval +  wts[4] * bitval  + wts[5] * eebitval +
-                    wts[6] * swbitval + wts[7] * ssbitval + wts[8] * sebitval ;
-                /* weighted val */
-                double aawtval = ((double)aasumval) / ((double)totwts);
-                /*0...grayscale-1*/
-                aabyteval = (int)(((double)(grayscale - 1)) * aawtval + 0.5);
-                /* set antialiased pixel */
-                bytemap[imap] = (intbyte)(aabyteval);
-                if (mctx->msglevel >= 99 && mctx->msgfp != NULL) {
-                    fprintf(mctx->msgfp,
-                    /*diagnostic output*/
-                            "%s> irow,icol,imap=%d,%d,%d aawtval=%.4f aabyteval=%d\n",
-                            (isfirstaa ? "aapnm algorithm" : "aapnm"),
-                            irow, icol, imap, aawtval, aabyteval);
-                    isfirstaa = 0;
-                }
-            } /* --- end-of-if(isedge) --- */
-        } /* --- end-of-for(irow,icol) --- */
+            /* antialiased pixel */
+            bytemap[imap] = table[window];
+            if (aawtvals[window] >= 0.0) {  /* pixel was antialiased */
+                fprintf(mctx->msgfp,
+                /*diagnostic output*/
+                        "%s> irow,icol,imap=%d,%d,%d aawtval=%.4f aabyteval=%d\n",
+                        (isfirstaa ? "aapnm algorithm" : "aapnm"),
+                        irow, icol, imap, aawtvals[window],
+                        (int)(((double)(grayscale - 1)) * aawtvals[window] + 0.5));
+                isfirstaa = 0;
+            }
+        } /* --- end-of-for(icol) --- */
+    } /* --- end-of-for(irow) --- */
     /* ------------------------------------------------------------
     Back to caller with gray-scale anti-aliased bytemap
     ------------------------------------------------------------ */
-    /*end_of_job:*/
-    return (1);
+end_of_job:
+    return (status);
 } /* --- end-of-function aapnm() --- */
 
 
 /* ==========================================================================
- * Function:    aapnmlookup ( rp, bytemap, grayscale )
- * Purpose: calculates a lowpass anti-aliased bytemap
- *      for rp->bitmap, with each byte 0...grayscale-1,
- *      based on the pnmalias.c algorithm.
- *      This version uses aagridnum() and aapatternnum() lookups
- *      to interpret 3x3 lowpass pixel grids.
+ * Function:    aapnmgrid ( rp, irow, icol, gridnum, grayscale, aawtval )
+ * Purpose: calculates aapnmlookup()'s anti-aliased value
+ *      for the pixel at irow,icol, whose surrounding 3x3
+ *      pixel grid is coded by gridnum
  * --------------------------------------------------------------------------
  * Arguments:   rp (I)      raster *  to raster whose bitmap
  *              is to be anti-aliased
- *      bytemap (O) intbyte * to bytemap, calculated
- *              by applying pnm-based filter to rp->bitmap,
- *              and returned (as you'd expect) in 1-to-1
- *              addressing correspondence with rp->bitmap
+ *      irow (I)    int containing row, 0...height-1,
+ *              of pixel to be antialiased
+ *      icol (I)    int containing col, 0...width-1,
+ *              of pixel to be antialiased
+ *      gridnum (I) int containing 0...511 corresponding to
+ *              3x3 pixel grid surrounding irow,icol
  *      grayscale (I)   int containing number of grayscales
  *              to be calculated, 0...grayscale-1
  *              (should typically be given as 256)
+ *      aawtval (O) double * returning the weighted val used,
+ *              or -1 if the pixel's value wasn't averaged
  * --------------------------------------------------------------------------
- * Returns: ( int )     1=success, 0=any error
+ * Returns: ( int )     antialiased (or unchanged) value
  * --------------------------------------------------------------------------
- * Notes:    o  Based on the pnmalias.c algorithm in the netpbm package
- *      on sourceforge.
- *       o  This version uses aagridnum() and aapatternnum() lookups
- *      to interpret 3x3 lowpass pixel grids.
+ * Notes:    o  Only the special patterns handled by aapatterns()
+ *      look beyond gridnum at rp,irow,icol, so the all-white
+ *      and all-black grids, 0 and 511, can be calculated once
+ *      for any irow,icol.
  * ======================================================================= */
 /* --- entry point --- */
-int aapnmlookup(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
+static int aapnmgrid(mimetex_ctx *mctx, raster *rp, int irow, int icol,
+                     int gridnum, int grayscale, double *aawtval)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
-    int width = rp->width, height = rp->height, /* width, height of raster */
-                                    icol = 0,        irow = 0,  /* width, height indexes */
-                                                            /* pixel index = icol + irow*width */
-                                                            imap = (-1);
     /* background, foreground bitval */
     int bgbitval = 0, fgbitval = 1;
-    /*debugging switch signals 1st pixel*/
-    int isfirstaa = 1;
     int aacenterwt = mctx->centerwt, aaadjacentwt = mctx->adjacentwt, aacornerwt = mctx->cornerwt,
         totwts = mctx->centerwt + 4 * (mctx->adjacentwt + mctx->cornerwt); /*pnmalias default wts*/
     int isfgalias  = mctx->fgalias,       /*(1) true to antialias fg bits */
         isfgonly   = mctx->fgonly,        /*(0) true to only antialias fg bits*/
         isbgalias  = mctx->bgalias,       /*(0) true to antialias bg bits */
         isbgonly   = mctx->bgonly;        /*(0) true to only antialias bg bits*/
-    int gridnum = (-1),  /* grid# for 3x3 grid at irow,icol */
-        patternum = (-1); /*pattern#, 1-51, for input gridnum*/
+    /*pattern#, 1-51, for input gridnum*/
+    int patternum = (-1);
+    int   bitval = 0,         /* value of rp bit at irow,icol */
+          isbgdiag = 0, isfgdiag = 0, /*does pixel border a bg or fg edge*/
+          aabyteval = 0, /* antialiased (or unchanged) value*/
+          aaval = (-1);  /* aapatterns() special value */
     /* ---
      * pattern number data
      * ------------------- */
@@ -1564,119 +1708,205 @@ int aapnmlookup(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
         -1
     }; /* --- end-of-diagedges[] --- */
     /* ------------------------------------------------------------
+    Calculate 9-point weighted average for the pixel's 3x3 grid
+    ------------------------------------------------------------ */
+    /* not averaged */
+    *aawtval = (-1.0);
+    /* center bit set if gridnum odd */
+    bitval = (gridnum & 1);
+    /* default aa val */
+    aabyteval = (intbyte)(bitval == bgbitval ? 0 : grayscale - 1);
+    /* gridnum out of bounds*/
+    if (gridnum < 0 || gridnum > 511) goto end_of_job;
+    /* --- check if we're antialiasing this pixel --- */
+    if ((isbgonly && bitval == fgbitval)   /* only antialias background bit */
+            || (isfgonly && bitval == bgbitval))  /* only antialias foreground bit */
+        /* leave default */
+        goto end_of_job;
+    /* --- look up pattern number, 1-51, corresponding to input gridnum --- */
+    /* look up pattern number */
+    patternum = aapatternnum(mctx, gridnum);
+    /* some internal error */
+    if (patternum < 1 || patternum > 51) goto end_of_job;
+    /* --- special pattern number processing --- */
+    if ((aaval = aapatterns(mctx, rp, irow, icol, gridnum, patternum, grayscale))
+            >=   0) {                 /* special processing for pattern */
+        /* set antialiased pixel */
+        aabyteval = aaval;
+        goto end_of_job;
+    }             /* and back to caller */
+    /* --- check for diagonal edges --- */
+    isbgdiag = (diagedges[patternum] == 2 || /*current pixel borders a bg edge*/
+                diagedges[patternum] == 0);
+    isfgdiag = (diagedges[patternum] == 2 || /*current pixel borders a fg edge*/
+                diagedges[patternum] == 1);
+    /* ---check top/bot left/right edges for corners (added by j.forkosh)--- */
+    if (1) {               /* true to perform test */
+        int isbghorz = 0, isfghorz = 0, isbgvert = 0, isfgvert = 0, /* horz/vert edges */
+                                     horzedge = horzedges[patternum], vertedge = vertedges[patternum];
+        /* top or bottom edge is all bg */
+        isbghorz = (horzedge == 2 || horzedge == 0);
+        /* top or bottom edge is all fg */
+        isfghorz = (horzedge == 2 || horzedge == 1);
+        /* left or right edge is all bg */
+        isbgvert = (vertedge == 2 || vertedge == 0);
+        /* left or right edge is all fg */
+        isfgvert = (vertedge == 2 || vertedge == 1);
+        if ((isbghorz && isbgvert && (bitval == fgbitval))   /* we're at an...*/
+                || (isfghorz && isfgvert && (bitval == bgbitval)))  /*...inside corner */
+            /* don't antialias */
+            goto end_of_job;
+    } /* --- end-of-if(1) --- */
+#if 0
+    /* --- check #gaps for checkerboard (added by j.forkosh) --- */
+    if (0) {               /* true to perform test */
+        int ngaps = 0, mingaps = 1, maxgaps = 2;   /* count #fg/bg flips (max=4 noop) */
+        /* upper-left =? upper */
+        if (nwbitval != nnbitval) ngaps++;
+        /* upper =? upper-right */
+        if (nnbitval != nebitval) ngaps++;
+        /* upper-right =? right */
+        if (nebitval != eebitval) ngaps++;
+        /* right =? lower-right */
+        if (eebitval != sebitval) ngaps++;
+        /* lower-right =? lower */
+        if (sebitval != ssbitval) ngaps++;
+        /* lower =? lower-left */
+        if (ssbitval != swbitval) ngaps++;
+        /* lower-left =? left */
+        if (swbitval != wwbitval) ngaps++;
+        /* left =? upper-left */
+        if (wwbitval != nwbitval) ngaps++;
+        if (ngaps > 0) ngaps /= 2;   /* each gap has 2 bg/fg flips */
+        if (ngaps < mingaps || ngaps > maxgaps) goto end_of_job;
+    } /* --- end-of-if(1) --- */
+#endif
+    /* --- antialias if necessary --- */
+    if ((isbgalias && isbgdiag)        /* alias pixel surrounding bg */
+            || (isfgalias && isfgdiag)        /* alias pixel surrounding fg */
+            || (isbgdiag  && isfgdiag)) {     /* neighboring fg and bg pixel */
+        int aasumval =          /* sum wts[]*bitmap[] */
+            aacenterwt * bitval +   /* apply mctx->centerwt to center pixel */
+            aaadjacentwt * nadjacents[patternum] + /* similarly for adjacents */
+            /* and corners */
+            aacornerwt * ncorners[patternum];
+        /* weighted val */
+        *aawtval = ((double)aasumval) / ((double)totwts);
+        /*0...grayscale-1*/
+        aabyteval = (int)(((double)(grayscale - 1)) * (*aawtval) + 0.5);
+    } /* --- end-of-if(isedge) --- */
+end_of_job:
+    /* back to caller with antialiased val */
+    return (aabyteval);
+} /* --- end-of-function aapnmgrid() --- */
+
+
+/* ==========================================================================
+ * Function:    aapnmlookup ( rp, bytemap, grayscale )
+ * Purpose: calculates a lowpass anti-aliased bytemap
+ *      for rp->bitmap, with each byte 0...grayscale-1,
+ *      based on the pnmalias.c algorithm.
+ *      This version uses aagridnum() and aapatternnum() lookups
+ *      to interpret 3x3 lowpass pixel grids.
+ * --------------------------------------------------------------------------
+ * Arguments:   rp (I)      raster *  to raster whose bitmap
+ *              is to be anti-aliased
+ *      bytemap (O) intbyte * to bytemap, calculated
+ *              by applying pnm-based filter to rp->bitmap,
+ *              and returned (as you'd expect) in 1-to-1
+ *              addressing correspondence with rp->bitmap
+ *      grayscale (I)   int containing number of grayscales
+ *              to be calculated, 0...grayscale-1
+ *              (should typically be given as 256)
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1=success, 0=any error
+ * --------------------------------------------------------------------------
+ * Notes:    o  Based on the pnmalias.c algorithm in the netpbm package
+ *      on sourceforge.
+ *       o  This version uses aagridnum() and aapatternnum() lookups
+ *      to interpret 3x3 lowpass pixel grids.
+ *       o  Words of the bitmap whose grids are all white or all black
+ *      (see aauniformword()) are filled 64 pixels at a time,
+ *      so only pixels along edges go through aapnmgrid().
+ * ======================================================================= */
+/* --- entry point --- */
+int aapnmlookup(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    int width = rp->width, height = rp->height, /* width, height of raster */
+                                    icol = 0,        irow = 0,  /* width, height indexes */
+                                                            /* pixel index = icol + irow*width */
+                                                            imap = (-1);
+    /*debugging switch signals 1st pixel*/
+    int isfirstaa = 1;
+    /* true for per-pixel diagnostic output */
+    int isdiag = (mctx->msglevel >= 99 && mctx->msgfp != NULL);
+    /* true to slide a window along (padded) bitmap rows */
+    int isrows = (rp->pixsz == 1 && rp->stride > 0);
+    int gridnum = (-1),  /* grid# for 3x3 grid at irow,icol */
+        window = 0,      /* aawindowmap()-style window at irow,icol */
+        uniform = (-1);  /* aauniformword() for word at irow,icol */
+    /* aapnmgrid() values for all-white, all-black grids */
+    int bgaaval = 0, fgaaval = 0;
+    /* weighted val from aapnmgrid() */
+    double aawtval = 0.0;
+    /* ------------------------------------------------------------
     Calculate bytemap as 9-point weighted average over bitmap
     ------------------------------------------------------------ */
+    /* --- values for uniform grids, which don't depend on irow,icol --- */
+    bgaaval = aapnmgrid(mctx, rp, 0, 0, 0, grayscale, &aawtval);
+    fgaaval = aapnmgrid(mctx, rp, 0, 0, 511, grayscale, &aawtval);
     for (irow = 0; irow < height; irow++) {
+        /* --- rows north of, at, and south of irow --- */
+        const pixbyte *nnrow = (irow > 0 && isrows ? bitmaprow(rp, irow - 1) : NULL),
+                      *row = (isrows ? bitmaprow(rp, irow) : NULL),
+                      *ssrow = (irow < height - 1 && isrows ? bitmaprow(rp, irow + 1) : NULL);
+        /* --- window starts with col 0 at its east edge --- */
+        if (isrows) window = aalookupcol(nnrow, row, ssrow, 0, width);
         for (icol = 0; icol < width; icol++) {
-            /* --- local allocations and declarations --- */
-            int   bitval = 0,         /* value of rp bit at irow,icol */
-                  isbgdiag = 0, isfgdiag = 0, /*does pixel border a bg or fg edge*/
-                  aabyteval = 0; /* antialiased (or unchanged) value*/
-            /* --- get gridnum and center bit value, init aabyteval --- */
+            /* --- fill 64 pixels at once if their grids are all uniform --- */
+            if (isrows && !isdiag && icol % 64 == 0  /* at a whole word */
+                    &&   (uniform = aauniformword(nnrow, row, ssrow, icol, width)) >= 0) {
+                memset((void *)(bytemap + imap + 1),
+                       (uniform == 0 ? bgaaval : fgaaval), 64);
+                imap += 64;
+                icol += 63;          /* next col is icol+64 */
+                window = uniform;    /* with cols icol+62...icol+64 same */
+                continue;
+            }
+            /* --- get gridnum and antialiased pixel --- */
             /* first set imap=icol + irow*width*/
             imap++;
-            /*grid# coding 3x3 grid at irow,icol*/
-            gridnum = aagridnum(mctx, rp, irow, icol);
-            /* center bit set if gridnum odd */
-            bitval = (gridnum & 1);
-            /* default aa val */
-            aabyteval = (intbyte)(bitval == bgbitval ? 0 : grayscale - 1);
-            /* init antialiased pixel */
-            bytemap[imap] = (intbyte)(aabyteval);
-            /* gridnum out of bounds*/
-            if (gridnum < 0 || gridnum > 511) continue;
-            /* --- check if we're antialiasing this pixel --- */
-            if ((isbgonly && bitval == fgbitval)   /* only antialias background bit */
-                    || (isfgonly && bitval == bgbitval))  /* only antialias foreground bit */
-                /* leave default and do next bit */
-                continue;
-            /* --- look up pattern number, 1-51, corresponding to input gridnum --- */
-            /* look up pattern number */
-            patternum = aapatternnum(mctx, gridnum);
-            /* some internal error */
-            if (patternum < 1 || patternum > 51) continue;
-            /* --- special pattern number processing --- */
-            if ((aabyteval = aapatterns(mctx, rp, irow, icol, gridnum, patternum, grayscale))
-                    >=   0) {                 /* special processing for pattern */
-                /* set antialiased pixel */
-                bytemap[imap] = (intbyte)(aabyteval);
-                continue;
-            }             /* and continue with next pixel */
-            /* --- check for diagonal edges --- */
-            isbgdiag = (diagedges[patternum] == 2 || /*current pixel borders a bg edge*/
-                        diagedges[patternum] == 0);
-            isfgdiag = (diagedges[patternum] == 2 || /*current pixel borders a fg edge*/
-                        diagedges[patternum] == 1);
-            /* ---check top/bot left/right edges for corners (added by j.forkosh)--- */
-            if (1) {               /* true to perform test */
-                int isbghorz = 0, isfghorz = 0, isbgvert = 0, isfgvert = 0, /* horz/vert edges */
-                                             horzedge = horzedges[patternum], vertedge = vertedges[patternum];
-                /* top or bottom edge is all bg */
-                isbghorz = (horzedge == 2 || horzedge == 0);
-                /* top or bottom edge is all fg */
-                isfghorz = (horzedge == 2 || horzedge == 1);
-                /* left or right edge is all bg */
-                isbgvert = (vertedge == 2 || vertedge == 0);
-                /* left or right edge is all fg */
-                isfgvert = (vertedge == 2 || vertedge == 1);
-                if ((isbghorz && isbgvert && (bitval == fgbitval))   /* we're at an...*/
-                        || (isfghorz && isfgvert && (bitval == bgbitval)))  /*...inside corner */
-                    /* don't antialias */
-                    continue;
-            } /* --- end-of-if(1) --- */
-#if 0
-            /* --- check #gaps for checkerboard (added by j.forkosh) --- */
-            if (0) {               /* true to perform test */
-                int ngaps = 0, mingaps = 1, maxgaps = 2;   /* count #fg/bg flips (max=4 noop) */
-                /* upper-left =? upper */
-                if (nwbitval != nnbitval) ngaps++;
-                /* upper =? upper-right */
-                if (nnbitval != nebitval) ngaps++;
-                /* upper-right =? right */
-                if (nebitval != eebitval) ngaps++;
-                /* right =? lower-right */
-                if (eebitval != sebitval) ngaps++;
-                /* lower-right =? lower */
-                if (sebitval != ssbitval) ngaps++;
-                /* lower =? lower-left */
-                if (ssbitval != swbitval) ngaps++;
-                /* lower-left =? left */
-                if (swbitval != wwbitval) ngaps++;
-                /* left =? upper-left */
-                if (wwbitval != nwbitval) ngaps++;
-                if (ngaps > 0) ngaps /= 2;   /* each gap has 2 bg/fg flips */
-                if (ngaps < mingaps || ngaps > maxgaps) continue;
-            } /* --- end-of-if(1) --- */
-#endif
-            /* --- antialias if necessary --- */
-            if ((isbgalias && isbgdiag)        /* alias pixel surrounding bg */
-                    || (isfgalias && isfgdiag)        /* alias pixel surrounding fg */
-                    || (isbgdiag  && isfgdiag)) {     /* neighboring fg and bg pixel */
-                int aasumval =          /* sum wts[]*bitmap[] */
-                    aacenterwt * bitval +   /* apply mctx->centerwt to center pixel */
-                    aaadjacentwt * nadjacents[patternum] + /* similarly for adjacents */
-                    /* and corners */
-                    aacornerwt * ncorners[patternum];
-                /* weighted val */
-                double aawtval = ((double)aasumval) / ((double)totwts);
-                /*0...grayscale-1*/
-                aabyteval = (int)(((double)(grayscale - 1)) * aawtval + 0.5);
-                /* set antialiased pixel */
-                bytemap[imap] = (intbyte)(aabyteval);
-                if (mctx->msglevel >= 99 && mctx->msgfp != NULL) {
-                    fprintf(mctx->msgfp,
-                    /*diagnostic output*/
-                            "%s> irow,icol,imap=%d,%d,%d aawtval=%.4f aabyteval=%d",
-                            (isfirstaa ? "aapnmlookup algorithm" : "aapnm"),
-                            irow, icol, imap, aawtval, aabyteval);
-                    /* no more output */
-                    if (mctx->msglevel < 100) fprintf(mctx->msgfp, "\n");
-                    else fprintf(mctx->msgfp, ", grid#,pattern#=%d,%d\n", gridnum, patternum);
-                    isfirstaa = 0;
-                }
-            } /* --- end-of-if(isedge) --- */
-        } /* --- end-of-for(irow,icol) --- */
-    }
+            if (isrows) {              /* slide window east to icol */
+                window = ((window << 1) & 0666)
+                         | aalookupcol(nnrow, row, ssrow, icol + 1, width);
+                gridnum = aawindowgridnum(window);
+            } else
+                /*grid# coding 3x3 grid at irow,icol*/
+                gridnum = aagridnum(mctx, rp, irow, icol);
+            /* set antialiased pixel */
+            if (!isdiag && (gridnum == 0 || gridnum == 511)) /* uniform grid */
+                bytemap[imap] = (intbyte)(gridnum == 0 ? bgaaval : fgaaval);
+            else
+                bytemap[imap] = (intbyte)(aapnmgrid(mctx, rp, irow, icol,
+                                                    gridnum, grayscale, &aawtval));
+            if (isdiag && aawtval >= 0.0) {  /* pixel was averaged */
+                fprintf(mctx->msgfp,
+                /*diagnostic output*/
+                        "%s> irow,icol,imap=%d,%d,%d aawtval=%.4f aabyteval=%d",
+                        (isfirstaa ? "aapnmlookup algorithm" : "aapnm"),
+                        irow, icol, imap, aawtval,
+                        (int)(((double)(grayscale - 1)) * aawtval + 0.5));
+                /* no more output */
+                if (mctx->msglevel < 100) fprintf(mctx->msgfp, "\n");
+                else fprintf(mctx->msgfp, ", grid#,pattern#=%d,%d\n",
+                                 gridnum, aapatternnum(mctx, gridnum));
+                isfirstaa = 0;
+            }
+        } /* --- end-of-for(icol) --- */
+    } /* --- end-of-for(irow) --- */
     /* ------------------------------------------------------------
     Back to caller with gray-scale anti-aliased bytemap
     ------------------------------------------------------------ */
@@ -1770,6 +2000,48 @@ end_of_job:
 } /* --- end-of-function aalookup() --- */
 
 
+/* ==========================================================================
+ * Function:    aalookupinit ( )
+ * Purpose: fills mctx->aalookuptable[] with aalookup()'s grayscale
+ *      for every 3x3 grid, so aalowpasslookup() needn't
+ *      classify each pixel's grid itself
+ * --------------------------------------------------------------------------
+ * Arguments:   none
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1=success, 0=any error
+ * --------------------------------------------------------------------------
+ * Notes:     o The table is indexed by the grid's rows, as
+ *        876     (north row)
+ *        543  =  (center row)   i.e., bit 4 is the center pixel
+ *        210     (south row)
+ *      rather than by gridnum, so that aalowpasslookup() can
+ *      slide its window east a bit at a time.
+ *        o aalookup() depends on nothing but gridnum, so this is
+ *      called just once, by mimetex_ctx_init().
+ * ======================================================================= */
+/* --- entry point --- */
+int aalookupinit(mimetex_ctx *mctx)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    int window = 0,         /* table index, coding rows of grid */
+        gridnum = 0; /* the same grid coded as a gridnum */
+    /* don't count table entries as diagnostics */
+    int ispatternnumcount = mctx->ispatternnumcount;
+    /* ------------------------------------------------------------
+    look up the grayscale for each grid
+    ------------------------------------------------------------ */
+    mctx->ispatternnumcount = 0;
+    for (window = 0; window < 512; window++) {
+        gridnum = aawindowgridnum(window);
+        mctx->aalookuptable[window] = aalookup(mctx, gridnum);
+    } /* --- end-of-for(window) --- */
+    mctx->ispatternnumcount = ispatternnumcount;
+    return (1);
+} /* --- end-of-function aalookupinit() --- */
+
+
 /* ==========================================================================
  * Function:    aalowpasslookup ( rp, bytemap, grayscale )
  * Purpose: calls aalookup() for each pixel in rp->bitmap
@@ -1786,7 +2058,11 @@ end_of_job:
  * --------------------------------------------------------------------------
  * Returns: ( int )     1=success, 0=any error
  * --------------------------------------------------------------------------
- * Notes:    o
+ * Notes:    o aalookup()'s results come from mctx->aalookuptable[],
+ *      looked up by aawindowmap(), unless
+ *      mctx->ispatternnumcount asks for aalookup()'s diagnostic
+ *      pattern counts, in which case aalookup() is called on
+ *      each pixel's aagridnum().
  * ======================================================================= */
 /* --- entry point --- */
 int aalowpasslookup(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale)
@@ -1800,9 +2076,23 @@ int aalowpasslookup(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int graysca
     int bitval = 0,         /* value of rp bit at irow,icol */
         aabyteval = 0; /* antialiased (or unchanged) value*/
     int gridnum = 0; /* grid# for 3x3 grid at irow,icol */
+    /* bytemap value for each 3x3 grid, indexed as in aalookupinit() */
+    intbyte table[512];
+    int window = 0;  /* table[] index */
     /* ------------------------------------------------------------
     generate bytemap by table lookup for each pixel of bitmap
     ------------------------------------------------------------ */
+    if (!mctx->ispatternnumcount) {      /* no diagnostics wanted */
+        for (window = 0; window < 512; window++) {
+            /* look up on window */
+            aabyteval = mctx->aalookuptable[window];
+            if (aabyteval < 0 || aabyteval > 255) /* lookup failed */
+                /* so default aa val */
+                aabyteval = (((window >> 4) & 1) == bgbitval ? 0 : grayscale - 1);
+            table[window] = (intbyte)(aabyteval);
+        } /* --- end-of-for(window) --- */
+        return (aawindowmap(rp, table, bytemap));
+    } /* --- end-of-if(!ispatternnumcount) --- */
     for (irow = 0; irow < height; irow++)
         for (icol = 0; icol < width; icol++) {
             /* --- get gridnum and center bit value, init aabyteval --- */
@@ -1949,6 +2239,78 @@ end_of_job:
 } /* --- end-of-function aacolormap() --- */
 
 
+/* ==========================================================================
+ * Function:    aaraster ( rp, bytemap, colormap, colors )
+ * Purpose: Anti-aliases bitmap rp with the mctx->aaalgorithm selected,
+ *      and reduces the resulting bytemap to colors[] and colormap[]
+ * --------------------------------------------------------------------------
+ * Arguments:   rp (I)      raster *  to raster whose bitmap
+ *              is to be anti-aliased
+ *      bytemap (O) intbyte *  to rp->width*rp->height bytes
+ *              returning the anti-aliased bytemap
+ *      colormap (O)    intbyte *  to rp->width*rp->height bytes
+ *              returning bytemap's colors[] indexes
+ *      colors (O)  intbyte *  to 256 bytes returning the
+ *              grayscales used in colormap
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #colors in colors[], or 0 if rp wasn't
+ *              anti-aliased (caller should emit rp's bitmap)
+ * --------------------------------------------------------------------------
+ * Notes:     o Any failure also returns 0, so the caller just emits
+ *      the b&w image, exactly as when mctx->aaalgorithm is 0.
+ *        o mctx->aaalgorithm itself is left untouched, so a context
+ *      can be reused for subsequent images.
+ * ======================================================================= */
+/* --- entry point --- */
+int aaraster(mimetex_ctx *mctx, raster *rp, intbyte *bytemap,
+             intbyte *colormap, intbyte *colors)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* 0-255 grayscales in 8-bit bytes */
+    int grayscale = 256;
+    /* #colors (0=not anti-aliased) */
+    int ncolors = 0;
+    /* 1=bytemap generated */
+    int isaa = 0;
+    /* ------------------------------------------------------------
+    generate anti-aliased bytemap using selected algorithm
+    ------------------------------------------------------------ */
+    if (rp == NULL || bytemap == NULL || colormap == NULL) goto end_of_job;
+    switch (mctx->aaalgorithm) {         /* choose antialiasing algorithm */
+    default:
+        /* unrecognized algorithm */
+        break;
+    case 1:              /* 1 for aalowpass() */
+        isaa = aalowpass(mctx, rp, bytemap, grayscale);
+        break;
+    case 2:              /*2 for netpbm pnmalias.c algorithm*/
+        isaa = aapnm(mctx, rp, bytemap, grayscale);
+        break;
+    case 3:              /*3 for aapnm() based on aagridnum()*/
+        isaa = aapnmlookup(mctx, rp, bytemap, grayscale);
+        break;
+    case 4:              /* 4 for aalookup() table lookup */
+        isaa = aalowpasslookup(mctx, rp, bytemap, grayscale);
+        break;
+    } /* --- end-of-switch(aaalgorithm) --- */
+    /* ------------------------------------------------------------
+    generate colors and colormap from bytemap
+    ------------------------------------------------------------ */
+    if (isaa) {                 /* we have bytemap */
+        ncolors = aacolormap(mctx, bytemap, (rp->width) * (rp->height),
+                             colors, colormap);
+        if (ncolors < 2)             /* failed */
+            /* so signal black&white */
+            ncolors = 0;
+    }
+end_of_job:
+    /* back with #colors */
+    return (ncolors);
+} /* --- end-of-function aaraster() --- */
+
+
 /* ==========================================================================
  * Function:    aaweights ( width, height )
  *      Builds "canonical" weight matrix, width x height, in a raster
@@ -2070,24 +2432,23 @@ int aawtpixel(mimetex_ctx *mctx, raster *image, int ipixel, raster *weights, int
         wtcol,  wtcol0 = wtwidth / 2, /* center col index for weights */
         imgrow, imgrow0 = ipixel / imgwidth, /* center row index for ipixel */
         imgcol, imgcol0 = ipixel - (imgrow0 * imgwidth); /*center col for ipixel*/
-    /* --- rotated grid variables --- */
-    /* rotate from previous call */
-    static  int prevrotate = 0;
-    static  double costheta = 1.0,      /* cosine for previous rotate */
-                   sintheta = 0.0; /* and sine for previous rotate */
+    /* --- rotated grid variables (cached in mctx across calls) --- */
+    double  costheta, sintheta;
     /* default aspect ratio */
     double  a = 1.0;
     /* ------------------------------------------------------------
     Initialization
     ------------------------------------------------------------ */
     /* --- refresh trig functions for rotate when it changes --- */
-    if (rotate != prevrotate) {      /* need new sine/cosine */
+    if (rotate != mctx->aaprevrotate) { /* need new sine/cosine */
         /*cos of rotate in radians*/
-        costheta = cos(((double)rotate) / 57.29578);
+        mctx->aacostheta = cos(((double)rotate) / 57.29578);
         /*sin of rotate in radians*/
-        sintheta = sin(((double)rotate) / 57.29578);
-        prevrotate = rotate;
+        mctx->aasintheta = sin(((double)rotate) / 57.29578);
+        mctx->aaprevrotate = rotate;
     }      /* save current rotate as prev */
+    costheta = mctx->aacostheta;
+    sintheta = mctx->aasintheta;
     /* ------------------------------------------------------------
     Calculate aapixel as weighted average over image points around ipixel
     ------------------------------------------------------------ */
@@ -0,0 +1,582 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Program:     bench  [-h htmlfile]  [-f corpusfile]  [-n iterations]
+ *              [-w warmups]  [-s]  [-m]
+ *
+ * Purpose:     Times each stage of mimeTeX's rendering pipeline,
+ *              i.e., mimeprep(), rasterize(), border_raster(),
+ *              each anti-aliasing algorithm, aacolormap(),
+ *              gif_raster() and png_raster(), over a corpus of
+ *              expressions, and reports p50/p99 latency and
+ *              throughput for each stage,
+ *              for each class of expressions and for all of them.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Command-line Arguments:
+ *              --- args can be in any order ---
+ *              -h htmlfile     mimetex.html whose <img src=mimetex.cgi?...>
+ *                              examples are class "html"
+ *                              (defaults to mimetex.html, skipped if missing)
+ *              -f corpusfile   file with one expression per line,
+ *                              which are class "file"
+ *              -n iterations   timed renders of each expression (default 5)
+ *              -w warmups      untimed renders of each expression
+ *                              before timing it (default 1)
+ *              -s              skip the built-in synthetic classes
+ *                              "long", "array", "nested" and "scripts"
+ *              -m              malloc() every raster, instead of
+ *                              allocating them from an arena
+ *                              like mimetex_render() does
+ *
+ * Output:      One tab-separated line per stage and class on stdout,
+ *              preceded by a # comment line identifying the run
+ *              and a header line naming the columns:
+ *                stage class n p50_us p99_us mean_us per_sec
+ *              Stage "total" is mimeprep through gif for mimetex_ctx's
+ *              default anti-aliasing algorithm, i.e., what a render costs.
+ *              Stage "png" encodes the same image as gif does.
+ *
+ * Exits:       0=success,  1=some error
+ *
+ * Source:      bench.c
+ *
+ ****************************************************************************/
+
+/* --------------------------------------------------------------------------
+standard headers, program parameters, global data and macros
+-------------------------------------------------------------------------- */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+/* --- standard headers --- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/* --- application headers --- */
+#include "mimetex.h"
+#include "gifsave.h"
+#include "corpus.h"
+
+/* --- parameters either -D defined on cc line, or defaulted here --- */
+#ifndef HTMLFILE
+#define HTMLFILE "mimetex.html"     /* examples for class "html" */
+#endif
+#ifndef NITERATIONS
+#define NITERATIONS 5               /* timed renders of each expression */
+#endif
+#ifndef NWARMUPS
+#define NWARMUPS 1                  /* untimed renders before timing */
+#endif
+
+/* --- stages of the rendering pipeline --- */
+#define MIMEPREP   (0)
+#define RASTERIZE  (1)
+#define BORDER     (2)
+#define AA1        (3)              /* aalowpass() */
+#define AA2        (4)              /* aapnm() */
+#define AA3        (5)              /* aapnmlookup() */
+#define AA4        (6)              /* aalowpasslookup() */
+#define COLORMAP   (7)
+#define GIF        (8)
+#define PNG        (9)
+#define TOTAL      (10)
+#define NSTAGES    (11)
+static char *stagenames[NSTAGES] = { "mimeprep", "rasterize",
+    "border_raster", "aa1", "aa2", "aa3", "aa4", "aacolormap", "gif", "png",
+    "total" };
+
+/* --- classes of expressions (the last is all of them) --- */
+#define MAXCLASSES (8)
+static char *classnames[MAXCLASSES+1] = { "html", "file", "long",
+    "array", "nested", "scripts", NULL, NULL, "all" };
+#define ALLCLASSES MAXCLASSES
+
+/* -------------------------------------------------------------------------
+expressions to be timed, and their timings
+-------------------------------------------------------------------------- */
+typedef struct benchexpr_struct
+{
+    char  *expression;        /* malloc'ed copy of expression */
+    int   iclass;             /* classnames[] index */
+} benchexpr; /* --- end-of-benchexpr_struct --- */
+
+typedef struct timings_struct
+{
+    int   n, maxn;            /* #samples, #allocated */
+    double *usecs;            /* sample latencies in microseconds */
+    double total;             /* sum of usecs[] */
+} timings; /* --- end-of-timings_struct --- */
+
+static benchexpr *exprs = NULL;     /* corpus */
+static int nexprs = 0, maxexprs = 0;
+static timings stagetimes[NSTAGES][MAXCLASSES+1];
+
+
+/* ==========================================================================
+ * Function:    addexpr ( expression, iclass )
+ * Purpose:     Adds a copy of expression to the corpus
+ * --------------------------------------------------------------------------
+ * Arguments:   expression (I)  char * to null-terminated expression
+ *              iclass (I)      int containing its classnames[] index
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if added, or 0 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o Empty expressions are ignored (and return 1).
+ * ======================================================================= */
+/* --- entry point --- */
+static int addexpr(char *expression, int iclass)
+{
+    char *copy = NULL;
+    if (expression == NULL || *expression == '\000') return (1);
+    if (nexprs >= maxexprs) {           /* need more room */
+        int newmax = (maxexprs < 64 ? 64 : 2 * maxexprs);
+        benchexpr *newexprs = (benchexpr *)realloc(exprs,
+                                 newmax * sizeof(benchexpr));
+        if (newexprs == NULL) return (0);
+        exprs = newexprs;
+        maxexprs = newmax;
+    }
+    if ((copy = (char *)malloc(strlen(expression) + 1)) == NULL) return (0);
+    strcpy(copy, expression);
+    exprs[nexprs].expression = copy;
+    exprs[nexprs].iclass = iclass;
+    nexprs++;
+    return (1);
+} /* --- end-of-function addexpr() --- */
+
+
+/* ==========================================================================
+ * Function:    addhtml ( expression )
+ * Purpose:     Adds an html example to the corpus as class "html"
+ *              (the CORPUSFUNC for corpus_html())
+ * --------------------------------------------------------------------------
+ * Arguments:   expression (I)  char * to null-terminated expression
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if added or skipped, or 0 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o Duplicate examples are skipped.
+ * ======================================================================= */
+/* --- entry point --- */
+static int addhtml(char *expression)
+{
+    int iexpr = 0;
+    for (iexpr = 0; iexpr < nexprs; iexpr++) /* skip duplicates */
+        if (exprs[iexpr].iclass == 0
+                &&   strcmp(exprs[iexpr].expression, expression) == 0)
+            return (1);
+    return (addexpr(expression, 0));
+} /* --- end-of-function addhtml() --- */
+
+
+/* ==========================================================================
+ * Function:    addline ( expression )
+ * Purpose:     Adds a corpus file line to the corpus as class "file"
+ *              (the CORPUSFUNC for corpus_lines())
+ * --------------------------------------------------------------------------
+ * Arguments:   expression (I)  char * to null-terminated expression
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if added, or 0 for any error
+ * ======================================================================= */
+/* --- entry point --- */
+static int addline(char *expression)
+{
+    return (addexpr(expression, 1));
+} /* --- end-of-function addline() --- */
+
+
+/* ==========================================================================
+ * Function:    loadsynthetic ( )
+ * Purpose:     Adds large generated expressions to the corpus,
+ *              in classes "long", "array", "nested" and "scripts"
+ * --------------------------------------------------------------------------
+ * Arguments:   none
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #expressions added
+ * --------------------------------------------------------------------------
+ * Notes:     o These stress what the html examples don't: long rows
+ *              of terms, big arrays, deep nesting and many scripts.
+ * ======================================================================= */
+/* --- entry point --- */
+static int loadsynthetic(void)
+{
+    static char expression[MAXEXPRSZ+1];
+    static int rowterms[] = { 100, 300, 600, 0 };
+    int nadded = 0, nterms = 0, irow = 0, i = 0, j = 0;
+    /* --- long: rows of 100, 300 and 600 terms --- */
+    for (irow = 0; (nterms = rowterms[irow]) > 0; irow++) {
+        *expression = '\000';
+        for (i = 0; i < nterms; i++)
+            sprintf(expression + strlen(expression), "%sx_{%d}",
+                    (i == 0 ? "" : (i % 3 == 0 ? "-" : "+")), i);
+        nadded += addexpr(expression, 2);
+    }
+    /* --- array: 10x10 and 30x8 arrays of fractions --- */
+    for (nterms = 10; nterms <= 30; nterms += 20) {
+        strcpy(expression, "\\left[\\begin{array}{cccccccccc}");
+        for (i = 0; i < nterms; i++)
+            for (j = 0; j < (nterms == 10 ? 10 : 8); j++)
+                sprintf(expression + strlen(expression), "\\frac{%d}{%d}%s",
+                        i + 1, j + 1, (j < (nterms == 10 ? 9 : 7) ? "&" :
+                                       (i < nterms - 1 ? "\\\\" : "")));
+        strcat(expression, "\\end{array}\\right]");
+        nadded += addexpr(expression, 3);
+    }
+    /* --- nested: continued fraction and nested radicals --- */
+    strcpy(expression, "x=");
+    for (i = 0; i < 10; i++)
+        sprintf(expression + strlen(expression), "a_%d+\\frac1{", i);
+    strcat(expression, "a_{10}");
+    for (i = 0; i < 10; i++) strcat(expression, "}");
+    nadded += addexpr(expression, 4);
+    *expression = '\000';
+    for (i = 0; i < 12; i++) strcat(expression, "\\sqrt{1+");
+    strcat(expression, "x");
+    for (i = 0; i < 12; i++) strcat(expression, "}");
+    nadded += addexpr(expression, 4);
+    /* --- scripts: sums of scripted and limit-bearing terms --- */
+    *expression = '\000';
+    for (i = 0; i < 60; i++)
+        sprintf(expression + strlen(expression), "%sa_{i_{%d}}^{k^{%d}}",
+                (i == 0 ? "" : "+"), i, i + 1);
+    nadded += addexpr(expression, 5);
+    *expression = '\000';
+    for (i = 0; i < 20; i++)
+        sprintf(expression + strlen(expression),
+                "\\sum_{n=%d}^{\\infty}\\int_0^{%d}f_n(t)dt", i, i + 1);
+    nadded += addexpr(expression, 5);
+    return (nadded);
+} /* --- end-of-function loadsynthetic() --- */
+
+
+/* ==========================================================================
+ * Function:    usecs ( t0, t1 )
+ * Purpose:     Returns elapsed microseconds from t0 to t1
+ * ======================================================================= */
+/* --- entry point --- */
+static double usecs(struct timespec *t0, struct timespec *t1)
+{
+    return (1.0e6 * (double)(t1->tv_sec - t0->tv_sec)
+            + 1.0e-3 * (double)(t1->tv_nsec - t0->tv_nsec));
+} /* --- end-of-function usecs() --- */
+
+
+/* ==========================================================================
+ * Function:    addtime ( istage, iclass, usec )
+ * Purpose:     Records one latency sample for istage, under iclass
+ *              and under all classes
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if recorded, or 0 for any error
+ * ======================================================================= */
+/* --- entry point --- */
+static int addtime(int istage, int iclass, double usec)
+{
+    int which[2], i = 0;
+    which[0] = iclass;
+    which[1] = ALLCLASSES;
+    for (i = 0; i < 2; i++) {
+        timings *tp = &(stagetimes[istage][which[i]]);
+        if (tp->n >= tp->maxn) {          /* need more room */
+            int newmax = (tp->maxn < 256 ? 256 : 2 * tp->maxn);
+            double *newusecs = (double *)realloc(tp->usecs,
+                                  newmax * sizeof(double));
+            if (newusecs == NULL) return (0);
+            tp->usecs = newusecs;
+            tp->maxn = newmax;
+        }
+        tp->usecs[tp->n++] = usec;
+        tp->total += usec;
+    }
+    return (1);
+} /* --- end-of-function addtime() --- */
+
+
+/* ==========================================================================
+ * Function:    benchrender ( mctx, expression, iclass, istimed )
+ * Purpose:     Renders expression once, stage by stage, recording
+ *              each stage's latency if istimed
+ * --------------------------------------------------------------------------
+ * Arguments:   mctx (I/O)      mimetex_ctx * to context, restored
+ *                              to its entry state before returning
+ *              expression (I)  char * to null-terminated expression
+ *              iclass (I)      int containing expression's class
+ *              istimed (I)     int containing true to record timings
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if rendered, or 0 if rasterize()
+ *                              or an allocation failed
+ * --------------------------------------------------------------------------
+ * Notes:     o This is mimetex_render()'s pipeline, except that every
+ *              anti-aliasing algorithm is run on the same bitmap.
+ * ======================================================================= */
+/* --- entry point --- */
+static int benchrender(mimetex_ctx *mctx, char *expression, int iclass,
+                       int istimed)
+{
+    mimetex_ctx entryctx;               /* restored at end-of-job */
+    static char exprbuffer[MAXEXPRSZ+1];
+    static unsigned char gifbuffer[MAXGIFSZ];
+    char *prepped = NULL;
+    subraster *sp = NULL;
+    raster *bp = NULL;
+    intbyte *bytemaps[4] = { NULL, NULL, NULL, NULL }, *colormap = NULL;
+    intbyte colors[256];
+    double elapsed[NSTAGES];
+    struct timespec t0, t1;
+    int ncolors = 0, nmap = 0, ialg = 0, istage = 0, isokay = 0;
+    int defaultalg = mctx->aaalgorithm;
+    /* --- save context, and copy expression since mimeprep() edits it --- */
+    memcpy((void *)&entryctx, (void *)mctx, sizeof(mimetex_ctx));
+    strninit(exprbuffer, expression, MAXEXPRSZ);
+    for (istage = 0; istage < NSTAGES; istage++) elapsed[istage] = 0.0;
+    /* --- mimeprep(), rasterize(), border_raster() --- */
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    prepped = mimeprep(mctx, exprbuffer);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed[MIMEPREP] = usecs(&t0, &t1);
+    if (prepped == NULL) goto end_of_job;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    sp = rasterize(mctx, prepped, NORMALSIZE);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed[RASTERIZE] = usecs(&t0, &t1);
+    if (sp == NULL) goto end_of_job;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    bp = border_raster(mctx, sp->image, 0, 0, 0, 1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed[BORDER] = usecs(&t0, &t1);
+    if (bp == NULL) goto end_of_job;
+    /* border_raster() freed sp->image */
+    sp->image = bp;
+    /* --- each anti-aliasing algorithm, on the same bitmap --- */
+    nmap = (bp->width) * (bp->height);
+    if ((colormap = (intbyte *)malloc(nmap)) == NULL) goto end_of_job;
+    for (ialg = 0; ialg < 4; ialg++) {
+        int isaa = 0;
+        if ((bytemaps[ialg] = (intbyte *)malloc(nmap)) == NULL) goto end_of_job;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        switch (ialg + 1) {
+        case 1:
+            isaa = aalowpass(mctx, bp, bytemaps[ialg], 256);
+            break;
+        case 2:
+            isaa = aapnm(mctx, bp, bytemaps[ialg], 256);
+            break;
+        case 3:
+            isaa = aapnmlookup(mctx, bp, bytemaps[ialg], 256);
+            break;
+        case 4:
+            isaa = aalowpasslookup(mctx, bp, bytemaps[ialg], 256);
+            break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        elapsed[AA1 + ialg] = usecs(&t0, &t1);
+        if (!isaa) {                    /* no bytemap from this one */
+            free((void *)bytemaps[ialg]);
+            bytemaps[ialg] = NULL;
+        }
+    } /* --- end-of-for(ialg) --- */
+    /* --- colormap from the default algorithm's bytemap, then gif --- */
+    if (defaultalg >= 1 && defaultalg <= 4 && bytemaps[defaultalg-1] != NULL) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        ncolors = aacolormap(mctx, bytemaps[defaultalg-1], nmap, colors, colormap);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        elapsed[COLORMAP] = usecs(&t0, &t1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    gif_raster(mctx, (ncolors >= 2 ? ncolors : 2), bp,
+               (ncolors >= 2 ? colormap : NULL), colors,
+               NULL, gifbuffer, sizeof(gifbuffer));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed[GIF] = usecs(&t0, &t1);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    png_raster(mctx, (ncolors >= 2 ? ncolors : 2), bp,
+               (ncolors >= 2 ? colormap : NULL), colors,
+               NULL, gifbuffer, sizeof(gifbuffer));
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    elapsed[PNG] = usecs(&t0, &t1);
+    /* --- what mimetex_render() would have spent --- */
+    elapsed[TOTAL] = elapsed[MIMEPREP] + elapsed[RASTERIZE] + elapsed[BORDER]
+                     + (defaultalg >= 1 && defaultalg <= 4 ?
+                        elapsed[AA1 + defaultalg - 1] + elapsed[COLORMAP] : 0.0)
+                     + elapsed[GIF];
+    isokay = 1;
+    if (istimed)
+        for (istage = 0; istage < NSTAGES; istage++)
+            if (istage != COLORMAP || ncolors >= 2)
+                if (!addtime(istage, iclass, elapsed[istage])) isokay = 0;
+end_of_job:
+    for (ialg = 0; ialg < 4; ialg++)
+        if (bytemaps[ialg] != NULL) free((void *)bytemaps[ialg]);
+    if (colormap != NULL) free((void *)colormap);
+    if (sp != NULL) delete_subraster(mctx, sp);
+    if (mctx->arena != NULL) reset_arena(mctx->arena);
+    /* restore context */
+    memcpy((void *)mctx, (void *)&entryctx, sizeof(mimetex_ctx));
+    return (isokay);
+} /* --- end-of-function benchrender() --- */
+
+
+/* ==========================================================================
+ * Function:    cmpdouble ( a, b )
+ * Purpose:     qsort() comparison for ascending doubles
+ * ======================================================================= */
+/* --- entry point --- */
+static int cmpdouble(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da < db ? -1 : (da > db ? 1 : 0));
+} /* --- end-of-function cmpdouble() --- */
+
+
+/* ==========================================================================
+ * Function:    percentile ( tp, pct )
+ * Purpose:     Returns the nearest-rank pct-th percentile of tp's
+ *              (already sorted) samples
+ * ======================================================================= */
+/* --- entry point --- */
+static double percentile(timings *tp, double pct)
+{
+    int irank = (int)((pct / 100.0) * (double)tp->n + 0.999999) - 1;
+    if (tp->n < 1) return (0.0);
+    if (irank < 0) irank = 0;
+    if (irank >= tp->n) irank = tp->n - 1;
+    return (tp->usecs[irank]);
+} /* --- end-of-function percentile() --- */
+
+
+/* ==========================================================================
+ * Function:    main ( argc, argv )
+ * Purpose:     Loads the corpus, times it, and reports the results
+ * ======================================================================= */
+/* --- entry point --- */
+int main(int argc, char *argv[])
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    mimetex_ctx mctx;
+    char *htmlfile = HTMLFILE, *corpusfile = NULL;
+    int niterations = NITERATIONS, nwarmups = NWARMUPS, issynthetic = 1;
+    int isarena = 1;
+    int argnum = 0, iexpr = 0, iter = 0, istage = 0, iclass = 0;
+    int nfailed = 0;
+    /* ------------------------------------------------------------
+    interpret command-line arguments
+    ------------------------------------------------------------ */
+    while (argc > ++argnum) {
+        char flag = (*argv[argnum] == '-' ? argv[argnum][1] : '\000');
+        char *value = (argnum + 1 < argc ? argv[argnum+1] : NULL);
+        switch (flag) {
+        default:
+            fprintf(stderr, "Usage: %s [-h htmlfile] [-f corpusfile]"
+                    " [-n iterations] [-w warmups] [-s] [-m]\n", argv[0]);
+            return (1);
+        case 's':
+            issynthetic = 0;
+            continue;
+        case 'm':
+            isarena = 0;
+            continue;
+        case 'h':
+        case 'f':
+        case 'n':
+        case 'w':
+            if (value == NULL) {
+                fprintf(stderr, "%s: -%c needs a value\n", argv[0], flag);
+                return (1);
+            }
+            argnum++;
+            if (flag == 'h') htmlfile = value;
+            if (flag == 'f') corpusfile = value;
+            if (flag == 'n') niterations = atoi(value);
+            if (flag == 'w') nwarmups = atoi(value);
+            break;
+        } /* --- end-of-switch(flag) --- */
+    } /* --- end-of-while(argc>++argnum) --- */
+    if (niterations < 1) niterations = 1;
+    if (nwarmups < 0) nwarmups = 0;
+    /* ------------------------------------------------------------
+    load corpus
+    ------------------------------------------------------------ */
+    if (corpus_html(htmlfile, addhtml) < 0)
+        fprintf(stderr, "%s: can't read %s, skipping html examples\n",
+                argv[0], htmlfile);
+    if (corpusfile != NULL)
+        if (corpus_lines(corpusfile, addline) < 0) {
+            fprintf(stderr, "%s: can't read %s\n", argv[0], corpusfile);
+            return (1);
+        }
+    if (issynthetic) loadsynthetic();
+    if (nexprs < 1) {
+        fprintf(stderr, "%s: no expressions to time\n", argv[0]);
+        return (1);
+    }
+    /* ------------------------------------------------------------
+    time each expression
+    ------------------------------------------------------------ */
+    if (mimetex_ctx_init(&mctx)) {
+        fprintf(stderr, "Failed to initialize context\n");
+        return (1);
+    }
+    if (isarena)
+        if ((mctx.arena = new_arena()) == NULL) {
+            fprintf(stderr, "%s: can't allocate arena\n", argv[0]);
+            return (1);
+        }
+    /* --- gif_raster() reuses one LZW string table, as a server would --- */
+    if ((mctx.gifstrtab = GIF_CreateStrtab()) == NULL) {
+        fprintf(stderr, "%s: can't allocate gif string table\n", argv[0]);
+        return (1);
+    }
+    for (iexpr = 0; iexpr < nexprs; iexpr++) {
+        int isokay = 1;
+        for (iter = 0; iter < nwarmups + niterations; iter++)
+            if (!benchrender(&mctx, exprs[iexpr].expression, exprs[iexpr].iclass,
+                             iter >= nwarmups))
+                isokay = 0;
+        if (!isokay) nfailed++;
+    } /* --- end-of-for(iexpr) --- */
+    /* ------------------------------------------------------------
+    report p50/p99 latency and throughput for each stage and class
+    ------------------------------------------------------------ */
+    printf("# mimetex bench version=%s expressions=%d failed=%d"
+           " iterations=%d warmups=%d aaalgorithm=%d arena=%d\n",
+           VERSION, nexprs, nfailed, niterations, nwarmups, mctx.aaalgorithm,
+           isarena);
+    printf("stage\tclass\tn\tp50_us\tp99_us\tmean_us\tper_sec\n");
+    for (istage = 0; istage < NSTAGES; istage++)
+        for (iclass = 0; iclass <= MAXCLASSES; iclass++) {
+            timings *tp = &(stagetimes[istage][iclass]);
+            if (tp->n < 1 || classnames[iclass] == NULL) continue;
+            qsort(tp->usecs, tp->n, sizeof(double), cmpdouble);
+            printf("%s\t%s\t%d\t%.1f\t%.1f\t%.1f\t%.1f\n",
+                   stagenames[istage], classnames[iclass], tp->n,
+                   percentile(tp, 50.0), percentile(tp, 99.0),
+                   tp->total / (double)tp->n,
+                   (tp->total > 0.0 ? 1.0e6 * (double)tp->n / tp->total : 0.0));
+        }
+    delete_arena(mctx.arena);
+    GIF_DestroyStrtab(mctx.gifstrtab);
+    return (0);
+} /* --- end-of-function main() --- */
@@ -66,6 +66,8 @@ chardef *new_chardef(mimetex_ctx *mctx)
     cp->image.format = 0;
     /* and #bits per pixel */
     cp->image.pixsz = 0;
+    /* packed rows, as in texfonts.h */
+    cp->image.stride = 0;
     /* init raster pixmap as null */
     cp->image.pixmap = NULL;
     /* ------------------------------------------------------------
@@ -105,6 +107,142 @@ int delete_chardef(mimetex_ctx *mctx, chardef *cp)
     return (1);
 } /* --- end-of-function delete_chardef() --- */
 
+/* ---
+ * index of every symtables[] entry, sorted by symbol, shared by all contexts
+ * ------------------------------------------------------------------------ */
+typedef struct symentry_struct {
+    char    *symbol;                /* symdef->symbol */
+    int     symlen;                 /* and its strlen() */
+    int     order;                  /* position in symtables[] search order */
+    mathchardef *symdef;            /* entry in symtables[] */
+} symentry; /* --- end-of-symentry_struct --- */
+typedef struct symindex_struct {
+    int     nsyms;                  /* #entries in syms[] */
+    symentry *syms;                 /* sorted by symbol, then order */
+} symindex; /* --- end-of-symindex_struct --- */
+static symindex *symdefindex = NULL;
+
+/* ---
+ * prefix trie of each family's ligatures, shared by all contexts
+ * -------------------------------------------------------------- */
+#define LIGFAMILIES (16)            /* families 0...15 (and any family) */
+typedef struct lignode_struct {
+    mathchardef *symdef;            /* ligature spelled by path to node */
+    int     kid;                    /* first child node, or 0 if none */
+    int     next;                   /* next sibling node, or 0 if none */
+    int     ch;                     /* char labelling edge to this node */
+} lignode; /* --- end-of-lignode_struct --- */
+typedef struct ligtrie_struct {
+    int     nnodes;                 /* #nodes[] used (nodes[0] unused) */
+    int     kids[256];              /* first node for each leading char */
+    lignode *nodes;                 /* trie nodes */
+} ligtrie; /* --- end-of-ligtrie_struct --- */
+static ligtrie *ligtries[LIGFAMILIES + 1];
+
+/* --- qsort() comparison for symentry's --- */
+static int symentrycmp(const void *a, const void *b)
+{
+    const symentry *sa = (const symentry *)a, *sb = (const symentry *)b;
+    int cmp = strcmp(sa->symbol, sb->symbol);
+    return (cmp != 0 ? cmp : sa->order - sb->order);
+} /* --- end-of-function symentrycmp() --- */
+
+/* ==========================================================================
+ * Function:    get_symindex ( )
+ * Purpose: returns the sorted index of symtables[], building it
+ *      the first time it's wanted
+ * --------------------------------------------------------------------------
+ * Arguments:   none
+ * --------------------------------------------------------------------------
+ * Returns: ( symindex * )  ptr to shared symbol index,
+ *              or NULL for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o Threads building the index concurrently each build one,
+ *      but only one is published; the others are freed.
+ * ======================================================================= */
+/* --- entry point --- */
+static symindex *get_symindex(void)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* index returned to caller */
+    symindex *index = loadshared(&symdefindex);
+    /* symtables[] and entry indexes */
+    int idef = 0, nsyms = 0;
+    mathchardef *symdef = NULL;
+    /* ------------------------------------------------------------
+    build index (unless already built)
+    ------------------------------------------------------------ */
+    if (index != NULL) return (index);   /* already built */
+    /* --- count symtables[] entries --- */
+    for (idef = 0; symtables[idef].table; idef++)
+        for (symdef = symtables[idef].table; symdef->symbol; symdef++)
+            nsyms++;
+    /* --- allocate index --- */
+    if ((index = (symindex *)malloc(sizeof(symindex))) == NULL)
+        return (NULL);
+    if ((index->syms = (symentry *)malloc((nsyms + 1) * sizeof(symentry)))
+            == NULL) {
+        free((void *)index);
+        return (NULL);
+    }
+    /* --- populate it in search order, and sort it --- */
+    index->nsyms = 0;
+    for (idef = 0; symtables[idef].table; idef++)
+        for (symdef = symtables[idef].table; symdef->symbol; symdef++) {
+            symentry *entry = &(index->syms[index->nsyms]);
+            entry->symbol = symdef->symbol;
+            entry->symlen = strlen(symdef->symbol);
+            entry->order = index->nsyms++;
+            entry->symdef = symdef;
+        }
+    qsort((void *)index->syms, index->nsyms, sizeof(symentry), symentrycmp);
+    /* ------------------------------------------------------------
+    publish it
+    ------------------------------------------------------------ */
+    if (!publishshared(&symdefindex, index)) { /* another thread beat us */
+        free((void *)index->syms);
+        free((void *)index);
+        index = loadshared(&symdefindex);
+    }
+    return (index);
+} /* --- end-of-function get_symindex() --- */
+
+/* ==========================================================================
+ * Function:    delete_symindex ( )
+ * Purpose: discards the symbol index and ligature tries, e.g., after
+ *      symtables[] changes, so that they're rebuilt when next wanted
+ * --------------------------------------------------------------------------
+ * Arguments:   none
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully
+ * --------------------------------------------------------------------------
+ * Notes:     o not thread-safe; like changes to symtables[] themselves,
+ *      must only be called before rendering on multiple threads.
+ * ======================================================================= */
+/* --- entry point --- */
+int delete_symindex(void)
+{
+    symindex *index = symdefindex;
+    int islot = 0;
+    symdefindex = NULL;
+    if (index != NULL) {
+        free((void *)index->syms);
+        free((void *)index);
+    }
+    /* --- ligature tries are built from symtables[], too --- */
+    for (islot = 0; islot <= LIGFAMILIES; islot++) {
+        ligtrie *trie = ligtries[islot];
+        ligtries[islot] = NULL;
+        if (trie != NULL) {
+            free((void *)trie->nodes);
+            free((void *)trie);
+        }
+    }
+    return (1);
+} /* --- end-of-function delete_symindex() --- */
+
 /* ==========================================================================
  * Function:    get_symdef ( symbol )
  * Purpose: returns mathchardef struct for symbol
@@ -122,6 +260,9 @@ int delete_chardef(mimetex_ctx *mctx, chardef *cp)
  *      data for \eta rather than \epsilon.  To get \epsilon,
  *      you must pass a leading substring long enough to eliminate
  *      shorter table matches, i.e., in this case \ep
+ *        o Ties go to the first match in symtables[] order.  Lookup is
+ *      a binary search of get_symindex() rather than a scan of
+ *      every symtables[] entry.
  * ======================================================================= */
 /* --- entry point --- */
 mathchardef *get_symdef(mimetex_ctx *mctx, char *symbol)
@@ -131,6 +272,9 @@ mathchardef *get_symdef(mimetex_ctx *mctx, char *symbol)
     ------------------------------------------------------------ */
     /* table of mathchardefs */
     mathchardef *symdef, *bestdef = NULL;
+    /* sorted index of symtables[], and range within it */
+    symindex *index = NULL;
+    int lo = 0, hi = 0, bestorder = 0;
     /* or we may have a ligature */
     int idef = 0;          /* symdefs[] index */
     int symlen = strlen(symbol),    /* length of input symbol */
@@ -176,8 +320,8 @@ mathchardef *get_symdef(mimetex_ctx *mctx, char *symbol)
     /* ------------------------------------------------------------
     If in \displaystyle mode, first xlate int to Bigint, etc.
     ------------------------------------------------------------ */
-    if (mctx->isdisplaystyle > 1) {
-        /* we're in \displaystyle mode */
+    if (mctx->isdisplaystyle > 1 && *symbol == '\\') {
+        /* we're in \displaystyle mode (and symbol might be \int, etc) */
         for (idef = 0; ; idef++) {     /* lookup symbol in displaysyms */
             char *fromsym = displaysyms[idef][0]; /* look for this symbol */
             char *tosym = displaysyms[idef][1]; /* and xlate it to this symbol */
@@ -199,30 +343,39 @@ mathchardef *get_symdef(mimetex_ctx *mctx, char *symbol)
         } /* --- end-of-for(idef) --- */
     }
     /* ------------------------------------------------------------
-    search symdefs[] in order for first occurrence of symbol
+    search index for shortest symdef that symbol is a prefix of
     ------------------------------------------------------------ */
-    for (idef = 0; symtables[idef].table; idef++) {
-        for (symdef = symtables[idef].table; symdef->symbol; symdef++) {
-            /* until trailer record found */
-            /* check against caller's symbol */
-            if (strncmp(symbol, symdef->symbol, symlen) == 0) {
-                /* found match */
-                if ((mctx->fontnum == 0 || family == CYR10)    /* mathmode, so check every match */
-                        || (0 && fontinfo[mctx->fontnum].istext == 1 &&
-                                (!alphasym  /* text mode and not alpha symbol */
-                                 || symdef->handler != NULL)) /* or text mode and directive */
-                        || (symdef->family == family /* have correct family */
-                            && symdef->handler == NULL)) /* and not a handler collision */ {
-                    if ((deflen = strlen(symdef->symbol)) < minlen) {
-                        /*new best match*/
-                        /* save index of new best match */
-                        bestdef = symdef;
-                        /* and save its len for next test */
-                        if ((minlen = deflen) ==  symlen)
-                            /*perfect match, so return with it*/
-                            break;
-                    }
-                }
+    if ((index = get_symindex()) == NULL) goto end_of_job;
+    /* --- binary search for first entry >= symbol --- */
+    lo = 0;
+    hi = index->nsyms;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (strcmp(index->syms[mid].symbol, symbol) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    /* --- entries with symbol as prefix follow contiguously --- */
+    for (; lo < index->nsyms; lo++) {
+        symentry *entry = &(index->syms[lo]);
+        /* past entries matching caller's symbol */
+        if (strncmp(symbol, entry->symbol, symlen) != 0) break;
+        symdef = entry->symdef;
+        /* found match */
+        if ((mctx->fontnum == 0 || family == CYR10)    /* mathmode, so check every match */
+                || (0 && fontinfo[mctx->fontnum].istext == 1 &&
+                        (!alphasym  /* text mode and not alpha symbol */
+                         || symdef->handler != NULL)) /* or text mode and directive */
+                || (symdef->family == family /* have correct family */
+                    && symdef->handler == NULL)) /* and not a handler collision */ {
+            if ((deflen = entry->symlen) < minlen   /*new best match*/
+                    || (deflen == minlen && entry->order < bestorder)) { /*or earlier*/
+                /* save index of new best match */
+                bestdef = symdef;
+                bestorder = entry->order;
+                /* and save its len for next test */
+                if ((minlen = deflen) ==  symlen)
+                    /*perfect match (sorted first, earliest first), so done*/
+                    break;
             }
         }
     }
@@ -253,6 +406,101 @@ end_of_job:
     return bestdef;
 } /* --- end-of-function get_symdef() --- */
 
+/* ==========================================================================
+ * Function:    get_ligtrie ( family )
+ * Purpose: returns the prefix trie of ligatures for family,
+ *      building it the first time it's wanted
+ * --------------------------------------------------------------------------
+ * Arguments:   family (I)  int containing NOVALUE for any family,
+ *              or, e.g., CYR10 for cyrillic, etc.
+ * --------------------------------------------------------------------------
+ * Returns: ( ligtrie * )   ptr to shared trie,
+ *              or NULL for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o A node's symdef is the first symtables[] entry spelling
+ *      that node's path, so longer ligatures are deeper in the trie.
+ *        o Threads building the same trie concurrently each build one,
+ *      but only one is published; the others are freed.
+ * ======================================================================= */
+/* --- entry point --- */
+static ligtrie *get_ligtrie(int family)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* trie returned to caller, and its slot in ligtries[] */
+    ligtrie *trie = NULL, **slot = NULL;
+    /* true for cyrillic families */
+    int iscyrfam = (family == CYR10);
+    /* symtables[] index, upper bound on #nodes */
+    int idef = 0, maxnodes = 1;
+    mathchardef *symdef = NULL;
+    /* ------------------------------------------------------------
+    look up trie (unless family isn't cached)
+    ------------------------------------------------------------ */
+    if (family >= LIGFAMILIES) return (NULL);  /* no such family */
+    slot = &(ligtries[family < 0 ? 0 : family + 1]);
+    if ((trie = loadshared(slot)) != NULL) return (trie);  /* already built */
+    /* ------------------------------------------------------------
+    build trie from family's entries in symtables[] order
+    ------------------------------------------------------------ */
+    /* --- upper bound on #nodes is total length of all symbols --- */
+    for (idef = 0; symtables[idef].table; idef++)
+        for (symdef = symtables[idef].table; symdef->symbol; symdef++)
+            maxnodes += strlen(symdef->symbol);
+    /* --- allocate trie --- */
+    if ((trie = (ligtrie *)malloc(sizeof(ligtrie))) == NULL)
+        return (NULL);
+    if ((trie->nodes = (lignode *)malloc(maxnodes * sizeof(lignode)))
+            == NULL) {
+        free((void *)trie);
+        return (NULL);
+    }
+    trie->nnodes = 1;
+    memset((void *)trie->kids, 0, sizeof(trie->kids));
+    /* --- insert every symbol that could be a ligature --- */
+    for (idef = 0; symtables[idef].table; idef++) {
+        /* skip handler tables */
+        if (symtables[idef].family == NOVALUE)
+            continue;
+        for (symdef = symtables[idef].table; symdef->symbol; symdef++) {
+            unsigned char *symbol = (unsigned char *)symdef->symbol;
+            /* head of current node's child list */
+            int *kids = &(trie->kids[*symbol]), inode = 0;
+            if ((symbol[0] == '\000' || symbol[1] == '\000') && !iscyrfam)
+                continue;     /* ligature >1 char long or cyrillic */
+            if (*symbol == '\\' && !iscyrfam)
+                continue;     /* not escaped or cyrillic */
+            if (family >= 0 && symdef->family != family)
+                continue;     /* or have wrong family */
+            for (; *symbol; symbol++) {  /* walk (or grow) path to symbol */
+                for (inode = *kids; inode != 0; inode = trie->nodes[inode].next)
+                    if (trie->nodes[inode].ch == *symbol) break;
+                if (inode == 0) {        /* no child for this char yet */
+                    lignode *node = &(trie->nodes[inode = trie->nnodes++]);
+                    node->symdef = NULL;
+                    node->kid = 0;
+                    node->next = *kids;
+                    node->ch = *symbol;
+                    *kids = inode;
+                }
+                kids = &(trie->nodes[inode].kid);
+            } /* --- end-of-for(symbol) --- */
+            if (trie->nodes[inode].symdef == NULL) /* first occurrence wins */
+                trie->nodes[inode].symdef = symdef;
+        } /* --- end-of-for(symdef) --- */
+    } /* --- end-of-for(idef) --- */
+    /* ------------------------------------------------------------
+    publish it
+    ------------------------------------------------------------ */
+    if (!publishshared(slot, trie)) {    /* another thread beat us */
+        free((void *)trie->nodes);
+        free((void *)trie);
+        trie = loadshared(slot);
+    }
+    return (trie);
+} /* --- end-of-function get_ligtrie() --- */
+
 /* ==========================================================================
  * Function:    get_ligature ( expression, family )
  * Purpose: returns symtable[] index for ligature
@@ -262,10 +510,11 @@ end_of_job:
  *      family (I)  int containing NOVALUE for any family,
  *              or, e.g., CYR10 for cyrillic, etc.
  * --------------------------------------------------------------------------
- * Returns: ( int )     symtable[] index defining ligature,
- *              or -9999 if no ligature found or for any error
+ * Returns: ( mathchardef * ) symtable[] entry defining longest
+ *              ligature, or NULL if none found or for any error
  * --------------------------------------------------------------------------
- * Notes:     o
+ * Notes:     o Matches by walking expression down get_ligtrie(family),
+ *      so each call looks at each char of the ligature once.
  * ======================================================================= */
 /* --- entry point --- */
 mathchardef *get_ligature(mimetex_ctx *mctx, char *expression, int family)
@@ -273,55 +522,37 @@ mathchardef *get_ligature(mimetex_ctx *mctx, char *expression, int family)
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
-    /* table of mathchardefs */
-    mathchardef *symdef, *bestdef = NULL;
-    char    *ligature = expression /*- 1*/, /* expression ptr */
-            *symbol = NULL; /* symdefs[idef].symbol */
-    /* #chars remaining in expression */
-    int liglen = strlen(ligature);
-    /* true for cyrillic families */
-    int iscyrfam = (family == CYR10);
-    int idef = 0, /* symdefs[] index */
-        maxlen = (-9999); /*length of longest matching symdef*/
+    /* longest ligature found */
+    mathchardef *bestdef = NULL;
+    unsigned char *ligature = (unsigned char *)expression; /* expression ptr */
+    /* family's ligatures, and trie node */
+    ligtrie *trie = NULL;
+    int inode = 0;
     /* ------------------------------------------------------------
-    search symdefs[] in order for first occurrence of symbol
+    walk trie along expression, remembering deepest ligature
     ------------------------------------------------------------ */
-    if (!mctx->isstring) {
-        for (idef = 0; symtables[idef].table; idef++) {
-            /* skip handler tables */
-            if (symtables[idef].family == NOVALUE)
-                continue;
-            /* no ligatures in "string" mode */
-            for (symdef = symtables[idef].table; symdef->symbol; symdef++) {
-                /* #chars in symbol */
-                int symlen = strlen(symbol);
-                if ((symlen > 1 || iscyrfam)  /*ligature >1 char long or cyrillic*/
-                        &&   symlen <= liglen       /* and enough remaining chars */
-                        && (*symbol != '\\' || iscyrfam)) /* not escaped or cyrillic */ {
-                    if (strncmp(ligature, symbol, symlen) == 0) {
-                        /* found match */
-                        if (family < 0             /* no family specifies */
-                                ||   symdef->family == family) {  /* or have correct family */
-                            if (symlen > maxlen) {        /* new longest ligature */
-                                /* save index of new best match */
-                                bestdef = symdef;
-                                /* and save its len for next test */
-                                maxlen = symlen;
-                            }
-                        }
-                    }
-                } /* --- end-of-if/else(symbol==NULL) --- */
-            }
-        }
+    if (!mctx->isstring) {               /* no ligatures in "string" mode */
+        if ((trie = get_ligtrie(family)) != NULL)
+            for (inode = trie->kids[*ligature]; inode != 0 && *ligature; ) {
+                lignode *node = &(trie->nodes[inode]);
+                if (node->ch != *ligature) {  /* try next sibling */
+                    inode = node->next;
+                    continue;
+                }
+                if (node->symdef != NULL)     /* new longest ligature */
+                    bestdef = node->symdef;
+                inode = node->kid;             /* down to next char */
+                ligature++;
+            } /* --- end-of-for(inode) --- */
         if (mctx->msgfp != NULL && mctx->msglevel >= 999) { /* debugging output */
             if (bestdef)
-                fprintf(mctx->msgfp, "get_ligature> ligature=%.4s is matched to symbol %s\n", ligature, bestdef->symbol);
+                fprintf(mctx->msgfp, "get_ligature> ligature=%.4s is matched to symbol %s\n", expression, bestdef->symbol);
             else
-                fprintf(mctx->msgfp, "get_ligature> ligature=%.4s is not matched to any symbol\n", ligature);
+                fprintf(mctx->msgfp, "get_ligature> ligature=%.4s is not matched to any symbol\n", expression);
             fflush(mctx->msgfp);
         }
     } /* --- end-of-if(!mctx->isstring) --- */
-    /* -9999 or index of best symdef[] */
+    /* NULL or longest ligature */
     return bestdef;
 } /* --- end-of-function get_ligature --- */
 
@@ -334,21 +565,24 @@ mathchardef *get_ligature(mimetex_ctx *mctx, char *expression, int family)
  *              whose corresponding chardef is wanted
  *      size (I)    int containing 0-5 for desired size
  * --------------------------------------------------------------------------
- * Returns: ( chardef * )   pointer to struct defining symbol at size,
+ * Returns: ( const chardef * ) pointer to struct defining symbol at size,
  *              or NULL for any error
  * --------------------------------------------------------------------------
  * Notes:     o if size unavailable, the next-closer-to-normalsize
  *      is returned instead.
+ *        o the returned chardef points into the read-only font tables,
+ *      and must never be modified (see cmex_botrow() for the
+ *      CMEX10 metric correction formerly applied here).
  * ======================================================================= */
 /* --- entry point --- */
-chardef *get_chardef(mimetex_ctx *mctx, mathchardef *symdef, int size)
+const chardef *get_chardef(mimetex_ctx *mctx, mathchardef *symdef, int size)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* table of font families */
     fontfamily  *fonts = mctx->fonttable;
-    chardef **fontdef,          /*tables for desired font, by size*/
+    const chardef **fontdef,    /*tables for desired font, by size*/
     /* chardef for symdef,size */
     *gfdata = (chardef *)NULL;
     /* fonts[] index */
@@ -357,10 +591,6 @@ chardef *get_chardef(mimetex_ctx *mctx, mathchardef *symdef, int size)
     int family, charnum;
     int sizeinc = 0,    /*+1 or -1 to get closer to normal*/
         normalsize = 2; /* this size always present */
-    /*true if symbol's 1st char is upper*/
-    int isBig = 0;
-    /* look for 1st alpha of symbol */
-    char    *symptr = NULL;
     /* ------------------------------------------------------------
     initialization
     ------------------------------------------------------------ */
@@ -381,21 +611,6 @@ chardef *get_chardef(mimetex_ctx *mctx, mathchardef *symdef, int size)
     if (size < normalsize) sizeinc = (+1);
     /*or next smaller if size too large*/
     if (size > normalsize) sizeinc = (-1);
-    /* --- check for really big symbol (1st char of symbol name uppercase) --- */
-    for (symptr = symdef->symbol; *symptr != '\000'; symptr++) {
-        /*skip leading \'s*/
-        if (isalpha(*symptr)) {        /* found leading alpha char */
-            /* is 1st char of name uppercase? */
-            isBig = isupper(*symptr);
-            if (!isBig             /* 1st char lowercase */
-                    &&   strlen(symptr) >= 4)     /* but followed by at least 3 chars */
-                isBig = !memcmp(symptr, "big\\", 4) /* isBig if name starts with big\ */
-                        /* or with bigg */
-                        || !memcmp(symptr, "bigg", 4);
-                /* don't check beyond 1st char */
-                break;
-        }
-    }
     /* ------------------------------------------------------------
     find font family in table of fonts[]
     ------------------------------------------------------------ */
@@ -443,15 +658,6 @@ chardef *get_chardef(mimetex_ctx *mctx, mathchardef *symdef, int size)
     /*ptr to chardef for symbol in size*/
     gfdata = &((fontdef[size])[charnum]);
     /* ------------------------------------------------------------
-    kludge to tweak CMEX10 (which appears to have incorrect descenders)
-    ------------------------------------------------------------ */
-    if (family == CMEX10) {          /* cmex10 needs tweak */
-        /*total height of char*/
-        int height = gfdata->toprow - gfdata->botrow + 1;
-        gfdata->botrow = (isBig ? (-height / 3) : (-height / 4));
-        gfdata->toprow = gfdata->botrow + gfdata->image.height;
-    }
-    /* ------------------------------------------------------------
     return subraster containing chardef data for symbol in requested size
     ------------------------------------------------------------ */
 end_of_job:
@@ -466,6 +672,56 @@ end_of_job:
     return (gfdata);
 } /* --- end-of-function get_chardef() --- */
 
+/* ==========================================================================
+ * Function:    cmex_botrow ( symdef, gfdata )
+ * Purpose: returns corrected botrow for a CMEX10 chardef,
+ *      whose descenders appear to be incorrect in the .gf files
+ * --------------------------------------------------------------------------
+ * Arguments:   symdef (I)  mathchardef *  for symbol whose chardef
+ *              is gfdata (decides how far it descends)
+ *      gfdata (I)  const chardef * for symdef at some size
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     corrected botrow, descending 1/3 of the
+ *              char's height for \Big-like symbols, else 1/4
+ * --------------------------------------------------------------------------
+ * Notes:     o The correction depends on the symbol name as well as
+ *      the glyph (several symbols share one cmex10 char), so it's
+ *      computed here rather than patched into the font tables,
+ *      which are const and shared by all contexts and threads.
+ * ======================================================================= */
+/* --- entry point --- */
+static int cmex_botrow(mathchardef *symdef, const chardef *gfdata)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /*total height of char*/
+    int height = gfdata->toprow - gfdata->botrow + 1;
+    /*true if symbol's 1st char is upper*/
+    int isBig = 0;
+    /* look for 1st alpha of symbol */
+    char    *symptr = NULL;
+    /* ------------------------------------------------------------
+    check for really big symbol (1st char of symbol name uppercase)
+    ------------------------------------------------------------ */
+    for (symptr = symdef->symbol; *symptr != '\000'; symptr++) {
+        /*skip leading \'s*/
+        if (isalpha(*symptr)) {        /* found leading alpha char */
+            /* is 1st char of name uppercase? */
+            isBig = isupper(*symptr);
+            if (!isBig             /* 1st char lowercase */
+                    &&   strlen(symptr) >= 4)     /* but followed by at least 3 chars */
+                isBig = !memcmp(symptr, "big\\", 4) /* isBig if name starts with big\ */
+                        /* or with bigg */
+                        || !memcmp(symptr, "bigg", 4);
+                /* don't check beyond 1st char */
+                break;
+        }
+    }
+    return (isBig ? (-height / 3) : (-height / 4));
+} /* --- end-of-function cmex_botrow() --- */
+
+
 /* ==========================================================================
  * Function:    get_baseline ( gfdata )
  * Purpose: returns baseline for a chardef struct
@@ -483,7 +739,7 @@ end_of_job:
  *      and everything else descends below the baseline.
  * ======================================================================= */
 /* --- entry point --- */
-int get_baseline(mimetex_ctx *mctx, chardef *gfdata)
+int get_baseline(mimetex_ctx *mctx, const chardef *gfdata)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
@@ -502,6 +758,143 @@ int get_baseline(mimetex_ctx *mctx, chardef *gfdata)
 } /* --- end-of-function get_baseline() --- */
 
 
+/* ---
+ * process-wide cache of decoded .gf-format (format 2,3) and unpacked
+ * (format 1) chardef bitmaps, along with their edge profiles for
+ * rastsmash(), indexed by family, size, charnum, and shared by all contexts
+ * ---------------------------------------------------------------------- */
+#define GLYPHFAMILIES (16)          /* families 0...15 */
+#define GLYPHCHARS    (256)         /* charnums 0...255 */
+typedef struct glyphbitmap_struct {
+    const chardef *gfdata;          /* chardef that was decoded */
+    raster  *bitmap;                /* its decoded bitmap, never freed */
+    edgeprofile *edges;             /* and the bitmap's edges */
+} glyphbitmap; /* --- end-of-glyphbitmap_struct --- */
+static glyphbitmap *glyphcache[GLYPHFAMILIES][LARGESTSIZE+1][GLYPHCHARS];
+
+/* ==========================================================================
+ * Function:    get_glyphbitmap ( family, size, gfdata )
+ * Purpose: returns the decoded bitmap for a .gf-format chardef,
+ *      or the unpacked bitmap for a packed one, converting it
+ *      with gftobitmap() (and finding its edges) the first
+ *      time it's wanted
+ * --------------------------------------------------------------------------
+ * Arguments:   family (I)  int containing font family of gfdata
+ *      size (I)    int containing font size 0-7 of gfdata
+ *      gfdata (I)  const chardef * whose image is format 1, 2 or 3
+ * --------------------------------------------------------------------------
+ * Returns: ( glyphbitmap * ) ptr to shared, read-only cache entry,
+ *              whose bitmap and edges are attached to
+ *              subrasters, or NULL for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o The returned bitmap belongs to the cache, so callers must
+ *      embed it in a GLYPHRASTER or CHARASTER subraster (which
+ *      delete_subraster() won't free) and never modify it,
+ *      which is what keeps its edge profile valid.
+ *        o Threads decoding the same glyph concurrently both decode it,
+ *      but only one bitmap is published; the other is freed.
+ *        o Returns NULL for chardefs outside the cache's index range
+ *      (or from a different fonttable than the cached one), which
+ *      the caller must then decode itself.
+ * ======================================================================= */
+/* --- entry point --- */
+static glyphbitmap *get_glyphbitmap(mimetex_ctx *mctx, int family, int size,
+                                    const chardef *gfdata)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* cache slot for family,size,charnum */
+    glyphbitmap **slot = NULL, *glyph = NULL;
+    /* mctx->arena, detached while decoding */
+    mimetex_arena *arena = NULL;
+    /* charnum of gfdata */
+    int charnum = gfdata->charnum;
+    /* ------------------------------------------------------------
+    look up glyph in cache
+    ------------------------------------------------------------ */
+    if (family >= 0 && family < GLYPHFAMILIES       /* family within cache */
+            && size >= 0 && size <= LARGESTSIZE    /* and size */
+            && charnum >= 0 && charnum < GLYPHCHARS) { /* and charnum */
+        slot = &(glyphcache[family][size][charnum]);
+        if ((glyph = loadshared(slot)) != NULL /* already decoded */
+                &&   glyph->gfdata == gfdata)       /* from the same chardef */
+            return (glyph);
+    } /* --- end-of-if(family,size,charnum) --- */
+    /* ------------------------------------------------------------
+    decode glyph and publish it in the cache
+    ------------------------------------------------------------ */
+    if (slot == NULL || glyph != NULL)   /* can't (or won't) cache it */
+        return (NULL);                    /* caller decodes it himself */
+    if ((glyph = (glyphbitmap *)malloc(sizeof(glyphbitmap))) == NULL)
+        return (NULL);
+    glyph->gfdata = gfdata;
+    arena = mctx->arena;                 /* cached bitmap outlives render */
+    mctx->arena = (mimetex_arena *)NULL;  /* so it mustn't come from arena */
+    glyph->bitmap = gftobitmap(mctx, &(gfdata->image));
+    glyph->edges = (glyph->bitmap == NULL ? NULL :
+                    new_edgeprofile(mctx, glyph->bitmap));
+    if (glyph->edges == NULL) {          /* failed to decode */
+        delete_raster(mctx, glyph->bitmap);
+        mctx->arena = arena;
+        free((void *)glyph);
+        return (NULL);
+    }
+    if (!publishshared(slot, glyph)) {    /* another thread published first */
+        delete_edgeprofile(mctx, glyph->edges); /* so discard ours */
+        delete_raster(mctx, glyph->bitmap);
+        mctx->arena = arena;
+        free((void *)glyph);
+        glyph = loadshared(slot);          /* and use its bitmap */
+        return (glyph->gfdata == gfdata ? glyph : NULL);
+    }
+    mctx->arena = arena;
+    return (glyph);
+} /* --- end-of-function get_glyphbitmap() --- */
+
+
+/* ==========================================================================
+ * Function:    mimetex_warm_glyphs ( mctx )
+ * Purpose: decodes (or unpacks) every chardef in mctx->fonttable into
+ *      the glyph cache, so that get_charsubraster() never has to
+ * --------------------------------------------------------------------------
+ * Arguments:   mctx (I)    mimetex_ctx * whose fonttable is to be decoded
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #glyphs now in the cache, or -1 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o optional; call once at startup to move decoding cost
+ *      out of the first requests (and out of the worker processes,
+ *      if called before forking).
+ * ======================================================================= */
+/* --- entry point --- */
+int mimetex_warm_glyphs(mimetex_ctx *mctx)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* table of font families */
+    fontfamily  *fonts = mctx->fonttable;
+    /* chardef within fontdef[size] */
+    const chardef *gfdata = NULL;
+    /* fonts[] index, size, #glyphs cached */
+    int ifont, size, nglyphs = 0;
+    /* ------------------------------------------------------------
+    decode (or unpack) each chardef in each family and size
+    ------------------------------------------------------------ */
+    for (ifont = 0; fonts[ifont].family >= 0; ifont++)  /* each family */
+        for (size = 0; size <= LARGESTSIZE; size++) {   /* each size */
+            if (fonts[ifont].fontdef[size] == NULL) continue; /* no such size */
+            for (gfdata = fonts[ifont].fontdef[size];    /* each chardef */
+                    gfdata->charnum >= 0; gfdata++) {     /* until trailer */
+                if (get_glyphbitmap(mctx, fonts[ifont].family, size, gfdata)
+                        == NULL) return (-1);             /* failed to decode */
+                nglyphs++;
+            }
+        } /* --- end-of-for(ifont,size) --- */
+    return (nglyphs);
+} /* --- end-of-function mimetex_warm_glyphs() --- */
+
+
 /* ==========================================================================
  * Function:    get_charsubraster ( symdef, size )
  * Purpose: returns new subraster ptr containing
@@ -515,6 +908,12 @@ int get_baseline(mimetex_ctx *mctx, chardef *gfdata)
  *              or NULL for any error
  * --------------------------------------------------------------------------
  * Notes:     o just wraps a subraster envelope around get_chardef()
+ *        o .gf-format chardefs are decoded once, by get_glyphbitmap(),
+ *      and handed out as shared GLYPHRASTERs, which delete_subraster()
+ *      doesn't free (like CHARASTERs) but rastcat() lays out like the
+ *      IMAGERASTERs they used to be.
+ *        o packed (format 1) chardef bitmaps are likewise unpacked
+ *      once, into rows padded to BITSTRIDE, but stay CHARASTERs.
  * ======================================================================= */
 /* --- entry point --- */
 subraster *get_charsubraster(mimetex_ctx *mctx, mathchardef *symdef, int size)
@@ -523,11 +922,13 @@ subraster *get_charsubraster(mimetex_ctx *mctx, mathchardef *symdef, int size)
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* chardef struct for symdef,size */
-    chardef *gfdata = NULL;
+    const chardef *gfdata = NULL;
     /* subraster containing gfdata */
     subraster *sp = NULL;
     /* convert .gf-format to bitmap */
     raster  *bitmaprp = NULL;
+    /* cached bitmap and its edges */
+    glyphbitmap *glyph = NULL;
     /* ------------------------------------------------------------
     look up chardef for symdef at size, and embed data (gfdata) in subraster
     ------------------------------------------------------------ */
@@ -535,8 +936,8 @@ subraster *get_charsubraster(mimetex_ctx *mctx, mathchardef *symdef, int size)
             !=   NULL)              /* and check that we found it */
         if ((sp = new_subraster(mctx, 0, 0, 0))   /* allocate subraster "envelope" */
                 !=   NULL) {               /* and check that we succeeded */
-            /* ptr to chardef's bitmap or .gf */
-            raster *image = &(gfdata->image);
+            /* ptr to chardef's bitmap or .gf (read-only font table) */
+            const raster *image = &(gfdata->image);
             /* 1=bitmap, else .gf */
             int format = image->format;
             /* replace NULL with caller's arg */
@@ -545,13 +946,18 @@ subraster *get_charsubraster(mimetex_ctx *mctx, mathchardef *symdef, int size)
             sp->size = size;
             /* get baseline of character */
             sp->baseline = get_baseline(mctx, gfdata);
-            if (format == 1) {         /* already a bitmap */
-                /* static char raster */
-                sp->type = CHARASTER;
-                /* store ptr to its bitmap */
-                sp->image = image;
+            if (symdef->family == CMEX10) /* cmex10 needs tweak */
+                sp->baseline = (image->height - 1) + cmex_botrow(symdef, gfdata);
+            if ((glyph = get_glyphbitmap(mctx, symdef->family,
+                                         size, gfdata)) != NULL) {
+                /* decoded once, shared by everyone */
+                sp->type = (format == 1 ? CHARASTER : GLYPHRASTER);
+                /* store ptr to cached bitmap (never modified) */
+                sp->image = glyph->bitmap;
+                /* and its edges, for rastsmash() */
+                sp->edges = glyph->edges;
             } else {
-                /* need to convert .gf-to-bitmap */
+                /* need to convert .gf (or packed bitmap) */
                 if ((bitmaprp = gftobitmap(mctx, image))    /* convert */
                         != (raster *)NULL) {         /* successful */
                     /* allocated raster will be freed */
@@ -652,7 +1058,7 @@ subraster *get_delim(mimetex_ctx *mctx, char *symbol, int height, int family)
     /* best match char */
     subraster *sp = (subraster *)NULL;
     /* get chardef struct for a symdef */
-    chardef *gfdata = NULL;
+    const chardef *gfdata = NULL;
     char    lcsymbol[256], *symptr,     /* lowercase symbol for comparison */
     /* unescaped symbol */
     *unescsymbol = symbol;
@@ -729,7 +1135,7 @@ subraster *get_delim(mimetex_ctx *mctx, char *symbol, int height, int family)
                 strcpy(lcsymbol, defsym);
                 if (isunesc && *lcsymbol == '\\')    /* ignored leading \ in symbol */
                     /* so squeeze it out of lcsymbol too*/
-                    strcpy(lcsymbol, lcsymbol + 1);
+                    strsqueeze(lcsymbol, 1);
                 if (0)               /* don't ignore case */
                     for (symptr = lcsymbol; *symptr != '\000'; symptr++) /*for each symbol ch*/
                         /*lowercase the char*/
@@ -0,0 +1,147 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Purpose:     Reads the expressions that the noinst test programs
+ *              (stress, bench) render (see corpus.h).
+ *
+ * Functions:   corpus_html(filename,addexpr)   mimetex.cgi? examples
+ *                                              in an html file
+ *              corpus_lines(filename,addexpr)  one expression per line
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mimetex.h"
+#include "corpus.h"
+
+
+/* ==========================================================================
+ * Function:    corpus_html ( filename, addexpr )
+ * Purpose:     Hands addexpr() the expression in each mimetex.cgi?expression
+ *              example of an html file, e.g., mimetex.html
+ * --------------------------------------------------------------------------
+ * Arguments:   filename (I)    char * to name of html file
+ *              addexpr (I)     CORPUSFUNC keeping each expression
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #expressions handed to addexpr(),
+ *                              or -1 if filename couldn't be read
+ * --------------------------------------------------------------------------
+ * Notes:     o An example runs from mimetex.cgi? to the closing quote.
+ *              Newlines become blanks, and &lt; &gt; &quot; &amp; are
+ *              decoded as a browser would before sending the query.
+ *            o Empty examples, and php snippets building urls,
+ *              are skipped.
+ * ======================================================================= */
+/* --- entry point --- */
+int corpus_html(char *filename, CORPUSFUNC addexpr)
+{
+    FILE *fp = fopen(filename, "rb");
+    char *html = NULL, *cgi = NULL, *expression = NULL;
+    long nbytes = 0;
+    int nadded = 0;
+    /* --- read entire file --- */
+    if (fp == NULL) return (-1);
+    fseek(fp, 0L, SEEK_END);
+    nbytes = ftell(fp);
+    fseek(fp, 0L, SEEK_SET);
+    if (nbytes < 0
+            || (html = (char *)malloc(nbytes + 1)) == NULL
+            || (expression = (char *)malloc(nbytes + 1)) == NULL) {
+        fclose(fp);
+        if (html != NULL) free((void *)html);
+        return (-1);
+    }
+    nbytes = fread(html, 1, nbytes, fp);
+    html[nbytes] = '\000';
+    fclose(fp);
+    /* --- extract each mimetex.cgi?expression --- */
+    for (cgi = strstr(html, "mimetex.cgi?"); cgi != NULL;
+            cgi = strstr(cgi, "mimetex.cgi?")) {
+        char *ptr = (cgi += strlen("mimetex.cgi?")), *exprptr = expression;
+        while (*ptr != '\000' && *ptr != '\"') {
+            if (*ptr == '\n' || *ptr == '\r' || *ptr == '\t')
+                *exprptr++ = ' ';
+            else if (*ptr == '&' && strncmp(ptr, "&lt;", 4) == 0) {
+                *exprptr++ = '<';
+                ptr += 3;
+            } else if (*ptr == '&' && strncmp(ptr, "&gt;", 4) == 0) {
+                *exprptr++ = '>';
+                ptr += 3;
+            } else if (*ptr == '&' && strncmp(ptr, "&quot;", 6) == 0) {
+                *exprptr++ = '\"';
+                ptr += 5;
+            } else if (*ptr == '&' && strncmp(ptr, "&amp;", 5) == 0) {
+                *exprptr++ = '&';
+                ptr += 4;
+            } else
+                *exprptr++ = *ptr;
+            ptr++;
+        } /* --- end-of-while(*ptr!='\"') --- */
+        *exprptr = '\000';
+        if (*expression == '\000') continue;
+        if (strchr(expression, '\'') != NULL) continue; /* php snippet */
+        if (!addexpr(expression)) break;
+        nadded++;
+    } /* --- end-of-for(cgi) --- */
+    free((void *)html);
+    free((void *)expression);
+    return (nadded);
+} /* --- end-of-function corpus_html() --- */
+
+
+/* ==========================================================================
+ * Function:    corpus_lines ( filename, addexpr )
+ * Purpose:     Hands addexpr() each line of filename
+ * --------------------------------------------------------------------------
+ * Arguments:   filename (I)    char * to name of corpus file
+ *              addexpr (I)     CORPUSFUNC keeping each expression
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #expressions handed to addexpr(),
+ *                              or -1 if filename couldn't be read
+ * --------------------------------------------------------------------------
+ * Notes:     o Blank lines, and lines starting with #, are skipped.
+ *            o Lines are truncated to MAXEXPRSZ chars.
+ * ======================================================================= */
+/* --- entry point --- */
+int corpus_lines(char *filename, CORPUSFUNC addexpr)
+{
+    FILE *fp = fopen(filename, "r");
+    static char line[MAXEXPRSZ+2];
+    int nadded = 0;
+    if (fp == NULL) return (-1);
+    while (fgets(line, MAXEXPRSZ + 1, fp) != NULL) {
+        int len = strlen(line);
+        while (len > 0 && (line[len-1] == '\n' || line[len-1] == '\r'))
+            line[--len] = '\000';
+        if (*line == '#' || len < 1) continue;
+        if (!addexpr(line)) break;
+        nadded++;
+    }
+    fclose(fp);
+    return (nadded);
+} /* --- end-of-function corpus_lines() --- */
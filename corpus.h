@@ -0,0 +1,16 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+/* ---
+ * Expressions for the noinst test programs (stress, bench) to render,
+ * read from the mimetex.cgi? examples of an html file like mimetex.html,
+ * or from a file with one expression per line.  Each expression found is
+ * handed to the caller's CORPUSFUNC, which keeps a copy (or skips it),
+ * and returns 1 to go on, or 0 to stop for an error.
+ * --------------------------------------------------------------------- */
+typedef int (*CORPUSFUNC)(char *expression);
+
+int corpus_html(char *filename, CORPUSFUNC addexpr);
+int corpus_lines(char *filename, CORPUSFUNC addexpr);
+
+#endif /* CORPUS_H */
@@ -0,0 +1,563 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Purpose:     On-disk cache of rendered images, shared by every mimetex
+ *              process given the same cachepath (see diskcache.h).
+ *
+ * Functions:   diskcache_key(mctx,opts,expression,key)   versioned key
+ *              diskcache_file(cachepath,key,cachefile)   image's path
+ *              diskcache_get(cachepath,key,image,maxbytes) reads image
+ *              diskcache_put(cachepath,key,image,nbytes,maxbytes)
+ *                                                        writes image
+ *
+ * Notes:     o cachepath/ab/cd/key is either absent or complete, since
+ *              diskcache_put() writes cd/.tmp.pid.n and rename()'s it.
+ *              An image removed while it's being read is still read.
+ *            o A read is indexed (and the image's mtime set) only if
+ *              the image's mtime is DISKCACHETOUCH secs old, so a hot
+ *              image costs one index line an hour.
+ *            o An index starts with a header line giving its shard's
+ *              #bytes of images, and its own #bytes, when rewritten.
+ *              After indexing a new image, diskcache_put() adds up
+ *              the images indexed since, and rewrites the index (first
+ *              removing least recently used images) if they're over
+ *              budget, or if DISKCACHEMAXLOG bytes were appended.
+ *              Other processes skip a shard while it's being rewritten.
+ *            o Without <sys/file.h>, there's no flock(), so only one
+ *              mimetex at a time should use a cachepath.
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "mimetex.h"
+#include "md5.h"
+#include "imgcache.h"
+#include "diskcache.h"
+
+#ifdef HAVE_SYS_FILE_H
+#include <sys/file.h>
+#define lockindex(fd,how)   flock((fd), (how))
+#else
+#ifndef LOCK_SH
+#define LOCK_SH (1)
+#define LOCK_EX (2)
+#define LOCK_NB (4)
+#endif
+#define lockindex(fd,how)   (0)
+#endif
+#ifndef O_BINARY
+#define O_BINARY (0)
+#endif
+
+/* --- next value of a counter shared by all threads, for unique names --- */
+#if defined(__GNUC__)
+#define nextcount(np)   __atomic_fetch_add((np), 1, __ATOMIC_RELAXED)
+#else                                   /* single-threaded use only */
+#define nextcount(np)   ((*(np))++)
+#endif
+
+#define MAXCACHEFILE (1024)         /* longest path under cachepath */
+#define INDEXHEAD   "# mimetex diskcache" /* index header line begins */
+#define INDEXHEADSZ (64)            /* #chars in header line, with \n */
+
+/* --- one image in an index being rewritten --- */
+typedef struct indexent_struct
+{
+    char  name[DISKCACHEKEYSZ + 4]; /* cd/key */
+    long  time;                 /* when last written or read */
+    long  nbytes;               /* #bytes in image, 0 if not known */
+} indexent; /* --- end-of-indexent_struct --- */
+
+
+/* ==========================================================================
+ * Function:    shardfile ( cachepath, key, name, path )
+ * Purpose:     Constructs cachepath/ab/name, for key ab...,
+ *              in path's MAXCACHEFILE+1 bytes
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0 if path would be too long
+ * ======================================================================= */
+/* --- entry point --- */
+static int shardfile(char *cachepath, char *key, char *name, char *path)
+{
+    int npath = snprintf(path, MAXCACHEFILE + 1, "%s%.2s/%s", cachepath, key, name);
+    return (npath >= 0 && npath <= MAXCACHEFILE);
+} /* --- end-of-function shardfile() --- */
+
+
+/* ==========================================================================
+ * Functions:   readall ( fd, buffer, nbytes ), writeall ( fd, buffer, nbytes )
+ * Purpose:     read() or write() nbytes, retrying short transfers
+ * --------------------------------------------------------------------------
+ * Returns:     ( long )    #bytes transferred, less than nbytes if failed
+ * ======================================================================= */
+/* --- entry point --- */
+static long readall(int fd, void *buffer, long nbytes)
+{
+    long ndone = 0, n = 0;
+    while (ndone < nbytes
+            && (n = read(fd, (char *)buffer + ndone, nbytes - ndone)) > 0)
+        ndone += n;
+    return (ndone);
+} /* --- end-of-function readall() --- */
+/* --- entry point --- */
+static long writeall(int fd, void *buffer, long nbytes)
+{
+    long ndone = 0, n = 0;
+    while (ndone < nbytes
+            && (n = write(fd, (char *)buffer + ndone, nbytes - ndone)) > 0)
+        ndone += n;
+    return (ndone);
+} /* --- end-of-function writeall() --- */
+
+
+/* ==========================================================================
+ * Function:    appendindex ( cachepath, key, nbytes )
+ * Purpose:     Appends  time nbytes cd/key  to key's shard's index
+ * --------------------------------------------------------------------------
+ * Arguments:   cachepath (I)   char * to cache directory, ending in /
+ *              key (I)         char * to diskcache_key()
+ *              nbytes (I)      long containing #bytes of image written,
+ *                              or 0 for a read
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1=okay, 0=failed
+ * --------------------------------------------------------------------------
+ * Notes:     o The line is one O_APPEND write(), so it's never
+ *              interleaved with another process's line.
+ * ======================================================================= */
+/* --- entry point --- */
+static int appendindex(char *cachepath, char *key, long nbytes)
+{
+    char indexfile[MAXCACHEFILE + 1], line[128];
+    int fd = (-1), nline = 0, isappended = 0;
+    if (!shardfile(cachepath, key, "index", indexfile)) goto end_of_job;
+    if ((fd = open(indexfile, O_WRONLY | O_APPEND | O_CREAT, 0644)) < 0)
+        goto end_of_job;
+    nline = sprintf(line, "%ld %ld %.2s/%.*s\n", (long)time(NULL), nbytes,
+                    key + 2, DISKCACHEKEYSZ, key);
+    isappended = (write(fd, line, nline) == nline);
+end_of_job:
+    if (fd >= 0) close(fd);
+    return (isappended);
+} /* --- end-of-function appendindex() --- */
+
+
+/* ==========================================================================
+ * Function:    iscompactdue ( cachepath, key, maxbytes )
+ * Purpose:     Checks whether key's shard's index should be rewritten
+ * --------------------------------------------------------------------------
+ * Arguments:   cachepath (I)   char * to cache directory, ending in /
+ *              key (I)         char * to diskcache_key()
+ *              maxbytes (I)    long containing shard's byte budget,
+ *                              or 0 for none
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if the images indexed are over budget,
+ *                              or the index has grown DISKCACHEMAXLOG
+ *                              bytes since it was rewritten, else 0
+ * ======================================================================= */
+/* --- entry point --- */
+static int iscompactdue(char *cachepath, char *key, long maxbytes)
+{
+    char indexfile[MAXCACHEFILE + 1], head[INDEXHEADSZ + 1];
+    char *tail = NULL, *line = NULL;
+    int fd = (-1), isdue = 0;
+    long nimgbytes = 0, nindexbytes = 0, ntail = 0, when = 0, nbytes = 0;
+    struct stat st;
+    if (!shardfile(cachepath, key, "index", indexfile)) goto end_of_job;
+    if ((fd = open(indexfile, O_RDONLY | O_BINARY)) < 0 || fstat(fd, &st) != 0)
+        goto end_of_job;
+    /* --- header gives sizes when last rewritten --- */
+    if (readall(fd, head, INDEXHEADSZ) == INDEXHEADSZ
+            && memcmp(head, INDEXHEAD, strlen(INDEXHEAD)) == 0) {
+        head[INDEXHEADSZ] = '\000';
+        if (sscanf(head + strlen(INDEXHEAD), "%ld %ld", &nimgbytes,
+                   &nindexbytes) != 2)
+            nimgbytes = nindexbytes = 0;
+    }
+    if ((ntail = (long)st.st_size - nindexbytes) > DISKCACHEMAXLOG) {
+        isdue = 1;
+        goto end_of_job;
+    }
+    if (maxbytes <= 0 || ntail <= 0) goto end_of_job;
+    /* --- add up images indexed since then --- */
+    if ((tail = (char *)malloc(ntail + 1)) == NULL) goto end_of_job;
+    if (lseek(fd, (off_t)nindexbytes, SEEK_SET) < 0
+            || (ntail = readall(fd, tail, ntail)) < 1)
+        goto end_of_job;
+    tail[ntail] = '\000';
+    for (line = tail; line != NULL && *line != '\000'; ) {
+        if (sscanf(line, "%ld %ld", &when, &nbytes) == 2 && nbytes > 0)
+            nimgbytes += nbytes;
+        if ((line = strchr(line, '\n')) != NULL) line++;
+    }
+    isdue = (nimgbytes > maxbytes);
+end_of_job:
+    if (tail != NULL) free((void *)tail);
+    if (fd >= 0) close(fd);
+    return (isdue);
+} /* --- end-of-function iscompactdue() --- */
+
+
+/* ==========================================================================
+ * Function:    cmpindexent ( a, b )
+ * Purpose:     qsort() comparison, least recently used first
+ * ======================================================================= */
+/* --- entry point --- */
+static int cmpindexent(const void *a, const void *b)
+{
+    long atime = ((const indexent *)a)->time, btime = ((const indexent *)b)->time;
+    return (atime < btime ? (-1) : (atime > btime ? 1 : 0));
+} /* --- end-of-function cmpindexent() --- */
+
+
+/* ==========================================================================
+ * Function:    compactshard ( cachepath, key, maxbytes )
+ * Purpose:     Rewrites key's shard's index with one line per image,
+ *              first removing least recently used images if the shard
+ *              is over budget
+ * --------------------------------------------------------------------------
+ * Arguments:   cachepath (I)   char * to cache directory, ending in /
+ *              key (I)         char * to diskcache_key()
+ *              maxbytes (I)    long containing shard's byte budget,
+ *                              or 0 for none
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1=rewritten, 0 if not (e.g., another
+ *                              process is rewriting it)
+ * --------------------------------------------------------------------------
+ * Notes:     o An over-budget shard is cut to 7/8 of its budget,
+ *              so it's not rewritten again on the next write.
+ *            o An image's last line with #bytes>0 gives its size,
+ *              and its latest time is its last use.  An image with
+ *              no #bytes (its write wasn't indexed) gets its size
+ *              from stat(), or is dropped if it doesn't exist.
+ * ======================================================================= */
+/* --- entry point --- */
+static int compactshard(char *cachepath, char *key, long maxbytes)
+{
+    char lockfile[MAXCACHEFILE + 1], indexfile[MAXCACHEFILE + 1],
+         tempfile[MAXCACHEFILE + 1], imagefile[MAXCACHEFILE + 1],
+         name[DISKCACHEKEYSZ + 4], head[INDEXHEADSZ];
+    char *index = NULL, *line = NULL, *next = NULL, *out = NULL;
+    indexent *ents = NULL;
+    long *table = NULL;
+    long nindex = 0, nlines = 0, nents = 0, ntable = 2, nout = 0,
+         nimgbytes = 0, when = 0, nbytes = 0, ient = 0, slot = 0;
+    int lockfd = (-1), fd = (-1), iscompacted = 0;
+    struct stat st;
+    /* ------------------------------------------------------------
+    lock out other writers (or leave it to another rewriter), read index
+    ------------------------------------------------------------ */
+    if (!shardfile(cachepath, key, "lock", lockfile)
+            || !shardfile(cachepath, key, "index", indexfile)
+            || !shardfile(cachepath, key, "index.tmp", tempfile))
+        goto end_of_job;
+    if ((lockfd = open(lockfile, O_RDWR | O_CREAT, 0644)) < 0
+            || lockindex(lockfd, LOCK_EX | LOCK_NB) != 0)
+        goto end_of_job;
+    if ((fd = open(indexfile, O_RDONLY | O_BINARY)) < 0 || fstat(fd, &st) != 0)
+        goto end_of_job;
+    nindex = (long)st.st_size;
+    if ((index = (char *)malloc(nindex + 1)) == NULL
+            || readall(fd, index, nindex) != nindex)
+        goto end_of_job;
+    index[nindex] = '\000';
+    close(fd);
+    fd = (-1);
+    /* ------------------------------------------------------------
+    one entry per image, found by name in an open-addressed table
+    ------------------------------------------------------------ */
+    for (line = index; (line = strchr(line, '\n')) != NULL; line++) nlines++;
+    while (ntable < 2 * (nlines + 1)) ntable *= 2;
+    if ((ents = (indexent *)calloc(nlines + 1, sizeof(indexent))) == NULL
+            || (table = (long *)malloc(ntable * sizeof(long))) == NULL)
+        goto end_of_job;
+    for (slot = 0; slot < ntable; slot++) table[slot] = (-1);
+    for (line = index; (next = strchr(line, '\n')) != NULL; line = next + 1) {
+        unsigned long hash = 2166136261UL;
+        char *c = name;
+        /* --- a partial last line is ignored --- */
+        *next = '\000';
+        if (*line == '#'
+                || sscanf(line, "%ld %ld %51s", &when, &nbytes, name) != 3
+                || !isxdigit(name[0]) || !isxdigit(name[1])
+                || name[2] != '/' || strchr(name + 3, '/') != NULL
+                || memcmp(name + 3, key, 2) != 0)   /* not in this shard */
+            continue;
+        while (*c != '\000') hash = (hash ^ (unsigned char)*c++) * 16777619UL;
+        slot = (long)(hash & (ntable - 1));
+        while (table[slot] >= 0 && strcmp(ents[table[slot]].name, name) != 0)
+            slot = (slot + 1) & (ntable - 1);
+        if (table[slot] < 0) {          /* first line for this image */
+            table[slot] = nents;
+            strcpy(ents[nents++].name, name);
+        }
+        ient = table[slot];
+        if (when > ents[ient].time) ents[ient].time = when;
+        if (nbytes > 0) ents[ient].nbytes = nbytes;
+    }
+    /* ------------------------------------------------------------
+    remove least recently used images, if over budget
+    ------------------------------------------------------------ */
+    for (ient = 0; ient < nents; ient++) {
+        if (ents[ient].nbytes < 1          /* unknown size */
+                && shardfile(cachepath, key, ents[ient].name, imagefile)
+                && stat(imagefile, &st) == 0)
+            ents[ient].nbytes = (long)st.st_size;
+        nimgbytes += ents[ient].nbytes;
+    }
+    qsort((void *)ents, nents, sizeof(indexent), cmpindexent);
+    if (maxbytes > 0 && nimgbytes > maxbytes)
+        for (ient = 0; ient < nents && nimgbytes > maxbytes - maxbytes / 8; ient++) {
+            if (ents[ient].nbytes < 1) continue;
+            if (shardfile(cachepath, key, ents[ient].name, imagefile))
+                unlink(imagefile);
+            nimgbytes -= ents[ient].nbytes;
+            ents[ient].nbytes = 0;         /* gone */
+        }
+    /* ------------------------------------------------------------
+    write new index, and rename it into place
+    ------------------------------------------------------------ */
+    if ((out = (char *)malloc(INDEXHEADSZ + nents * (DISKCACHEKEYSZ + 48)))
+            == NULL)
+        goto end_of_job;
+    nout = INDEXHEADSZ;
+    for (ient = 0; ient < nents; ient++)
+        if (ents[ient].nbytes > 0)
+            nout += sprintf(out + nout, "%ld %ld %s\n", ents[ient].time,
+                            ents[ient].nbytes, ents[ient].name);
+    memset(out, ' ', INDEXHEADSZ);     /* header, padded with blanks */
+    memcpy(out, head, sprintf(head, "%s %ld %ld", INDEXHEAD, nimgbytes, nout));
+    out[INDEXHEADSZ - 1] = '\n';
+    if ((fd = open(tempfile, O_WRONLY | O_CREAT | O_TRUNC | O_BINARY, 0644)) < 0)
+        goto end_of_job;
+    if (writeall(fd, out, nout) != nout || close(fd) != 0) {
+        fd = (-1);
+        unlink(tempfile);
+        goto end_of_job;
+    }
+    fd = (-1);
+    if (rename(tempfile, indexfile) != 0) {
+        unlink(tempfile);
+        goto end_of_job;
+    }
+    iscompacted = 1;
+end_of_job:
+    if (out != NULL) free((void *)out);
+    if (table != NULL) free((void *)table);
+    if (ents != NULL) free((void *)ents);
+    if (index != NULL) free((void *)index);
+    if (fd >= 0) close(fd);
+    if (lockfd >= 0) close(lockfd);     /* and unlock */
+    return (iscompacted);
+} /* --- end-of-function compactshard() --- */
+
+
+/* ==========================================================================
+ * Function:    diskcache_key ( mctx, opts, expression, key )
+ * Purpose:     Names the cached image of expression rendered with mctx
+ *              and opts, in a way that changes with REVISIONDATE
+ * --------------------------------------------------------------------------
+ * Arguments:   mctx (I)        mimetex_ctx * expression is rendered with
+ *              opts (I)        mimetex_options * it's rendered with
+ *              expression (I)  char * to null-terminated expression
+ *              key (O)         char * to DISKCACHEKEYSZ bytes returning
+ *                              md5 of REVISIONDATE, imgcache_optkey()
+ *                              and expression, in hex, then .gif, .png,
+ *                              .pbm or .pgm
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1=okay, 0=failed
+ * ======================================================================= */
+/* --- entry point --- */
+int diskcache_key(mimetex_ctx *mctx, mimetex_options *opts, char *expression,
+                  char *key)
+{
+    char optkey[IMGCACHEOPTSZ];
+    unsigned char md5sum[16];
+    md5_context ctx;
+    int nopt = 0, j = 0;
+    if (expression == NULL || key == NULL) return (0);
+    nopt = imgcache_optkey(mctx, opts, optkey);
+    md5_starts(&ctx);
+    md5_update(&ctx, (uint8_t *)REVISIONDATE "\n", strlen(REVISIONDATE "\n"));
+    md5_update(&ctx, (uint8_t *)optkey, nopt);
+    md5_update(&ctx, (uint8_t *)expression, strlen(expression));
+    md5_finish(&ctx, md5sum);
+    for (j = 0; j < 16; j++)
+        sprintf(key + 2 * j, "%02x", md5sum[j]);
+    strcpy(key + 32, (opts->format == MIMETEX_PNG ? ".png" :
+                      (opts->format == MIMETEX_PBM ? ".pbm" :
+                       (opts->format == MIMETEX_PGM ? ".pgm" : ".gif"))));
+    return (1);
+} /* --- end-of-function diskcache_key() --- */
+
+
+/* ==========================================================================
+ * Function:    diskcache_file ( cachepath, key, cachefile )
+ * Purpose:     Constructs the path to key's image, cachepath/ab/cd/key
+ * --------------------------------------------------------------------------
+ * Arguments:   cachepath (I)   char * to cache directory, ending in /
+ *                              (or empty for the current directory)
+ *              key (I)         char * to diskcache_key()
+ *              cachefile (O)   char * returning path, with room for
+ *                              strlen(cachepath)+DISKCACHEKEYSZ+8 chars
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1=okay, 0 for a bad key or too long a path
+ * ======================================================================= */
+/* --- entry point --- */
+int diskcache_file(char *cachepath, char *key, char *cachefile)
+{
+    int nkey = (key == NULL ? 0 : strlen(key));
+    if (nkey < 5 || nkey >= DISKCACHEKEYSZ || cachepath == NULL
+            || strlen(cachepath) + nkey + 8 > MAXCACHEFILE)
+        return (0);
+    sprintf(cachefile, "%s%.2s/%.2s/%s", cachepath, key, key + 2, key);
+    return (1);
+} /* --- end-of-function diskcache_file() --- */
+
+
+/* ==========================================================================
+ * Function:    diskcache_get ( cachepath, key, image, maxbytes )
+ * Purpose:     Reads key's cached image, if any
+ * --------------------------------------------------------------------------
+ * Arguments:   cachepath (I)   char * to cache directory, ending in /
+ *              key (I)         char * to diskcache_key()
+ *              image (O)       unsigned char * returning image bytes
+ *              maxbytes (I)    int containing #bytes available in image
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #bytes of image, or 0 if not cached
+ * ======================================================================= */
+/* --- entry point --- */
+int diskcache_get(char *cachepath, char *key, unsigned char *image,
+                  int maxbytes)
+{
+    char cachefile[MAXCACHEFILE + 1];
+    int fd = (-1), nbytes = 0;
+    struct stat st;
+    if (image == NULL || !diskcache_file(cachepath, key, cachefile))
+        goto end_of_job;
+    if ((fd = open(cachefile, O_RDONLY | O_BINARY)) < 0 || fstat(fd, &st) != 0
+            || st.st_size < 1 || st.st_size > maxbytes)
+        goto end_of_job;
+    if (readall(fd, image, (long)st.st_size) != (long)st.st_size)
+        goto end_of_job;
+    nbytes = (int)st.st_size;
+    /* --- index the read, if it's been a while --- */
+    if ((long)time(NULL) - (long)st.st_mtime > DISKCACHETOUCH) {
+        utime(cachefile, NULL);         /* not until DISKCACHETOUCH again */
+        appendindex(cachepath, key, 0);
+    }
+end_of_job:
+    if (fd >= 0) close(fd);
+    return (nbytes);
+} /* --- end-of-function diskcache_get() --- */
+
+
+/* ==========================================================================
+ * Function:    diskcache_put ( cachepath, key, image, nbytes, maxbytes )
+ * Purpose:     Writes key's image to the cache, atomically, and keeps
+ *              its shard within budget
+ * --------------------------------------------------------------------------
+ * Arguments:   cachepath (I)   char * to cache directory, ending in /
+ *              key (I)         char * to diskcache_key()
+ *              image (I)       unsigned char * to image bytes
+ *              nbytes (I)      int containing #bytes of image
+ *              maxbytes (I)    long containing byte budget for the whole
+ *                              cache, or 0 for none
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1=cached, 0=failed
+ * --------------------------------------------------------------------------
+ * Notes:     o Directories cachepath/ab/ and ab/cd/ are created as
+ *              needed, but cachepath itself must exist.
+ *            o The temporary name's n is taken atomically, so threads
+ *              putting images at once never build the same name.
+ *            o The image is renamed into place and indexed under a
+ *              shared lock, so a shard's rewrite never misses it.
+ * ======================================================================= */
+/* --- entry point --- */
+int diskcache_put(char *cachepath, char *key, unsigned char *image,
+                  int nbytes, long maxbytes)
+{
+    static int ntemps = 0;              /* for unique temporary names */
+    char cachefile[MAXCACHEFILE + 1], tempfile[MAXCACHEFILE + 1],
+         lockfile[MAXCACHEFILE + 1], name[64];
+    int fd = (-1), lockfd = (-1), itry = 0, isput = 0, ntemp = 0;
+    long shardbytes = (maxbytes <= 0 ? 0 :
+                       (maxbytes + DISKCACHESHARDS - 1) / DISKCACHESHARDS);
+    if (image == NULL || nbytes < 1 || !diskcache_file(cachepath, key, cachefile))
+        goto end_of_job;
+    /* ------------------------------------------------------------
+    write image to cachepath/ab/cd/.tmp.pid.n
+    ------------------------------------------------------------ */
+    ntemp = snprintf(tempfile, MAXCACHEFILE + 1, "%s%.2s", cachepath, key);
+    if (ntemp < 0 || ntemp > MAXCACHEFILE) goto end_of_job;
+    mkdir(tempfile, 0755);              /* okay if it already exists */
+    ntemp = snprintf(tempfile, MAXCACHEFILE + 1, "%s%.2s/%.2s", cachepath, key,
+                     key + 2);
+    if (ntemp < 0 || ntemp > MAXCACHEFILE) goto end_of_job;
+    mkdir(tempfile, 0755);
+    for (itry = 0; fd < 0 && itry < 16; itry++) {
+        sprintf(name, "%.2s/.tmp.%ld.%d", key + 2, (long)getpid(),
+                nextcount(&ntemps));
+        if (!shardfile(cachepath, key, name, tempfile)) goto end_of_job;
+        fd = open(tempfile, O_WRONLY | O_CREAT | O_EXCL | O_BINARY, 0644);
+    }
+    if (fd < 0) goto end_of_job;
+    if (writeall(fd, image, nbytes) != nbytes || close(fd) != 0) {
+        fd = (-1);
+        unlink(tempfile);
+        goto end_of_job;
+    }
+    fd = (-1);
+    /* ------------------------------------------------------------
+    rename it into place, and index it, with rewrites locked out
+    ------------------------------------------------------------ */
+    if (shardfile(cachepath, key, "lock", lockfile)
+            && (lockfd = open(lockfile, O_RDWR | O_CREAT, 0644)) >= 0)
+        (void)lockindex(lockfd, LOCK_SH);
+    if (rename(tempfile, cachefile) != 0) {
+        unlink(tempfile);
+        goto end_of_job;
+    }
+    isput = 1;
+    appendindex(cachepath, key, nbytes);
+    if (lockfd >= 0) close(lockfd);     /* and unlock */
+    lockfd = (-1);
+    /* --- rewrite index, if it's over budget or too long --- */
+    if (iscompactdue(cachepath, key, shardbytes))
+        compactshard(cachepath, key, shardbytes);
+end_of_job:
+    if (fd >= 0) close(fd);
+    if (lockfd >= 0) close(lockfd);
+    return (isput);
+} /* --- end-of-function diskcache_put() --- */
@@ -0,0 +1,33 @@
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include "mimetex.h"
+
+/* ---
+ * On-disk cache of rendered images (for -DCACHEPATH), laid out as
+ *   cachepath/ab/cd/key   an image, where key is the md5 of REVISIONDATE,
+ *                         every render option and the expression, plus
+ *                         .gif (etc), and ab, cd are its first 4 digits
+ *   cachepath/ab/index    a line "time #bytes cd/key" for each image
+ *                         written (or read, #bytes=0, now and then)
+ *   cachepath/ab/lock     flock()'ed while changing index
+ * Images are written to a temporary file, then renamed into place, so
+ * no reader ever sees part of one.  When an ab/ shard holds more than
+ * its 1/DISKCACHESHARDS of the byte budget, its least recently used
+ * images are removed, and its index rewritten.
+ * --------------------------------------------------------------------- */
+#define DISKCACHEMB (1024)      /* default byte budget, in megabytes */
+#define DISKCACHESHARDS (256)   /* #ab/ directories */
+#define DISKCACHEKEYSZ (48)     /* longest key, with .ext and null */
+#define DISKCACHETOUCH (3600)   /* #secs before a read is re-indexed */
+#define DISKCACHEMAXLOG (65536) /* #index bytes appended till rewritten */
+
+int diskcache_key(mimetex_ctx *mctx, mimetex_options *opts, char *expression,
+                  char *key);
+int diskcache_file(char *cachepath, char *key, char *cachefile);
+int diskcache_get(char *cachepath, char *key, unsigned char *image,
+                  int maxbytes);
+int diskcache_put(char *cachepath, char *key, unsigned char *image,
+                  int nbytes, long maxbytes);
+
+#endif /* DISKCACHE_H */
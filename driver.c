@@ -32,8 +32,9 @@
 #include <time.h>
 
 #include "mimetex.h"
-#include "gifsave.h"
-#include "md5.h"
+#include "serve.h"
+#include "diskcache.h"
+#include "packcache.h"
 
 /* --- check whether or not to perform http_referer check --- */
 #ifdef REFERER              /* only specified referers allowed */
@@ -87,6 +88,12 @@
 #else
 #define ISCACHING 1           /* caching if -DCACHEPATH="path" */
 #endif
+#ifndef CACHEMB
+#define CACHEMB DISKCACHEMB   /* megabytes under CACHEPATH, 0=no limit */
+#endif
+#ifndef CACHEPACK
+#define CACHEPACK "\000"      /* file per image, or else one pack file */
+#endif
 /* --- \input paths (prepend prefix if given -DPATHPREFIX=\"prefix\") --- */
 #define PATHPREFIX "\000"     /* paths relative mimetex.cgi */
 /* --- treat +'s in query string as blanks? --- */
@@ -209,37 +216,34 @@ static  char *msgtable[] = {        /* messages referenced by [index] */
     NULL
 } ;               /* trailer */
 
+/* --- error message rendered for an empty query string --- */
+static  char *noquerymsg =
+    "\\red\\small\\rm\\fbox{\\begin{gather}\\LaTeX~expression~not~supplied"
+    "\\\\i.e.,~no~?query\\_string~given~to~mimetex.cgi\\end{gather}}";
+
+/* --- with --serve, renders run concurrently, so some globals are per thread --- */
+#if defined(__GNUC__)
+#define THREADLOCAL __thread
+#else
+#define THREADLOCAL
+#endif
 static int iscaching = ISCACHING;  /* true if caching images */
 static char cachepath[256] = CACHEPATH;  /* relative path to cached files */
+static char cachepack[256] = CACHEPACK;  /* pack file in cachepath, if any */
 static int isemitcontenttype = 1;  /* true to emit mime content-type */
 static int isnomath = 0;       /* true to inhibit math mode */
 static int seclevel        = SECURITY;    /* security level */
-static int inputseclevel   = INPUTSECURITY; /* \input{} security level */
+static THREADLOCAL int inputseclevel = INPUTSECURITY; /* \input{} security level */
 static int counterseclevel = COUNTERSECURITY; /* \counter{} security level */
 static int environseclevel = ENVIRONSECURITY; /* \environ{} security level */
 static char pathprefix[256] = { '\000' }; /*prefix for \input,\counter paths*/
 static int exitstatus = 0;
 static char exprprefix[256] = "\000";  /* prefix prepended to expressions */
-static int ninputcmds = 0;     /* # of \input commands processed */
+static THREADLOCAL int ninputcmds = 0; /* # of \input commands processed */
 static int errorstatus = ERRORSTATUS;  /* exit status if error encountered*/
 static int isplusblank = -1;  /*interpret +'s in query as blanks?*/
 static int tzdelta = 0;
 
-static char *md5str(char *instr)
-{
-    static char outstr[64];
-    unsigned char md5sum[16];
-    md5_context ctx;
-    int j;
-    md5_starts(&ctx);
-    md5_update(&ctx, (uint8_t *)instr, strlen(instr));
-    md5_finish(&ctx, md5sum);
-    for (j = 0; j < 16; j++)
-        sprintf(outstr + j*2, "%02x", md5sum[j]);
-    outstr[32] = '\000';
-    return (outstr);
-}
-
 /* ==========================================================================
  * Function:    urlprune ( url, n )
  * Purpose: Prune http://abc.def.ghi.com/etc into abc.def.ghi.com
@@ -269,7 +273,7 @@ static char *urlprune(char *url, int n)
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* pruned url returned to caller */
-    static  char pruned[1024];
+    static  THREADLOCAL char pruned[1024];
     char    *purl = /*NULL*/pruned;     /* ptr to pruned, init for error */
     /* delimiter separating components */
     char    *delim = NULL;
@@ -405,7 +409,7 @@ end_of_job:
 } /* --- end-of-function urlncmp() --- */
 
 /* ==========================================================================
- * Functions:   int  unescape_url ( char *url, int isescape )
+ * Functions:   int  unescape_url ( char *url, int isescape, int *plusblank )
  *      char x2c ( char *what )
  * Purpose: unescape_url replaces 3-character sequences %xx in url
  *          with the single character represented by hex xx.
@@ -417,6 +421,9 @@ end_of_job:
  *              to be converted.
  *      isescape (I)    int containing 1 to _not_ unescape
  *              \% sequences (0 would be NCSA default)
+ *      plusblank (I/O) int * to 1 to xlate +'s to blanks, 0 not to,
+ *              or -1 to decide from url (reset to 0 on return,
+ *              so repeated calls don't xlate again)
  *      what (I)    char * whose first 2 characters are
  *              interpreted as ascii representations
  *              of hex digits.
@@ -435,11 +442,11 @@ end_of_job:
  *        o Added ^M,^F,etc to blank xlation 0n 01-Oct-06
  * ======================================================================= */
 /* --- entry point --- */
-static int unescape_url(char *url, int isescape)
+static int unescape_url(char *url, int isescape, int *plusblank)
 {
     int x = 0, y = 0, prevescape = 0, gotescape = 0;
     /* true to xlate plus to blank */
-    int xlateplus = (isplusblank == 1 ? 1 : 0);
+    int xlateplus = (*plusblank == 1 ? 1 : 0);
     /* replace + with blank, if needed */
     int strreplace();
     char x2c();
@@ -456,7 +463,7 @@ static int unescape_url(char *url, int isescape)
         /* --- first, entirely remove ctrlchars from beginning and end --- */
         if (seglen > 0) {          /*have ctrlchars at start of string*/
             /* squeeze out initial ctrlchars */
-            strcpy(url, url + seglen);
+            strsqueeze(url, seglen);
             urllen -= seglen;
         }     /* string is now shorter */
         while (--urllen >= 0)          /* now remove ctrlchars from end */
@@ -475,7 +482,7 @@ static int unescape_url(char *url, int isescape)
     /* ---
      * xlate +'s to blanks if requested or if deemed necessary
      * ------------------------------------------------------------ */
-    if (isplusblank == (-1)) {   /*determine whether or not to xlate*/
+    if (*plusblank == (-1)) {   /*determine whether or not to xlate*/
         char *searchfor[] = { " ", "%20", "%2B", "%2b", "+++", "++",
                               "+=+", "+-+", NULL
                             };
@@ -497,21 +504,21 @@ static int unescape_url(char *url, int isescape)
         /* --- apply some common-sense logic --- */
         if (nfound[0] + nfound[1] > 0)     /* we have actual " "s or "%20"s */
             /* so +++'s aren't blanks */
-            isplusblank = xlateplus = 0;
+            *plusblank = xlateplus = 0;
         if (nfound[2] + nfound[3] > 0) {   /* we have "%2B" for +++'s */
-            if (isplusblank != 0)        /* and haven't disabled xlation */
+            if (*plusblank != 0)        /* and haven't disabled xlation */
                 /* so +++'s are blanks */
-                isplusblank = xlateplus = 1;
+                *plusblank = xlateplus = 1;
             else
             /* we have _both_ "%20" and "%2b" */
                 xlateplus = 0;
         }      /* tough call */
         if (nfound[4] + nfound[5] > 0  /* we have multiple ++'s */
                 ||   nfound[6] + nfound[7] > 0)   /* or we have a +=+ or +-+ */
-            if (isplusblank != 0)        /* and haven't disabled xlation */
+            if (*plusblank != 0)        /* and haven't disabled xlation */
                 /* so xlate +++'s to blanks */
                 xlateplus = 1;
-    } /* --- end-of-if(isplusblank==-1) --- */
+    } /* --- end-of-if(*plusblank==-1) --- */
     if (xlateplus > 0) {         /* want +'s xlated to blanks */
         char *xlateto[] = { "", " ", " ", " + ", " ", " ", " ", " ", " " };
         while (xlateplus > 0) {        /* still have +++'s to xlate */
@@ -526,7 +533,7 @@ static int unescape_url(char *url, int isescape)
         } /* --- end-of-while(xlateplus>0) --- */
     } /* --- end-of-if(xlateplus) --- */
     /* don't iterate this xlation */
-    isplusblank = 0;
+    *plusblank = 0;
     /* ---
      * xlate %nn to corresponding char
      * ------------------------------------------------------------ */
@@ -545,6 +552,47 @@ static int unescape_url(char *url, int isescape)
     return 0;
 } /* --- end-of-function unescape_url() --- */
 
+/* ==========================================================================
+ * Function:    unescape_query ( expression, plusblank )
+ * Purpose: converts a query string to the LaTeX expression it encodes,
+ *      i.e., strips formdata= from <form> input and unescapes %xx's
+ * --------------------------------------------------------------------------
+ * Arguments:   expression (I/O) char * to null-terminated query string,
+ *              edited in place
+ *      plusblank (I/O) int * to isplusblank-style flag,
+ *              see unescape_url()
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if expression was <input name="formdata">,
+ *              0 if it was a plain query
+ * --------------------------------------------------------------------------
+ * Notes:     o Used for QUERY_STRING by main(), and for each request
+ *      by serverender().
+ * ======================================================================= */
+/* --- entry point --- */
+static int unescape_query(char *expression, int *plusblank)
+{
+    if (!memcmp(expression, "formdata", 8)) { /*must be <input name="formdata"> */
+        /* find equal following formdata */
+        char *delim = strchr(expression, '=');
+        if (delim != (char *)NULL)   /* found unescaped equal sign */
+            /* so shift name= out of expression*/
+            memmove(expression, delim + 1, strlen(delim + 1) + 1);
+        while ((delim = strchr(expression, '+')) != NULL) /*unescaped plus sign*/
+            /* is "shorthand" for blank space */
+            *delim = ' ';
+        /*unescape_url(expression,1);*/ /* convert unescaped %xx's to chars */
+        /* convert all %xx's to chars */
+        unescape_url(expression, 0, plusblank);
+        /* repeat */
+        unescape_url(expression, 0, plusblank);
+        /* signal form data */
+        return (1);
+    }
+    /* --- query, but not <form> input --- */
+    unescape_url(expression, 0, plusblank);
+    return (0);
+} /* --- end-of-function unescape_query() --- */
+
 /* ==========================================================================
  * Function:    rasteditfilename ( filename )
  * Purpose:    edits filename to remove security problems,
@@ -587,7 +635,7 @@ static char *rasteditfilename(char *filename)
         /* still have chars in filename */
         while (isthischar(*editname, " ./\\"))
             /* absolute paths invalid so flush leading / or \ (or ' ')*/
-            strcpy(editname, editname + 1);
+            strsqueeze(editname, 1);
     }
     if (*editname == '\000')
         /* no chars left in filename */
@@ -651,7 +699,7 @@ char    *sanitize_pathname(char *filename)
     /* --- remove leading / and \ and dots (and blanks) --- */
     if (*editname != '\000')         /* still have chars in filename */
         while (isthischar(*editname, " ./\\"))  /* absolute paths invalid */
-            strcpy(editname, editname + 1);  /* so flush leading / or \ (or ' ')*/
+            strsqueeze(editname, 1);  /* so flush leading / or \ (or ' ')*/
     /* no chars left in filename */
     if (*editname == '\000') goto end_of_job;
     /* --- remove leading or embedded ../'s and ..\'s --- */
@@ -903,7 +951,6 @@ int rastwritefile(mimetex_ctx *mctx, char *filename, char *tag, char *value, int
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
-    char *timestamp();
     FILE *rastopenfile();
     int rastreadfile();
 
@@ -1046,7 +1093,7 @@ int rastwritefile(mimetex_ctx *mctx, char *filename, char *tag, char *value, int
                     /* spacer */
                     strcat(fbuff, " modified at ");
                     /* start with timestamp */
-                    strcat(fbuff, timestamp(tzdelta, 0));
+                    strcat(fbuff, timestamp(mctx, tzdelta, 0));
                     status = rastwritefile(mctx, filename, "timestamp", fbuff, 1);
                 }
     /* --- return status to caller --- */
@@ -1101,6 +1148,8 @@ static subraster *rastenviron(mimetex_ctx *mctx,
        wraplen = 48; /* strwrap() wrap lines at 48 chars*/
     /* environ[] index */
     int ienv = 0;
+    /* don't xlate +'s in environment vars */
+    int plusblank = 0;
     /* rasterize environment string */
     subraster *environsp = NULL;
     /* ------------------------------------------------------------
@@ -1146,8 +1195,8 @@ static subraster *rastenviron(mimetex_ctx *mctx,
             /* so add an ellipsis */
             strcat(environvar, "...");
         /* convert all %xx's to chars */
-        unescape_url(environvar, 0);
-        environptr = strdetex(environvar, 1); /* remove/replace any math chars */
+        unescape_url(environvar, 0, &plusblank);
+        environptr = strdetex(mctx, environvar, 1); /* remove/replace any math chars */
         strninit(environvar, environptr, maxvarlen); /*de-tex'ed/nomath environvar*/
         /* wrap long lines */
         environptr = strwrap(mctx, environvar, wraplen, -6);
@@ -1236,7 +1285,7 @@ static subraster *rastmessage(mimetex_ctx *mctx, char **expression, int size,
         if (reflevels > 0)             /* have #levels to validate */
             strreplace(msg, "SERVER_NAME",   /* replace SERVER_NAME */
                        /*with referer_match*/
-                       strdetex(urlprune(referer_match, reflevels), 1), 0);
+                       strdetex(mctx, urlprune(referer_match, reflevels), 1), 0);
     } /* --- end-of-switch(imsg) --- */
     /* --- rasterize requested message --- */
     /* rasterize message string */
@@ -1441,7 +1490,7 @@ static subraster *rastcounter(mimetex_ctx *mctx, char **expression, int size,
                 /* logvars[] index */
                 int  ilog = 0;
                 /* first emit timestamp */
-                fprintf(logfp, "%s  ", timestamp(tzdelta, 0));
+                fprintf(logfp, "%s  ", timestamp(mctx, tzdelta, 0));
                 /* emit counter filename */
                 if (*tag == '\000') fprintf(logfp, "%s", filename);
                 /* or tag if we have one */
@@ -1474,7 +1523,7 @@ static subraster *rastcounter(mimetex_ctx *mctx, char **expression, int size,
     /* --- construct expression --- */
     /*sprintf(text,"%d",counter);*/     /* start with counter */
     /* comma-separated counter value */
-    strcpy(text, dbltoa(((double)counter), 0));
+    strcpy(text, dbltoa(mctx, ((double)counter), 0));
     if (ordindex >= 0) {         /* need to tack on ordinal suffix */
         /* start with ^ and {\underline{\rm */
         strcat(text, "^{\\underline{\\rm~");
@@ -1596,7 +1645,7 @@ static subraster *rastinput(mimetex_ctx *mctx, char **expression, int size,
             /* interpret subexpr as double */
             double d = strtod(subexpr, NULL);
             if (d != 0.0)            /* conversion to double successful */
-                if ((reformat = dbltoa(d, npts)) != NULL) /* reformat successful */
+                if ((reformat = dbltoa(mctx, d, npts)) != NULL) /* reformat successful */
                     strcpy(subexpr, reformat);
         } /*replace subexpr with reformatted*/
     } /* --- end-of-if(isinput) --- */
@@ -1629,148 +1678,6 @@ static mathchardef extra_handlers[] = {
     { NULL,     -999,   -999,   -999,       NULL }
 };
 
-/* ==========================================================================
- * Function:    type_pbmpgm ( rp, ptype, file )
- * Purpose: Write pbm or pgm image of rp to file
- * --------------------------------------------------------------------------
- * Arguments:   rp (I)      ptr to raster struct for which
- *              a pbm/pgm file is to be written.
- *      ptype (I)   int containing 1 for pbm, 2 for pgm, or
- *              0 to determine ptype from values in rp
- *      file (I)    ptr to null-terminated char string
- *              containing name of fuke to be written
- *              (see notes below).
- * --------------------------------------------------------------------------
- * Returns: ( int )     total #bytes written,
- *              or 0 for any error.
- * --------------------------------------------------------------------------
- * Notes:     o (a) If file==NULL, output is written to stdout;
- *      (b) if *file=='\000' then file is taken as the
- *          address of an output buffer to which output
- *          is written (and is followed by a terminating
- *          '\0' which is not counted in #bytes returned);
- *      (c) otherwise file is the filename (opened and
- *          closed internally) to which output is written,
- *          except that any final .ext extension is replaced
- *          by .pbm or .pgm depending on ptype.
- * ======================================================================= */
-/* --- entry point --- */
-static int type_pbmpgm(raster *rp, int ptype, FILE *fp)
-{
-    /* ------------------------------------------------------------
-    Allocations and Declarations
-    ------------------------------------------------------------ */
-    /* completion flag, total #bytes written */
-    int isokay = 0, nbytes = 0;
-    /*height(row), width(col) indexes in raster*/
-    int irow = 0, jcol = 0;
-    int pixmin = 9999, pixmax = (-9999); /* min, max pixel value in raster */
-    char    outline[1024], outfield[256], /* output line, field */
-    /* cr at end-of-line */
-    cr[16] = "\n\000";
-    /* maximum allowed line length */
-    int maxlinelen = 70;
-    int pixfrac = 6;    /* use (pixmax-pixmin)/pixfrac as step */
-    static char *magic[] = { NULL, "P1", "P2" };    /*identifying "magic number"*/
-    /* ------------------------------------------------------------
-    check input, determine grayscale,  and set up output file if necessary
-    ------------------------------------------------------------ */
-    /* --- check input args --- */
-    /* no input raster provided */
-    if (rp == NULL) goto end_of_job;
-    /* --- determine largest (and smallest) value in pixmap --- */
-    for (irow = 0; irow < rp->height; irow++)  /* for each row, top-to-bottom */
-        for (jcol = 0; jcol < rp->width; jcol++) { /* for each col, left-to-right */
-            /* value of pixel at irow,jcol */
-            int pixval = getpixel(rp, irow, jcol);
-            /* new minimum */
-            pixmin = min2(pixmin, pixval);
-            pixmax = max2(pixmax, pixval);
-        } /* new maximum */
-    /* --- open output file if necessary --- */
-    /*null ptr signals output to stdout*/
-    /* ------------------------------------------------------------
-    format and write header
-    ------------------------------------------------------------ */
-    /* --- format header info --- */
-    /* initialize line buffer */
-    *outline = '\000';
-    /* begin file with "magic number" */
-    strcat(outline, magic[ptype]);
-    /* followed by cr to end line */
-    strcat(outline, cr);
-    /* format width and height */
-    sprintf(outfield, "%d %d", rp->width, rp->height);
-    /* add width and height to header */
-    strcat(outline, outfield);
-    /* followed by cr to end line */
-    strcat(outline, cr);
-    if (ptype == 2) {            /* need max grayscale value */
-        /* format maximum pixel value */
-        sprintf(outfield, "%d", pixmax);
-        /* add max value to header */
-        strcat(outline, outfield);
-        strcat(outline, cr);
-    }       /* followed by cr to end line */
-    /* --- write header to file or memory buffer --- */
-    /* or if we have an open file... */
-    if (fputs(outline, fp)     /* try writing header to open file */
-        /* return with error if failed */
-        ==   EOF) goto end_of_job;
-    /* bump output byte count */
-    nbytes += strlen(outline);
-    /* ------------------------------------------------------------
-    format and write pixels
-    ------------------------------------------------------------ */
-    /* initialize line buffer */
-    *outline = '\000';
-    for (irow = 0; irow <= rp->height; irow++) /* for each row, top-to-bottom */
-        for (jcol = 0; jcol < rp->width; jcol++)  { /* for each col, left-to-right */
-            /* --- format value at irow,jcol--- */
-            /* init empty field */
-            *outfield = '\000';
-            if (irow < rp->height) {       /* check row index */
-                /* value of pixel at irow,jcol */
-                int pixval = getpixel(rp, irow, jcol);
-                if (ptype == 1)              /* pixval must be 1 or 0 */
-                    pixval = (pixval > pixmin + ((pixmax - pixmin) / pixfrac) ? 1 : 0);
-                sprintf(outfield, "%d ", pixval);
-            }   /* format pixel value */
-            /* --- write line if this value won't fit on it (or last line) --- */
-            if (strlen(outline) + strlen(outfield) + strlen(cr) >= maxlinelen /*won't fit*/
-                    ||   irow >= rp->height) {        /* force writing last line */
-                /* add cr to end current line */
-                strcat(outline, cr);
-                /* or if we have an open file... */
-                if (fputs(outline, fp)     /* try writing header to open file */
-                        /* return with error if failed */
-                        ==   EOF) goto end_of_job;
-                /* bump output byte count */
-                nbytes += strlen(outline);
-                /* re-initialize line buffer */
-                *outline = '\000';
-            } /* --- end-of-if(strlen>=maxlinelen) --- */
-            /* done after writing last line */
-            if (irow >= rp->height) break;
-            /* --- concatanate value to line -- */
-            /* concatanate value to line */
-            strcat(outline, outfield);
-        } /* --- end-of-for(jcol,irow) --- */
-    /* signal successful completion */
-    isokay = 1;
-    /* ------------------------------------------------------------
-    Back to caller with total #bytes written, or 0=failed.
-    ------------------------------------------------------------ */
-end_of_job:
-    if (fp != NULL             /* output written to an open file */
-            &&   fp != stdout)            /* and it's not just stdout */
-        /* so close file before returning */
-        fclose(fp);
-    /*back to caller with #bytes written*/
-    return ((isokay ? nbytes : 0));
-} /* --- end-of-function type_pbmpgm() --- */
-
-
 /* ==========================================================================
  * Function:    type_bytemap ( bp, grayscale, width, height, fp )
  * Purpose: Emit an ascii dump representing bp, on fp.
@@ -1929,102 +1836,6 @@ static int xbitmap_raster(raster *rp, FILE *fp)
     return (1);
 } /* --- end-of-function xbitmap_raster() --- */
 
-struct gif_raster_params {
-    mimetex_ctx *mctx;
-    int ncolors;
-    raster *bitmap; /* use 0/1 bitmap image or */
-    intbyte *colormap;  /* anti-aliased color indexes */
-};
-
-/* ==========================================================================
- * Function:    gif_raster_get_pixel ( int x, int y )
- * Purpose: callback for GIF_CompressImage() returning the
- *      pixel at column x, row y
- * --------------------------------------------------------------------------
- * Arguments:   x (I)       int containing column=0...width-1
- *              of desired pixel
- *      y (I)       int containing row=0...height-1
- *              of desired pixel
- * --------------------------------------------------------------------------
- * Returns: ( int )     0 or 1, if pixel at x,y is off or on
- * --------------------------------------------------------------------------
- * Notes:     o
- * ======================================================================= */
-/* --- entry point --- */
-static int gif_raster_get_pixel(void *_ctx, int x, int y)
-{
-    struct gif_raster_params *ctx = _ctx;
-
-    /* pixel index for x,y-coords*/
-    int ipixel = y * ctx->bitmap->width + x;
-    /* value of pixel */
-    int pixval = 0;
-    if (!ctx->colormap)               /* use bitmap if not anti-aliased */
-        /*pixel = 0 or 1*/
-        pixval = (int)getlongbit(ctx->bitmap->pixmap, ipixel);
-    else
-    /* else use anti-aliased grayscale*/
-        /* colors[] index number */
-        pixval = (int)(ctx->colormap[ipixel]);
-    if (ctx->mctx->msgfp != NULL && ctx->mctx->msglevel >= 9999) { /* dump pixel */
-        fprintf(ctx->mctx->msgfp, "gif_raster_get_pixel> x=%d, y=%d  pixel=%d\n", x, y, pixval);
-        fflush(ctx->mctx->msgfp);
-    }
-    return pixval;
-} /* --- end-of-function gif_raster_get_pixel() --- */
-
-
-static int gif_raster(mimetex_ctx *mctx, int ncolors, raster *bp, intbyte *colormap, intbyte *colors, FILE *fp, void *buffer, int buffer_size)
-{
-    struct gif_raster_params params = { mctx, ncolors, bp, colormap };
-    GIFContext *gctx;
-    /* --- initialize gifsave library and colors --- */
-    if (mctx->msgfp != NULL && mctx->msglevel >= 999) {
-        fprintf(mctx->msgfp, "main> calling GIF_Create(*,%d,%d,%d,8)\n",
-                bp->width, bp->height, ncolors);
-        fflush(mctx->msgfp);
-    }
-    if ((gctx = GIF_Create(fp, buffer, buffer_size, bp->width, bp->height, ncolors, 8)) == NULL)
-        return 0;
-    /* background white if all 255 */
-    GIF_SetColor(gctx, 0, mctx->bgred, mctx->bggreen, mctx->bgblue);
-    if (ncolors == 2) {               /* just b&w if not anti-aliased */
-        /* foreground black if all 0 */
-        GIF_SetColor(gctx, 1, mctx->fgred, mctx->fggreen, mctx->fgblue);
-        /* and set 2 b&w color indexes */
-        colors[0] = '\000';
-        colors[1] = '\001';
-    } else {
-        int igray;
-        /* set grayscales for anti-aliasing */
-        /* --- anti-aliased, so call GIF_SetColor() for each colors[] --- */
-        for (igray = 1; igray < ncolors; igray++) { /* for colors[] values */
-            /*--- gfrac goes from 0 to 1.0, as igray goes from 0 to ncolors-1 ---*/
-            double gfrac = ((double)colors[igray]) / ((double)colors[ncolors-1]);
-            /* --- r,g,b components go from background to foreground color --- */
-            int red  = iround(((double)mctx->bgred)  + gfrac * ((double)(mctx->fgred - mctx->bgred))),
-                green = iround(((double)mctx->bggreen) + gfrac * ((double)(mctx->fggreen - mctx->bggreen))),
-                blue = iround(((double)mctx->bgblue) + gfrac * ((double)(mctx->fgblue - mctx->bgblue)));
-            /* --- set color index number igray to rgb values gray,gray,gray --- */
-            /*set gray,grayer,...,0=black*/
-            GIF_SetColor(gctx, igray, red, green, blue);
-        } /* --- end-of-for(igray) --- */
-    }        
-    /* --- set gif color#0 (background) transparent --- */
-    if (mctx->istransparent)             /* transparent background wanted */
-        /* set transparent background */
-        GIF_SetTransparent(gctx, 0);
-    /*flush debugging output*/
-    if (mctx->msgfp != NULL && mctx->msglevel >= 9)
-        fflush(mctx->msgfp);
-    /* --- emit compressed gif image (to stdout or cache file) --- */
-    /* emit gif */
-    GIF_CompressImage(gctx, 0, 0, -1, -1, gif_raster_get_pixel, &params);
-    /* close file */
-    GIF_Close(gctx);
-    return gctx->gifSize;
-}
-
 /* ==========================================================================
  * Function:    ismonth ( char *month )
  * Purpose: returns 1 if month contains current month "jan"..."dec".
@@ -2119,11 +1930,12 @@ typedef struct logdata {
 } logdata ; /* --- end-of-logdata_struct --- */
 
 /* ==========================================================================
- * Function:    logger ( fp, mctx.msglevel, message, logvars )
+ * Function:    logger ( mctx, fp, msglevel, message, logvars )
  * Purpose: Logs the environment variables specified in logvars
  *      to fp if their mctx.msglevel is >= the passed mctx.msglevel.
  * --------------------------------------------------------------------------
- * Arguments:   fp (I)      FILE * to file containing log
+ * Arguments:   mctx (I)    mimetex_ctx * for timestamp() buffer
+ *      fp (I)      FILE * to file containing log
  *      mctx.msglevel (I)    int containing logging message level
  *      message (I) char * to optional message, or NULL
  *      logvars (I) logdata * to array of environment variables
@@ -2135,22 +1947,20 @@ typedef struct logdata {
  * Notes:     o
  * ======================================================================= */
 /* --- entry point --- */
-static int logger(FILE *fp, int msglevel, char *message, logdata *logvars)
+static int logger(mimetex_ctx *mctx, FILE *fp, int msglevel, char *message, logdata *logvars)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* logvars[] index, #vars logged */
     int ilog = 0, nlogged = 0;
-    /* timestamp logged */
-    char    *timestamp();
     /* getenv(name) to be logged */
     char    *value = NULL;
     /* ------------------------------------------------------------
     Log each variable
     ------------------------------------------------------------ */
     /*emit timestamp before first var*/
-    fprintf(fp, "%s\n", timestamp(tzdelta, 0));
+    fprintf(fp, "%s\n", timestamp(mctx, tzdelta, 0));
     if (message != NULL)             /* optional message supplied */
         /* emit caller-supplied message */
         fprintf(fp, "  MESSAGE = %s\n", message);
@@ -2334,6 +2144,297 @@ end_of_job:
 } /* --- end-of-function emitcache() --- */
 
 
+/* ==========================================================================
+ * Function:    iscacheable ( expression, isformdata )
+ * Purpose: checks whether expression's image may be cached
+ *      (and given a long Cache-Control: max-age)
+ * --------------------------------------------------------------------------
+ * Arguments:   expression (I)  char * to null-terminated expression
+ *      isformdata (I)  true if expression is <form> input
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if image may be cached, 0 if not
+ * ======================================================================= */
+/* --- entry point --- */
+static int iscacheable(char *expression, int isformdata)
+{
+    if (strstr(expression, "\\counter")  != NULL /* can't cache \counter{} */
+            ||   strstr(expression, "\\input")    != NULL /* can't cache \input{} */
+            ||   strstr(expression, "\\today")    != NULL /* can't cache \today */
+            ||   strstr(expression, "\\calendar") != NULL /* can't cache \calendar */
+            ||   strstr(expression, "\\nocach")   != NULL /* no caching requested */
+            ||   isformdata             /* don't cache user form input */
+       ) return (0);
+    return (1);
+} /* --- end-of-function iscacheable() --- */
+
+
+/* ==========================================================================
+ * Function:    checkreferer ( mctx, expression, http_referer,
+ *      referer_match, progname )
+ * Purpose: checks whether http_referer may use this image and \input{},
+ *      as per -DREFERER, -DREFLEVELS, -DINPUTREFERER,
+ *      -DDENYREFERER and -DNOREFMAXLEN
+ * --------------------------------------------------------------------------
+ * Arguments:   mctx (I)    mimetex_ctx * for debugging output
+ *      expression (I/O) char * to query's expression, in a buffer
+ *              of MAXEXPRSZ+1 bytes, possibly overwritten
+ *              with an invalid referer message
+ *      http_referer (I) char * to HTTP_REFERER, or NULL
+ *      referer_match (I) char * to HTTP_HOST or SERVER_NAME
+ *              that http_referer must match, or NULL
+ *      progname (I)    char * to name program executed as,
+ *              for the -DREFERER=\"month\" check
+ * --------------------------------------------------------------------------
+ * Returns: ( char * )  expression to be rendered, i.e., expression
+ *              or an invalid referer message
+ * --------------------------------------------------------------------------
+ * Notes:     o Also sets inputseclevel for this query (or thread).
+ * ======================================================================= */
+/* --- entry point --- */
+static char *checkreferer(mimetex_ctx *mctx, char *expression,
+                          char *http_referer, char *referer_match, char *progname)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* http_referer must contain this */
+    char    *referer = REFERER;
+    /*http_referer's permitted to \input*/
+    char    *inputreferer = INPUTREFERER;
+    /* cmp http_referer,server_name */
+    int reflevels = REFLEVELS;
+    /* prune referer_match */
+    struct  {
+        /* http_referer can't contain this */
+        char *referer;
+        int msgnum;
+    } denyreferer[] = {       /* referer table to deny access to */
+#ifdef DENYREFERER
+#include DENYREFERER      /* e.g.,  {"",1},  for no referer */
+#endif
+        { NULL, -999 }
+    /* trailer */
+    };
+    int ishttpreferer = (isempty(http_referer) ? 0 : 1);
+    /* true for inavlid referer */
+    int isinvalidreferer = 0;
+    /*max query_string len if no referer*/
+    int norefmaxlen = NOREFMAXLEN;
+    /*msg to invalid referer*/
+    char    *invalid_referer_msg = msgtable[invmsgnum];
+    /*referer isn't host*/
+    char    *invalid_referer_match = msgtable[refmsgnum];
+    /* ---
+     * check if http_referer is allowed to use this image and to use \input{}
+     * ------------------------------------------------------------ */
+    /* --- check -DREFERER=\"comma,separated,list\" of valid referers --- */
+    if (referer != NULL) {          /* compiled with -DREFERER=\"...\" */
+        if (strcmp(referer, "month") != 0)     /* but it's *only* "month" signal */
+            if (ishttpreferer)            /* or called "standalone" */
+                if (!isstrstr(http_referer, referer, 0)) { /* invalid http_referer */
+                    /* so give user error message */
+                    expression = invalid_referer_msg;
+                    isinvalidreferer = 1;
+                }
+    }     /* and signal invalid referer */
+    else
+    /* compiled without -DREFERER= */
+        if (reflevels > 0) {       /*match referer unless -DREFLEVELS=0*/
+            /* --- check topmost levels of http_referer against http_host --- */
+            if (ishttpreferer             /* have http_referer */
+                    &&   !isempty(referer_match))    /* and something to match it with */
+                if (!urlncmp(http_referer, referer_match, reflevels)) { /*match failed*/
+                    /* init error message */
+                    strcpy(expression, invalid_referer_match);
+                    strreplace(expression, "SERVER_NAME", /* and then replace SERVER_NAME */
+                               /*with referer_match*/
+                               strdetex(mctx, urlprune(referer_match, reflevels), 1), 0);
+                    isinvalidreferer = 1;
+                }        /* and signal invalid referer */
+        } /* --- end-of-if(reflevels>0) --- */
+    /* --- check -DINPUTREFERER=\"comma,separated,list\" of \input users --- */
+    /* set default input security */
+    inputseclevel = INPUTSECURITY;
+    if (inputreferer != NULL) {         /* compiled with -DINPUTREFERER= */
+        if (http_referer == NULL)          /* but no http_referer given */
+            /* unknown user can't \input{} */
+            inputseclevel = (-1);
+        else
+        /*have inputreferer and http_referer*/
+            if (!isstrstr(http_referer, inputreferer, 0)) /*http_referer can't \input*/
+                /* this known user can't \input{} */
+                inputseclevel = (-1);
+    } /* --- end-of-if(inputreferer!=NULL) --- */
+    /* ---
+     * check if referer contains "month" signal
+     * ------------------------------------------------------------ */
+    if (referer != NULL)            /* nor if compiled w/o -DREFERER= */
+        if (!isinvalidreferer)         /* nor if already invalid referer */
+            if (strstr(referer, "month") != NULL)  /* month check requested */
+                if (!ismonth(progname)) {        /* not executed as mimetexJan-Dec */
+                    /* so give user error message */
+                    expression = invalid_referer_msg;
+                    isinvalidreferer = 1;
+                }      /* and signal invalid referer */
+    /* ---
+     * check if http_referer is to be denied access
+     * ------------------------------------------------------------ */
+    if (!isinvalidreferer) {        /* nor if already invalid referer */
+        /* denyreferer index, message# */
+        int iref = 0, msgnum = (-999);
+        for (iref = 0; msgnum < 0; iref++) { /* run through denyreferer[] table */
+            /* referer to be denied */
+            char *deny = denyreferer[iref].referer;
+            /* null signals end-of-table */
+            if (deny == NULL) break;
+            if (mctx->msglevel >= 999 && mctx->msgfp != NULL) { /* debugging */
+                fprintf(mctx->msgfp, "main> invalid iref=%d: deny=%s http_referer=%s\n",
+                        iref, deny, (http_referer == NULL ? "null" : http_referer));
+                fflush(mctx->msgfp);
+            }
+            if (*deny == '\000') {     /* signal to check for no referer */
+                if (http_referer == NULL)      /* http_referer not supplied */
+                    msgnum = denyreferer[iref].msgnum;
+            } /* so set message# */
+            else
+            /* have referer to check for */
+                if (http_referer != NULL)     /* and have referer to be checked */
+                    if (isstrstr(http_referer, deny, 0)) /* invalid http_referer */
+                        /* so set message# */
+                        msgnum = denyreferer[iref].msgnum;
+        } /* --- end-of-for(iref) --- */
+        if (msgnum >= 0) {           /* deny access to this referer */
+            /* keep index within bounds */
+            if (msgnum > maxmsgnum) msgnum = 0;
+            /* set user error message */
+            expression = msgtable[msgnum];
+            isinvalidreferer = 1;
+        }      /* and signal invalid referer */
+    } /* --- end-of-if(!isinvalidreferer) --- */
+    /* --- also check maximum query_string length if no http_referer given --- */
+    if (!isinvalidreferer) {
+        /* nor if already invalid referer */
+        if (!ishttpreferer) {
+            /* no http_referer supplied */
+            if (strlen(expression) > norefmaxlen) {   /* query_string too long */
+                if (isempty(referer_match)) {
+                    /* no referer_match to display */
+                    /* set invalid http_referer message*/
+                    expression = invalid_referer_msg;
+                } else {              /* error with referer_match display*/
+                    /* init error message */
+                    strcpy(expression, invalid_referer_match);
+                    strreplace(expression, "SERVER_NAME", /* and then replace SERVER_NAME */
+                               strdetex(mctx, urlprune(referer_match, reflevels), 1), 0);
+                } /*with host_http*/
+                isinvalidreferer = 1;
+            } /* and signal invalid referer */
+        }
+    }
+    /* back with expression to be rendered */
+    return (expression);
+} /* --- end-of-function checkreferer() --- */
+
+
+/* --- main()'s progname, for serverender()'s referer checks --- */
+static char *serveprogname = "mimetex";
+
+/* ==========================================================================
+ * Function:    serverender ( mctx, req )
+ * Purpose: SERVEFUNC for mimetex --serve and --http, renders one
+ *      request's query string the way main() renders a QUERY_STRING
+ * --------------------------------------------------------------------------
+ * Arguments:   mctx (I)    mimetex_ctx * to the worker's context
+ *      req (I/O)   servereq * whose query is rendered into
+ *              req->image, and whose nbytes, valign, maxage are set
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #bytes of image in req->image, or 0 if failed
+ * --------------------------------------------------------------------------
+ * Notes:     o Runs in serve_run()'s worker threads, so main()'s globals
+ *      are only read here (ninputcmds, inputseclevel are per-thread).
+ *        o Referer checks use req->referer and req->host, which
+ *      are NULL for --serve requests, as for a CGI request
+ *      without an HTTP_REFERER.
+ *        o There are no msglevel=/logfile= prefixes or logging,
+ *      and no cachepath files, but cacheable images are kept
+ *      in req->cache (if not NULL), so repeats aren't rendered,
+ *      nor are simultaneous requests for one image (the first
+ *      renders it, and imgcache_get() holds the rest till then).
+ * ======================================================================= */
+/* --- entry point --- */
+static int serverender(mimetex_ctx *mctx, servereq *req)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* query, unescaped in place */
+    char *expression = req->query;
+    /* +'s are blanks, as for QUERY_STRING */
+    int plusblank = ISPLUSBLANK;
+    /* true if query is <form> input */
+    int isformdata = 0;
+    /* true if image may come from, and go to, req->cache */
+    int iscache = 0;
+    /* #chars in exprprefix */
+    int npref = strlen(exprprefix);
+    /* http_referer must match Host:, or else SERVER_NAME */
+    char *referer_match = (!isempty(req->host) ? req->host : getenv("SERVER_NAME"));
+    /* size, baseline, etc of rendered image */
+    mimetex_image image;
+    /* ------------------------------------------------------------
+    convert query to expression, as main() does
+    ------------------------------------------------------------ */
+    /* reset count of \input commands */
+    ninputcmds = 0;
+    /* empty query gets an error message, as from main() */
+    if (*expression == '\000') strcpy(expression, noquerymsg);
+    /* convert _all_ %xx's to chars */
+    isformdata = unescape_query(expression, &plusblank);
+    /* --- expression whose last char is \ --- */
+    if (lastchar(expression) == '\\'   /* last char is backslash */
+            &&   strlen(expression) < MAXEXPRSZ)
+        /* assume "\ " lost the final space*/
+        strcat(expression, " ");
+    /* --- prepend prefix{ and append } --- */
+    if (npref > 0 && strlen(expression) + npref + 2 <= MAXEXPRSZ) {
+        /*make room*/
+        memmove(expression + npref + 1, expression, strlen(expression) + 1);
+        /* copy prefix into expression */
+        memcpy(expression, exprprefix, npref);
+        /* followed by { */
+        expression[npref] = '{';
+        strcat(expression, "}");
+    }
+    /* --- check http_referer, as main() does --- */
+    expression = checkreferer(mctx, expression, req->referer, referer_match,
+                              serveprogname);
+    /* --- max-age is two hours, or 5 seconds if not cacheable --- */
+    iscache = iscacheable(expression, isformdata);
+    req->maxage = (iscache ? 7200 : 5);
+    /* ------------------------------------------------------------
+    serve it from req->cache, or render it and cache it
+    ------------------------------------------------------------ */
+    if (iscache) {               /* \counter, \today, etc vary */
+        req->nbytes = imgcache_get(req->cache, mctx, &req->options, expression,
+                                   req->image, req->maxbytes, &req->valign);
+        if (req->nbytes > 0)     /* hit, so no need to render */
+            return (req->nbytes);
+        if (req->nbytes < 0) {   /* someone else's render just failed */
+            req->nbytes = 0;
+            req->valign = (-9999);
+            return (0);
+        }
+    }
+    req->nbytes = mimetex_render(mctx, expression, &req->options,
+                                 req->image, req->maxbytes, &image);
+    req->valign = (req->nbytes > 0 ? image.valign : (-9999));
+    if (iscache)        /* keep it for next time, and for any waiting */
+        imgcache_put(req->cache, mctx, &req->options, expression,
+                     req->image, req->nbytes, req->valign);
+    return (req->nbytes);
+} /* --- end-of-function serverender() --- */
+
+
 /* ==========================================================================
  * Function:    main() driver for mimetex.c
  * Purpose: emits a mime xbitmap or gif image of a LaTeX math expression
@@ -2356,6 +2457,12 @@ end_of_job:
  *              |-f input_file] or read expression from file
  *              [-m mctx.msglevel]   verbosity of debugging output
  *              [-s fontsize]   default fontsize, 0-5
+ *              [-g format]     -g0 gif, -g1 pbm, -g2 pgm, -g3 xbm, -g4 png
+ *              [-z level]      png compression level, 0-9
+ *              [--serve address] render server on a socket
+ *              [--http address]  http/1.1 render server
+ *              [-w workers]    #render threads for --serve
+ *              [--cache megabytes] image cache for --serve
  *      -d   Rather than ascii debugging output, mimeTeX dumps the
  *           actual gif (or xbitmap) to stdout, e.g.,
  *          ./mimetex  -d  x^2+y^2  > expression.gif
@@ -2372,6 +2479,27 @@ end_of_job:
  *           also be specified in the expression by a leading
  *           preamble terminated by $, e.g., 3$f(x)=x^2 displays
  *           f(x)=x^2 at font size 3.  Default font size is 2.
+ *      -g   Image format of an -e output file, e.g., -g4 for png.
+ *           Without -g, the file's extension (.gif,.png,etc) decides.
+ *      -z   Deflate level for png images, 0=stored...9=smallest,
+ *           default 6.
+ *      --serve  Runs as a server rendering requests that arrive on
+ *           a unix socket, if address contains a /, e.g.,
+ *           --serve /var/run/mimetex.sock, or else on a tcp
+ *           [host:]port, e.g., --serve 8000 (host 127.0.0.1).
+ *           Each request is a query string, rendered like
+ *           QUERY_STRING, in the -g format (gif by default),
+ *           at the -s size, with the -a,-o,etc switches given.
+ *           See serve.h for the protocol.  Stop it with SIGTERM.
+ *      --http   Like --serve, but answers http/1.1 requests
+ *           GET /?expression, e.g., --http 8080, with the
+ *           Cache-Control: and Vertical-Align: headers of
+ *           a CGI reply, and checks Referer: as for a CGI query.
+ *      -w   #worker threads rendering --serve or --http requests,
+ *           default 4.
+ *      --cache  Megabytes of rendered images a --serve or --http
+ *           server keeps in memory, default 64, or 0 for none.
+ *           GET /stats shows an --http server's hits, misses, etc.
  * --------------------------------------------------------------------------
  * Exits:   0=success, 1=some error
  * --------------------------------------------------------------------------
@@ -2420,7 +2548,7 @@ int main(int argc, char *argv[], char *envp[])
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
-    static char *suffix[] = { ".gif", ".pbm", ".pgm", ".xbm" };
+    static char *suffix[] = { ".gif", ".pbm", ".pgm", ".xbm", ".png" };
     /* --- expression to be emitted --- */
     /* input TeX expression */
     static  char exprbuffer[MAXEXPRSZ+1] = "f(x)=x^2";
@@ -2447,46 +2575,28 @@ int main(int argc, char *argv[], char *envp[])
     raster *bp = NULL;
     /* for clean-up at end-of-job */
     /* --- http_referer --- */
-    /* http_referer must contain this */
-    char    *referer = REFERER;
-    /*http_referer's permitted to \input*/
-    char    *inputreferer = INPUTREFERER;
-    /* cmp http_referer,server_name */
-    int reflevels = REFLEVELS;
-    /* prune referer_match */
-    struct  {
-        /* http_referer can't contain this */
-        char *referer;
-        int msgnum;
-    } denyreferer[] = {       /* referer table to deny access to */
-#ifdef DENYREFERER
-#include DENYREFERER      /* e.g.,  {"",1},  for no referer */
-#endif
-        { NULL, -999 }
-    /* trailer */
-    };
     char    *http_referer = getenv("HTTP_REFERER"), /* referer using mimeTeX */
             *http_host    = getenv("HTTP_HOST"), /* http host for mimeTeX */
             *server_name  = getenv("SERVER_NAME"), /* server hosting mimeTeX */
             *referer_match = (!isempty(http_host) ? http_host : /*match http_host*/
                              (!isempty(server_name) ? server_name : (NULL))); /* or server_name */
-    int ishttpreferer = (isempty(http_referer) ? 0 : 1);
-    /* true for inavlid referer */
-    int isinvalidreferer = 0;
-    /*max query_string len if no referer*/
-    int norefmaxlen = NOREFMAXLEN;
     /* --- gif --- */
     char *outfile = (char *)NULL;
     char outfilebuf[256];
     char *pdot;
-    char cachefile[256] = "\000";    /* full path and name to cache file*/
+    char cachefile[256+DISKCACHEKEYSZ+8] = "\000"; /* path to cache file */
+    char cachekey[DISKCACHEKEYSZ] = "\000"; /* cache file's name */
+    packcache *pack = NULL;          /* cachepath/cachepack, if open */
     /* max-age is two hours */
     int maxage = 7200;
     /*Vertical-Align:baseline-(height-1)*/
     int valign = (-9999);
     /* --- image format (-g switch) --- */
-    /* -1=detect by filename 0=gif 1=pbm 2=pgm 3=xbm */
+    /* -1=detect by filename 0=gif 1=pbm 2=pgm 3=xbm 4=png */
     int ptype = -1;
+    /* --- render server (--serve or --http address, -w workers) --- */
+    char *serveaddr = NULL;
+    int nworkers = SERVEWORKERS, ishttp = 0, cachemb = IMGCACHEMB;
     /* --- anti-aliasing --- */
     intbyte *bytemap_raster = NULL;    /* anti-aliased bitmap */
     intbyte *colormap_raster = NULL;
@@ -2502,10 +2612,6 @@ int main(int argc, char *argv[], char *envp[])
     char    *progname = (argc > 0 ? argv[0] : "noname");
     char    *dashes =           /* separates logfile entries */
         "--------------------------------------------------------------------------";
-    /*msg to invalid referer*/
-    char    *invalid_referer_msg = msgtable[invmsgnum];
-    /*referer isn't host*/
-    char    *invalid_referer_match = msgtable[refmsgnum];
     mimetex_ctx mctx;
     /* ------------------------------------------------------------
     initialization
@@ -2516,16 +2622,7 @@ int main(int argc, char *argv[], char *envp[])
     }
 
     /* install extra handlers */
-    {
-        int i;
-        for (i = 0; i < sizeof(symtables) / sizeof(*symtables); i++) {
-            if (!symtables[i].table) {
-                symtables[i].family = NOVALUE;
-                symtables[i].table = extra_handlers;
-                break;
-            }
-        }
-    }
+    mimetex_add_handlers(extra_handlers);
     /* --- set global variables --- */
     strcpy(pathprefix, PATHPREFIX);
     /* for command-line mode output */
@@ -2563,7 +2660,7 @@ int main(int argc, char *argv[], char *envp[])
             if (0)               /*true to remove leading whitespace*/
                 while (isspace(*expression) && *expression != '\000')
                     /* squeeze out white space */
-                    strcpy(expression, expression + 1);
+                    strsqueeze(expression, 1);
             isquery = 1;
         }          /* and set isquery flag */
     if (!isquery) {              /* empty query string */
@@ -2574,10 +2671,8 @@ int main(int argc, char *argv[], char *envp[])
             isquery = 1;
             /* signal error */
             if (exitstatus == 0) exitstatus = errorstatus;
-            strcpy(expression,
             /* and give user an error message */
-                   "\\red\\small\\rm\\fbox{\\begin{gather}\\LaTeX~expression~not~supplied"
-                   "\\\\i.e.,~no~?query\\_string~given~to~mimetex.cgi\\end{gather}}");
+            strcpy(expression, noquerymsg);
         }
         /* signal empty query string */
         isqempty = 1;
@@ -2630,6 +2725,18 @@ int main(int argc, char *argv[], char *envp[])
                 /* arg following flag/switch is usually its value */
                 /* another switch on command line */
                 nswitches++;
+                if (strcmp(field, "-serve") == 0     /* --serve address */
+                        ||   strcmp(field, "-http") == 0) { /* --http address */
+                    if (argnum < argc) serveaddr = argv[argnum];
+                    else nbadargs++;
+                    ishttp = (field[1] == 'h');
+                    continue;
+                }
+                if (strcmp(field, "-cache") == 0) { /* --cache megabytes */
+                    if (argnum < argc) cachemb = atoi(argv[argnum]);
+                    else nbadargs++;
+                    continue;
+                }
                 if (isstrict &&            /* if strict checking then... */
                         !isthischar(flag, "g") && arglen != 1) { /*must be single-char switch*/
                     /* so ignore longer -xxx switch */
@@ -2663,7 +2770,7 @@ int main(int argc, char *argv[], char *envp[])
                     case 'g':
                         /* -g2 ==> ptype=2 */
                         if (arglen > 1) ptype = atoi(field + 1);
-                        if (ptype < 0 || ptype > sizeof(suffix) / sizeof(*suffix))
+                        if (ptype < 0 || ptype >= sizeof(suffix) / sizeof(*suffix))
                             ptype = 0;
                         argnum--;
                         break;
@@ -2688,6 +2795,12 @@ int main(int argc, char *argv[], char *envp[])
                     case 's':
                         if (argnum < argc) size = atoi(argv[argnum]);
                         break;
+                    case 'z':
+                        if (argnum < argc) mctx.pnglevel = atoi(argv[argnum]);
+                        break;
+                    case 'w':
+                        if (argnum < argc) nworkers = atoi(argv[argnum]);
+                        break;
                     } /* --- end-of-switch(flag) --- */
                 }
             } /* --- end-of-if(*argv[argnum]=='-') --- */
@@ -2794,32 +2907,37 @@ int main(int argc, char *argv[], char *envp[])
         /* emulate query string processing */
         if (isqforce) isquery = 1;
     } /* --- end-of-if(!isquery) --- */
+    /* ---
+     * or run as a render server, if given --serve or --http address
+     * ------------------------------------------------------------ */
+    if (serveaddr != NULL) {
+        serveconfig config;
+        config.address = serveaddr;
+        config.ishttp = ishttp;
+        config.nworkers = nworkers;
+        config.mctx = &mctx;
+        config.options.size = size;
+        config.options.format = (ptype == MIMETEX_PBM || ptype == MIMETEX_PGM
+                                 || ptype == MIMETEX_PNG ? ptype : MIMETEX_GIF);
+        /* render failure messages, as for queries */
+        config.options.iserrormsg = 1;
+        config.render = serverender;
+        /* NULL (no cache) for --cache 0 */
+        config.cache = imgcache_create(1048576L * cachemb);
+        serveprogname = progname;
+        /* decode fonts once, before the first request */
+        mimetex_warm_glyphs(&mctx);
+        if (serve_run(&config) != 0)  /* couldn't start */
+            exit(1);
+        imgcache_destroy(config.cache);
+        goto end_of_job;
+    } /* --- end-of-if(serveaddr!=NULL) --- */
     /* ---
      * check for <form> input
      * ------------------------------------------------------------ */
-    if (isquery) {               /* must be <form method="get"> */
-        if (!memcmp(expression, "formdata", 8)) { /*must be <input name="formdata"> */
-            /* find equal following formdata */
-            char *delim = strchr(expression, '=');
-            if (delim != (char *)NULL)   /* found unescaped equal sign */
-                /* so shift name= out of expression*/
-                strcpy(expression, delim + 1);
-            while ((delim = strchr(expression, '+')) != NULL) /*unescaped plus sign*/
-                /* is "shorthand" for blank space */
-                *delim = ' ';
-            /*unescape_url(expression,1);*/ /* convert unescaped %xx's to chars */
-            /* convert all %xx's to chars */
-            unescape_url(expression, 0);
-            /* repeat */
-            unescape_url(expression, 0);
-            /* mctx.msglevel for forms */
-            if (0) mctx.msglevel = FORMLEVEL;
-            isformdata = 1;
-        }           /* set flag to signal form data */
-        else
-        /* --- query, but not <form> input --- */
-            unescape_url(expression, 0);
-    }   /* convert _all_ %xx's to chars */
+    if (isquery)                 /* must be <form method="get"> */
+        /* convert _all_ %xx's to chars */
+        isformdata = unescape_query(expression, &isplusblank);
     /* ---
      * check queries for prefixes/suffixes/embedded that might cause problems
      * ------------------------------------------------------------ */
@@ -2870,7 +2988,7 @@ int main(int argc, char *argv[], char *envp[])
                             !=   NULL) {            /* ignore logging if can't open */
                         /* --- default logging --- */
                         /* log query */
-                        logger(mctx.msgfp, mctx.msglevel, expression, mimelog);
+                        logger(&mctx, mctx.msgfp, mctx.msglevel, expression, mimelog);
                         /* --- additional debug logging (argv and environment) --- */
                         if (mctx.msglevel >= 9) {        /* log environment */
                             /*char name[999],*value;*/
@@ -2950,118 +3068,9 @@ int main(int argc, char *argv[], char *envp[])
     /* ---
      * check if http_referer is allowed to use this image and to use \input{}
      * ------------------------------------------------------------ */
-    if (isquery) {           /* not relevant if "interactive" */
-        /* --- check -DREFERER=\"comma,separated,list\" of valid referers --- */
-        if (referer != NULL) {          /* compiled with -DREFERER=\"...\" */
-            if (strcmp(referer, "month") != 0)     /* but it's *only* "month" signal */
-                if (ishttpreferer)            /* or called "standalone" */
-                    if (!isstrstr(http_referer, referer, 0)) { /* invalid http_referer */
-                        /* so give user error message */
-                        expression = invalid_referer_msg;
-                        isinvalidreferer = 1;
-                    }
-        }     /* and signal invalid referer */
-        else
-        /* compiled without -DREFERER= */
-            if (reflevels > 0) {       /*match referer unless -DREFLEVELS=0*/
-                /* --- check topmost levels of http_referer against http_host --- */
-                if (ishttpreferer             /* have http_referer */
-                        &&   !isempty(referer_match))    /* and something to match it with */
-                    if (!urlncmp(http_referer, referer_match, reflevels)) { /*match failed*/
-                        /* init error message */
-                        strcpy(exprbuffer, invalid_referer_match);
-                        strreplace(exprbuffer, "SERVER_NAME", /* and then replace SERVER_NAME */
-                                   /*with referer_match*/
-                                   strdetex(urlprune(referer_match, reflevels), 1), 0);
-                        isinvalidreferer = 1;
-                    }        /* and signal invalid referer */
-            } /* --- end-of-if(reflevels>0) --- */
-        /* --- check -DINPUTREFERER=\"comma,separated,list\" of \input users --- */
-        /* set default input security */
-        inputseclevel = INPUTSECURITY;
-        if (inputreferer != NULL) {         /* compiled with -DINPUTREFERER= */
-            if (http_referer == NULL)          /* but no http_referer given */
-                /* unknown user can't \input{} */
-                inputseclevel = (-1);
-            else
-            /*have inputreferer and http_referer*/
-                if (!isstrstr(http_referer, inputreferer, 0)) /*http_referer can't \input*/
-                    /* this known user can't \input{} */
-                    inputseclevel = (-1);
-        } /* --- end-of-if(inputreferer!=NULL) --- */
-    } /* --- end-of-if(isquery) --- */
-    /* ---
-     * check if referer contains "month" signal
-     * ------------------------------------------------------------ */
     if (isquery)                 /* not relevant if "interactive" */
-        if (referer != NULL)            /* nor if compiled w/o -DREFERER= */
-            if (!isinvalidreferer)         /* nor if already invalid referer */
-                if (strstr(referer, "month") != NULL)  /* month check requested */
-                    if (!ismonth(progname)) {        /* not executed as mimetexJan-Dec */
-                        /* so give user error message */
-                        expression = invalid_referer_msg;
-                        isinvalidreferer = 1;
-                    }      /* and signal invalid referer */
-    /* ---
-     * check if http_referer is to be denied access
-     * ------------------------------------------------------------ */
-    if (isquery) { /* not relevant if "interactive" */
-        if (!isinvalidreferer) {        /* nor if already invalid referer */
-            /* denyreferer index, message# */
-            int iref = 0, msgnum = (-999);
-            for (iref = 0; msgnum < 0; iref++) { /* run through denyreferer[] table */
-                /* referer to be denied */
-                char *deny = denyreferer[iref].referer;
-                /* null signals end-of-table */
-                if (deny == NULL) break;
-                if (mctx.msglevel >= 999 && mctx.msgfp != NULL) { /* debugging */
-                    fprintf(mctx.msgfp, "main> invalid iref=%d: deny=%s http_referer=%s\n",
-                            iref, deny, (http_referer == NULL ? "null" : http_referer));
-                    fflush(mctx.msgfp);
-                }
-                if (*deny == '\000') {     /* signal to check for no referer */
-                    if (http_referer == NULL)      /* http_referer not supplied */
-                        msgnum = denyreferer[iref].msgnum;
-                } /* so set message# */
-                else
-                /* have referer to check for */
-                    if (http_referer != NULL)     /* and have referer to be checked */
-                        if (isstrstr(http_referer, deny, 0)) /* invalid http_referer */
-                            /* so set message# */
-                            msgnum = denyreferer[iref].msgnum;
-            } /* --- end-of-for(iref) --- */
-            if (msgnum >= 0) {           /* deny access to this referer */
-                /* keep index within bounds */
-                if (msgnum > maxmsgnum) msgnum = 0;
-                /* set user error message */
-                expression = msgtable[msgnum];
-                isinvalidreferer = 1;
-            }      /* and signal invalid referer */
-        } /* --- end-of-if(!isinvalidreferer) --- */
-    }
-    /* --- also check maximum query_string length if no http_referer given --- */
-    if (isquery) {
-        /* not relevant if "interactive" */
-        if (!isinvalidreferer) {
-            /* nor if already invalid referer */
-            if (!ishttpreferer) {
-                /* no http_referer supplied */
-                if (strlen(expression) > norefmaxlen) {   /* query_string too long */
-                    if (isempty(referer_match)) {
-                        /* no referer_match to display */
-                        /* set invalid http_referer message*/
-                        expression = invalid_referer_msg;
-                    } else {              /* error with referer_match display*/
-                        /* init error message */
-                        strcpy(exprbuffer, invalid_referer_match);
-                        strreplace(exprbuffer, "SERVER_NAME", /* and then replace SERVER_NAME */
-                                   strdetex(urlprune(referer_match, reflevels), 1), 0);
-                    } /*with host_http*/
-                    isinvalidreferer = 1;
-                } /* and signal invalid referer */
-            }
-        }
-    }
+        expression = checkreferer(&mctx, expression, http_referer,
+                                  referer_match, progname);
     /* ---
      * emit copyright, gnu/gpl notice (if "interactive")
      * ------------------------------------------------------------ */
@@ -3108,7 +3117,7 @@ int main(int argc, char *argv[], char *envp[])
             /*render expression as \rm*/
             strcat(errormsg, "{\\rm\\hspace{10}{");
             /*add detexed expression to msg*/
-            strcat(errormsg, strdetex(expression, 0));
+            strcat(errormsg, strdetex(&mctx, expression, 0));
             /* finish up */
             strcat(errormsg, "}\\hspace{10}}\\end{gather}}");
             if ((sp = rasterize(&mctx, errormsg, 1)) == NULL)  /*couldn't rasterize errmsg*/
@@ -3139,7 +3148,6 @@ int main(int argc, char *argv[], char *envp[])
          * ------------------------------------------------------------ */
         /*#bytes needed in byte,colormap*/
         int   nbytes = (bp->width) * (bp->height);
-        /* anti-aliasing wanted */
         /* malloc bytemap and colormap */
         if ((bytemap_raster = (intbyte *)malloc(nbytes)) == NULL) {
             fprintf(mctx.msgfp, "allocation failure\n");
@@ -3151,84 +3159,53 @@ int main(int argc, char *argv[], char *envp[])
             goto end_of_job;
         }
         /* ---
-         * now generate anti-aliased bytemap and colormap from bitmap
+         * now generate anti-aliased bytemap, colors and colormap from bitmap
          * ------------------------------------------------------------ */
+        /* aalookup() pattern# counts are displayed below */
+        mctx.ispatternnumcount = (mctx.msglevel >= 99);
+        if ((ncolors = aaraster(&mctx, bp, bytemap_raster, colormap_raster, colors))
+                <    2) {                /* failed */
+            /* so turn off anti-aliasing */
+            mctx.aaalgorithm = 0;
+            /* and reset for black&white */
+            ncolors = 2;
+            free(bytemap_raster);
+            bytemap_raster = NULL;
+            free(colormap_raster);
+            colormap_raster = NULL;
+        }
         /* ---
-         * select anti-aliasing algorithm
+         * emit aalookup() pattern# counts/percents diagnostics
          * ------------------------------------------------------------ */
-        /* generate bytemap for lowpass */
-        switch (mctx.aaalgorithm) {          /* choose antialiasing algorithm */
-        default:
-            /* unrecognized algorithm */
-            mctx.aaalgorithm = 0;
-            break;
-        case 1:              /* 1 for aalowpass() */
-            /*my own lowpass filter*/
-            /*failed, so turn off anti-aliasing*/
-            if (aalowpass(&mctx,bp, bytemap_raster, grayscale) == 0) {
-                mctx.aaalgorithm = 0;
-            }
-            break;
-        case 2:              /*2 for netpbm pnmalias.c algorithm*/
-            if (aapnm(&mctx, bp, bytemap_raster, grayscale) == 0) {
-                mctx.aaalgorithm = 0;
-            }
-            break;
-        case 3:              /*3 for aapnm() based on aagridnum()*/
-            if (aapnmlookup(&mctx, bp, bytemap_raster, grayscale) == 0) {
-                mctx.aaalgorithm = 0;
-            }
-            break;
-        case 4:              /* 4 for aalookup() table lookup */
-            if (aalowpasslookup(&mctx, bp, bytemap_raster, grayscale) == 0) {
-                mctx.aaalgorithm = 0;
-            }
-            break;
-        } /* --- end-of-switch(aaalgorithm) --- */
-        if (mctx.aaalgorithm) {              /* we have bytemap_raster */
-            /* ---
-             * emit aalookup() pattern# counts/percents diagnostics
-             * ------------------------------------------------------------ */
-            if (!isquery && mctx.msgfp != NULL && mctx.msglevel >= 99) { /*emit patternnumcounts*/
-                /* init total w,b center counts */
-                int pcount0 = 0, pcount1 = 0;
-                for (ipattern = 1; ipattern <= 51; ipattern++) { /*each possible pattern*/
-                    if (ipattern > 1)          /* ignore all-white squares */
-                        /* bump total white centers */
-                        pcount0 += mctx.patternnumcount0[ipattern];
-                    pcount1 += mctx.patternnumcount1[ipattern];
-                } /* bump total black centers */
-                if (pcount0 + pcount1 > 0)      /* have pcounts (using aalookup) */
-                    fprintf(mctx.msgfp, "  aalookup() patterns excluding#1 white"
-                            " (%%'s are in tenths of a percent)...\n");
-                for (ipattern = 1; ipattern <= 51; ipattern++) { /*each possible pattern*/
-                    int tot = mctx.patternnumcount0[ipattern] + mctx.patternnumcount1[ipattern];
-                    if (tot > 0)           /* this pattern occurs in image */
-                        fprintf(mctx.msgfp,
-                                "  pattern#%2d: %7d(%6.2f%%) +%7d(%6.2f%%) =%7d(%6.2f%%)\n",
-                                ipattern, mctx.patternnumcount0[ipattern], (ipattern <= 1 ? 999.99 :
-                                                                       1000.*((double)mctx.patternnumcount0[ipattern]) / ((double)pcount0)),
-                                mctx.patternnumcount1[ipattern],
-                                1000.*((double)mctx.patternnumcount1[ipattern]) / ((double)pcount1),
-                                tot, (ipattern <= 1 ? 999.99 :
-                                      1000.*((double)tot) / ((double)(pcount0 + pcount1))));
-                }
-                if (pcount0 + pcount1 > 0) /* true when using aalookup() */
+        if (mctx.aaalgorithm             /* we have bytemap_raster */
+                &&   !isquery && mctx.msgfp != NULL && mctx.msglevel >= 99) { /*emit patternnumcounts*/
+            /* init total w,b center counts */
+            int pcount0 = 0, pcount1 = 0;
+            for (ipattern = 1; ipattern <= 51; ipattern++) { /*each possible pattern*/
+                if (ipattern > 1)          /* ignore all-white squares */
+                    /* bump total white centers */
+                    pcount0 += mctx.patternnumcount0[ipattern];
+                pcount1 += mctx.patternnumcount1[ipattern];
+            } /* bump total black centers */
+            if (pcount0 + pcount1 > 0)      /* have pcounts (using aalookup) */
+                fprintf(mctx.msgfp, "  aalookup() patterns excluding#1 white"
+                        " (%%'s are in tenths of a percent)...\n");
+            for (ipattern = 1; ipattern <= 51; ipattern++) { /*each possible pattern*/
+                int tot = mctx.patternnumcount0[ipattern] + mctx.patternnumcount1[ipattern];
+                if (tot > 0)           /* this pattern occurs in image */
                     fprintf(mctx.msgfp,
-                            "all patterns: %7d          +%7d          =%7d  total pixels\n",
-                            pcount0, pcount1, pcount0 + pcount1);
-            }
-            if (colormap_raster) {
-                /* ---
-                 * finally, generate colors and colormap
-                 * ------------------------------------------------------------ */
-                ncolors = aacolormap(&mctx, bytemap_raster, nbytes, colors, colormap_raster);
-                if (ncolors < 2) {     /* failed */
-                    /* so turn off anti-aliasing */
-                    mctx.aaalgorithm = 0;
-                    ncolors = 2;
-                }        /* and reset for black&white */
+                            "  pattern#%2d: %7d(%6.2f%%) +%7d(%6.2f%%) =%7d(%6.2f%%)\n",
+                            ipattern, mctx.patternnumcount0[ipattern], (ipattern <= 1 ? 999.99 :
+                                                                   1000.*((double)mctx.patternnumcount0[ipattern]) / ((double)pcount0)),
+                            mctx.patternnumcount1[ipattern],
+                            1000.*((double)mctx.patternnumcount1[ipattern]) / ((double)pcount1),
+                            tot, (ipattern <= 1 ? 999.99 :
+                                  1000.*((double)tot) / ((double)(pcount0 + pcount1))));
             }
+            if (pcount0 + pcount1 > 0) /* true when using aalookup() */
+                fprintf(mctx.msgfp,
+                        "all patterns: %7d          +%7d          =%7d  total pixels\n",
+                        pcount0, pcount1, pcount0 + pcount1);
         }
     } /* --- end-of-if(isaa) --- */
     /* ------------------------------------------------------------
@@ -3282,56 +3259,80 @@ int main(int argc, char *argv[], char *envp[])
                     gif_raster(&mctx, ncolors, bp, colormap_raster, colors, fp, NULL, 0);
                 } else if (ptype == 1) {
                     if (ncolors == 2)
-                        type_pbmpgm(bp, 1, fp);  /* emit b/w pbm file */
+                        type_pbmpgm(bp, 1, fp, NULL, 0);  /* emit b/w pbm file */
                     else
                         fprintf(mctx.msgfp, "-g1 (pbm) doesn't allow grayscaled images\n");
+                    fclose(fp);
                 } else if (ptype == 2) {
                     /*construct arg for write_pbmpgm()*/
                     raster pbm_raster;
                     pbm_raster.width  = bp->width;
                     pbm_raster.height = bp->height;
+                    pbm_raster.format = 1;
                     pbm_raster.pixsz  = 8;
                     pbm_raster.pixmap = (pixbyte *)bytemap_raster;
-                    type_pbmpgm(&pbm_raster, 2, fp);
+                    pbm_raster.stride = bp->width;
+                    /* b&w bitmap if not anti-aliased */
+                    type_pbmpgm((bytemap_raster == NULL ? bp : &pbm_raster), 2, fp, NULL, 0);
+                    fclose(fp);
                 } else if (ptype == 3) {
                     xbitmap_raster(bp, fp);
+                } else if (ptype == 4) {
+                    png_raster(&mctx, ncolors, bp, colormap_raster, colors, fp, NULL, 0);
+                    fclose(fp);
                 }
             }
         }
     } else {
+        /* gif written in memory buffer */
+        char gif_buffer[MAXGIFSZ] = "\000";
+        /* #bytes of gif in gif_buffer */
+        int gifSize = 0;
         /* ---
          * check for image caching
          * ------------------------------------------------------------ */
-        if (strstr(expression, "\\counter")  != NULL /* can't cache \counter{} */
-                ||   strstr(expression, "\\input")    != NULL /* can't cache \input{} */
-                ||   strstr(expression, "\\today")    != NULL /* can't cache \today */
-                ||   strstr(expression, "\\calendar") != NULL /* can't cache \calendar */
-                ||   strstr(expression, "\\nocach")   != NULL /* no caching requested */
-                ||   isformdata             /* don't cache user form input */
-           ) {
+        if (!iscacheable(expression, isformdata)) {
             /* so turn caching off */
             iscaching = 0;
             maxage = 5;
         }          /* and set max-age to 5 seconds */
         if (iscaching) {            /* image caching enabled */
             /* --- set up path to cached image file --- */
-            /* md5 hash of expression */
-            /* relative path to cached files */
-            char *md5hash = md5str(expression);
-            if (md5hash == NULL)       /* failed for some reason */
+            /* options the image is rendered with */
+            mimetex_options cacheopts;
+            memset((void *)&cacheopts, 0, sizeof(cacheopts));
+            cacheopts.size = size;
+            cacheopts.format = MIMETEX_GIF;
+            cacheopts.iserrormsg = 1;
+            if (!diskcache_key(&mctx, &cacheopts, expression, cachekey)
+                    || !diskcache_file(cachepath, cachekey, cachefile))
                 /* so turn off caching */
                 iscaching = 0;
             else {
-                /* start with (relative) path */
-                strcpy(cachefile, cachepath);
-                /* add md5 hash of expression */
-                strcat(cachefile, md5hash);
-                /* finish with .gif extension */
-                strcat(cachefile, ".gif");
+                /* --- images in one pack file, if -DCACHEPACK --- */
+                if (*cachepack != '\000') {
+                    char packfile[512];
+                    sprintf(packfile, "%s%s", cachepath, cachepack);
+                    /* (else a file per image) */
+                    if ((pack = packcache_open(packfile, 1048576L * CACHEMB)) != NULL)
+                        sprintf(cachefile, "%s%s", cachepath, cachekey);
+                }
                 /* --- emit cached image if it already exists --- */
-                if (emitcache(cachefile, maxage, valign, 0) > 0) /* cached image emitted */
+                if (pack != NULL) {
+                    /* image in mapped pack, and its Vertical-Align: */
+                    unsigned char *image = NULL;
+                    int packvalign = valign;
+                    if ((gifSize = packcache_get(pack, cachekey, &image, &packvalign)) > 0) {
+                        emitcache((char *)image, maxage, packvalign, gifSize);
+                        /* so nothing else to do */
+                        goto end_of_job;
+                    }
+                } else if ((gifSize = diskcache_get(cachepath, cachekey,
+                                                    (unsigned char *)gif_buffer, MAXGIFSZ)) > 0) {
+                    emitcache(gif_buffer, maxage, valign, gifSize);
                     /* so nothing else to do */
                     goto end_of_job;
+                }
                 /* --- log caching request --- */
                 if (mctx.msglevel >= 1             /* check if logging */
                         /*&&   seclevel <= 5*/)      /* and if logging permitted */
@@ -3350,7 +3351,7 @@ int main(int argc, char *argv[], char *envp[])
                                 int isreflogged = 0;
                                 fprintf(filefp, "%s                 %s\n", /* timestamp, md5 file */
                                         /*skip path*/
-                                        timestamp(tzdelta, 0), cachefile + strlen(cachepath));
+                                        timestamp(&mctx, tzdelta, 0), cachefile + strlen(cachepath));
                                 /* expression in filename */
                                 fprintf(filefp, "%s\n", expression);
                                 if (http_referer != NULL)     /* show referer if we have one */
@@ -3377,27 +3378,23 @@ int main(int argc, char *argv[], char *envp[])
                                 fclose(filefp);
                             }             /* close logfile immediately */
                         } /* --- end-of-if(cachelog!=NULL) --- */
-            } /* --- end-of-if/else(md5hash==NULL) --- */
+            } /* --- end-of-if/else(!diskcache_key()) --- */
         } /* --- end-of-if(iscaching) --- */
 
-        {
-            int gifSize = 0;
-            char gif_buffer[MAXGIFSZ] = "\000";  /* or gif written in memory buffer */
-            FILE *fp = iscaching ? fopen(cachefile, "wb"): NULL;
-            if (fp == NULL)
-                gifSize = gif_raster(&mctx, ncolors, bp, colormap_raster, colors, NULL, gif_buffer, sizeof(gif_buffer));
+        /* --- gif written in memory buffer, cached, then emitted --- */
+        gifSize = gif_raster(&mctx, ncolors, bp, colormap_raster, colors, NULL, gif_buffer, MAXGIFSZ);
+        if (iscaching && gifSize > 0) {   /* caching enabled */
+            if (pack != NULL)
+                packcache_put(pack, cachekey, (unsigned char *)gif_buffer, gifSize, valign);
             else
-                gif_raster(&mctx, ncolors, bp, colormap_raster, colors, fp, NULL, 0);
-            /* --- may need to emit image from cached file or from memory --- */
-            if (iscaching)            /* caching enabled */
-                /*emit cached image (hopefully)*/
-                emitcache(cachefile, maxage, valign, 0);
-            else          /* or emit image from memory buffer*/
-                emitcache(gif_buffer, maxage, valign, gifSize);
+                diskcache_put(cachepath, cachekey, (unsigned char *)gif_buffer, gifSize,
+                              1048576L * CACHEMB);
         }
+        emitcache(gif_buffer, maxage, valign, gifSize);
     } /* --- end-of-if(isquery) --- */
     /* --- exit --- */
 end_of_job:
+    if (pack != NULL) packcache_close(pack);
     if (bytemap_raster != NULL) free(bytemap_raster);
     /*and colormap_raster*/
     if (colormap_raster != NULL)free(colormap_raster);
@@ -3406,7 +3403,7 @@ end_of_job:
     if (mctx.msgfp != NULL          /* have message/log file open */
             &&   mctx.msgfp != stdout) {       /* and it's not stdout */
         fprintf(mctx.msgfp, "mimeTeX> successful end-of-job at %s\n",
-                timestamp(tzdelta, 0));
+                timestamp(&mctx, tzdelta, 0));
         /* so log separator line */
         fprintf(mctx.msgfp, "%s\n", dashes);
         fclose(mctx.msgfp);
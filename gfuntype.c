@@ -851,7 +851,7 @@ int	main (int argc, char *argv[])
         }	/* report error and quit */
     /* --- header lines --- */
     fprintf (outfp,"/%c --- fontdef for %s --- %c/\n", '*',fontname,'*');
-    fprintf (outfp,"static\tchardef %c%s[] =\n   {\n", ' ',fontname);
+    fprintf (outfp,"static\tconst chardef %c%s[] =\n   {\n", ' ',fontname);
     /* --- write characters comprising font --- */
     for (charnum=0; charnum<256; charnum++)   /*for each possible char in font*/
         if (fontdef[charnum] != (chardef *) NULL) { /*check if char exists in font*/
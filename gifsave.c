@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <stdint.h>
 #include "gifsave.h"
 
 /**************************************************************************
@@ -30,21 +31,34 @@
 /* used by routines maintaining an LZW string table */
 #define RES_CODES 2
 
-#define HASH_FREE 0xFFFF
-#define NEXT_FIRST 0xFFFF
-
 #define MAXBITS 12
 #define MAXSTR (1 << MAXBITS)
 
-#define HASHSIZE 9973
-#define HASHSTEP 2039
+#define HASHBITS 13
+#define HASHSIZE (1 << HASHBITS)
+
+/* a slot's key is (generation << 20) | (index << 8) | lastbyte */
+#define GENSHIFT 20
+#define MAXGEN ((1 << (32 - GENSHIFT)) - 1)
 
-#define HASH(index, lastbyte) (((lastbyte << 8) ^ index) % HASHSIZE)
+#define HASH(key) ((Word) (((key) * 2654435761U) & 0xFFFFFFFFU) >> (32 - HASHBITS))
 
 #if !defined(MAXGIFSZ)		/* " */
   #define MAXGIFSZ 131072	/* " max #bytes comprising gif image */
 #endif				/* " */
 
+/* the LZW string table, see GIF_CreateStrtab() */
+typedef struct {
+    uint32_t Key;            /* slot's string, or of an older generation */
+    uint16_t Code;           /* if free */
+} StrtabSlot;
+
+struct GIFStrtab {
+    uint32_t Gen;            /* current generation, 1...MAXGEN */
+    StrtabSlot Slot[HASHSIZE];
+    uint16_t Child[MAXSTR][2];  /* for 1-bit images, see LZW_Compress() */
+};
+
 /* used in the main routines */
 typedef struct {
     Word LocalScreenWidth,
@@ -74,10 +88,13 @@ typedef struct {
     Word ImageHeight,
          ImageWidth,
          ImageLeft,
-         ImageTop,
-         RelPixX, RelPixY;   /* used by InputByte() -function */
-    int(*GetPixel)(void *ctx, int x, int y);
+         ImageTop;
+    int(*GetPixel)(void *ctx, int x, int y); /* callback, or NULL if */
     void *getPixelCtx;
+    const Byte *Pixels;      /* pixels are read from this buffer, */
+    int  Stride,             /* with rows Stride bytes apart, */
+         BitsPrPixel;        /* and 8 or 1 bits per pixel */
+    Byte *Row;               /* used by InputRow() -function */
 } GIFCreationContext;
 
 /**************************************************************************
@@ -308,22 +325,16 @@ WriteBits(GIFContext *ctx, int bits, int numbits)
  *
  *  NAME          FreeStrtab
  *
- *  DESCRIPTION   Free arrays used in string table routines
+ *  DESCRIPTION   Free the string table, unless it was given by
+ *                GIF_SetStrtab()
  */
 static void
 FreeStrtab(GIFContext *ctx)
 {
-    if (ctx->StrHsh) {
-        free(ctx->StrHsh);
-        ctx->StrHsh = NULL;
-    }
-    if (ctx->StrNxt) {
-        free(ctx->StrNxt);
-        ctx->StrNxt = NULL;
-    }
-    if (ctx->StrChr) {
-        free(ctx->StrChr);
-        ctx->StrChr = NULL;
+    if (ctx->OwnStrtab) {
+        GIF_DestroyStrtab(ctx->Strtab);
+        ctx->Strtab = NULL;
+        ctx->OwnStrtab = 0;
     }
 }
 
@@ -333,7 +344,8 @@ FreeStrtab(GIFContext *ctx)
  *
  *  NAME          AllocStrtab
  *
- *  DESCRIPTION   Allocate arrays used in string table routines
+ *  DESCRIPTION   Allocate the string table, unless there already is
+ *                one (from an earlier image, or from GIF_SetStrtab())
  *
  *  RETURNS       GIF_OK     - OK
  *                GIF_OUTMEM - Out of memory
@@ -341,21 +353,11 @@ FreeStrtab(GIFContext *ctx)
 static int
 AllocStrtab(GIFContext *ctx)
 {
-    /* just in case */
-    FreeStrtab(ctx);
-
-    if ((ctx->StrChr = (Byte *) malloc(MAXSTR * sizeof(Byte))) == 0) {
-        FreeStrtab(ctx);
-        return GIF_OUTMEM;
-    }
-    if ((ctx->StrNxt = (Word *) malloc(MAXSTR * sizeof(Word))) == 0) {
-        FreeStrtab(ctx);
+    if (ctx->Strtab)
+        return GIF_OK;
+    if ((ctx->Strtab = GIF_CreateStrtab()) == NULL)
         return GIF_OUTMEM;
-    }
-    if ((ctx->StrHsh = (Word *) malloc(HASHSIZE * sizeof(Word))) == 0) {
-        FreeStrtab(ctx);
-        return GIF_OUTMEM;
-    }
+    ctx->OwnStrtab = 1;
     return GIF_OK;
 }
 
@@ -368,11 +370,11 @@ AllocStrtab(GIFContext *ctx)
  *  DESCRIPTION   Add a string consisting of the string of index plus
  *                the byte b.
  *
- *                If a string of length 1 is wanted, the index should
- *                be 0xFFFF.
+ *                One-byte strings, and the reserved codes, are never
+ *                looked up in the table (see FindCharString()), so
+ *                ClearStrtab() just counts them.
  *
- *  INPUT         index   index to first part of string, or 0xFFFF is
- *                        only 1 byte is wanted
+ *  INPUT         index   index to first part of string
  *                b       last byte in new string
  *
  *  RETURNS       Index to new string, or 0xFFFF if no more room
@@ -380,6 +382,8 @@ AllocStrtab(GIFContext *ctx)
 static Word
 AddCharString(GIFContext *ctx, Word index, Byte b)
 {
+    GIFStrtab *tab = ctx->Strtab;
+    uint32_t key = (tab->Gen << GENSHIFT) | (index << 8) | b;
     Word hshidx;
 
     /* check if there is more room */
@@ -387,14 +391,13 @@ AddCharString(GIFContext *ctx, Word index, Byte b)
         return 0xFFFF;
 
     /* search the string table until a free position is found */
-    hshidx = HASH(index, b);
-    while (ctx->StrHsh[hshidx] != 0xFFFF)
-        hshidx = (hshidx + HASHSTEP) % HASHSIZE;
+    hshidx = HASH(key);
+    while ((tab->Slot[hshidx].Key >> GENSHIFT) == tab->Gen)
+        hshidx = (hshidx + 1) & (HASHSIZE - 1);
 
     /* insert new string */
-    ctx->StrHsh[hshidx] = ctx->NumStrings;
-    ctx->StrChr[ctx->NumStrings] = b;
-    ctx->StrNxt[ctx->NumStrings] = (index != 0xFFFF) ? index : NEXT_FIRST;
+    tab->Slot[hshidx].Key = key;
+    tab->Slot[hshidx].Code = ctx->NumStrings;
 
     return ctx->NumStrings++;
 }
@@ -420,7 +423,9 @@ AddCharString(GIFContext *ctx, Word index, Byte b)
 static Word
 FindCharString(GIFContext *ctx, Word index, Byte b)
 {
-    Word hshidx, nxtidx;
+    GIFStrtab *tab = ctx->Strtab;
+    uint32_t key, slotkey;
+    Word hshidx;
 
     /* check if index is 0xFFFF. in that case we need only return b,
      * since all one-character strings has their bytevalue as their
@@ -429,12 +434,14 @@ FindCharString(GIFContext *ctx, Word index, Byte b)
         return b;
 
     /* search the string table until the string is found, or we find
-     * HASH_FREE. in that case the string does not exist. */
-    hshidx = HASH(index, b);
-    while ((nxtidx = ctx->StrHsh[hshidx]) != 0xFFFF) {
-        if (ctx->StrNxt[nxtidx] == index && ctx->StrChr[nxtidx] == b)
-            return nxtidx;
-        hshidx = (hshidx + HASHSTEP) % HASHSIZE;
+     * a slot of an older generation. in that case the string does
+     * not exist. */
+    key = (tab->Gen << GENSHIFT) | (index << 8) | b;
+    hshidx = HASH(key);
+    while (((slotkey = tab->Slot[hshidx].Key) >> GENSHIFT) == tab->Gen) {
+        if (slotkey == key)
+            return tab->Slot[hshidx].Code;
+        hshidx = (hshidx + 1) & (HASHSIZE - 1);
     }
 
     /* no match is found */
@@ -451,27 +458,30 @@ FindCharString(GIFContext *ctx, Word index, Byte b)
  *                one-byte strings, and reserve the RES_CODES reserved
  *                codes.
  *
+ *                The hash table is freed by starting a new generation,
+ *                so it's only actually cleared once every MAXGEN times.
+ *
  *  INPUT         codesize
  *                        number of bits to encode one pixel
  */
 static void
 ClearStrtab(GIFContext *ctx, int codesize)
 {
+    GIFStrtab *tab = ctx->Strtab;
     int q, w;
-    Word *wp;
-
-    /* no strings currently in the table */
-    ctx->NumStrings = 0;
 
     /* mark entire hashtable as free */
-    wp = ctx->StrHsh;
-    for (q = 0; q < HASHSIZE; q++)
-        *wp++ = HASH_FREE;
+    if (++tab->Gen > MAXGEN) {
+        memset(tab->Slot, 0, sizeof(tab->Slot));
+        tab->Gen = 1;
+    }
 
-    /* insert 2**codesize one-character strings, and reserved codes */
+    /* 2**codesize one-character strings, and reserved codes, and none
+     * of them has any longer strings yet */
     w = (1 << codesize) + RES_CODES;
     for (q = 0; q < w; q++)
-        AddCharString(ctx, 0xFFFF, q);
+        tab->Child[q][0] = tab->Child[q][1] = 0xFFFF;
+    ctx->NumStrings = w;
 }
 
 
@@ -480,6 +490,40 @@ ClearStrtab(GIFContext *ctx, int codesize)
  =                        LZW compression routine                         =
  *========================================================================*/
 
+/*-------------------------------------------------------------------------
+ *
+ *  NAME          InputRow
+ *
+ *  DESCRIPTION   Get a row of pixels from the image. Called by the
+ *                LZW_Compress()-function
+ *
+ *  INPUT         y       image-relative row, [0, ImageHeight - 1]
+ *
+ *  RETURNS       Pointer to the row's ImageWidth pixelvalues, either
+ *                in the caller's 8-bit buffer or in ctx->Row
+ */
+static const Byte *
+InputRow(GIFCreationContext *ctx, Word y)
+{
+    const Byte *src;
+    Word x, bit;
+
+    if (ctx->GetPixel) {
+        for (x = 0; x < ctx->ImageWidth; x++)
+            ctx->Row[x] = ctx->GetPixel(ctx->getPixelCtx, ctx->ImageLeft + x,
+                                        ctx->ImageTop + y);
+        return ctx->Row;
+    }
+    src = ctx->Pixels + (ctx->ImageTop + y) * ctx->Stride;
+    if (ctx->BitsPrPixel == 8)
+        return src + ctx->ImageLeft;
+    for (x = 0, bit = ctx->ImageLeft; x < ctx->ImageWidth; x++, bit++)
+        ctx->Row[x] = (src[bit >> 3] >> (bit & 7)) & 1;
+    return ctx->Row;
+}
+
+
+
 /*-------------------------------------------------------------------------
  *
  *  NAME          LZW_Compress
@@ -487,23 +531,30 @@ ClearStrtab(GIFContext *ctx, int codesize)
  *  DESCRIPTION   Perform LZW compression as specified in the
  *                GIF-standard.
  *
+ *                A 1-bit image (see GIF_CompressBits()) has only two
+ *                strings following any string, so they're kept in
+ *                the table's Child[] array instead of being hashed.
+ *
  *  INPUT         codesize
  *                         number of bits needed to represent
  *                         one pixelvalue.
- *                inputbyte
- *                         function that fetches each byte to compress.
- *                         must return -1 when no more bytes.
+ *                cctx     the image to compress, fetched a row
+ *                         at a time by InputRow().
  *
  *  RETURNS       GIF_OK     - OK
  *                GIF_OUTMEM - Out of memory
  */
 static int
-LZW_Compress(GIFContext *ctx, int codesize, int (*inputbyte)(void*), void *ibctx)
+LZW_Compress(GIFContext *ctx, int codesize, GIFCreationContext *cctx)
 {
     register int c;
     register Word index;
     int  clearcode, endofinfo, numbits, limit, errcode;
+    int  isbits = (!cctx->GetPixel && cctx->BitsPrPixel == 1);
     Word prefix = 0xFFFF;
+    const Byte *row, *end;
+    Word y;
+    uint16_t (*child)[2];
 
     /* set up the given outfile */
     InitBitFile(ctx);
@@ -518,38 +569,58 @@ LZW_Compress(GIFContext *ctx, int codesize, int (*inputbyte)(void*), void *ibctx
     if ((errcode = AllocStrtab(ctx)) != GIF_OK)
         return errcode;
     ClearStrtab(ctx, codesize);
+    child = ctx->Strtab->Child;
 
     /* first send a code telling the unpacker to clear the stringtable */
     WriteBits(ctx, clearcode, numbits);
 
-    /* pack image */
-    while ((c = inputbyte(ibctx)) != -1) {
-        /* now perform the packing. check if the prefix + the new
-         *  character is a string that exists in the table */
-        if ((index = FindCharString(ctx, prefix, c)) != 0xFFFF) {
-            /* the string exists in the table. make this string the
-             * new prefix.  */
-            prefix = index;
-        } else {
-            /* the string does not exist in the table. first write
-             * code of the old prefix to the file. */
-            WriteBits(ctx, prefix, numbits);
-
-            /* add the new string (the prefix + the new character) to
-             * the stringtable */
-            if (AddCharString(ctx, prefix, c) > limit) {
-                if (++numbits > 12) {
-                    WriteBits(ctx, clearcode, numbits - 1);
-                    ClearStrtab(ctx, codesize);
-                    numbits = codesize + 1;
+    /* pack image, a row at a time */
+    for (y = 0; y < cctx->ImageHeight; y++) {
+        row = InputRow(cctx, y);
+        for (end = row + cctx->ImageWidth; row < end; row++) {
+            c = *row;
+            /* now perform the packing. check if the prefix + the new
+             *  character is a string that exists in the table */
+            if (prefix == 0xFFFF)
+                index = c;
+            else if (isbits)
+                index = child[prefix][c];
+            else
+                index = FindCharString(ctx, prefix, c);
+            if (index != 0xFFFF) {
+                /* the string exists in the table. make this string the
+                 * new prefix.  */
+                prefix = index;
+            } else {
+                /* the string does not exist in the table. first write
+                 * code of the old prefix to the file. */
+                WriteBits(ctx, prefix, numbits);
+
+                /* add the new string (the prefix + the new character) to
+                 * the stringtable */
+                if (isbits) {
+                    if ((index = ctx->NumStrings) < MAXSTR) {
+                        ctx->NumStrings++;
+                        child[prefix][c] = index;
+                        child[index][0] = child[index][1] = 0xFFFF;
+                    } else
+                        index = 0xFFFF;
+                } else
+                    index = AddCharString(ctx, prefix, c);
+                if (index > limit) {
+                    if (++numbits > 12) {
+                        WriteBits(ctx, clearcode, numbits - 1);
+                        ClearStrtab(ctx, codesize);
+                        numbits = codesize + 1;
+                    }
+                    limit = (1 << numbits) - 1;
                 }
-                limit = (1 << numbits) - 1;
-            }
 
-            /* set prefix to a string containing only the character
-             * read. since all possible one-character strings exists
-             * int the table, there's no need to check if it is found. */
-            prefix = c;
+                /* set prefix to a string containing only the character
+                 * read. since all possible one-character strings exists
+                 * int the table, there's no need to check if it is found. */
+                prefix = c;
+            }
         }
     }
 
@@ -557,10 +628,10 @@ LZW_Compress(GIFContext *ctx, int codesize, int (*inputbyte)(void*), void *ibctx
     if (prefix != 0xFFFF)
         WriteBits(ctx, prefix, numbits);
 
-    /* erite end of info -mark, flush the buffer, and tidy up */
+    /* erite end of info -mark, flush the buffer, and tidy up
+     * (the string table is kept for the next image) */
     WriteBits(ctx, endofinfo, numbits);
     ResetOutBitFile(ctx);
-    FreeStrtab(ctx);
 
     return GIF_OK;
 }
@@ -596,33 +667,6 @@ BitsNeeded(Word n)
 
 
 
-/*-------------------------------------------------------------------------
- *
- *  NAME          InputByte
- *
- *  DESCRIPTION   Get next pixel from image. Called by the
- *                LZW_Compress()-function
- *
- *  RETURNS       Next pixelvalue, or -1 if no more pixels
- */
-static int
-InputByte(void *_ctx)
-{
-    GIFCreationContext *ctx = _ctx;
-    int ret;
-
-    if (ctx->RelPixY >= ctx->ImageHeight)
-        return -1;
-    ret = ctx->GetPixel(ctx->getPixelCtx, ctx->ImageLeft + ctx->RelPixX, ctx->ImageTop + ctx->RelPixY);
-    if (++ctx->RelPixX >= ctx->ImageWidth) {
-        ctx->RelPixX = 0;
-        ++ctx->RelPixY;
-    }
-    return ret;
-}
-
-
-
 /*-------------------------------------------------------------------------
  *
  *  NAME          WriteScreenDescriptor
@@ -734,6 +778,96 @@ WriteImageDescriptor(GIFContext *ctx, ImageDescriptor *id)
 
 
 
+/*-------------------------------------------------------------------------
+ *
+ *  NAME          CompressImage
+ *
+ *  DESCRIPTION   Compress an image into the GIF-file. Does the work of
+ *                GIF_CompressImage(), GIF_CompressBytes() and
+ *                GIF_CompressBits(), which differ only in where the
+ *                pixels come from.
+ *
+ *  INPUT         left, top, width, height
+ *                        as for GIF_CompressImage()
+ *                cctx    where the pixels come from. The image's
+ *                        position and size are filled in here.
+ *
+ *  RETURNS       GIF_OK       - OK
+ *                GIF_OUTMEM   - Out of memory
+ *                GIF_ERRWRITE - Error writing to the file
+ */
+static int
+CompressImage(GIFContext *ctx, int left, int top, int width, int height,
+              GIFCreationContext *cctx)
+{
+    int codesize, errcode;
+    ImageDescriptor ID;
+
+    if (width < 0) {
+        width = ctx->ScreenWidth;
+        left = 0;
+    }
+    if (height < 0) {
+        height = ctx->ScreenHeight;
+        top = 0;
+    }
+    if (left < 0)
+        left = 0;
+    if (top < 0)
+        top = 0;
+
+    /* write global colortable if any */
+    if (ctx->NumColors)
+        if ((Write(ctx, ctx->ColorTable, ctx->NumColors * 3)) != GIF_OK)
+            return GIF_ERRWRITE;
+
+    /* write graphic extension block with transparent color index */
+    if ( ctx->TransparentColorIndex >= 0 )     /* (added by j.forkosh) */
+      if ( WriteTransparentColorIndex(ctx, ctx->TransparentColorIndex)
+      !=   GIF_OK ) return GIF_ERRWRITE;
+
+    /* initiate and write image descriptor */
+    ID.Separator = ',';
+    ID.LeftPosition = cctx->ImageLeft = left;
+    ID.TopPosition = cctx->ImageTop = top;
+    ID.Width = cctx->ImageWidth = width;
+    ID.Height = cctx->ImageHeight = height;
+    ID.LocalColorTableSize = 0;
+    ID.Reserved = 0;
+    ID.SortFlag = 0;
+    ID.InterlaceFlag = 0;
+    ID.LocalColorTableFlag = 0;
+
+    if (WriteImageDescriptor(ctx, &ID) != GIF_OK)
+        return GIF_ERRWRITE;
+
+    /* write code size */
+    codesize = BitsNeeded(ctx->NumColors);
+    if (codesize == 1)
+        ++codesize;
+    if (WriteByte(ctx, codesize) != GIF_OK)
+        return GIF_ERRWRITE;
+
+    /* perform compression, with a row buffer unless rows are used as is */
+    cctx->Row = NULL;
+    if (cctx->GetPixel || cctx->BitsPrPixel != 8)
+        if ((cctx->Row = (Byte *) malloc(width > 0 ? width : 1)) == NULL)
+            return GIF_OUTMEM;
+    errcode = LZW_Compress(ctx, codesize, cctx);
+    if (cctx->Row)
+        free(cctx->Row);
+    if (errcode != GIF_OK)
+        return errcode;
+
+    /* write terminating 0-byte */
+    if (WriteByte(ctx, 0) != GIF_OK)
+        return GIF_ERRWRITE;
+
+    return GIF_OK;
+}
+
+
+
 /**************************************************************************
  *                                                                        *
  *                    P U B L I C    F U N C T I O N S                    *
@@ -772,7 +906,7 @@ GIF_Create(FILE *fp, void *buffer, int buffer_size, int width, int height,
         return NULL;
     }
 
-    memset(retval, sizeof(GIFContext), 0);
+    memset(retval, 0, sizeof(GIFContext));
 
     retval->TransparentColorIndex = -1;
     retval->OutFile = fp;
@@ -824,9 +958,8 @@ GIF_Create(FILE *fp, void *buffer, int buffer_size, int width, int height,
         }
     }
 
-    retval->StrHsh = NULL;
-    retval->StrChr = NULL;
-    retval->StrNxt = NULL;
+    retval->Strtab = NULL;
+    retval->OwnStrtab = 0;
     return retval;
 }
 
@@ -878,6 +1011,66 @@ GIF_SetTransparent(GIFContext *ctx, int colornum)
 
 
 
+/*-------------------------------------------------------------------------
+ *
+ *  NAME          GIF_CreateStrtab
+ *
+ *  DESCRIPTION   Allocate an LZW string table, which can be given
+ *                to any number of GIF-files, one at a time, with
+ *                GIF_SetStrtab(). Otherwise each GIF-file allocates
+ *                its own, kept until GIF_Close().
+ *
+ *  RETURNS       The string table, or NULL if out of memory
+ */
+GIFStrtab *
+GIF_CreateStrtab(void)
+{
+    GIFStrtab *tab;
+
+    if ((tab = malloc(sizeof(GIFStrtab))) == NULL)
+        return NULL;
+    memset(tab->Slot, 0, sizeof(tab->Slot));
+    tab->Gen = 0;
+    return tab;
+}
+
+
+
+/*-------------------------------------------------------------------------
+ *
+ *  NAME          GIF_DestroyStrtab
+ *
+ *  DESCRIPTION   Free a string table from GIF_CreateStrtab()
+ */
+void
+GIF_DestroyStrtab(GIFStrtab *tab)
+{
+    if (tab)
+        free(tab);
+}
+
+
+
+/*-------------------------------------------------------------------------
+ *
+ *  NAME          GIF_SetStrtab
+ *
+ *  DESCRIPTION   Use a string table from GIF_CreateStrtab() to
+ *                compress this GIF-file's images. The table still
+ *                belongs to the caller, and isn't freed by GIF_Close().
+ *
+ *  INPUT         tab     the string table
+ */
+void
+GIF_SetStrtab(GIFContext *ctx, GIFStrtab *tab)
+{
+    FreeStrtab(ctx);
+    ctx->Strtab = tab;
+    ctx->OwnStrtab = 0;
+}
+
+
+
 /*-------------------------------------------------------------------------
  *
  *  NAME          GIF_CompressImage
@@ -917,67 +1110,91 @@ int
 GIF_CompressImage(GIFContext *ctx, int left, int top, int width, int height,
 		  int (*getpixel)(void *ctx, int x, int y), void *getPixelCtx)
 {
-    int codesize, errcode;
-    ImageDescriptor ID;
     GIFCreationContext cctx;
 
-    if (width < 0) {
-        width = ctx->ScreenWidth;
-        left = 0;
-    }
-    if (height < 0) {
-        height = ctx->ScreenHeight;
-        top = 0;
-    }
-    if (left < 0)
-        left = 0;
-    if (top < 0)
-        top = 0;
+    cctx.GetPixel = getpixel;
+    cctx.getPixelCtx = getPixelCtx;
+    cctx.Pixels = NULL;
+    cctx.Stride = 0;
+    cctx.BitsPrPixel = 8;
+    return CompressImage(ctx, left, top, width, height, &cctx);
+}
 
-    /* write global colortable if any */
-    if (ctx->NumColors)
-        if ((Write(ctx, ctx->ColorTable, ctx->NumColors * 3)) != GIF_OK)
-            return GIF_ERRWRITE;
 
-    /* write graphic extension block with transparent color index */
-    if ( ctx->TransparentColorIndex >= 0 )     /* (added by j.forkosh) */
-      if ( WriteTransparentColorIndex(ctx, ctx->TransparentColorIndex)
-      !=   GIF_OK ) return GIF_ERRWRITE;
 
-    /* initiate and write image descriptor */
-    ID.Separator = ',';
-    ID.LeftPosition = cctx.ImageLeft = left;
-    ID.TopPosition = cctx.ImageTop = top;
-    ID.Width = cctx.ImageWidth = width;
-    ID.Height = cctx.ImageHeight = height;
-    ID.LocalColorTableSize = 0;
-    ID.Reserved = 0;
-    ID.SortFlag = 0;
-    ID.InterlaceFlag = 0;
-    ID.LocalColorTableFlag = 0;
+/*-------------------------------------------------------------------------
+ *
+ *  NAME          GIF_CompressBytes
+ *
+ *  DESCRIPTION   Compress an image into the GIF-file, like
+ *                GIF_CompressImage(), but reading the pixels directly
+ *                from a buffer of 8-bit pixel values, one byte per
+ *                pixel, rather than calling back for each of them.
+ *
+ *                The pixel at x, y is pixels[y * stride + x], for x
+ *                and y in the same intervals as GIF_CompressImage()
+ *                passes to its callback.
+ *
+ *  INPUT         left, top, width, height
+ *                        as for GIF_CompressImage()
+ *                pixels  the pixel values, each in the interval
+ *                        [0, NumColors - 1]
+ *                stride  number of bytes from one row of pixels
+ *                        to the next
+ *
+ *  RETURNS       GIF_OK       - OK
+ *                GIF_OUTMEM   - Out of memory
+ *                GIF_ERRWRITE - Error writing to the file
+ */
+int
+GIF_CompressBytes(GIFContext *ctx, int left, int top, int width, int height,
+		  const void *pixels, int stride)
+{
+    GIFCreationContext cctx;
 
-    if (WriteImageDescriptor(ctx, &ID) != GIF_OK)
-        return GIF_ERRWRITE;
+    cctx.GetPixel = NULL;
+    cctx.getPixelCtx = NULL;
+    cctx.Pixels = pixels;
+    cctx.Stride = stride;
+    cctx.BitsPrPixel = 8;
+    return CompressImage(ctx, left, top, width, height, &cctx);
+}
 
-    /* write code size */
-    codesize = BitsNeeded(ctx->NumColors);
-    if (codesize == 1)
-        ++codesize;
-    if (WriteByte(ctx, codesize) != GIF_OK)
-        return GIF_ERRWRITE;
 
-    /* perform compression */
-    cctx.RelPixX = cctx.RelPixY = 0;
-    cctx.GetPixel = getpixel;
-    cctx.getPixelCtx = getPixelCtx;
-    if ((errcode = LZW_Compress(ctx, codesize, InputByte, &cctx)) != GIF_OK)
-        return errcode;
 
-    /* write terminating 0-byte */
-    if (WriteByte(ctx, 0) != GIF_OK)
-        return GIF_ERRWRITE;
+/*-------------------------------------------------------------------------
+ *
+ *  NAME          GIF_CompressBits
+ *
+ *  DESCRIPTION   Compress a two-color image into the GIF-file, like
+ *                GIF_CompressBytes(), but reading the pixels from a
+ *                bitmap with one bit per pixel.
+ *
+ *                The pixel at x, y is bit x % 8 (counting from the
+ *                least significant bit) of bits[y * stride + x / 8].
+ *
+ *  INPUT         left, top, width, height
+ *                        as for GIF_CompressImage()
+ *                bits    the bitmap, a set bit being pixel value 1
+ *                stride  number of bytes from one row of pixels
+ *                        to the next
+ *
+ *  RETURNS       GIF_OK       - OK
+ *                GIF_OUTMEM   - Out of memory
+ *                GIF_ERRWRITE - Error writing to the file
+ */
+int
+GIF_CompressBits(GIFContext *ctx, int left, int top, int width, int height,
+		 const void *bits, int stride)
+{
+    GIFCreationContext cctx;
 
-    return GIF_OK;
+    cctx.GetPixel = NULL;
+    cctx.getPixelCtx = NULL;
+    cctx.Pixels = bits;
+    cctx.Stride = stride;
+    cctx.BitsPrPixel = 1;
+    return CompressImage(ctx, left, top, width, height, &cctx);
 }
 
 
@@ -1020,6 +1237,9 @@ GIF_Close(GIFContext *ctx)
         ctx->ColorTable = NULL;
     }
 
+    /* and string table */
+    FreeStrtab(ctx);
+
     return GIF_OK;
 }
 /* --- end-of-file gifsave.c --- */
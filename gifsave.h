@@ -11,6 +11,8 @@ enum GIF_Code {
 typedef unsigned Word;          /* at least two bytes (16 bits) */
 typedef unsigned char Byte;     /* exactly one byte (8 bits) */
 
+typedef struct GIFStrtab GIFStrtab; /* LZW string table, see gifsave.c */
+
 typedef struct {
     int  BitsPrPrimColor,    /* bits pr primary color */
          NumColors;          /* number of colors in color table */
@@ -27,10 +29,9 @@ typedef struct {
     int  Index,              /* current byte in buffer */
          BitsLeft;           /* bits left to fill in current byte. These
                                      * are right-justified */
-    Byte *StrChr;
-    Word *StrNxt,
-         *StrHsh,
-         NumStrings;
+    GIFStrtab *Strtab;       /* LZW string table */
+    int  OwnStrtab;          /* true if allocated for this file */
+    Word NumStrings;
 } GIFContext;
 
 GIFContext* GIF_Create(FILE *fp, void *buffer, int buffer_size,
@@ -39,6 +40,13 @@ void GIF_SetColor(GIFContext *ctx, int colornum, int red, int green, int blue);
 void GIF_SetTransparent(GIFContext *ctx, int colornum);	/* (added by j.forkosh) */
 int  GIF_CompressImage(GIFContext *ctx, int left, int top, int width, int height,
 		       int (*getpixel)(void *ctx, int x, int y), void *cctx);
+int  GIF_CompressBytes(GIFContext *ctx, int left, int top, int width, int height,
+		       const void *pixels, int stride);
+int  GIF_CompressBits(GIFContext *ctx, int left, int top, int width, int height,
+		      const void *bits, int stride);
 int  GIF_Close(GIFContext *);
+GIFStrtab *GIF_CreateStrtab(void);
+void GIF_DestroyStrtab(GIFStrtab *tab);
+void GIF_SetStrtab(GIFContext *ctx, GIFStrtab *tab);
 
 #endif /* GIFSAVE_H */
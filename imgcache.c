@@ -0,0 +1,618 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Purpose:     In-memory LRU cache of rendered images, so a long-running
+ *              mimetex (--serve or --http) answers hot formulas without
+ *              rendering them again (see imgcache.h).
+ *
+ * Functions:   imgcache_optkey(mctx,opts,key)  options part of a key
+ *              imgcache_create(maxbytes)       new cache with byte budget
+ *              imgcache_destroy(cache)         frees cache and its images
+ *              imgcache_get(cache,mctx,opts,expression,image,maxbytes,valign)
+ *                                              copies out a cached image,
+ *                                              or waits for its render
+ *              imgcache_put(cache,mctx,opts,expression,image,nbytes,valign)
+ *                                              caches a rendered image
+ *              imgcache_stats(cache,stats)     hit/miss/eviction counters
+ *
+ * Notes:     o An entry's key is a short string of render options,
+ *              a newline, then the expression.  Its hash picks a shard,
+ *              and then a bucket in the shard's chained hash table.
+ *            o Each shard holds at most maxbytes/IMGCACHESHARDS bytes,
+ *              counting each entry's struct, key and image, and drops
+ *              least recently used entries to make room.
+ *            o A miss also enters the key in its shard's in-flight
+ *              list, until the caller's imgcache_put().  Meanwhile,
+ *              other imgcache_get()'s of that key wait, and are then
+ *              handed a copy of the caller's image, so a burst of
+ *              requests for one new formula renders it just once.
+ *              If the render fails, they all fail with it.
+ *            o Without pthreads, there's no locking (nor any threads).
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mimetex.h"
+#include "imgcache.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#define SHARDLOCK pthread_mutex_t
+#define SHARDCOND pthread_cond_t
+#define initshardlock(s)    ( pthread_mutex_init(&(s)->lock, NULL), \
+                              pthread_cond_init(&(s)->landed, NULL) )
+#define destroyshardlock(s) ( pthread_mutex_destroy(&(s)->lock), \
+                              pthread_cond_destroy(&(s)->landed) )
+#define lockshard(s)        pthread_mutex_lock(&(s)->lock)
+#define unlockshard(s)      pthread_mutex_unlock(&(s)->lock)
+#define waitshard(s)        pthread_cond_wait(&(s)->landed, &(s)->lock)
+#define wakeshard(s)        pthread_cond_broadcast(&(s)->landed)
+#else
+#define SHARDLOCK int
+#define SHARDCOND int
+#define initshardlock(s)    ((s)->lock = (s)->landed = 0)
+#define destroyshardlock(s) ((s)->lock = (s)->landed = 0)
+#define lockshard(s)        ((s)->lock = 1)
+#define unlockshard(s)      ((s)->lock = 0)
+#define waitshard(s)        ((s)->landed = 1) /* never called */
+#define wakeshard(s)        ((s)->landed = 0)
+#endif
+
+#define NBUCKETS    (256)           /* initial #buckets in each shard */
+
+/* --- one cached image --- */
+typedef struct imgentry_struct
+{
+    unsigned long hash;         /* hash of key */
+    char  *key;                 /* options, \n, expression (not null-
+                                 * terminated), stored after the struct */
+    int   nkey;                 /* #chars in key */
+    unsigned char *image;       /* image bytes, stored after key */
+    int   nbytes;               /* #bytes in image */
+    int   valign;               /* Vertical-Align: for image */
+    long  size;                 /* #bytes charged against budget */
+    struct imgentry_struct *hnext; /* next in hash bucket */
+    struct imgentry_struct *prev, *next; /* LRU list, newest first */
+} imgentry; /* --- end-of-imgentry_struct --- */
+
+/* --- one image being rendered, which other requests wait for --- */
+typedef struct imgflight_struct
+{
+    unsigned long hash;         /* hash of key */
+    char  *key;                 /* options, \n, expression, stored after
+                                 * the struct, as for imgentry */
+    int   nkey;                 /* #chars in key */
+    int   nwaiters;             /* #imgcache_get()'s waiting for it */
+    int   isdone;               /* true once imgcache_put() is called */
+    int   isfailed;             /* true if the render failed */
+    unsigned char *image;       /* malloc'ed copy for waiters, or NULL */
+    int   nbytes;               /* #bytes in image, or 0 if none */
+    int   valign;               /* Vertical-Align: for image */
+    struct imgflight_struct *next; /* next in shard's in-flight list */
+} imgflight; /* --- end-of-imgflight_struct --- */
+
+/* --- one independently locked part of the cache --- */
+typedef struct imgshard_struct
+{
+    SHARDLOCK lock;             /* protects everything below */
+    SHARDCOND landed;           /* signalled when a flight is done */
+    imgentry **buckets;         /* hash table */
+    int   nbuckets;             /* #buckets, a power of 2 */
+    long  nentries;             /* #entries in table */
+    imgentry *newest, *oldest;  /* LRU list */
+    long  nbytes, maxbytes;     /* bytes used, budget */
+    imgflight *flights;         /* misses being rendered */
+    long  nhits, nmisses, nevictions; /* counters */
+    long  ncoalesced;           /* #gets answered by another's render */
+} imgshard; /* --- end-of-imgshard_struct --- */
+
+/* --- the whole cache --- */
+struct imgcache_struct
+{
+    long  maxbytes;             /* byte budget, over all shards */
+    imgshard shards[IMGCACHESHARDS];
+}; /* --- end-of-imgcache_struct --- */
+
+
+/* ==========================================================================
+ * Function:    imgcache_optkey ( mctx, opts, key )
+ * Purpose:     Formats every option that changes a rendered image
+ * --------------------------------------------------------------------------
+ * Arguments:   mctx (I)    mimetex_ctx * to be rendered with
+ *              opts (I)    mimetex_options * to be rendered with
+ *              key (O)     char * to IMGCACHEOPTSZ bytes returning options,
+ *                          followed by a newline
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #chars in key
+ * ======================================================================= */
+/* --- entry point --- */
+int imgcache_optkey(mimetex_ctx *mctx, mimetex_options *opts, char *key)
+{
+    return (sprintf(key,
+                    "s%d f%d e%d w%d b%d fg%d,%d,%d bg%d,%d,%d t%d a%d g%.6g z%d"
+                    " sh%d aa%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d d%d m%d u%.6g\n",
+                    opts->size, opts->format, opts->iserrormsg,
+                    mctx->warninglevel, mctx->isblackonwhite,
+                    mctx->fgred, mctx->fggreen, mctx->fgblue,
+                    mctx->bgred, mctx->bggreen, mctx->bgblue,
+                    mctx->istransparent, mctx->aaalgorithm,
+                    mctx->gammacorrection, mctx->pnglevel, mctx->shrinkfactor,
+                    mctx->maxfollow, mctx->fgalias, mctx->fgonly,
+                    mctx->bgalias, mctx->bgonly, mctx->centerwt,
+                    mctx->minadjacent, mctx->maxadjacent, mctx->adjacentwt,
+                    mctx->weightnum, mctx->cornerwt, mctx->displaysize,
+                    mctx->smashmargin, mctx->unitlength));
+} /* --- end-of-function imgcache_optkey() --- */
+
+
+/* ==========================================================================
+ * Function:    keyhash ( key, nkey, expression )
+ * Purpose:     FNV-1a hash of an options key followed by an expression
+ * --------------------------------------------------------------------------
+ * Returns:     ( unsigned long )   hash
+ * ======================================================================= */
+/* --- entry point --- */
+static unsigned long keyhash(const char *key, int nkey, const char *expression)
+{
+    unsigned long hash = 2166136261UL;
+    while (nkey-- > 0) hash = (hash ^ (unsigned char)*key++) * 16777619UL;
+    while (*expression != '\000')
+        hash = (hash ^ (unsigned char)*expression++) * 16777619UL;
+    return (hash);
+} /* --- end-of-function keyhash() --- */
+
+
+/* ==========================================================================
+ * Function:    findentry ( shard, hash, key, nkey, expression, nexpr )
+ * Purpose:     Looks up key+expression in a (locked) shard
+ * --------------------------------------------------------------------------
+ * Returns:     ( imgentry * )  matching entry, or NULL
+ * ======================================================================= */
+/* --- entry point --- */
+static imgentry *findentry(imgshard *shard, unsigned long hash, const char *key,
+                           int nkey, const char *expression, int nexpr)
+{
+    imgentry *entry = shard->buckets[hash & (shard->nbuckets - 1)];
+    for (; entry != NULL; entry = entry->hnext)
+        if (entry->hash == hash && entry->nkey == nkey + nexpr
+                && memcmp(entry->key, key, nkey) == 0
+                && memcmp(entry->key + nkey, expression, nexpr) == 0)
+            return (entry);
+    return (NULL);
+} /* --- end-of-function findentry() --- */
+
+
+/* ==========================================================================
+ * Functions:   unlinklru ( shard, entry ), linklru ( shard, entry )
+ * Purpose:     Removes entry from, or adds it as newest to, the LRU list
+ * ======================================================================= */
+/* --- entry point --- */
+static void unlinklru(imgshard *shard, imgentry *entry)
+{
+    if (entry->prev != NULL) entry->prev->next = entry->next;
+    else shard->newest = entry->next;
+    if (entry->next != NULL) entry->next->prev = entry->prev;
+    else shard->oldest = entry->prev;
+    entry->prev = entry->next = NULL;
+} /* --- end-of-function unlinklru() --- */
+/* --- entry point --- */
+static void linklru(imgshard *shard, imgentry *entry)
+{
+    entry->prev = NULL;
+    if ((entry->next = shard->newest) != NULL) entry->next->prev = entry;
+    else shard->oldest = entry;
+    shard->newest = entry;
+} /* --- end-of-function linklru() --- */
+
+
+/* ==========================================================================
+ * Function:    dropentry ( shard, entry )
+ * Purpose:     Removes entry from a (locked) shard and frees it
+ * ======================================================================= */
+/* --- entry point --- */
+static void dropentry(imgshard *shard, imgentry *entry)
+{
+    imgentry **link = &shard->buckets[entry->hash & (shard->nbuckets - 1)];
+    while (*link != entry) link = &(*link)->hnext;
+    *link = entry->hnext;
+    unlinklru(shard, entry);
+    shard->nentries--;
+    shard->nbytes -= entry->size;
+    free((void *)entry);
+} /* --- end-of-function dropentry() --- */
+
+
+/* ==========================================================================
+ * Function:    growshard ( shard )
+ * Purpose:     Doubles a (locked) shard's #buckets, rehashing its entries
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0=no memory (shard still usable)
+ * ======================================================================= */
+/* --- entry point --- */
+static int growshard(imgshard *shard)
+{
+    int nbuckets = 2 * shard->nbuckets, ibucket = 0;
+    imgentry **buckets = (imgentry **)calloc(nbuckets, sizeof(imgentry *));
+    if (buckets == NULL) return (0);
+    for (ibucket = 0; ibucket < shard->nbuckets; ibucket++) {
+        imgentry *entry = shard->buckets[ibucket], *hnext = NULL;
+        for (; entry != NULL; entry = hnext) {
+            imgentry **head = &buckets[entry->hash & (nbuckets - 1)];
+            hnext = entry->hnext;
+            entry->hnext = *head;
+            *head = entry;
+        }
+    }
+    free((void *)shard->buckets);
+    shard->buckets = buckets;
+    shard->nbuckets = nbuckets;
+    return (1);
+} /* --- end-of-function growshard() --- */
+
+
+/* ==========================================================================
+ * Function:    findflight ( shard, hash, key, nkey, expression, nexpr )
+ * Purpose:     Looks up key+expression in a (locked) shard's in-flight list
+ * --------------------------------------------------------------------------
+ * Returns:     ( imgflight * ) matching flight, or NULL
+ * ======================================================================= */
+/* --- entry point --- */
+static imgflight *findflight(imgshard *shard, unsigned long hash,
+                             const char *key, int nkey,
+                             const char *expression, int nexpr)
+{
+    imgflight *flight = shard->flights;
+    for (; flight != NULL; flight = flight->next)
+        if (flight->hash == hash && flight->nkey == nkey + nexpr
+                && memcmp(flight->key, key, nkey) == 0
+                && memcmp(flight->key + nkey, expression, nexpr) == 0)
+            return (flight);
+    return (NULL);
+} /* --- end-of-function findflight() --- */
+
+
+/* ==========================================================================
+ * Function:    freeflight ( flight )
+ * Purpose:     Frees a flight and its copy of the image
+ * ======================================================================= */
+/* --- entry point --- */
+static void freeflight(imgflight *flight)
+{
+    if (flight->image != NULL) free((void *)flight->image);
+    free((void *)flight);
+} /* --- end-of-function freeflight() --- */
+
+
+/* ==========================================================================
+ * Function:    endflight ( shard, flight, image, nbytes, valign )
+ * Purpose:     Removes a finished render from a (locked) shard's in-flight
+ *              list, and hands its image to any waiting imgcache_get()'s
+ * --------------------------------------------------------------------------
+ * Arguments:   shard (I/O)     imgshard * containing flight
+ *              flight (I/O)    imgflight * whose render is done
+ *              image (I)       unsigned char * to image bytes, or NULL
+ *              nbytes (I)      int containing #bytes of image, or 0
+ *                              if the render failed
+ *              valign (I)      int containing Vertical-Align:
+ * --------------------------------------------------------------------------
+ * Notes:     o With no waiters, the flight is freed right away, or else
+ *              by the last waiter.  Waiters are told if the render
+ *              failed, so they don't each repeat it in turn.  But
+ *              waiters given no image for want of memory try again.
+ * ======================================================================= */
+/* --- entry point --- */
+static void endflight(imgshard *shard, imgflight *flight,
+                      unsigned char *image, int nbytes, int valign)
+{
+    imgflight **link = &shard->flights;
+    while (*link != flight) link = &(*link)->next;
+    *link = flight->next;
+    flight->isdone = 1;
+    if (flight->nwaiters < 1) {          /* nobody waiting */
+        freeflight(flight);
+        return;
+    }
+    flight->isfailed = (image == NULL || nbytes < 1);
+    if (image != NULL && nbytes > 0
+            && (flight->image = (unsigned char *)malloc(nbytes)) != NULL) {
+        memcpy(flight->image, image, nbytes);
+        flight->nbytes = nbytes;
+        flight->valign = valign;
+    }
+    wakeshard(shard);
+} /* --- end-of-function endflight() --- */
+
+
+/* ==========================================================================
+ * Function:    imgcache_create ( maxbytes )
+ * Purpose:     Allocates an empty cache
+ * --------------------------------------------------------------------------
+ * Arguments:   maxbytes (I)    long containing byte budget
+ * --------------------------------------------------------------------------
+ * Returns:     ( imgcache * )  new cache, or NULL if maxbytes<=0
+ *                              or no memory
+ * ======================================================================= */
+/* --- entry point --- */
+imgcache *imgcache_create(long maxbytes)
+{
+    imgcache *cache = NULL;
+    int ishard = 0;
+    if (maxbytes <= 0) goto end_of_job;
+    if ((cache = (imgcache *)calloc(1, sizeof(imgcache))) == NULL)
+        goto end_of_job;
+    cache->maxbytes = maxbytes;
+    for (ishard = 0; ishard < IMGCACHESHARDS; ishard++) {
+        imgshard *shard = &cache->shards[ishard];
+        initshardlock(shard);
+        shard->maxbytes = maxbytes / IMGCACHESHARDS;
+        shard->nbuckets = NBUCKETS;
+        if ((shard->buckets = (imgentry **)calloc(NBUCKETS, sizeof(imgentry *)))
+                == NULL) {
+            imgcache_destroy(cache);
+            cache = NULL;
+            goto end_of_job;
+        }
+    }
+end_of_job:
+    return (cache);
+} /* --- end-of-function imgcache_create() --- */
+
+
+/* ==========================================================================
+ * Function:    imgcache_destroy ( cache )
+ * Purpose:     Frees a cache and all its images
+ * ======================================================================= */
+/* --- entry point --- */
+void imgcache_destroy(imgcache *cache)
+{
+    int ishard = 0;
+    if (cache == NULL) return;
+    for (ishard = 0; ishard < IMGCACHESHARDS; ishard++) {
+        imgshard *shard = &cache->shards[ishard];
+        imgentry *entry = shard->newest, *next = NULL;
+        imgflight *flight = shard->flights, *fnext = NULL;
+        for (; entry != NULL; entry = next) {
+            next = entry->next;
+            free((void *)entry);
+        }
+        for (; flight != NULL; flight = fnext) { /* never put */
+            fnext = flight->next;
+            freeflight(flight);
+        }
+        if (shard->buckets != NULL) free((void *)shard->buckets);
+        destroyshardlock(shard);
+    }
+    free((void *)cache);
+} /* --- end-of-function imgcache_destroy() --- */
+
+
+/* ==========================================================================
+ * Function:    imgcache_get ( cache, mctx, opts, expression,
+ *                             image, maxbytes, valign )
+ * Purpose:     Copies the cached image of expression, if any,
+ *              or else waits for it if another thread is rendering it
+ * --------------------------------------------------------------------------
+ * Arguments:   cache (I)       imgcache * to cache, or NULL
+ *              mctx (I)        mimetex_ctx * expression would be
+ *                              rendered with
+ *              opts (I)        mimetex_options * it would be rendered with
+ *              expression (I)  char * to null-terminated expression
+ *              image (O)       unsigned char * returning image bytes
+ *              maxbytes (I)    int containing #bytes available in image
+ *              valign (O)      int * returning Vertical-Align:
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #bytes of image, or 0 if not cached,
+ *                              in which case the caller must render it
+ *                              and then imgcache_put() it (even if the
+ *                              render fails, with nbytes=0),
+ *                              or -1 if another caller's render of it,
+ *                              waited for, failed
+ * --------------------------------------------------------------------------
+ * Notes:     o A hit makes the entry most recently used.
+ *            o On a miss, other gets of expression (with the same
+ *              options) wait until the caller's imgcache_put(),
+ *              and then copy its image, or return -1 if it failed.
+ *              Failures aren't cached, so a later get renders again.
+ * ======================================================================= */
+/* --- entry point --- */
+int imgcache_get(imgcache *cache, mimetex_ctx *mctx, mimetex_options *opts,
+                 char *expression, unsigned char *image, int maxbytes,
+                 int *valign)
+{
+    char key[IMGCACHEOPTSZ];
+    int nkey = 0, nexpr = 0, nbytes = 0;
+    unsigned long hash = 0;
+    imgshard *shard = NULL;
+    imgentry *entry = NULL;
+    imgflight *flight = NULL;
+    if (cache == NULL || expression == NULL) return (0);
+    nkey = imgcache_optkey(mctx, opts, key);
+    nexpr = strlen(expression);
+    hash = keyhash(key, nkey, expression);
+    shard = &cache->shards[(hash >> 16) % IMGCACHESHARDS];
+    lockshard(shard);
+    while (1) {
+        /* --- cached --- */
+        if ((entry = findentry(shard, hash, key, nkey, expression, nexpr))
+                != NULL && entry->nbytes <= maxbytes) {
+            memcpy(image, entry->image, entry->nbytes);
+            nbytes = entry->nbytes;
+            if (valign != NULL) *valign = entry->valign;
+            unlinklru(shard, entry);    /* now most recently used */
+            linklru(shard, entry);
+            shard->nhits++;
+            break;
+        }
+        /* --- not cached, nor being rendered, so caller renders it --- */
+        if ((flight = findflight(shard, hash, key, nkey, expression, nexpr))
+                == NULL) {
+            shard->nmisses++;
+            if ((flight = (imgflight *)malloc(sizeof(imgflight) + nkey + nexpr))
+                    != NULL) {           /* else it's just not coalesced */
+                memset((void *)flight, 0, sizeof(imgflight));
+                flight->hash = hash;
+                flight->key = (char *)(flight + 1);
+                flight->nkey = nkey + nexpr;
+                memcpy(flight->key, key, nkey);
+                memcpy(flight->key + nkey, expression, nexpr);
+                flight->next = shard->flights;
+                shard->flights = flight;
+            }
+            break;
+        }
+        /* --- being rendered, so wait for it --- */
+        flight->nwaiters++;
+        while (!flight->isdone) waitshard(shard);
+        flight->nwaiters--;
+        if (flight->isfailed) {         /* failed for us, too */
+            nbytes = (-1);
+            shard->ncoalesced++;
+        }
+        else if (flight->nbytes > 0 && flight->nbytes <= maxbytes) {
+            memcpy(image, flight->image, flight->nbytes);
+            nbytes = flight->nbytes;
+            if (valign != NULL) *valign = flight->valign;
+            shard->ncoalesced++;
+        }
+        if (flight->nwaiters < 1) freeflight(flight);
+        if (nbytes != 0) break;
+    } /* --- end-of-while(1) --- */
+    unlockshard(shard);
+    return (nbytes);
+} /* --- end-of-function imgcache_get() --- */
+
+
+/* ==========================================================================
+ * Function:    imgcache_put ( cache, mctx, opts, expression,
+ *                             image, nbytes, valign )
+ * Purpose:     Caches the rendered image of expression, dropping least
+ *              recently used images as needed to stay within budget
+ * --------------------------------------------------------------------------
+ * Arguments:   cache (I/O)     imgcache * to cache, or NULL
+ *              mctx (I)        mimetex_ctx * expression was rendered with
+ *              opts (I)        mimetex_options * it was rendered with
+ *              expression (I)  char * to null-terminated expression
+ *              image (I)       unsigned char * to image bytes
+ *              nbytes (I)      int containing #bytes of image,
+ *                              or 0 if the render failed
+ *              valign (I)      int containing Vertical-Align:
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if cached (or already was), 0 if not
+ * --------------------------------------------------------------------------
+ * Notes:     o Requests waiting for this render get image even if
+ *              it isn't cached, e.g., if bigger than a shard's budget.
+ * ======================================================================= */
+/* --- entry point --- */
+int imgcache_put(imgcache *cache, mimetex_ctx *mctx, mimetex_options *opts,
+                 char *expression, unsigned char *image, int nbytes,
+                 int valign)
+{
+    char key[IMGCACHEOPTSZ];
+    int nkey = 0, nexpr = 0, isput = 0;
+    long size = 0;
+    unsigned long hash = 0;
+    imgshard *shard = NULL;
+    imgentry *entry = NULL;
+    imgflight *flight = NULL;
+    if (cache == NULL || expression == NULL) return (0);
+    nkey = imgcache_optkey(mctx, opts, key);
+    nexpr = strlen(expression);
+    hash = keyhash(key, nkey, expression);
+    shard = &cache->shards[(hash >> 16) % IMGCACHESHARDS];
+    size = (long)sizeof(imgentry) + nkey + nexpr + nbytes;
+    lockshard(shard);
+    /* --- hand image to requests waiting for it --- */
+    if ((flight = findflight(shard, hash, key, nkey, expression, nexpr)) != NULL)
+        endflight(shard, flight, image, nbytes, valign);
+    if (image == NULL || nbytes < 1 || size > shard->maxbytes)
+        goto end_of_job;
+    /* --- another thread may have just cached it --- */
+    if (findentry(shard, hash, key, nkey, expression, nexpr) != NULL) {
+        isput = 1;
+        goto end_of_job;
+    }
+    /* --- make room --- */
+    while (shard->nbytes + size > shard->maxbytes && shard->oldest != NULL) {
+        dropentry(shard, shard->oldest);
+        shard->nevictions++;
+    }
+    /* --- entry, key and image in one block --- */
+    if ((entry = (imgentry *)malloc(size)) == NULL) goto end_of_job;
+    entry->hash = hash;
+    entry->key = (char *)(entry + 1);
+    entry->nkey = nkey + nexpr;
+    memcpy(entry->key, key, nkey);
+    memcpy(entry->key + nkey, expression, nexpr);
+    entry->image = (unsigned char *)(entry->key + entry->nkey);
+    entry->nbytes = nbytes;
+    memcpy(entry->image, image, nbytes);
+    entry->valign = valign;
+    entry->size = size;
+    /* --- into hash table and LRU list --- */
+    if (shard->nentries >= shard->nbuckets) growshard(shard);
+    entry->hnext = shard->buckets[hash & (shard->nbuckets - 1)];
+    shard->buckets[hash & (shard->nbuckets - 1)] = entry;
+    linklru(shard, entry);
+    shard->nentries++;
+    shard->nbytes += size;
+    isput = 1;
+end_of_job:
+    unlockshard(shard);
+    return (isput);
+} /* --- end-of-function imgcache_put() --- */
+
+
+/* ==========================================================================
+ * Function:    imgcache_stats ( cache, stats )
+ * Purpose:     Sums every shard's counters
+ * --------------------------------------------------------------------------
+ * Arguments:   cache (I)   imgcache * to cache
+ *              stats (O)   imgcachestats * returning counters
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0 if no cache (stats zeroed)
+ * ======================================================================= */
+/* --- entry point --- */
+int imgcache_stats(imgcache *cache, imgcachestats *stats)
+{
+    int ishard = 0;
+    memset((void *)stats, 0, sizeof(imgcachestats));
+    if (cache == NULL) return (0);
+    stats->maxbytes = cache->maxbytes;
+    for (ishard = 0; ishard < IMGCACHESHARDS; ishard++) {
+        imgshard *shard = &cache->shards[ishard];
+        lockshard(shard);
+        stats->nbytes += shard->nbytes;
+        stats->nentries += shard->nentries;
+        stats->nhits += shard->nhits;
+        stats->nmisses += shard->nmisses;
+        stats->nevictions += shard->nevictions;
+        stats->ncoalesced += shard->ncoalesced;
+        unlockshard(shard);
+    }
+    return (1);
+} /* --- end-of-function imgcache_stats() --- */
@@ -0,0 +1,44 @@
+#ifndef IMGCACHE_H
+#define IMGCACHE_H
+
+#include "mimetex.h"
+
+/* ---
+ * In-memory LRU cache of finished image bytes, for mimetex --serve/--http.
+ * An image is found by its expression together with every option that
+ * changes the output (size, format, colors, anti-aliasing, gamma, etc),
+ * so callers just pass the mimetex_ctx and mimetex_options they'd render
+ * with.  The cache is split into IMGCACHESHARDS independently locked
+ * shards, each with its share of the byte budget and its own LRU list.
+ * Concurrent misses of one image are coalesced: the first caller renders
+ * it, and the rest wait in imgcache_get() for its imgcache_put().
+ * --------------------------------------------------------------------- */
+#define IMGCACHEMB (64)         /* default byte budget, in megabytes */
+#define IMGCACHESHARDS (16)     /* #shards, each with its own lock */
+#define IMGCACHEOPTSZ (512)     /* longest imgcache_optkey() */
+
+typedef struct imgcache_struct imgcache;
+
+/* --- counters, summed over all shards --- */
+typedef struct imgcachestats_struct
+{
+    long  maxbytes;             /* byte budget */
+    long  nbytes;               /* #bytes in use (images, keys, entries) */
+    long  nentries;             /* #images cached */
+    long  nhits, nmisses;       /* imgcache_get() results */
+    long  nevictions;           /* #images dropped to stay within budget */
+    long  ncoalesced;           /* #gets that waited for another's render */
+} imgcachestats; /* --- end-of-imgcachestats_struct --- */
+
+int imgcache_optkey(mimetex_ctx *mctx, mimetex_options *opts, char *key);
+imgcache *imgcache_create(long maxbytes);
+void imgcache_destroy(imgcache *cache);
+int imgcache_get(imgcache *cache, mimetex_ctx *mctx, mimetex_options *opts,
+                 char *expression, unsigned char *image, int maxbytes,
+                 int *valign);
+int imgcache_put(imgcache *cache, mimetex_ctx *mctx, mimetex_options *opts,
+                 char *expression, unsigned char *image, int nbytes,
+                 int valign);
+int imgcache_stats(imgcache *cache, imgcachestats *stats);
+
+#endif /* IMGCACHE_H */
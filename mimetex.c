@@ -194,6 +194,10 @@
  *      aalowpass(rp,bytemap,grayscale)     lowpass grayscale bytemap
  *      aapnm(rp,bytemap,grayscale)       lowpass based on pnmalias.c
  *      aapnmlookup(rp,bytemap,grayscale)  aapnm based on aagridnum()
+ *      aapnmgrid(rp,irow,icol,gridnum,grayscale,aawtval) one pixel
+ *      aawindowmap(rp,table,bytemap)   bytemap from 3x3 grid table[]
+ *      aauniformword(nnrow,row,ssrow,icol,width)  all-white/black?
+ *      aawindowgridnum(window)           3x3 window to aagridnum()
  *      aapatterns(rp,irow,icol,gridnum,patternum,grayscale) call 19,
  *      aapattern1124(rp,irow,icol,gridnum,grayscale)antialias pattrn
  *      aapattern19(rp,irow,icol,gridnum,grayscale) antialias pattern
@@ -203,6 +207,7 @@
  *      aagridnum(rp,irow,icol)             calculates gridnum, 0-511
  *      aapatternnum(gridnum)    looks up pattern#, 1-51, for gridnum
  *      aalookup(gridnum)     table lookup for all possible 3x3 grids
+ *      aalookupinit()           aalookup() for every grid, in mctx
  *      aalowpasslookup(rp,bytemap,grayscale)   driver for aalookup()
  *      aasupsamp(rp,aa,sf,grayscale)             or by supersampling
  *      aacolormap(bytemap,nbytes,colors,colormap)make colors,colormap
@@ -309,8 +314,23 @@
  *          high hit rates then image caching may be helpful.
  *          The  path/  is relative to mimetex.cgi, and must
  *          be writable by it.  Files created under  path/  are
- *          named filename.gif, where filename is the 32-character
- *          MD5 hash of the LaTeX expression.
+ *          named ab/cd/filename.gif, where filename is the
+ *          32-character MD5 hash of the mimeTeX revision, the
+ *          rendering options and the LaTeX expression, and ab, cd
+ *          are its first four characters.  Each path/ab/ also
+ *          holds an index of its images' sizes and last uses,
+ *          and the least recently used images are removed to
+ *          keep path/ within -DCACHEMB (see diskcache.h).
+ *      -DCACHEMB=n
+ *          Megabytes of images kept under -DCACHEPATH, default
+ *          1024, or 0 for no limit.
+ *      -DCACHEPACK=\"name\"
+ *          With -DCACHEPATH, keeps all images in the one file
+ *          path/name, with an index path/name.idx, rather than a
+ *          file per image (see packcache.h).  It's appended to,
+ *          and rewritten without its oldest images when it grows
+ *          past -DCACHEMB.  A copy of path/name is a complete
+ *          cache (the index is rebuilt if it's missing).
  *      -DDEFAULTSIZE=n
  *          MimeTeX currently has eight font sizes numbered 0-7,
  *          and always starts in DEFAULTSIZE whose default value
@@ -2045,7 +2065,8 @@ int mimetex_ctx_init(mimetex_ctx *mctx)
     for (i = 1; i <= 51; i++)
         mctx->patternnumcount0[i] = mctx->patternnumcount1[i] = 0;
 
-    mctx->ispatternnumcount = 1;      /* true to accumulate counts */
+    mctx->ispatternnumcount = 0;      /* true to accumulate counts */
+    aalookupinit(mctx);               /* aalookup() for every 3x3 grid */
     mctx->warninglevel = WARNINGLEVEL;  /* warning level */
 
     /* ------------------------------------------------------------
@@ -2075,6 +2096,7 @@ int mimetex_ctx_init(mimetex_ctx *mctx)
     mctx->blanksignal = BLANKSIGNAL;  /*rastsmash signal right-hand blank*/
     mctx->blanksymspace = 0;      /* extra (or too much) space wanted*/
     mctx->istransparent = 1;      /* true sets background transparent*/
+    mctx->pnglevel = 6;       /* png_raster() deflate level, 0-9 */
     mctx->fgred = 0;
     mctx->fggreen = 0;
     mctx->fgblue = 0;      /* fg r,g,b */
@@ -2092,11 +2114,54 @@ int mimetex_ctx_init(mimetex_ctx *mctx)
     mctx->workingparam = (int *)NULL;  /* working parameter */
     mctx->workingbox = (subraster *)NULL; /*working subraster box*/
     mctx->isreplaceleft = 0;      /* true to replace mctx->leftexpression */
-    mctx->leftexpression = (subraster *)NULL; /*rasterized so far*/
+    mctx->lefthlist = (hlist *)NULL; /* rasterized so far */
     mctx->leftsymdef = NULL; /* mathchardef for preceding symbol*/
     mctx->fraccenterline = NOVALUE; /* baseline for punct. after \frac */
     mctx->fonttable = aafonttable;
+    mctx->arena = (mimetex_arena *)NULL; /* rasters are malloc()'ed */
+    mctx->gifstrtab = NULL;   /* gif_raster() allocates its own */
+    mctx->displaystylelevel = (-99); /* \displaystyle set at recurlevel */
+    mctx->blevel = 0;         /* rastbegin() nesting level */
+    mctx->aaprevrotate = 0;   /* aawtpixel() rotate from previous call */
+    mctx->aacostheta = 1.0;   /* cosine for previous rotate */
+    mctx->aasintheta = 0.0;   /* and sine for previous rotate */
+    for (i = 0; i < 65; i++)  /* rastarray() global values */
+        mctx->gjustify[i] = mctx->gcolwidth[i] = mctx->growheight[i] =
+            mctx->gfixcolsize[i] = mctx->gfixrowsize[i] = mctx->growcenter[i] = 0;
+    *mctx->detexbuff = *mctx->wrapbuff = *mctx->calbuff = '\000';
+    *mctx->timebuff = *mctx->dblbuff = '\000';
     return 0;
 }
 
+/* ==========================================================================
+ * Function:    mimetex_add_handlers ( table )
+ * Purpose:     installs an additional mathchardef table of handlers
+ *              in the first free slot of the global symtables[]
+ * --------------------------------------------------------------------------
+ * Arguments:   table (I)       mathchardef * to table to be installed,
+ *                              terminated by a NULL symbol
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         0 if installed (or already installed),
+ *                              -1 if symtables[] has no free slot
+ * --------------------------------------------------------------------------
+ * Notes:     o symtables[] is shared by all contexts and read without
+ *              locking, so call this once at startup, before rendering
+ *              from more than one thread.
+ * ======================================================================= */
+int mimetex_add_handlers(mathchardef *table)
+{
+    int i;
+    for (i = 0; i < sizeof(symtables) / sizeof(*symtables); i++) {
+        if (symtables[i].table == table)  /* already installed */
+            return 0;
+        if (!symtables[i].table) {        /* first free slot */
+            symtables[i].family = NOVALUE;
+            symtables[i].table = table;
+            delete_symindex();            /* rebuilt on next lookup */
+            return 0;
+        }
+    }
+    return -1;
+} /* --- end-of-function mimetex_add_handlers() --- */
+
 
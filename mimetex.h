@@ -80,21 +80,34 @@ typedef struct raster_struct
     /* -----------------------------------------------------------------------
     memory for raster
     ------------------------------------------------------------------------ */
-    pixbyte *pixmap;      /* memory for width*height bits or bytes */
+    pixbyte *pixmap;      /* memory for stride*height bits or bytes */
+    int   stride;             /* #pixels per row of pixmap, or 0 if packed */
 } raster; /* --- end-of-raster_struct --- */
 
 /* ---
  * associated raster constants and macros
  * -------------------------------------- */
 #define maxraster 1048576 /*99999*/ /* max #pixels for raster pixmap */
+/* --- bitmap rows are padded to a multiple of BITSTRIDE bits, so every
+ * row starts on a word boundary (texfonts.h bitmaps, with stride 0, are
+ * packed, i.e., rows follow one another bit by bit, and are unpacked
+ * by get_charsubraster() before being rendered) --- */
+#define BITSTRIDE 64            /* bitmap row alignment, in bits */
+#define rowstride(width,pixsz) ((pixsz)==1? /* #pixels per row of pixmap */ \
+    (((width)+BITSTRIDE-1)/BITSTRIDE)*BITSTRIDE : (width))
 /* --- #bytes in pixmap raster needed to contain width x height pixels --- */
 #define bitmapsz(width,height) (((width)*(height)+7)/8) /*#bytes if a bitmap*/
-#define pixmapsz(rp) (((rp)->pixsz)*bitmapsz((rp)->width,(rp)->height))
+#define pixmapsz(rp) (((rp)->pixsz)*bitmapsz( /* #bytes in pixmap */ \
+    ((rp)->stride>0?(rp)->stride:(rp)->width),(rp)->height))
+/* --- first byte of irow-th row of a (strided) bitmap --- */
+#define bitmaprow(rp,irow) ((rp)->pixmap+(irow)*((rp)->stride/8))
 /* --- #bytes in raster struct, by its format --- */
 #define pixbytes(rp) ((rp)->format==1? pixmapsz(rp) : /*#bytes in bitmap*/  \
     ((rp)->format==2? (rp)->pixsz : (1+(rp)->pixsz)/2) ) /*gf-formatted*/
 /* --- pixel index calculation used by getpixel() and setpixel() below --- */
-#define PIXDEX(rp,irow,icol) (((irow)*((rp)->width))+(icol))/*irow,icol indx*/
+#define PIXDEX(rp,irow,icol) (((irow)*((rp)->stride))+(icol))/*irow,icol indx*/
+/* --- PIXDEX() of the ipix-th pixel counting row after row (as if packed) --- */
+#define PACKDEX(rp,ipix) ((((ipix)/((rp)->width))*((rp)->stride))+((ipix)%((rp)->width)))
 /* --- get value of pixel, either one bit or one byte, at (irow,icol) --- */
 #define getpixel(rp,irow,icol)      /*get bit or byte based on pixsz*/  \
     ((rp)->pixsz==1? getlongbit((rp)->pixmap,PIXDEX(rp,(irow),(icol))) :\
@@ -157,6 +170,28 @@ typedef struct chardef_struct
     raster  image;            /* bitmap image of character */
 } chardef; /* --- end-of-chardef_struct --- */
 
+/* -------------------------------------------------------------------------
+arena that render-scoped rasters and subrasters are bump-allocated from
+(see new_arena()), so a whole render is released by one reset_arena()
+-------------------------------------------------------------------------- */
+typedef struct arenablock_struct
+{
+    struct arenablock_struct *next; /* next block, or NULL */
+    size_t size;              /* #bytes of memory following this header */
+    size_t used;              /* #bytes handed out so far */
+    size_t last;              /* offset of most recent allocation */
+} arenablock; /* --- end-of-arenablock_struct --- */
+typedef struct mimetex_arena_struct
+{
+    arenablock *blocks;       /* first (oldest) block, or NULL */
+    arenablock *current;      /* block being allocated from */
+} mimetex_arena; /* --- end-of-mimetex_arena_struct --- */
+/* --- arena parameters --- */
+#define ARENABLOCK (65536)    /* #bytes in an arena's first block */
+#define ARENAMAXALLOC (16384) /* bigger rasters are malloc()'ed */
+#define ARENAKEEP (1048576)   /* #bytes of blocks kept by reset_arena() */
+#define ARENAALIGN (16)       /* alignment of every allocation */
+
 typedef struct mimetex_ctx_struct mimetex_ctx;
 typedef struct subraster_struct subraster;
 
@@ -251,6 +286,19 @@ aspect ratio is width/height of the displayed image of a pixel
 #define SQRTWIDTH(sqrtht,x) min2(32,max2(10,SURDWIDTH((sqrtht),(x))))
 
 
+/* -------------------------------------------------------------------------
+edge profile (leftmost and rightmost set pixel in each row of a bitmap),
+which is all rastsmash() needs to know about an image
+-------------------------------------------------------------------------- */
+typedef struct edgeprofile_struct /* typedef for edgeprofile_struct */
+{
+    const raster *image;      /* bitmap described by firstcol[],lastcol[] */
+    int   height;             /* #rows described, image->height */
+    int   nrows;              /* #rows containing set pixels */
+    int   *firstcol;          /* leftmost set col in each row, or -1 */
+    int   *lastcol;           /* rightmost set col in each row, or -1 */
+} edgeprofile; /* --- end-of-edgeprofile_struct --- */
+
 /* -------------------------------------------------------------------------
 subraster (bitmap image, its attributes, overlaid position in raster, etc)
 -------------------------------------------------------------------------- */
@@ -266,6 +314,8 @@ struct subraster_struct /* "typedef" for subraster_struct*/
     int   toprow, leftcol;        /* upper-left corner of subraster */
     /* --- pointer to raster bitmap image of subraster --- */
     raster *image;            /*ptr to bitmap image of subraster*/
+    /* --- edges of a cached glyph's image, see subrastedges() --- */
+    const edgeprofile *edges; /* shared with glyph cache, or NULL */
 }; /* --- end-of-subraster_struct --- */
 
 /* --- subraster types --- */
@@ -274,8 +324,40 @@ struct subraster_struct /* "typedef" for subraster_struct*/
 #define IMAGERASTER (3)     /* image */
 #define FRACRASTER  (4)     /* image of \frac{}{} */
 #define ASCIISTRING (5)     /* ascii string (not a raster) */
+#define GLYPHRASTER (6)     /* shared decoded .gf char, laid out as image */
 
 #define make_raster(expression,size)    ((rasterize(expression,size))->image)
+/* --- sp's edge profile, if it still describes sp's image, else NULL --- */
+#define subrastedges(sp) ((sp)->edges != NULL && \
+    ((sp)->edges)->image == (sp)->image ? (sp)->edges : NULL)
+
+
+/* -------------------------------------------------------------------------
+hlist (row of subrasters laid out by rastcat() but not yet painted)
+-------------------------------------------------------------------------- */
+typedef struct hlistitem_struct /* typedef for hlistitem_struct */
+{
+    raster *image;            /* bitmap image of one concatenated term */
+    int   isowned;            /* true to free image along with hlist */
+    int   toprow, leftcol;    /* upper-left corner, less hlist shift */
+    int   nrows;              /* #rows of image lying inside composite */
+} hlistitem; /* --- end-of-hlistitem_struct --- */
+
+typedef struct hlist_struct /* typedef for hlist_struct */
+{
+    /* --- composite as rastcat() would have returned it, less pixmap --- */
+    subraster box;            /* type, symdef, baseline, size */
+    raster dims;              /* width, height, pixsz (pixmap unused) */
+    subraster *painted;       /* composite painted by hlist_box(), or NULL*/
+    /* --- terms placed in composite so far --- */
+    int   rowshift, colshift; /* added to each item's toprow, leftcol */
+    int   nitems, maxitems;   /* #items placed, #items allocated */
+    hlistitem *items;         /* items in the order they were placed */
+    /* --- right edge of composite, for rastsmash() --- */
+    int   *lastcol;           /* rightmost set col in each row, or -1 */
+    int   maxrows;            /* #ints allocated for lastcol[] */
+    int   islastcol;          /* true if lastcol[] describes composite */
+} hlist; /* --- end-of-hlist_struct --- */
 
 
 /* -------------------------------------------------------------------------
@@ -287,7 +369,7 @@ typedef struct fontfamily_struct /* typedef for fontfamily */
     several sizes, fontdef[0-7]=tiny,small,normal,large,Large,LARGE,huge,HUGE
     ------------------------------------------------------------------------ */
     int   family;             /* font family e.g., 2=math symbol */
-    chardef *fontdef[LARGESTSIZE+2];  /*small=(fontdef[1])[charnum].image*/
+    const chardef *fontdef[LARGESTSIZE+2]; /*small=(fontdef[1])[charnum].image*/
 } fontfamily; /* --- end-of-fontfamily_struct --- */
 
 /* --- sqrt --- */
@@ -345,6 +427,7 @@ struct mimetex_ctx_struct {
     int patternnumcount0[99];
     int patternnumcount1[99]; /*aalookup() counts*/
     int istransparent;/* true sets background transparent*/
+    int pnglevel;     /* png_raster() deflate level, 0-9 */
     int isplusblank;  /*interpret +'s in query as blanks?*/
     int aaalgorithm;  /* for lp, 1=aalowpass, 2 =aapnm */
     int recurlevel;     /* inc/decremented in rasterize() */
@@ -378,7 +461,7 @@ struct mimetex_ctx_struct {
     int *workingparam;  /* working parameter */
     subraster *workingbox; /*working subraster box*/
     int isreplaceleft;      /* true to replace leftexpression */
-    subraster *leftexpression; /*rasterized so far*/
+    hlist *lefthlist;       /* rasterized so far, see get_leftexpression() */
     mathchardef *leftsymdef; /* mathchardef for preceding symbol*/
     int fraccenterline; /* baseline for punct. after \frac */
     int centerwt;
@@ -389,10 +472,59 @@ struct mimetex_ctx_struct {
     int maxaaparams;
     int cornerwt;
     int ispatternnumcount;
+    /* --- aalookup() grayscale for each 3x3 grid, see aalookupinit() --- */
+    int aalookuptable[512];
     /* --- for low-pass anti-aliasing --- */
     fontfamily *fonttable;
+    /* --- render-scoped memory, see new_arena() --- */
+    mimetex_arena *arena;   /* for rasters, or NULL to malloc() */
+    /* --- gif_raster()'s LZW string table, see GIF_CreateStrtab() --- */
+    struct GIFStrtab *gifstrtab; /* kept by caller, or NULL */
+    /* --- state formerly kept in function-level statics --- */
+    int displaystylelevel;  /* \displaystyle set at recurlevel */
+    int blevel;         /* rastbegin() nesting level */
+    int aaprevrotate;   /* aawtpixel() rotate from previous call */
+    double aacostheta;  /* and its cosine */
+    double aasintheta;  /* and its sine */
+    /* --- rastarray() global values, shared by nested arrays --- */
+    int gjustify[65];   /* -1,0,+1 = l,c,r */
+    int gcolwidth[65];  /* widest token in col */
+    int growheight[65]; /* "highest" in row */
+    int gfixcolsize[65]; /* 1=fixed col width */
+    int gfixrowsize[65]; /* 1=fixed row height */
+    int growcenter[65]; /* true = vcenter row */
+    /* --- returned-string buffers (valid until next call) --- */
+    char detexbuff[4096];   /* strdetex() */
+    char wrapbuff[4096];    /* strwrap() */
+    char calbuff[4096];     /* calendar() */
+    char timebuff[256];     /* timestamp() */
+    char dblbuff[256];      /* dbltoa() */
 };
 
+/* -------------------------------------------------------------------------
+options and results for mimetex_render() (library entry point)
+-------------------------------------------------------------------------- */
+/* --- image formats (same numbering as mimetex's -g switch) --- */
+#define MIMETEX_GIF (0)     /* gif */
+#define MIMETEX_PBM (1)     /* b&w portable bitmap */
+#define MIMETEX_PGM (2)     /* grayscale portable graymap */
+#define MIMETEX_PNG (4)     /* png (3 is the driver's xbm) */
+typedef struct mimetex_options_struct
+{
+    int   size;               /* font size 0-7, usually NORMALSIZE */
+    int   format;             /* MIMETEX_GIF, _PNG, _PBM or _PGM */
+    int   iserrormsg;         /* true to render failure message */
+} mimetex_options; /* --- end-of-mimetex_options_struct --- */
+typedef struct mimetex_image_struct
+{
+    int   format;             /* MIMETEX_GIF, _PNG, _PBM or _PGM */
+    int   width, height;      /* #pixels wide, high */
+    int   baseline;           /* baseline row, 0=top */
+    int   valign;             /* baseline-(height-1), or -9999 */
+    int   ncolors;            /* #colors, 2=b&w */
+    int   nbytes;             /* #bytes in (or needed for) image */
+} mimetex_image; /* --- end-of-mimetex_image_struct --- */
+
 /* ---
  * mathchardefs for symbols recognized by mimetex
  * ---------------------------------------------- */
@@ -400,6 +532,7 @@ extern mathchardef_table symtables[16];
 
 /* mimetex.c */
 int mimetex_ctx_init(mimetex_ctx *mctx);
+int mimetex_add_handlers(mathchardef *table);
 
 /* raster.c */
 raster *new_raster(mimetex_ctx *mctx, int width, int height, int pixsz);
@@ -418,6 +551,17 @@ int rastsmashcheck(mimetex_ctx *mctx, char *term);
 subraster *new_subraster(mimetex_ctx *mctx, int width, int height, int pixsz);
 int delete_subraster(mimetex_ctx *mctx, subraster *sp);
 subraster *subrastcpy(mimetex_ctx *mctx, subraster *sp);
+hlist *new_hlist(mimetex_ctx *mctx, subraster *sp);
+int hlist_cat(mimetex_ctx *mctx, hlist *hp, subraster *sp);
+subraster *hlist_box(mimetex_ctx *mctx, hlist *hp);
+subraster *hlist_subraster(mimetex_ctx *mctx, hlist *hp);
+int delete_hlist(mimetex_ctx *mctx, hlist *hp);
+mimetex_arena *new_arena(void);
+int reset_arena(mimetex_arena *ap);
+int delete_arena(mimetex_arena *ap);
+edgeprofile *new_edgeprofile(mimetex_ctx *mctx, const raster *rp);
+int delete_edgeprofile(mimetex_ctx *mctx, edgeprofile *ep);
+subraster *subrastkeep(mimetex_ctx *mctx, subraster *sp);
 
 /* tex.c */
 char *texchar(mimetex_ctx *mctx, char *expression, char *chartoken);
@@ -425,7 +569,7 @@ char *texsubexpr(mimetex_ctx *mctx, char *expression, char *subexpr, int maxsubs
 char *texleft(mimetex_ctx *mctx, char *expression, char *subexpr, int maxsubsz, char *ldelim, char *rdelim);
 char *texscripts(mimetex_ctx *mctx, char *expression, char *subscript, char *superscript, int which);
 int isbrace(mimetex_ctx *mctx, char *expression, char *braces, int isescape);
-char *strdetex(char *s, int mode);
+char *strdetex(mimetex_ctx *mctx, char *s, int mode);
 char *mimeprep(mimetex_ctx *mctx, char *expression);
 char *strtexchr(char *string, char *texchr);
 char *preamble(mimetex_ctx *mctx, char *expression, int *size, char *subexpr);
@@ -435,14 +579,16 @@ chardef *new_chardef(mimetex_ctx *mctx);
 int delete_chardef(mimetex_ctx *mctx, chardef *cp);
 mathchardef *get_ligature(mimetex_ctx *mctx, char *expression, int family);
 mathchardef *get_symdef(mimetex_ctx *mctx, char *symbol);
+int delete_symindex(void);
 subraster *make_delim(mimetex_ctx *mctx, char *symbol, int height);
 subraster *get_delim(mimetex_ctx *mctx, char *symbol, int height, int family);
 subraster *get_charsubraster(mimetex_ctx *mctx, mathchardef *symdef, int size);
+int mimetex_warm_glyphs(mimetex_ctx *mctx);
 
 /* render.c */
 int type_raster(mimetex_ctx *mctx, raster *rp, FILE *fp);
 raster *border_raster(mimetex_ctx *mctx, raster *rp, int ntop, int nbot, int isline, int isfree);
-raster *gftobitmap(mimetex_ctx *mctx, raster *gf);
+raster *gftobitmap(mimetex_ctx *mctx, const raster *gf);
 subraster *arrow_subraster(mimetex_ctx *mctx, int width, int height, int pixsz, int drctn, int isBig);
 subraster *uparrow_subraster(mimetex_ctx *mctx, int width, int height, int pixsz, int drctn, int isBig);
 subraster *rastparen(mimetex_ctx *mctx, char **subexpr, int size, subraster *basesp);
@@ -456,12 +602,13 @@ int circle_recurse(mimetex_ctx *mctx, raster *rp, int row0, int col0, int row1,
 int line_recurse(mimetex_ctx *mctx, raster *rp, double row0, double col0, double row1, double col1, int thickness);
 raster  *backspace_raster(mimetex_ctx *mctx, raster *rp, int nback, int *pback, int minspace, int isfree);
 subraster *rasterize(mimetex_ctx *mctx, char *expression, int size);
+subraster *get_leftexpression(mimetex_ctx *mctx);
 
 /* utils.c */
-char *dbltoa(double dblval, int npts);
+char *dbltoa(mimetex_ctx *mctx, double dblval, int npts);
 int emit_string(FILE *fp, int col1, char *string, char *comment);
-char *calendar(int year, int month, int day);
-char *timestamp(int tzdelta, int ifmt);
+char *calendar(mimetex_ctx *mctx, int year, int month, int day);
+char *timestamp(mimetex_ctx *mctx, int tzdelta, int ifmt);
 int tzadjust(int tzdelta, int *year, int *month, int *day, int *hour);
 int daynumber(int year, int month, int day);
 char *strwrap(mimetex_ctx *mctx, char *s, int linelen, int tablen);
@@ -477,8 +624,16 @@ int hex_bitmap(raster *rp, FILE *fp, int col1, int isstr);
 int aalowpass(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale);
 int aapnm(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale);
 int aapnmlookup(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale);
+int aalookupinit(mimetex_ctx *mctx);
 int aalowpasslookup(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, int grayscale);
 int aacolormap(mimetex_ctx *mctx, intbyte *bytemap, int nbytes, intbyte *colors, intbyte *colormap);
+int aaraster(mimetex_ctx *mctx, raster *rp, intbyte *bytemap, intbyte *colormap, intbyte *colors);
+
+/* output.c */
+int type_pbmpgm(raster *rp, int ptype, FILE *fp, char *buffer, int buffer_size);
+int gif_raster(mimetex_ctx *mctx, int ncolors, raster *bp, intbyte *colormap, intbyte *colors, FILE *fp, void *buffer, int buffer_size);
+int png_raster(mimetex_ctx *mctx, int ncolors, raster *bp, intbyte *colormap, intbyte *colors, FILE *fp, void *buffer, int buffer_size);
+int mimetex_render(mimetex_ctx *mctx, char *expression, mimetex_options *opts, unsigned char *buffer, int buffer_size, mimetex_image *image);
 
 /* ------------------------------------------------------------
 miscellaneous macros
@@ -494,6 +649,8 @@ miscellaneous macros
 
 /* --- lowercase a string --- */
 #define strlower(s) strnlower((s),0)    /* lowercase an entire string */
+/* --- drop a string's first n chars (overlapping, so not strcpy()) --- */
+#define strsqueeze(s,n) memmove((s),(s)+(n),strlen((s)+(n))+1)
 /* --- strip leading and trailing whitespace (including ~) --- */
 #define trimwhite(thisstr) if ( (thisstr) != NULL ) { \
     int thislen = strlen(thisstr); \
@@ -502,7 +659,7 @@ miscellaneous macros
         (thisstr)[thislen] = '\000'; \
       else break; \
     if ( (thislen = strspn((thisstr)," \t\n\r\f\v")) > 0 ) \
-      strcpy((thisstr),(thisstr)+thislen); } else
+      strsqueeze((thisstr),thislen); } else
 /* --- strncpy() n bytes and make sure it's null-terminated --- */
 #define strninit(target,source,n) if( (target)!=NULL && (n)>=0 ) { \
       char *thissource = (source); \
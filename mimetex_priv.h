@@ -32,6 +32,16 @@
 
 #define BLANKSIGNAL (-991234)       /*rastsmash signal right-hand blank*/
 
+/* --- read/publish ptrs to lazily-built tables shared by all contexts --- */
+#if defined(__GNUC__)
+#define loadshared(pp) __atomic_load_n((pp), __ATOMIC_ACQUIRE)
+#define publishshared(pp,p) __atomic_compare_exchange_n((pp), \
+            &(__typeof__(*(pp))){NULL}, (p), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#else                                   /* single-threaded use only */
+#define loadshared(pp) (*(pp))
+#define publishshared(pp,p) (*(pp) == NULL ? (*(pp) = (p), 1) : 0)
+#endif
+
 struct fontinfo_struct {
     char *name;
     int family;
@@ -0,0 +1,645 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include "mimetex_priv.h"
+#include "gifsave.h"
+#include "pngsave.h"
+
+
+/* ==========================================================================
+ * Function:    pbmpgm_write ( fp, buffer, buffer_size, nbytes, text )
+ * Purpose: Appends text to fp, or to buffer if fp is NULL
+ * --------------------------------------------------------------------------
+ * Arguments:   fp (I)      FILE * to open output file,
+ *              or NULL to write to buffer
+ *      buffer (O)  char * to output buffer (used if fp==NULL)
+ *      buffer_size (I) int containing #bytes in buffer
+ *      nbytes (I/O)    int * to #bytes already written,
+ *              incremented by strlen(text)
+ *      text (I)    char * to null-terminated text to be written
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error).
+ * --------------------------------------------------------------------------
+ * Notes:     o Like gifsave.c's Write(), a full buffer isn't an error,
+ *      nbytes just keeps counting so the caller can see
+ *      how big a buffer was needed.
+ * ======================================================================= */
+/* --- entry point --- */
+static int pbmpgm_write(FILE *fp, char *buffer, int buffer_size,
+                        int *nbytes, char *text)
+{
+    /* #bytes to be written */
+    int textlen = strlen(text);
+    if (fp != NULL) {            /* write to open file */
+        if (fputs(text, fp) == EOF) return (0);
+    } else if (buffer != NULL) {     /* or to memory buffer */
+        if (*nbytes + textlen <= buffer_size)
+            memcpy(buffer + *nbytes, text, textlen);
+    }
+    /* bump output byte count */
+    *nbytes += textlen;
+    return (1);
+} /* --- end-of-function pbmpgm_write() --- */
+
+
+/* ==========================================================================
+ * Function:    type_pbmpgm ( rp, ptype, fp, buffer, buffer_size )
+ * Purpose: Write pbm or pgm image of rp to fp or buffer
+ * --------------------------------------------------------------------------
+ * Arguments:   rp (I)      ptr to raster struct for which
+ *              a pbm/pgm file is to be written.
+ *      ptype (I)   int containing 1 for pbm, 2 for pgm, or
+ *              0 to determine ptype from values in rp
+ *      fp (I)      FILE * to open output file,
+ *              or NULL to write to buffer instead
+ *      buffer (O)  char * to output buffer (used if fp==NULL)
+ *      buffer_size (I) int containing #bytes in buffer
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     total #bytes written,
+ *              or 0 for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o fp isn't closed, that's up to the caller.
+ *        o If the image doesn't fit in buffer, the #bytes it needs
+ *      is still returned (and is greater than buffer_size).
+ * ======================================================================= */
+/* --- entry point --- */
+int type_pbmpgm(raster *rp, int ptype, FILE *fp, char *buffer, int buffer_size)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* completion flag, total #bytes written */
+    int isokay = 0, nbytes = 0;
+    /*height(row), width(col) indexes in raster*/
+    int irow = 0, jcol = 0;
+    int pixmin = 9999, pixmax = (-9999); /* min, max pixel value in raster */
+    char    outline[1024], outfield[256], /* output line, field */
+    /* cr at end-of-line */
+    cr[16] = "\n\000";
+    /* maximum allowed line length */
+    int maxlinelen = 70;
+    int pixfrac = 6;    /* use (pixmax-pixmin)/pixfrac as step */
+    static char *magic[] = { NULL, "P1", "P2" };    /*identifying "magic number"*/
+    /* ------------------------------------------------------------
+    check input, determine grayscale,  and set up output file if necessary
+    ------------------------------------------------------------ */
+    /* --- check input args --- */
+    /* no input raster provided */
+    if (rp == NULL) goto end_of_job;
+    /* --- determine largest (and smallest) value in pixmap --- */
+    for (irow = 0; irow < rp->height; irow++)  /* for each row, top-to-bottom */
+        for (jcol = 0; jcol < rp->width; jcol++) { /* for each col, left-to-right */
+            /* value of pixel at irow,jcol */
+            int pixval = getpixel(rp, irow, jcol);
+            /* new minimum */
+            pixmin = min2(pixmin, pixval);
+            pixmax = max2(pixmax, pixval);
+        } /* new maximum */
+    /* --- determine ptype if not given --- */
+    if (ptype < 1 || ptype > 2)          /* caller wants us to decide */
+        /* pbm unless grayscale */
+        ptype = (pixmax > 1 ? 2 : 1);
+    /* ------------------------------------------------------------
+    format and write header
+    ------------------------------------------------------------ */
+    /* --- format header info --- */
+    /* initialize line buffer */
+    *outline = '\000';
+    /* begin file with "magic number" */
+    strcat(outline, magic[ptype]);
+    /* followed by cr to end line */
+    strcat(outline, cr);
+    /* format width and height */
+    sprintf(outfield, "%d %d", rp->width, rp->height);
+    /* add width and height to header */
+    strcat(outline, outfield);
+    /* followed by cr to end line */
+    strcat(outline, cr);
+    if (ptype == 2) {            /* need max grayscale value */
+        /* format maximum pixel value */
+        sprintf(outfield, "%d", pixmax);
+        /* add max value to header */
+        strcat(outline, outfield);
+        strcat(outline, cr);
+    }       /* followed by cr to end line */
+    /* --- write header to file or memory buffer --- */
+    if (!pbmpgm_write(fp, buffer, buffer_size, &nbytes, outline))
+        /* return with error if failed */
+        goto end_of_job;
+    /* ------------------------------------------------------------
+    format and write pixels
+    ------------------------------------------------------------ */
+    /* initialize line buffer */
+    *outline = '\000';
+    for (irow = 0; irow <= rp->height; irow++) /* for each row, top-to-bottom */
+        for (jcol = 0; jcol < rp->width; jcol++)  { /* for each col, left-to-right */
+            /* --- format value at irow,jcol--- */
+            /* init empty field */
+            *outfield = '\000';
+            if (irow < rp->height) {       /* check row index */
+                /* value of pixel at irow,jcol */
+                int pixval = getpixel(rp, irow, jcol);
+                if (ptype == 1)              /* pixval must be 1 or 0 */
+                    pixval = (pixval > pixmin + ((pixmax - pixmin) / pixfrac) ? 1 : 0);
+                sprintf(outfield, "%d ", pixval);
+            }   /* format pixel value */
+            /* --- write line if this value won't fit on it (or last line) --- */
+            if (strlen(outline) + strlen(outfield) + strlen(cr) >= maxlinelen /*won't fit*/
+                    ||   irow >= rp->height) {        /* force writing last line */
+                /* add cr to end current line */
+                strcat(outline, cr);
+                if (!pbmpgm_write(fp, buffer, buffer_size, &nbytes, outline))
+                    /* return with error if failed */
+                    goto end_of_job;
+                /* re-initialize line buffer */
+                *outline = '\000';
+            } /* --- end-of-if(strlen>=maxlinelen) --- */
+            /* done after writing last line */
+            if (irow >= rp->height) break;
+            /* --- concatanate value to line -- */
+            /* concatanate value to line */
+            strcat(outline, outfield);
+        } /* --- end-of-for(jcol,irow) --- */
+    /* signal successful completion */
+    isokay = 1;
+    /* ------------------------------------------------------------
+    Back to caller with total #bytes written, or 0=failed.
+    ------------------------------------------------------------ */
+end_of_job:
+    /*back to caller with #bytes written*/
+    return ((isokay ? nbytes : 0));
+} /* --- end-of-function type_pbmpgm() --- */
+
+
+struct gif_raster_params {
+    mimetex_ctx *mctx;
+    int ncolors;
+    raster *bitmap; /* use 0/1 bitmap image or */
+    intbyte *colormap;  /* anti-aliased color indexes */
+};
+
+/* ==========================================================================
+ * Function:    gif_raster_get_pixel ( int x, int y )
+ * Purpose: callback for GIF_CompressImage() returning the
+ *      pixel at column x, row y
+ * --------------------------------------------------------------------------
+ * Arguments:   x (I)       int containing column=0...width-1
+ *              of desired pixel
+ *      y (I)       int containing row=0...height-1
+ *              of desired pixel
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     0 or 1, if pixel at x,y is off or on
+ * --------------------------------------------------------------------------
+ * Notes:     o
+ * ======================================================================= */
+/* --- entry point --- */
+static int gif_raster_get_pixel(void *_ctx, int x, int y)
+{
+    struct gif_raster_params *ctx = _ctx;
+
+    /* pixel index for x,y-coords*/
+    int ipixel = y * ctx->bitmap->width + x;
+    /* value of pixel */
+    int pixval = 0;
+    if (!ctx->colormap)               /* use bitmap if not anti-aliased */
+        /*pixel = 0 or 1*/
+        pixval = getpixel(ctx->bitmap, y, x);
+    else
+    /* else use anti-aliased grayscale*/
+        /* colors[] index number */
+        pixval = (int)(ctx->colormap[ipixel]);
+    if (ctx->mctx->msgfp != NULL && ctx->mctx->msglevel >= 9999) { /* dump pixel */
+        fprintf(ctx->mctx->msgfp, "gif_raster_get_pixel> x=%d, y=%d  pixel=%d\n", x, y, pixval);
+        fflush(ctx->mctx->msgfp);
+    }
+    return pixval;
+} /* --- end-of-function gif_raster_get_pixel() --- */
+
+
+/* ==========================================================================
+ * Function:    gif_raster ( ncolors, bp, colormap, colors, fp,
+ *              buffer, buffer_size )
+ * Purpose: Emit a gif image of bp (or of its anti-aliased colormap)
+ *      to fp, or to buffer if fp is NULL
+ * --------------------------------------------------------------------------
+ * Arguments:   ncolors (I) int containing #colors in colors[],
+ *              2 for a b&w image
+ *      bp (I)      raster * to bitmap image
+ *      colormap (I)    intbyte * to anti-aliased colors[] indexes,
+ *              or NULL to use the bitmap in bp
+ *      colors (I/O)    intbyte * to grayscales, 0=white...255=black
+ *      fp (I)      FILE * to open output file (closed when done),
+ *              or NULL to write to buffer instead
+ *      buffer (O)  void * to output buffer (used if fp==NULL)
+ *      buffer_size (I) int containing #bytes in buffer
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #bytes in gif image, or 0 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o If the image doesn't fit in buffer, the #bytes it needs
+ *      is still returned (and is greater than buffer_size).
+ *        o Pixels are handed to gifsave a buffer at a time, except
+ *      at msglevel>=9999, when gif_raster_get_pixel() dumps each one.
+ *        o The LZW string table is mctx->gifstrtab.  If that's NULL,
+ *      a temporary table is used instead, so callers emitting many
+ *      images should set mctx->gifstrtab=GIF_CreateStrtab() once.
+ * ======================================================================= */
+/* --- entry point --- */
+int gif_raster(mimetex_ctx *mctx, int ncolors, raster *bp, intbyte *colormap,
+               intbyte *colors, FILE *fp, void *buffer, int buffer_size)
+{
+    struct gif_raster_params params = { mctx, ncolors, bp, colormap };
+    GIFContext *gctx;
+    /* #bytes emitted */
+    int gifSize = 0;
+    /* GIF_CompressImage() (or Bytes or Bits) status */
+    int status = GIF_OK;
+    /* temporary LZW string table, if mctx doesn't have one */
+    GIFStrtab *tempstrtab = NULL;
+    /* --- initialize gifsave library and colors --- */
+    if (mctx->msgfp != NULL && mctx->msglevel >= 999) {
+        fprintf(mctx->msgfp, "gif_raster> calling GIF_Create(*,%d,%d,%d,8)\n",
+                bp->width, bp->height, ncolors);
+        fflush(mctx->msgfp);
+    }
+    if ((gctx = GIF_Create(fp, buffer, buffer_size, bp->width, bp->height, ncolors, 8)) == NULL)
+        return 0;
+    if (mctx->gifstrtab != NULL)         /* caller keeps a string table */
+        GIF_SetStrtab(gctx, mctx->gifstrtab);
+    else if ((tempstrtab = GIF_CreateStrtab()) != NULL) /* else use our own */
+        GIF_SetStrtab(gctx, tempstrtab);
+    /* background white if all 255 */
+    GIF_SetColor(gctx, 0, mctx->bgred, mctx->bggreen, mctx->bgblue);
+    if (ncolors == 2) {               /* just b&w if not anti-aliased */
+        /* foreground black if all 0 */
+        GIF_SetColor(gctx, 1, mctx->fgred, mctx->fggreen, mctx->fgblue);
+        /* and set 2 b&w color indexes */
+        colors[0] = '\000';
+        colors[1] = '\001';
+    } else {
+        int igray;
+        /* set grayscales for anti-aliasing */
+        /* --- anti-aliased, so call GIF_SetColor() for each colors[] --- */
+        for (igray = 1; igray < ncolors; igray++) { /* for colors[] values */
+            /*--- gfrac goes from 0 to 1.0, as igray goes from 0 to ncolors-1 ---*/
+            double gfrac = ((double)colors[igray]) / ((double)colors[ncolors-1]);
+            /* --- r,g,b components go from background to foreground color --- */
+            int red  = iround(((double)mctx->bgred)  + gfrac * ((double)(mctx->fgred - mctx->bgred))),
+                green = iround(((double)mctx->bggreen) + gfrac * ((double)(mctx->fggreen - mctx->bggreen))),
+                blue = iround(((double)mctx->bgblue) + gfrac * ((double)(mctx->fgblue - mctx->bgblue)));
+            /* --- set color index number igray to rgb values gray,gray,gray --- */
+            /*set gray,grayer,...,0=black*/
+            GIF_SetColor(gctx, igray, red, green, blue);
+        } /* --- end-of-for(igray) --- */
+    }
+    /* --- set gif color#0 (background) transparent --- */
+    if (mctx->istransparent)             /* transparent background wanted */
+        /* set transparent background */
+        GIF_SetTransparent(gctx, 0);
+    /*flush debugging output*/
+    if (mctx->msgfp != NULL && mctx->msglevel >= 9)
+        fflush(mctx->msgfp);
+    /* --- emit compressed gif image (to stdout or cache file) --- */
+    if (mctx->msgfp != NULL && mctx->msglevel >= 9999) /* dump pixels */
+        /* so get each one from gif_raster_get_pixel() */
+        status = GIF_CompressImage(gctx, 0, 0, -1, -1, gif_raster_get_pixel, &params);
+    else if (colormap != NULL)        /* anti-aliased colors[] indexes */
+        /* are one byte per pixel, row after row */
+        status = GIF_CompressBytes(gctx, 0, 0, -1, -1, colormap, bp->width);
+    else if (bp->pixsz == 1 && bp->stride > 0) /* padded bitmap */
+        /* is read a row of bits at a time */
+        status = GIF_CompressBits(gctx, 0, 0, -1, -1, bp->pixmap, bp->stride / 8);
+    else
+        /* anything else goes through gif_raster_get_pixel() */
+        status = GIF_CompressImage(gctx, 0, 0, -1, -1, gif_raster_get_pixel, &params);
+    /* emit gif */
+    if (status == GIF_OK
+            /* close file */
+            &&   GIF_Close(gctx) == GIF_OK)
+        gifSize = gctx->gifSize;
+    /* GIF_Close() doesn't free its context */
+    free((void *)gctx);
+    GIF_DestroyStrtab(tempstrtab);
+    return gifSize;
+} /* --- end-of-function gif_raster() --- */
+
+
+/* ==========================================================================
+ * Function:    png_raster ( ncolors, bp, colormap, colors, fp,
+ *              buffer, buffer_size )
+ * Purpose: Emit a png image of bp (or of its anti-aliased colormap)
+ *      to fp, or to buffer if fp is NULL
+ * --------------------------------------------------------------------------
+ * Arguments:   ncolors (I) int containing #colors in colors[],
+ *              2 for a b&w image
+ *      bp (I)      raster * to bitmap image
+ *      colormap (I)    intbyte * to anti-aliased colors[] indexes,
+ *              or NULL to use the bitmap in bp
+ *      colors (I)  intbyte * to grayscales, 0=white...255=black
+ *              (not used for a b&w image)
+ *      fp (I)      FILE * to open output file,
+ *              or NULL to write to buffer instead
+ *      buffer (O)  void * to output buffer (used if fp==NULL)
+ *      buffer_size (I) int containing #bytes in buffer
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #bytes in png image, or 0 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o fp isn't closed, that's up to the caller.
+ *        o If the image doesn't fit in buffer, the #bytes it needs
+ *      is still returned (and is greater than buffer_size).
+ *        o The palette has gif_raster()'s colors, at the fewest
+ *      bits per pixel that hold ncolors of them.  But if
+ *      mctx->istransparent, every index is the foreground color,
+ *      with colors[] as its alpha, so anti-aliased edges blend
+ *      into any background rather than the one bg r,g,b names.
+ *        o Compressed at mctx->pnglevel, see png_deflate().
+ * ======================================================================= */
+/* --- entry point --- */
+int png_raster(mimetex_ctx *mctx, int ncolors, raster *bp, intbyte *colormap,
+               intbyte *colors, FILE *fp, void *buffer, int buffer_size)
+{
+    /* image for png_write() */
+    pngimage image;
+    /* bp's pixels one per byte, unless it's a padded bitmap */
+    unsigned char *pixels = NULL;
+    /* #bytes emitted */
+    int pngSize = 0;
+    int igray = 0, irow = 0, jcol = 0;
+    /* --- check input --- */
+    if (bp == NULL || (colormap != NULL && colors == NULL)) return 0;
+    if (colormap == NULL) ncolors = 2;  /* b&w bitmap */
+    if (ncolors < 2 || ncolors > 256) return 0;
+    memset((void *)&image, 0, sizeof(pngimage));
+    image.width = bp->width;
+    image.height = bp->height;
+    image.colortype = PNG_PALETTE;
+    image.bitdepth = (ncolors <= 2 ? 1 : (ncolors <= 4 ? 2 : (ncolors <= 16 ? 4 : 8)));
+    image.ncolors = ncolors;
+    /* --- palette goes from background to foreground color --- */
+    for (igray = 0; igray < ncolors; igray++) {
+        /*--- gfrac goes from 0 to 1.0, as igray goes from 0 to ncolors-1 ---*/
+        double gfrac = (igray == 0 ? 0.0 : (colormap == NULL ? 1.0 :
+                        ((double)colors[igray]) / ((double)colors[ncolors-1])));
+        unsigned char *rgb = image.palette[igray];
+        if (mctx->istransparent) {      /* fg with alpha=gfrac */
+            rgb[0] = (unsigned char)(igray == 0 ? mctx->bgred : mctx->fgred);
+            rgb[1] = (unsigned char)(igray == 0 ? mctx->bggreen : mctx->fggreen);
+            rgb[2] = (unsigned char)(igray == 0 ? mctx->bgblue : mctx->fgblue);
+            image.alpha[igray] = (unsigned char)iround(255.0 * gfrac);
+        } else {                        /* opaque blend of bg and fg */
+            rgb[0] = (unsigned char)iround(((double)mctx->bgred) +
+                                           gfrac * ((double)(mctx->fgred - mctx->bgred)));
+            rgb[1] = (unsigned char)iround(((double)mctx->bggreen) +
+                                           gfrac * ((double)(mctx->fggreen - mctx->bggreen)));
+            rgb[2] = (unsigned char)iround(((double)mctx->bgblue) +
+                                           gfrac * ((double)(mctx->fgblue - mctx->bgblue)));
+            image.alpha[igray] = 255;
+        }
+    } /* --- end-of-for(igray) --- */
+    /* --- pixels --- */
+    if (colormap != NULL) {             /* anti-aliased colors[] indexes */
+        image.pixels = colormap;
+        image.stride = bp->width;
+    } else if (bp->pixsz == 1 && bp->stride > 0) { /* padded bitmap */
+        image.pixels = bp->pixmap;
+        image.stride = bp->stride / 8;
+        image.isbits = 1;
+    } else {                            /* anything else, via getpixel() */
+        if ((pixels = (unsigned char *)malloc(bp->width * bp->height)) == NULL)
+            return 0;
+        for (irow = 0; irow < bp->height; irow++)
+            for (jcol = 0; jcol < bp->width; jcol++)
+                pixels[irow*bp->width + jcol] = (getpixel(bp, irow, jcol) ? 1 : 0);
+        image.pixels = pixels;
+        image.stride = bp->width;
+    }
+    /* --- emit png image (to stdout or cache file) --- */
+    if (mctx->msgfp != NULL && mctx->msglevel >= 999) {
+        fprintf(mctx->msgfp, "png_raster> calling png_write(%dx%d,%d colors,"
+                "%d bits,level=%d)\n", bp->width, bp->height, ncolors,
+                image.bitdepth, mctx->pnglevel);
+        fflush(mctx->msgfp);
+    }
+    pngSize = png_write(&image, mctx->pnglevel, fp, buffer, buffer_size);
+    if (pixels != NULL) free((void *)pixels);
+    return pngSize;
+} /* --- end-of-function png_raster() --- */
+
+
+/* ==========================================================================
+ * Function:    mimetex_render ( mctx, expression, opts,
+ *              buffer, buffer_size, image )
+ * Purpose: Library entry point: renders a LaTeX expression all the way
+ *      to gif, png, pbm or pgm bytes in a caller-supplied buffer
+ * --------------------------------------------------------------------------
+ * Arguments:   mctx (I)    mimetex_ctx * initialized by mimetex_ctx_init()
+ *              (its colors, aaalgorithm, gamma, etc are used)
+ *      expression (I)  char * to null-terminated LaTeX expression
+ *              (not modified)
+ *      opts (I)    mimetex_options * to render options,
+ *              or NULL for defaults
+ *      buffer (O)  unsigned char * to buffer returning
+ *              the image bytes
+ *      buffer_size (I) int containing #bytes in buffer
+ *      image (O)   mimetex_image * returning size, baseline, etc,
+ *              of the rendered image (may be NULL)
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #bytes of image in buffer,
+ *              or 0 for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o This is the same pipeline main() runs, i.e.,
+ *      mimeprep(), rasterize(), border_raster(), aaraster(),
+ *      and then gif_raster(), png_raster() or type_pbmpgm(),
+ *      but everything stays in memory and nothing exits.
+ *        o mctx is restored to its entry state before returning,
+ *      so one context may be reused for any number of renders.
+ *        o If buffer is too small, 0 is returned and image->nbytes
+ *      contains the #bytes that would have been needed.
+ *        o Rasters are allocated from mctx->arena, which is reset
+ *      before returning.  If mctx->arena is NULL, a temporary arena
+ *      is used instead, so callers rendering many expressions
+ *      should set mctx->arena=new_arena() once, and keep its memory.
+ *      Likewise for mctx->gifstrtab=GIF_CreateStrtab() (see gif_raster()).
+ * ======================================================================= */
+/* --- entry point --- */
+int mimetex_render(mimetex_ctx *mctx, char *expression, mimetex_options *opts,
+                   unsigned char *buffer, int buffer_size, mimetex_image *image)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* mctx as given to us, restored at end-of-job */
+    mimetex_ctx entryctx;
+    /* defaults if opts not given */
+    mimetex_options defaultopts = { NORMALSIZE, MIMETEX_GIF, 0 };
+    /* local copy of expression for mimeprep() */
+    char    *exprbuffer = NULL, *prepped = NULL;
+    /* rasterized expression */
+    subraster *sp = NULL;
+    /* bordered bitmap */
+    raster  *bp = NULL;
+    /* anti-aliased bytemap and colormap */
+    intbyte *bytemap = NULL, *colormap = NULL;
+    intbyte colors[256]; /* grayscale vals in bytemap */
+    int ncolors = 0;         /* #colors (0=not anti-aliased) */
+    int nbytes = 0;          /* #bytes in rendered image */
+    int isokay = 0;          /* true if image fits in buffer */
+    /* Vertical-Align: baseline-(height-1) */
+    int valign = (-9999);
+    /* arena for this render's rasters, and temporary one if needed */
+    mimetex_arena *arena = NULL, *temparena = NULL;
+    /* ------------------------------------------------------------
+    initialization
+    ------------------------------------------------------------ */
+    if (image != NULL)               /* clear results */
+        memset((void *)image, 0, sizeof(mimetex_image));
+    if (mctx == NULL || expression == NULL) return (0);
+    /* save context */
+    memcpy((void *)&entryctx, (void *)mctx, sizeof(mimetex_ctx));
+    /* --- rasters come from an arena, reset at end-of-job --- */
+    if ((arena = mctx->arena) == NULL)    /* caller didn't supply one */
+        if ((arena = temparena = new_arena()) == NULL)
+            goto end_of_job;
+    mctx->arena = arena;
+    if (opts == NULL) opts = &defaultopts;
+    /* --- copy expression, since mimeprep() edits it in place --- */
+    if ((exprbuffer = (char *)malloc(MAXEXPRSZ + 1)) == NULL)
+        goto end_of_job;
+    strninit(exprbuffer, expression, MAXEXPRSZ);
+    /* ------------------------------------------------------------
+    rasterize expression and put a border around it
+    ------------------------------------------------------------ */
+    if ((prepped = mimeprep(mctx, exprbuffer)) == NULL) goto end_of_job;
+    if ((sp = rasterize(mctx, prepped, opts->size)) == NULL) { /* failed */
+        if (opts->iserrormsg) {      /* try to display failed expression*/
+            /* buffer for failed expression */
+            char errormsg[4096];
+            /* restore context messed up by failed attempt */
+            memcpy((void *)mctx, (void *)&entryctx, sizeof(mimetex_ctx));
+            mctx->arena = arena;
+            strcpy(errormsg,
+            /* init error message */
+                   "\\red\\fbox{\\begin{gather}"
+                   "{\\rm~mi\\underline{meTeX~failed~to~render~your~expressi}on}\\\\[5]");
+            /*render expression as \rm*/
+            strcat(errormsg, "{\\rm\\hspace{10}{");
+            /*add detexed expression to msg*/
+            strncat(errormsg, strdetex(mctx, prepped, 0), 2048);
+            /* finish up */
+            strcat(errormsg, "}\\hspace{10}}\\end{gather}}");
+            if ((sp = rasterize(mctx, errormsg, 1)) == NULL)  /*couldn't rasterize errmsg*/
+                /* so rasterize generic error */
+                sp = rasterize(mctx,
+                         "\\red\\rm~\\fbox{mimeTeX~failed~to~render\\\\your~expression}", 1);
+        }
+        /* re-check for err message failure*/
+        if (sp == NULL) goto end_of_job;
+    } /* --- end-of-if((sp=rasterize())==NULL) --- */
+    /* --- no border, but this adjusts width to multiple of 8 bits --- */
+    if ((bp = border_raster(mctx, sp->image, 0, 0, 0, 1)) == NULL)
+        goto end_of_job;
+    /* border_raster() freed sp->image */
+    sp->image = bp;
+    /* #pixels for Vertical-Align: */
+    valign = sp->baseline - (bp->height - 1);
+    /* sanity check */
+    if (abs(valign) > 255) valign = (-9999);
+    /* ------------------------------------------------------------
+    generate anti-aliased bytemap from (bordered) bitmap
+    ------------------------------------------------------------ */
+    if (mctx->aaalgorithm && opts->format != MIMETEX_PBM) { /* want grays */
+        /*#bytes needed in byte,colormap*/
+        int   nmap = (bp->width) * (bp->height);
+        if ((bytemap = (intbyte *)malloc(nmap)) == NULL
+                ||   (colormap = (intbyte *)malloc(nmap)) == NULL)
+            goto end_of_job;
+        ncolors = aaraster(mctx, bp, bytemap, colormap, colors);
+    }
+    /* ------------------------------------------------------------
+    emit image to caller's buffer
+    ------------------------------------------------------------ */
+    switch (opts->format) {
+    default:
+        break;
+    case MIMETEX_GIF:
+        nbytes = gif_raster(mctx, (ncolors > 0 ? ncolors : 2), bp,
+                            (ncolors > 0 ? colormap : NULL), colors,
+                            NULL, buffer, buffer_size);
+        break;
+    case MIMETEX_PNG:
+        nbytes = png_raster(mctx, (ncolors > 0 ? ncolors : 2), bp,
+                            (ncolors > 0 ? colormap : NULL), colors,
+                            NULL, buffer, buffer_size);
+        break;
+    case MIMETEX_PBM:
+        nbytes = type_pbmpgm(bp, 1, NULL, (char *)buffer, buffer_size);
+        break;
+    case MIMETEX_PGM:
+        if (ncolors > 0) {           /* emit anti-aliased bytemap */
+            /*construct arg for type_pbmpgm()*/
+            raster pgm_raster;
+            pgm_raster.width  = bp->width;
+            pgm_raster.height = bp->height;
+            pgm_raster.format = 1;
+            pgm_raster.pixsz  = 8;
+            pgm_raster.pixmap = (pixbyte *)bytemap;
+            pgm_raster.stride = bp->width;
+            nbytes = type_pbmpgm(&pgm_raster, 2, NULL, (char *)buffer, buffer_size);
+        } else                       /* or just the b&w bitmap */
+            nbytes = type_pbmpgm(bp, 2, NULL, (char *)buffer, buffer_size);
+        break;
+    } /* --- end-of-switch(opts->format) --- */
+    /* image must fit in caller's buffer */
+    isokay = (nbytes > 0 && nbytes <= buffer_size);
+    /* --- return image info to caller --- */
+    if (image != NULL) {
+        image->format   = opts->format;
+        image->width    = bp->width;
+        image->height   = bp->height;
+        image->baseline = sp->baseline;
+        image->valign   = valign;
+        image->ncolors  = (ncolors > 0 ? ncolors : 2);
+        image->nbytes   = nbytes;
+    }
+    /* ------------------------------------------------------------
+    free everything and restore context
+    ------------------------------------------------------------ */
+end_of_job:
+    if (bytemap != NULL) free((void *)bytemap);
+    if (colormap != NULL) free((void *)colormap);
+    if (sp != NULL) delete_subraster(mctx, sp);
+    if (exprbuffer != NULL) free((void *)exprbuffer);
+    /* release all rasters at once */
+    if (arena != NULL) reset_arena(arena);
+    if (temparena != NULL) delete_arena(temparena);
+    /* restore context */
+    memcpy((void *)mctx, (void *)&entryctx, sizeof(mimetex_ctx));
+    /* back with #bytes in buffer, or 0=failed */
+    return (isokay ? nbytes : 0);
+} /* --- end-of-function mimetex_render() --- */
@@ -0,0 +1,826 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Purpose:     Single-file cache of rendered images, an append-only pack
+ *              plus an mmap()'ed hash index into it (see packcache.h).
+ *
+ * Functions:   packcache_open(packfile,maxbytes)   opens (and repairs)
+ *              packcache_close(pack)               unmaps and closes
+ *              packcache_get(pack,key,image,valign) finds cached image
+ *              packcache_put(pack,key,image,nbytes,valign) appends one
+ *              packcache_compact(pack,maxbytes)    rewrites pack
+ *
+ * Notes:     o A lookup is one probe of the mapped index (keys are md5's,
+ *              so their first bytes are a good hash), and returns a
+ *              pointer into the mapped pack, not a copy.
+ *            o An append writes the record, then its index slot, and
+ *              only then the index's pack size.  So after a crash, the
+ *              index covers a prefix of the pack, and the next writer
+ *              indexes any complete records after it (checking their
+ *              checksums) and truncates a torn last record.  An index
+ *              that's missing, damaged, or from another generation
+ *              (e.g., a crash between compaction's two renames) is
+ *              rebuilt by scanning the whole pack.
+ *            o Compaction writes a new pack (with a new generation) of
+ *              just the indexed records, newest first up to 7/8 of the
+ *              budget, and a new index, and renames both into place.
+ *              Processes with the old files mapped keep reading them
+ *              until their next call, which notices the new inodes.
+ *            o Without <sys/mman.h>, packcache_open() always fails.
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "packcache.h"
+
+#if defined(HAVE_SYS_MMAN_H) && defined(HAVE_SYS_FILE_H)
+#include <stdint.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define MAXPACKFILE (1024)          /* longest packfile path */
+#define PACKMAGIC   "MTXPACK1"      /* pack header begins */
+#define PACKHEADSZ  (16)            /* magic, generation */
+#define RECMAGIC    "MTXR"          /* record header begins */
+#define RECHEADSZ   (32)            /* magic, key, #bytes, valign, sum */
+#define INDEXMAGIC  "MTXINDX1"      /* index header begins */
+#define INDEXHEADSZ (32)            /* magic, generation, packsize,
+                                     * #slots, #entries */
+#define SLOTSZ      (32)            /* key, offset, #bytes, valign */
+#define MAXRECBYTES (1 << 30)       /* bigger #bytes means damage */
+#define padded(n)   (((n) + 7) & ~7)
+
+/* --- an open pack and index --- */
+struct packcache_struct
+{
+    char  packfile[MAXPACKFILE + 1];  /* pack */
+    char  indexfile[MAXPACKFILE + 8]; /* packfile.idx */
+    char  lockfile[MAXPACKFILE + 8];  /* packfile.lock */
+    long  maxbytes;             /* pack budget, or 0 for none */
+    int   lockfd;               /* flock()'ed */
+    int   packfd, indexfd;      /* open pack, index, or -1 */
+    ino_t packino, indexino;    /* to notice a compaction's new files */
+    unsigned char *packmap;     /* pack, mapped read-only */
+    long  npackmap;             /* #bytes mapped */
+    unsigned char *indexmap;    /* index, mapped read/write shared */
+    long  nindexmap;            /* #bytes mapped */
+}; /* --- end-of-packcache_struct --- */
+
+
+/* ==========================================================================
+ * Functions:   get32 ( p ), put32 ( p, v ), get64 ( p ), put64 ( p, v )
+ * Purpose:     little-endian numbers in the pack and index
+ * ======================================================================= */
+/* --- entry point --- */
+static uint32_t get32(const unsigned char *p)
+{
+    return ((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16)
+            | ((uint32_t)p[3] << 24));
+} /* --- end-of-function get32() --- */
+/* --- entry point --- */
+static void put32(unsigned char *p, uint32_t v)
+{
+    p[0] = v & 255; p[1] = (v >> 8) & 255; p[2] = (v >> 16) & 255; p[3] = v >> 24;
+} /* --- end-of-function put32() --- */
+/* --- entry point --- */
+static uint64_t get64(const unsigned char *p)
+{
+    return ((uint64_t)get32(p) | ((uint64_t)get32(p + 4) << 32));
+} /* --- end-of-function get64() --- */
+/* --- entry point --- */
+static void put64(unsigned char *p, uint64_t v)
+{
+    put32(p, (uint32_t)v);
+    put32(p + 4, (uint32_t)(v >> 32));
+} /* --- end-of-function put64() --- */
+
+
+/* ==========================================================================
+ * Function:    hexkey ( key, md5 )
+ * Purpose:     Converts a diskcache_key()'s 32 hex digits to 16 bytes
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0 if key doesn't begin with 32 hex digits
+ * ======================================================================= */
+/* --- entry point --- */
+static int hexkey(const char *key, unsigned char *md5)
+{
+    static const char *hex = "0123456789abcdef";
+    int j = 0;
+    const char *hi = NULL, *lo = NULL;
+    if (key == NULL) return (0);
+    for (j = 0; j < 16; j++) {
+        if (key[2 * j] == '\000' || (hi = strchr(hex, key[2 * j])) == NULL
+                || key[2 * j + 1] == '\000'
+                || (lo = strchr(hex, key[2 * j + 1])) == NULL)
+            return (0);
+        md5[j] = (unsigned char)(16 * (hi - hex) + (lo - hex));
+    }
+    return (1);
+} /* --- end-of-function hexkey() --- */
+
+
+/* ==========================================================================
+ * Function:    recsum ( rechead, image, nbytes )
+ * Purpose:     FNV-1a checksum of a record's key, #bytes, valign and image
+ * ======================================================================= */
+/* --- entry point --- */
+static uint32_t recsum(const unsigned char *rechead, const unsigned char *image,
+                       long nbytes)
+{
+    uint32_t sum = 2166136261U;
+    int j = 0;
+    for (j = 4; j < 28; j++) sum = (sum ^ rechead[j]) * 16777619U;
+    while (nbytes-- > 0) sum = (sum ^ *image++) * 16777619U;
+    return (sum);
+} /* --- end-of-function recsum() --- */
+
+
+/* ==========================================================================
+ * Function:    findslot ( map, key, isempty )
+ * Purpose:     Probes a mapped index for key
+ * --------------------------------------------------------------------------
+ * Arguments:   map (I)     unsigned char * to mapped index
+ *              key (I)     unsigned char * to 16-byte md5 key
+ *              isempty (I) true to return the empty slot ending the probe
+ *                          if key isn't found, false to return NULL
+ * --------------------------------------------------------------------------
+ * Returns:     ( unsigned char * ) slot, or NULL
+ * --------------------------------------------------------------------------
+ * Notes:     o An empty slot has offset 0 (the pack header).  The index
+ *              is never more than half full, so a probe always ends.
+ * ======================================================================= */
+/* --- entry point --- */
+static unsigned char *findslot(unsigned char *map, const unsigned char *key,
+                               int isempty)
+{
+    uint32_t nslots = get32(map + 24), islot = get32(key) & (nslots - 1);
+    while (1) {
+        unsigned char *slot = map + INDEXHEADSZ + (long)islot * SLOTSZ;
+        if (get64(slot + 16) == 0) return (isempty ? slot : NULL);
+        if (memcmp(slot, key, 16) == 0) return (slot);
+        islot = (islot + 1) & (nslots - 1);
+    }
+} /* --- end-of-function findslot() --- */
+
+
+/* ==========================================================================
+ * Function:    setslot ( map, key, offset, nbytes, valign )
+ * Purpose:     Enters (or replaces) key's slot in a mapped index
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1 if a new entry, 0 if replaced
+ * ======================================================================= */
+/* --- entry point --- */
+static int setslot(unsigned char *map, const unsigned char *key,
+                   uint64_t offset, uint32_t nbytes, uint32_t valign)
+{
+    unsigned char *slot = findslot(map, key, 1);
+    int isnew = (get64(slot + 16) == 0);
+    memcpy(slot, key, 16);
+    put32(slot + 24, nbytes);
+    put32(slot + 28, valign);
+    put64(slot + 16, offset);           /* last, as it marks slot used */
+    if (isnew) put32(map + 28, get32(map + 28) + 1);
+    return (isnew);
+} /* --- end-of-function setslot() --- */
+
+
+/* ==========================================================================
+ * Function:    mapfile ( fd, map, nmap, iswrite )
+ * Purpose:     (Re)maps all of an open file
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay (*map=NULL for an empty file), 0=failed
+ * ======================================================================= */
+/* --- entry point --- */
+static int mapfile(int fd, unsigned char **map, long *nmap, int iswrite)
+{
+    struct stat st;
+    if (*map != NULL) munmap((void *)*map, *nmap);
+    *map = NULL;
+    *nmap = 0;
+    if (fd < 0 || fstat(fd, &st) != 0) return (0);
+    if (st.st_size < 1) return (1);
+    *map = (unsigned char *)mmap(NULL, (size_t)st.st_size,
+                                 (iswrite ? PROT_READ | PROT_WRITE : PROT_READ),
+                                 MAP_SHARED, fd, 0);
+    if (*map == (unsigned char *)MAP_FAILED) {
+        *map = NULL;
+        return (0);
+    }
+    *nmap = (long)st.st_size;
+    return (1);
+} /* --- end-of-function mapfile() --- */
+
+
+/* ==========================================================================
+ * Functions:   closefiles ( pack ), openfiles ( pack )
+ * Purpose:     Unmaps and closes, or opens and maps, pack and index
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     openfiles() returns 1=okay, 0=failed
+ * ======================================================================= */
+/* --- entry point --- */
+static void closefiles(packcache *pack)
+{
+    if (pack->packmap != NULL) munmap((void *)pack->packmap, pack->npackmap);
+    if (pack->indexmap != NULL) munmap((void *)pack->indexmap, pack->nindexmap);
+    if (pack->packfd >= 0) close(pack->packfd);
+    if (pack->indexfd >= 0) close(pack->indexfd);
+    pack->packmap = pack->indexmap = NULL;
+    pack->npackmap = pack->nindexmap = 0;
+    pack->packfd = pack->indexfd = (-1);
+} /* --- end-of-function closefiles() --- */
+/* --- entry point --- */
+static int openfiles(packcache *pack)
+{
+    struct stat st;
+    closefiles(pack);
+    if ((pack->packfd = open(pack->packfile, O_RDWR | O_CREAT, 0644)) < 0
+            || (pack->indexfd = open(pack->indexfile, O_RDWR | O_CREAT, 0644)) < 0)
+        return (0);
+    if (fstat(pack->packfd, &st) != 0) return (0);
+    pack->packino = st.st_ino;
+    if (fstat(pack->indexfd, &st) != 0) return (0);
+    pack->indexino = st.st_ino;
+    return (mapfile(pack->packfd, &pack->packmap, &pack->npackmap, 0)
+            && mapfile(pack->indexfd, &pack->indexmap, &pack->nindexmap, 1));
+} /* --- end-of-function openfiles() --- */
+
+
+/* ==========================================================================
+ * Function:    remapfiles ( pack )
+ * Purpose:     Remaps pack or index if its size has changed
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0=failed
+ * ======================================================================= */
+/* --- entry point --- */
+static int remapfiles(packcache *pack)
+{
+    struct stat st;
+    if (fstat(pack->packfd, &st) != 0) return (0);
+    if ((long)st.st_size != pack->npackmap
+            && !mapfile(pack->packfd, &pack->packmap, &pack->npackmap, 0))
+        return (0);
+    if (fstat(pack->indexfd, &st) != 0) return (0);
+    if ((long)st.st_size != pack->nindexmap
+            && !mapfile(pack->indexfd, &pack->indexmap, &pack->nindexmap, 1))
+        return (0);
+    return (1);
+} /* --- end-of-function remapfiles() --- */
+
+
+/* ==========================================================================
+ * Function:    isrenamed ( pack )
+ * Purpose:     Checks whether another process renamed a new pack or
+ *              index into place since openfiles()
+ * ======================================================================= */
+/* --- entry point --- */
+static int isrenamed(packcache *pack)
+{
+    struct stat st;
+    return (stat(pack->packfile, &st) != 0 || st.st_ino != pack->packino
+            || stat(pack->indexfile, &st) != 0 || st.st_ino != pack->indexino);
+} /* --- end-of-function isrenamed() --- */
+
+
+/* ==========================================================================
+ * Function:    isindexok ( pack )
+ * Purpose:     Checks that the index is well-formed, from the pack's
+ *              generation, and covers all of the pack
+ * ======================================================================= */
+/* --- entry point --- */
+static int isindexok(packcache *pack)
+{
+    unsigned char *map = pack->indexmap;
+    uint32_t nslots = 0;
+    if (pack->packmap == NULL || pack->npackmap < PACKHEADSZ
+            || map == NULL || pack->nindexmap < INDEXHEADSZ
+            || memcmp(map, INDEXMAGIC, 8) != 0
+            || get64(map + 8) != get64(pack->packmap + 8))
+        return (0);
+    nslots = get32(map + 24);
+    return (nslots > 0 && (nslots & (nslots - 1)) == 0
+            && pack->nindexmap == INDEXHEADSZ + (long)nslots * SLOTSZ
+            && get32(map + 28) <= nslots / 2
+            && (long)get64(map + 16) == pack->npackmap);
+} /* --- end-of-function isindexok() --- */
+
+
+/* ==========================================================================
+ * Function:    newindex ( path, generation, packsize, nslots, map, nmap )
+ * Purpose:     Creates an empty index file, mapped
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     open fd, or -1 if failed
+ * ======================================================================= */
+/* --- entry point --- */
+static int newindex(char *path, uint64_t generation, uint64_t packsize,
+                    uint32_t nslots, unsigned char **map, long *nmap)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    *map = NULL;
+    *nmap = 0;
+    if (fd < 0) return (-1);
+    if (ftruncate(fd, (off_t)INDEXHEADSZ + (off_t)nslots * SLOTSZ) != 0
+            || !mapfile(fd, map, nmap, 1) || *map == NULL) {
+        close(fd);
+        unlink(path);
+        return (-1);
+    }
+    memcpy(*map, INDEXMAGIC, 8);
+    put64(*map + 8, generation);
+    put64(*map + 16, packsize);
+    put32(*map + 24, nslots);
+    put32(*map + 28, 0);
+    return (fd);
+} /* --- end-of-function newindex() --- */
+
+
+/* ==========================================================================
+ * Function:    growindex ( pack, nslots )
+ * Purpose:     Replaces the index with one of nslots slots, holding the
+ *              same entries
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0=failed
+ * ======================================================================= */
+/* --- entry point --- */
+static int growindex(packcache *pack, uint32_t nslots)
+{
+    char tempfile[MAXPACKFILE + 16];
+    unsigned char *map = NULL, *old = pack->indexmap;
+    long nmap = 0, islot = 0;
+    int fd = (-1);
+    struct stat st;
+    sprintf(tempfile, "%s.tmp", pack->indexfile);
+    if ((fd = newindex(tempfile, get64(old + 8), get64(old + 16), nslots,
+                       &map, &nmap)) < 0)
+        return (0);
+    for (islot = 0; islot < (long)get32(old + 24); islot++) {
+        unsigned char *slot = old + INDEXHEADSZ + islot * SLOTSZ;
+        if (get64(slot + 16) != 0)
+            setslot(map, slot, get64(slot + 16), get32(slot + 24),
+                    get32(slot + 28));
+    }
+    if (rename(tempfile, pack->indexfile) != 0 || fstat(fd, &st) != 0) {
+        munmap((void *)map, nmap);
+        close(fd);
+        unlink(tempfile);
+        return (0);
+    }
+    munmap((void *)old, pack->nindexmap);
+    close(pack->indexfd);
+    pack->indexfd = fd;
+    pack->indexmap = map;
+    pack->nindexmap = nmap;
+    pack->indexino = st.st_ino;
+    return (1);
+} /* --- end-of-function growindex() --- */
+
+
+/* ==========================================================================
+ * Function:    indextail ( pack, offset )
+ * Purpose:     Indexes every complete record from offset to the end of
+ *              the pack, and truncates the pack after the last one
+ * --------------------------------------------------------------------------
+ * Arguments:   pack (I/O)  packcache * with exclusive lock, and a
+ *                          well-formed index of the pack's generation
+ *              offset (I)  long containing pack offset of first record
+ *                          not yet indexed
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #records indexed, or -1 if failed
+ * ======================================================================= */
+/* --- entry point --- */
+static int indextail(packcache *pack, long offset)
+{
+    unsigned char *rec = NULL;
+    long nbytes = 0;
+    int nrecs = 0;
+    if (!mapfile(pack->packfd, &pack->packmap, &pack->npackmap, 0)
+            || pack->packmap == NULL)
+        return (-1);
+    while (offset + RECHEADSZ <= pack->npackmap) {
+        rec = pack->packmap + offset;
+        nbytes = (long)get32(rec + 20);
+        if (memcmp(rec, RECMAGIC, 4) != 0 || nbytes > MAXRECBYTES
+                || offset + RECHEADSZ + padded(nbytes) > pack->npackmap
+                || get32(rec + 28) != recsum(rec, rec + RECHEADSZ, nbytes))
+            break;                       /* torn (or damaged) record */
+        if (2 * (get32(pack->indexmap + 28) + 1) > get32(pack->indexmap + 24)
+                && !growindex(pack, 2 * get32(pack->indexmap + 24)))
+            return (-1);
+        setslot(pack->indexmap, rec + 4, (uint64_t)offset, (uint32_t)nbytes,
+                get32(rec + 24));
+        offset += RECHEADSZ + padded(nbytes);
+        nrecs++;
+    }
+    if (offset < pack->npackmap) {       /* drop what's after last record */
+        if (ftruncate(pack->packfd, (off_t)offset) != 0
+                || !mapfile(pack->packfd, &pack->packmap, &pack->npackmap, 0))
+            return (-1);
+    }
+    put64(pack->indexmap + 16, (uint64_t)offset);
+    return (nrecs);
+} /* --- end-of-function indextail() --- */
+
+
+/* ==========================================================================
+ * Function:    repair ( pack )
+ * Purpose:     Makes the index cover the whole pack, initializing a new
+ *              pack, indexing records after a crash, or rebuilding the
+ *              index from scratch
+ * --------------------------------------------------------------------------
+ * Arguments:   pack (I/O)  packcache * with exclusive lock, files open
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0=failed (e.g., not a pack file)
+ * ======================================================================= */
+/* --- entry point --- */
+static int repair(packcache *pack)
+{
+    char tempfile[MAXPACKFILE + 16];
+    unsigned char head[PACKHEADSZ], *map = NULL;
+    uint64_t generation = 0;
+    uint32_t nslots = PACKCACHESLOTS;
+    long nmap = 0;
+    int fd = (-1);
+    struct stat st;
+    if (!remapfiles(pack)) return (0);
+    if (isindexok(pack)) return (1);
+    map = pack->indexmap;
+    /* --- new (empty) pack gets a header --- */
+    if (pack->npackmap == 0) {
+        generation = ((uint64_t)time(NULL) << 24) ^ (uint64_t)getpid();
+        memcpy(head, PACKMAGIC, 8);
+        put64(head + 8, generation);
+        if (pwrite(pack->packfd, head, PACKHEADSZ, 0) != PACKHEADSZ
+                || !mapfile(pack->packfd, &pack->packmap, &pack->npackmap, 0))
+            return (0);
+    }
+    if (pack->npackmap < PACKHEADSZ || memcmp(pack->packmap, PACKMAGIC, 8) != 0)
+        return (0);                      /* not ours, so leave it alone */
+    generation = get64(pack->packmap + 8);
+    /* --- crash after appending, so index the rest --- */
+    if (map != NULL && pack->nindexmap >= INDEXHEADSZ
+            && memcmp(map, INDEXMAGIC, 8) == 0 && get64(map + 8) == generation
+            && (nslots = get32(map + 24)) > 0 && (nslots & (nslots - 1)) == 0
+            && pack->nindexmap == INDEXHEADSZ + (long)nslots * SLOTSZ
+            && (long)get64(map + 16) >= PACKHEADSZ
+            && (long)get64(map + 16) <= pack->npackmap)
+        return (indextail(pack, (long)get64(map + 16)) >= 0);
+    /* --- else rebuild index from the whole pack --- */
+    while (nslots < (uint32_t)(pack->npackmap / 1024) && nslots < (1U << 30))
+        nslots *= 2;                     /* a guess, grown as needed */
+    if (nslots < PACKCACHESLOTS) nslots = PACKCACHESLOTS;
+    sprintf(tempfile, "%s.tmp", pack->indexfile);
+    if ((fd = newindex(tempfile, generation, PACKHEADSZ, nslots,
+                       &map, &nmap)) < 0)
+        return (0);
+    if (rename(tempfile, pack->indexfile) != 0 || fstat(fd, &st) != 0) {
+        munmap((void *)map, nmap);
+        close(fd);
+        unlink(tempfile);
+        return (0);
+    }
+    if (pack->indexmap != NULL) munmap((void *)pack->indexmap, pack->nindexmap);
+    close(pack->indexfd);
+    pack->indexfd = fd;
+    pack->indexmap = map;
+    pack->nindexmap = nmap;
+    pack->indexino = st.st_ino;
+    return (indextail(pack, PACKHEADSZ) >= 0);
+} /* --- end-of-function repair() --- */
+
+
+/* ==========================================================================
+ * Function:    lockpack ( pack, how )
+ * Purpose:     flock()'s the pack, reopening its files if they've been
+ *              replaced, and (if exclusive) repairing its index
+ * --------------------------------------------------------------------------
+ * Arguments:   pack (I/O)  packcache * to be locked
+ *              how (I)     int containing LOCK_SH or LOCK_EX
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=locked with a good index, 0=failed (unlocked)
+ * ======================================================================= */
+/* --- entry point --- */
+static int lockpack(packcache *pack, int how)
+{
+    if (flock(pack->lockfd, how) != 0) return (0);
+    if ((pack->packfd < 0 || isrenamed(pack)) && !openfiles(pack))
+        goto failed;
+    if (!remapfiles(pack)) goto failed;  /* another process wrote */
+    if (isindexok(pack)) return (1);
+    if (how == LOCK_EX && repair(pack)) return (1);
+failed:
+    flock(pack->lockfd, LOCK_UN);
+    return (0);
+} /* --- end-of-function lockpack() --- */
+
+
+/* ==========================================================================
+ * Function:    packcache_open ( packfile, maxbytes )
+ * Purpose:     Opens (creating or repairing if necessary) a pack
+ * --------------------------------------------------------------------------
+ * Arguments:   packfile (I)    char * to pack's path (the index and lock
+ *                              files are packfile.idx and packfile.lock)
+ *              maxbytes (I)    long containing byte budget, beyond which
+ *                              packcache_put() compacts, or 0 for none
+ * --------------------------------------------------------------------------
+ * Returns:     ( packcache * ) open pack, or NULL if failed
+ * ======================================================================= */
+/* --- entry point --- */
+packcache *packcache_open(char *packfile, long maxbytes)
+{
+    packcache *pack = NULL;
+    if (packfile == NULL || strlen(packfile) > MAXPACKFILE) goto end_of_job;
+    if ((pack = (packcache *)calloc(1, sizeof(packcache))) == NULL)
+        goto end_of_job;
+    strcpy(pack->packfile, packfile);
+    sprintf(pack->indexfile, "%s.idx", packfile);
+    sprintf(pack->lockfile, "%s.lock", packfile);
+    pack->maxbytes = maxbytes;
+    pack->packfd = pack->indexfd = (-1);
+    if ((pack->lockfd = open(pack->lockfile, O_RDWR | O_CREAT, 0644)) < 0) {
+        free((void *)pack);
+        pack = NULL;
+        goto end_of_job;
+    }
+    /* --- usually fine as is, or else needs repair --- */
+    if (lockpack(pack, LOCK_SH) || lockpack(pack, LOCK_EX))
+        flock(pack->lockfd, LOCK_UN);
+    else {
+        packcache_close(pack);
+        pack = NULL;
+    }
+end_of_job:
+    return (pack);
+} /* --- end-of-function packcache_open() --- */
+
+
+/* ==========================================================================
+ * Function:    packcache_close ( pack )
+ * Purpose:     Unmaps and closes a pack
+ * ======================================================================= */
+/* --- entry point --- */
+void packcache_close(packcache *pack)
+{
+    if (pack == NULL) return;
+    closefiles(pack);
+    if (pack->lockfd >= 0) close(pack->lockfd);
+    free((void *)pack);
+} /* --- end-of-function packcache_close() --- */
+
+
+/* ==========================================================================
+ * Function:    packcache_get ( pack, key, image, valign )
+ * Purpose:     Finds key's image in the pack
+ * --------------------------------------------------------------------------
+ * Arguments:   pack (I)        packcache * to open pack, or NULL
+ *              key (I)         char * to diskcache_key()
+ *              image (O)       unsigned char ** returning pointer to image
+ *                              in the mapped pack, valid until the next
+ *                              packcache call
+ *              valign (O)      int * returning Vertical-Align:
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #bytes of image, or 0 if not cached
+ * ======================================================================= */
+/* --- entry point --- */
+int packcache_get(packcache *pack, char *key, unsigned char **image,
+                  int *valign)
+{
+    unsigned char md5[16], *slot = NULL, *rec = NULL;
+    long offset = 0;
+    int nbytes = 0;
+    if (pack == NULL || image == NULL || !hexkey(key, md5)) return (0);
+    if (!lockpack(pack, LOCK_SH)) return (0);
+    if ((slot = findslot(pack->indexmap, md5, 0)) != NULL
+            && (offset = (long)get64(slot + 16)) + RECHEADSZ
+            + (long)get32(slot + 24) <= pack->npackmap) {
+        rec = pack->packmap + offset;
+        if (memcmp(rec, RECMAGIC, 4) == 0
+                && memcmp(rec + 4, md5, 16) == 0
+                && get32(rec + 20) == get32(slot + 24)) {
+            *image = rec + RECHEADSZ;
+            nbytes = (int)get32(slot + 24);
+            if (valign != NULL) *valign = (int)get32(slot + 28);
+        }
+    }
+    flock(pack->lockfd, LOCK_UN);
+    return (nbytes);
+} /* --- end-of-function packcache_get() --- */
+
+
+/* ==========================================================================
+ * Function:    packcache_put ( pack, key, image, nbytes, valign )
+ * Purpose:     Appends key's image to the pack, and indexes it
+ * --------------------------------------------------------------------------
+ * Arguments:   pack (I/O)      packcache * to open pack, or NULL
+ *              key (I)         char * to diskcache_key()
+ *              image (I)       unsigned char * to image bytes
+ *              nbytes (I)      int containing #bytes of image
+ *              valign (I)      int containing Vertical-Align:
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if cached (or already was), 0 if not
+ * --------------------------------------------------------------------------
+ * Notes:     o The pack's compacted afterwards if it's over budget.
+ * ======================================================================= */
+/* --- entry point --- */
+int packcache_put(packcache *pack, char *key, unsigned char *image,
+                  int nbytes, int valign)
+{
+    unsigned char md5[16], *rec = NULL;
+    long offset = 0, nrec = 0;
+    int isput = 0, iscompact = 0;
+    if (pack == NULL || image == NULL || nbytes < 1 || nbytes > MAXRECBYTES
+            || !hexkey(key, md5))
+        return (0);
+    if ((rec = (unsigned char *)calloc(1, RECHEADSZ + padded(nbytes))) == NULL)
+        return (0);
+    if (!lockpack(pack, LOCK_EX)) goto end_of_job;
+    if (findslot(pack->indexmap, md5, 0) != NULL) { /* another process did */
+        isput = 1;
+        goto unlock;
+    }
+    /* --- append record --- */
+    offset = (long)get64(pack->indexmap + 16);
+    nrec = RECHEADSZ + padded(nbytes);
+    memcpy(rec, RECMAGIC, 4);
+    memcpy(rec + 4, md5, 16);
+    put32(rec + 20, (uint32_t)nbytes);
+    put32(rec + 24, (uint32_t)valign);
+    memcpy(rec + RECHEADSZ, image, nbytes);
+    put32(rec + 28, recsum(rec, image, nbytes));
+    if (pwrite(pack->packfd, rec, nrec, (off_t)offset) != nrec) {
+        /* --- drop the torn record, else the pack's now longer than its
+           index says, so isindexok() fails until repair() drops it --- */
+        if (ftruncate(pack->packfd, (off_t)offset) != 0)
+            (void)repair(pack);          /* try now, we hold LOCK_EX */
+        goto unlock;
+    }
+    /* --- then index it, and then advance index's pack size --- */
+    if (2 * (get32(pack->indexmap + 28) + 1) > get32(pack->indexmap + 24)
+            && !growindex(pack, 2 * get32(pack->indexmap + 24)))
+        goto unlock;                     /* next repair() indexes it */
+    setslot(pack->indexmap, md5, (uint64_t)offset, (uint32_t)nbytes,
+            (uint32_t)valign);
+    put64(pack->indexmap + 16, (uint64_t)(offset + nrec));
+    isput = 1;
+    iscompact = (pack->maxbytes > 0 && offset + nrec > pack->maxbytes);
+unlock:
+    flock(pack->lockfd, LOCK_UN);
+    if (iscompact) packcache_compact(pack, pack->maxbytes);
+end_of_job:
+    free((void *)rec);
+    return (isput);
+} /* --- end-of-function packcache_put() --- */
+
+
+/* ==========================================================================
+ * Function:    cmpoffset ( a, b )
+ * Purpose:     qsort() comparison of index slots, by pack offset
+ * ======================================================================= */
+/* --- entry point --- */
+static int cmpoffset(const void *a, const void *b)
+{
+    uint64_t aoff = get64((const unsigned char *)a + 16),
+             boff = get64((const unsigned char *)b + 16);
+    return (aoff < boff ? (-1) : (aoff > boff ? 1 : 0));
+} /* --- end-of-function cmpoffset() --- */
+
+
+/* ==========================================================================
+ * Function:    packcache_compact ( pack, maxbytes )
+ * Purpose:     Rewrites the pack with just its indexed records, newest
+ *              first up to 7/8 of maxbytes, and a new index
+ * --------------------------------------------------------------------------
+ * Arguments:   pack (I/O)      packcache * to open pack
+ *              maxbytes (I)    long containing byte budget, or 0 to keep
+ *                              all indexed records
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #records kept, or -1 if failed
+ * ======================================================================= */
+/* --- entry point --- */
+int packcache_compact(packcache *pack, long maxbytes)
+{
+    char packtemp[MAXPACKFILE + 16], indextemp[MAXPACKFILE + 16];
+    unsigned char head[PACKHEADSZ], *slots = NULL, *map = NULL;
+    uint64_t generation = 0;
+    uint32_t nslots = PACKCACHESLOTS;
+    long nentries = 0, islot = 0, ifirst = 0, nkept = 0, nrec = 0, nmap = 0,
+         offset = PACKHEADSZ, lowbytes = maxbytes - maxbytes / 8;
+    int packfd = (-1), indexfd = (-1), nrecs = (-1);
+    if (pack == NULL || !lockpack(pack, LOCK_EX)) return (-1);
+    sprintf(packtemp, "%s.tmp", pack->packfile);
+    sprintf(indextemp, "%s.tmp", pack->indexfile);
+    /* ------------------------------------------------------------
+    indexed records, oldest first, and the newest that fit
+    ------------------------------------------------------------ */
+    nentries = (long)get32(pack->indexmap + 28);
+    if ((slots = (unsigned char *)malloc((nentries + 1) * SLOTSZ)) == NULL)
+        goto end_of_job;
+    for (islot = 0; islot < (long)get32(pack->indexmap + 24); islot++) {
+        unsigned char *slot = pack->indexmap + INDEXHEADSZ + islot * SLOTSZ;
+        if (get64(slot + 16) != 0 && nkept < nentries)
+            memcpy(slots + SLOTSZ * nkept++, slot, SLOTSZ);
+    }
+    nentries = nkept;
+    qsort((void *)slots, nentries, SLOTSZ, cmpoffset);
+    for (nkept = 0, ifirst = nentries; ifirst > 0; ifirst--, nkept += nrec) {
+        nrec = RECHEADSZ + padded((long)get32(slots + SLOTSZ * (ifirst - 1) + 24));
+        if (maxbytes > 0 && PACKHEADSZ + nkept + nrec > lowbytes) break;
+    }
+    while (nslots < 2 * (uint32_t)(nentries - ifirst + 1)) nslots *= 2;
+    /* ------------------------------------------------------------
+    write new pack and index
+    ------------------------------------------------------------ */
+    generation = (get64(pack->packmap + 8) + 1) ^ ((uint64_t)getpid() << 32);
+    if ((packfd = open(packtemp, O_RDWR | O_CREAT | O_TRUNC, 0644)) < 0)
+        goto end_of_job;
+    memcpy(head, PACKMAGIC, 8);
+    put64(head + 8, generation);
+    if (write(packfd, head, PACKHEADSZ) != PACKHEADSZ) goto end_of_job;
+    if ((indexfd = newindex(indextemp, generation, PACKHEADSZ, nslots,
+                            &map, &nmap)) < 0)
+        goto end_of_job;
+    for (islot = ifirst; islot < nentries; islot++) {
+        unsigned char *slot = slots + SLOTSZ * islot;
+        long nrec = RECHEADSZ + padded((long)get32(slot + 24));
+        if ((long)get64(slot + 16) + nrec > pack->npackmap) continue;
+        if (write(packfd, pack->packmap + get64(slot + 16), nrec) != nrec)
+            goto end_of_job;
+        setslot(map, slot, (uint64_t)offset, get32(slot + 24), get32(slot + 28));
+        offset += nrec;
+    }
+    put64(map + 16, (uint64_t)offset);
+    /* --- pack first: a crash before the index's rename just means
+     * the old index's generation is wrong, so it's rebuilt --- */
+    if (close(packfd) != 0 || rename(packtemp, pack->packfile) != 0) {
+        packfd = (-1);
+        goto end_of_job;
+    }
+    packfd = (-1);
+    munmap((void *)map, nmap);
+    map = NULL;
+    if (close(indexfd) != 0 || rename(indextemp, pack->indexfile) != 0) {
+        indexfd = (-1);
+        goto end_of_job;
+    }
+    indexfd = (-1);
+    nrecs = (int)(nentries - ifirst);
+    openfiles(pack);
+end_of_job:
+    if (map != NULL) munmap((void *)map, nmap);
+    if (indexfd >= 0) { close(indexfd); unlink(indextemp); }
+    if (packfd >= 0) { close(packfd); unlink(packtemp); }
+    if (slots != NULL) free((void *)slots);
+    flock(pack->lockfd, LOCK_UN);
+    return (nrecs);
+} /* --- end-of-function packcache_compact() --- */
+
+#else /* no mmap() */
+
+packcache *packcache_open(char *packfile, long maxbytes)
+{
+    return (NULL);
+}
+void packcache_close(packcache *pack) { }
+int packcache_get(packcache *pack, char *key, unsigned char **image,
+                  int *valign)
+{
+    return (0);
+}
+int packcache_put(packcache *pack, char *key, unsigned char *image,
+                  int nbytes, int valign)
+{
+    return (0);
+}
+int packcache_compact(packcache *pack, long maxbytes)
+{
+    return (-1);
+}
+#endif /* HAVE_SYS_MMAN_H */
@@ -0,0 +1,30 @@
+#ifndef PACKCACHE_H
+#define PACKCACHE_H
+
+/* ---
+ * Single-file image cache (for -DCACHEPATH with -DCACHEPACK), instead of
+ * diskcache.c's file per image:
+ *   packfile       append-only pack, a 16-byte header ("MTXPACK1" and a
+ *                  generation number) then records, each a 32-byte header
+ *                  ("MTXR", md5 key, #bytes, Vertical-Align:, checksum)
+ *                  followed by the image, padded to a multiple of 8 bytes
+ *   packfile.idx   hash table from md5 key to (offset, #bytes, valign),
+ *                  mmap()'ed, and rebuilt from the pack if it's missing,
+ *                  stale or from another generation
+ *   packfile.lock  flock()'ed, shared to read and exclusive to write
+ * All numbers are little-endian, so a pack can be copied between hosts.
+ * A packcache is for one thread; processes share the files.
+ * --------------------------------------------------------------------- */
+#define PACKCACHESLOTS (4096)   /* initial #index slots, a power of 2 */
+
+typedef struct packcache_struct packcache;
+
+packcache *packcache_open(char *packfile, long maxbytes);
+void packcache_close(packcache *pack);
+int packcache_get(packcache *pack, char *key, unsigned char **image,
+                  int *valign);
+int packcache_put(packcache *pack, char *key, unsigned char *image,
+                  int nbytes, int valign);
+int packcache_compact(packcache *pack, long maxbytes);
+
+#endif /* PACKCACHE_H */
@@ -0,0 +1,1065 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Purpose:     Writes png images for png_raster(), with its own deflate
+ *              compressor, so mimeTeX doesn't need zlib.
+ *
+ * Functions:   png_deflate(in,nin,level,out)   zlib stream of in[]
+ *              png_write(image,level,fp,buffer,buffer_size) png file
+ *
+ * Notes:     o See RFC 1950 (zlib), RFC 1951 (deflate) and the png
+ *              specification (www.w3.org/TR/PNG/) for the formats.
+ *            o Everything here is reentrant: tables are const,
+ *              and working storage is malloc()'ed for each call.
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "pngsave.h"
+
+/* --- deflate parameters --- */
+#define WSIZE     (32768)       /* window, i.e., farthest match */
+#define WMASK     (WSIZE-1)
+#define MINMATCH  (3)           /* shortest match */
+#define MAXMATCH  (258)         /* longest match */
+#define TOOFAR    (4096)        /* drop length 3 matches farther away */
+#define MAXHBITS  (15)          /* at most 1<<MAXHBITS hash chains */
+#define MAXSYMS   (16384)       /* literals and matches per block */
+#define MAXBITS   (15)          /* longest literal/length or distance code */
+#define MAXBLBITS (7)           /* longest code length code */
+#define NLITLEN   (288)         /* literal/length codes, incl 2 unused */
+#define NDIST     (30)          /* distance codes */
+#define NBLCODES  (19)          /* code length codes */
+#define ENDBLOCK  (256)         /* end-of-block literal/length code */
+
+/* --- lazy match parameters for each level, as in zlib --- */
+static const struct {
+    int good;                   /* search 1/4 of chain after one this long */
+    int lazy;                   /* don't look for a longer match
+                                 * after one this long, 0=greedy */
+    int nice;                   /* stop searching at one this long */
+    int chain;                  /* #hash chain entries searched */
+} levels[PNG_BESTLEVEL+1] = {
+    {  0,   0,   0,    0 },     /* 0: stored */
+    {  4,   0,   8,    4 },     /* 1-3: greedy */
+    {  4,   0,  16,    8 },
+    {  4,   0,  32,   32 },
+    {  4,   4,  16,   16 },     /* 4-9: lazy */
+    {  8,  16,  32,   32 },
+    {  8,  16, 128,  128 },
+    {  8,  32, 128,  256 },
+    { 32, 128, 258, 1024 },
+    { 32, 258, 258, 4096 }
+};
+
+/* --- length codes 257...285, and distance codes 0...29 --- */
+static const int lenbase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17,
+    19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int lenextra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1,
+    2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int distbase[NDIST] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33,
+    49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+    4097, 6145, 8193, 12289, 16385, 24577 };
+static const int distextra[NDIST] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4,
+    5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+/* --- order code length code lengths are sent in --- */
+static const int blorder[NBLCODES] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5,
+    11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+/* --- deflate working storage --- */
+typedef struct deflatestate_struct
+{
+    const unsigned char *in;    /* data being compressed */
+    int   nin;                  /* #bytes in in[] */
+    int   level;                /* 0-9 */
+    int   inpos;                /* in[] covered by syms so far */
+    int   blockstart;           /* in[] index where block begins */
+    unsigned char *out;         /* malloc'ed zlib stream */
+    int   nout, maxout;         /* #bytes in, allocated for, out[] */
+    unsigned long bitbuf;       /* bits not yet in out[], lsb first */
+    int   nbits;                /* #bits in bitbuf, always <8 */
+    int   isfailed;             /* true if out[] couldn't grow */
+    int   *head;                /* 1+most recent in[] index for hash */
+    int   *prev;                /* 1+previous in[] index for same hash */
+    int   hbits;                /* hash is hbits wide */
+    int   nsyms;                /* #syms in current block */
+    unsigned short symlit[MAXSYMS]; /* literal, or 256+length-3 */
+    unsigned short symdist[MAXSYMS]; /* distance, or 0 for literal */
+    unsigned litfreq[NLITLEN];  /* current block's code frequencies */
+    unsigned distfreq[NDIST];
+} deflatestate; /* --- end-of-deflatestate_struct --- */
+
+/* --- crc of 4 bits at a time, polynomial 0xedb88320 --- */
+static const unsigned long crcnibble[16] = {
+    0x00000000UL, 0x1db71064UL, 0x3b6e20c8UL, 0x26d930acUL,
+    0x76dc4190UL, 0x6b6b51f4UL, 0x4db26158UL, 0x5005713cUL,
+    0xedb88320UL, 0xf00f9344UL, 0xd6d6a3e8UL, 0xcb61b38cUL,
+    0x9b64c2b0UL, 0x86d3d2d4UL, 0xa00ae278UL, 0xbdbdf21cUL };
+/* --- 4-bit values with their bits reversed --- */
+static const unsigned char revnibble[16] = {
+    0x0, 0x8, 0x4, 0xc, 0x2, 0xa, 0x6, 0xe,
+    0x1, 0x9, 0x5, 0xd, 0x3, 0xb, 0x7, 0xf };
+
+
+/* ==========================================================================
+ * Function:    putbyte ( ds, byte )
+ * Purpose:     Appends one byte to ds->out[], growing it if necessary
+ * --------------------------------------------------------------------------
+ * Arguments:   ds (I/O)    deflatestate * to compressor
+ *              byte (I)    int containing byte to be appended
+ * --------------------------------------------------------------------------
+ * Returns:     ( void )
+ * --------------------------------------------------------------------------
+ * Notes:     o If out[] can't grow, ds->isfailed is set and
+ *              the byte is dropped.
+ * ======================================================================= */
+/* --- entry point --- */
+static void putbyte(deflatestate *ds, int byte)
+{
+    if (ds->nout >= ds->maxout) {       /* out[] is full */
+        int maxout = 2 * ds->maxout;
+        unsigned char *out = NULL;
+        if (ds->isfailed
+                || (out = (unsigned char *)realloc(ds->out, maxout)) == NULL) {
+            ds->isfailed = 1;
+            return;
+        }
+        ds->out = out;
+        ds->maxout = maxout;
+    }
+    ds->out[ds->nout++] = (unsigned char)byte;
+} /* --- end-of-function putbyte() --- */
+
+
+/* ==========================================================================
+ * Function:    putbits ( ds, value, n )
+ * Purpose:     Appends the n low-order bits of value to ds->out[],
+ *              least significant bit first
+ * --------------------------------------------------------------------------
+ * Arguments:   ds (I/O)    deflatestate * to compressor
+ *              value (I)   unsigned containing bits to be appended
+ *              n (I)       int containing #bits, 0...16
+ * --------------------------------------------------------------------------
+ * Returns:     ( void )
+ * --------------------------------------------------------------------------
+ * Notes:     o Huffman codes are sent most significant bit first,
+ *              so buildcodes() has already reversed them.
+ * ======================================================================= */
+/* --- entry point --- */
+static void putbits(deflatestate *ds, unsigned value, int n)
+{
+    ds->bitbuf |= ((unsigned long)value) << ds->nbits;
+    ds->nbits += n;
+    while (ds->nbits >= 8) {            /* emit each complete byte */
+        putbyte(ds, (int)(ds->bitbuf & 0xff));
+        ds->bitbuf >>= 8;
+        ds->nbits -= 8;
+    }
+} /* --- end-of-function putbits() --- */
+
+
+/* ==========================================================================
+ * Function:    alignbits ( ds )
+ * Purpose:     Pads ds->out[] with 0 bits to the next byte boundary
+ * ======================================================================= */
+/* --- entry point --- */
+static void alignbits(deflatestate *ds)
+{
+    if (ds->nbits > 0) putbits(ds, 0, 8 - ds->nbits);
+} /* --- end-of-function alignbits() --- */
+
+
+/* ==========================================================================
+ * Function:    lencode ( length )
+ * Purpose:     Returns length's index, 0...28, into lenbase[]
+ *              (i.e., its literal/length code less 257)
+ * ======================================================================= */
+/* --- entry point --- */
+static int lencode(int length)
+{
+    int v = length - MINMATCH, log2v = 0;
+    if (length >= MAXMATCH) return (28);
+    if (v < 8) return (v);
+    while ((v >> (log2v + 1)) != 0) log2v++;
+    return (4 * (log2v - 1) + ((v >> (log2v - 2)) & 3));
+} /* --- end-of-function lencode() --- */
+
+
+/* ==========================================================================
+ * Function:    distcode ( dist )
+ * Purpose:     Returns dist's distance code, 0...29
+ * ======================================================================= */
+/* --- entry point --- */
+static int distcode(int dist)
+{
+    int v = dist - 1, log2v = 0;
+    if (v < 4) return (v);
+    while ((v >> (log2v + 1)) != 0) log2v++;
+    return (2 * log2v + ((v >> (log2v - 1)) & 1));
+} /* --- end-of-function distcode() --- */
+
+
+/* ==========================================================================
+ * Function:    buildlengths ( freq, n, maxbits, lens )
+ * Purpose:     Huffman code lengths, at most maxbits long,
+ *              for symbols 0...n-1 with frequencies freq[]
+ * --------------------------------------------------------------------------
+ * Arguments:   freq (I)    unsigned * to n symbol frequencies
+ *              n (I)       int containing #symbols, at most NLITLEN
+ *              maxbits (I) int containing longest allowed length
+ *              lens (O)    unsigned char * returning n code lengths,
+ *                          0 for symbols whose freq is 0
+ * --------------------------------------------------------------------------
+ * Returns:     ( void )
+ * --------------------------------------------------------------------------
+ * Notes:     o If the tree is too deep, frequencies are halved
+ *              (but kept >=1) and it's rebuilt, which converges
+ *              on a balanced tree.  That's not quite optimal,
+ *              but it's rarely needed for mimeTeX's images.
+ *            o At least two symbols get codes, so the code is
+ *              always complete, as some inflaters insist.
+ * ======================================================================= */
+/* --- entry point --- */
+static void buildlengths(const unsigned *freq, int n, int maxbits,
+                         unsigned char *lens)
+{
+    unsigned w[NLITLEN];        /* (scaled) frequencies */
+    unsigned weight[2*NLITLEN]; /* leaves, then internal nodes */
+    int order[NLITLEN];         /* leaf symbols by ascending weight */
+    int parent[2*NLITLEN], depth[2*NLITLEN];
+    int nleaves = 0, i = 0, j = 0, k = 0;
+    /* --- leaves are the symbols that occur --- */
+    memset((void *)lens, 0, n);
+    for (i = 0; i < n; i++)
+        if ((w[i] = freq[i]) > 0) order[nleaves++] = i;
+    if (nleaves < 2) {                  /* need at least two codes */
+        int other = (nleaves > 0 && order[0] == 0 ? 1 : 0);
+        lens[other] = 1;
+        lens[nleaves > 0 ? order[0] : 1 - other] = 1;
+        return;
+    }
+    while (1) {
+        int ileaf = 0, inode = nleaves, maxdepth = 0;
+        /* --- insertion sort leaves by weight (ties by symbol) --- */
+        for (i = 1; i < nleaves; i++) {
+            int sym = order[i];
+            for (j = i; j > 0 && w[order[j-1]] > w[sym]; j--)
+                order[j] = order[j-1];
+            order[j] = sym;
+        }
+        for (i = 0; i < nleaves; i++) weight[i] = w[order[i]];
+        /* --- two-queue Huffman: internal nodes come out in order --- */
+        for (k = nleaves; k < 2 * nleaves - 1; k++) {
+            int pick, a = 0, b = 0;
+            for (pick = 0; pick < 2; pick++) {
+                int node = (ileaf < nleaves
+                            && (inode >= k || weight[ileaf] <= weight[inode]) ?
+                            ileaf++ : inode++);
+                if (pick == 0) a = node;
+                else b = node;
+            }
+            weight[k] = weight[a] + weight[b];
+            parent[a] = parent[b] = k;
+        }
+        depth[2 * nleaves - 2] = 0;     /* root */
+        for (k = 2 * nleaves - 3; k >= 0; k--)
+            depth[k] = depth[parent[k]] + 1;
+        for (i = 0; i < nleaves; i++)
+            if (depth[i] > maxdepth) maxdepth = depth[i];
+        if (maxdepth <= maxbits) break; /* lengths are okay */
+        for (i = 0; i < nleaves; i++)   /* else flatten and try again */
+            w[order[i]] = (w[order[i]] + 1) / 2;
+    } /* --- end-of-while(1) --- */
+    for (i = 0; i < nleaves; i++)
+        lens[order[i]] = (unsigned char)depth[i];
+} /* --- end-of-function buildlengths() --- */
+
+
+/* ==========================================================================
+ * Function:    buildcodes ( lens, n, codes )
+ * Purpose:     Canonical Huffman codes for code lengths lens[],
+ *              bit-reversed, ready for putbits()
+ * ======================================================================= */
+/* --- entry point --- */
+static void buildcodes(const unsigned char *lens, int n, unsigned short *codes)
+{
+    int blcount[MAXBITS+1], nextcode[MAXBITS+1];
+    int code = 0, bits = 0, i = 0;
+    memset((void *)blcount, 0, sizeof(blcount));
+    for (i = 0; i < n; i++) blcount[lens[i]]++;
+    blcount[0] = 0;
+    for (bits = 1; bits <= MAXBITS; bits++) {
+        code = (code + blcount[bits-1]) << 1;
+        nextcode[bits] = code;
+    }
+    for (i = 0; i < n; i++) {
+        int len = lens[i], c = 0, rev = 0;
+        codes[i] = 0;
+        if (len == 0) continue;
+        c = nextcode[len]++;
+        for (bits = 0; bits < len; bits++) /* reverse len bits */
+            rev = (rev << 1) | ((c >> bits) & 1);
+        codes[i] = (unsigned short)rev;
+    }
+} /* --- end-of-function buildcodes() --- */
+
+
+/* ==========================================================================
+ * Function:    putstored ( ds, isfinal )
+ * Purpose:     Emits in[blockstart...inpos-1] as stored block(s)
+ * ======================================================================= */
+/* --- entry point --- */
+static void putstored(deflatestate *ds, int isfinal)
+{
+    int start = ds->blockstart, n = ds->inpos - ds->blockstart;
+    do {
+        int len = (n > 65535 ? 65535 : n), i = 0;
+        putbits(ds, (isfinal && len == n ? 1 : 0), 3); /* BTYPE=00 */
+        alignbits(ds);
+        putbyte(ds, len & 0xff);
+        putbyte(ds, (len >> 8) & 0xff);
+        putbyte(ds, ~len & 0xff);
+        putbyte(ds, (~len >> 8) & 0xff);
+        for (i = 0; i < len; i++) putbyte(ds, ds->in[start+i]);
+        start += len;
+        n -= len;
+    } while (n > 0);
+} /* --- end-of-function putstored() --- */
+
+
+/* ==========================================================================
+ * Function:    putsymbols ( ds, litlens, litcodes, distlens, distcodes )
+ * Purpose:     Emits the current block's literals and matches,
+ *              and its end-of-block code, using the given codes
+ * ======================================================================= */
+/* --- entry point --- */
+static void putsymbols(deflatestate *ds,
+                       const unsigned char *litlens, const unsigned short *litcodes,
+                       const unsigned char *distlens, const unsigned short *distcodes)
+{
+    int isym = 0;
+    for (isym = 0; isym < ds->nsyms; isym++) {
+        int lit = ds->symlit[isym], dist = ds->symdist[isym];
+        if (dist == 0)                  /* literal byte */
+            putbits(ds, litcodes[lit], litlens[lit]);
+        else {                          /* length, distance pair */
+            int length = lit - 256 + MINMATCH,
+                ilen = lencode(length), idist = distcode(dist);
+            putbits(ds, litcodes[257+ilen], litlens[257+ilen]);
+            if (lenextra[ilen] > 0)
+                putbits(ds, length - lenbase[ilen], lenextra[ilen]);
+            putbits(ds, distcodes[idist], distlens[idist]);
+            if (distextra[idist] > 0)
+                putbits(ds, dist - distbase[idist], distextra[idist]);
+        }
+    } /* --- end-of-for(isym) --- */
+    putbits(ds, litcodes[ENDBLOCK], litlens[ENDBLOCK]);
+} /* --- end-of-function putsymbols() --- */
+
+
+/* ==========================================================================
+ * Function:    symbolbits ( ds, litlens, distlens )
+ * Purpose:     Returns #bits putsymbols() would emit with these lengths
+ * ======================================================================= */
+/* --- entry point --- */
+static long symbolbits(deflatestate *ds, const unsigned char *litlens,
+                       const unsigned char *distlens)
+{
+    long nbits = 0;
+    int i = 0;
+    for (i = 0; i < NLITLEN; i++)
+        if (ds->litfreq[i] > 0)
+            nbits += (long)ds->litfreq[i] *
+                     (litlens[i] + (i > ENDBLOCK ? lenextra[i-257] : 0));
+    for (i = 0; i < NDIST; i++)
+        if (ds->distfreq[i] > 0)
+            nbits += (long)ds->distfreq[i] * (distlens[i] + distextra[i]);
+    return (nbits);
+} /* --- end-of-function symbolbits() --- */
+
+
+/* ==========================================================================
+ * Function:    flushblock ( ds, isfinal )
+ * Purpose:     Emits the current block as whichever of stored,
+ *              fixed or dynamic Huffman codes is smallest
+ * --------------------------------------------------------------------------
+ * Arguments:   ds (I/O)    deflatestate * to compressor, whose
+ *                          current block is then empty
+ *              isfinal (I) int containing true for the last block
+ * --------------------------------------------------------------------------
+ * Returns:     ( void )
+ * ======================================================================= */
+/* --- entry point --- */
+static void flushblock(deflatestate *ds, int isfinal)
+{
+    unsigned char fixlitlens[NLITLEN], fixdistlens[NDIST],
+                  litlens[NLITLEN], distlens[NDIST],
+                  alllens[NLITLEN+NDIST], bllens[NBLCODES];
+    unsigned short litcodes[NLITLEN], distcodes[NDIST], blcodes[NBLCODES];
+    unsigned blfreq[NBLCODES];
+    unsigned char blsym[NLITLEN+NDIST], blextra[NLITLEN+NDIST];
+    int nlit = NLITLEN - 2, ndist = NDIST, nbl = NBLCODES, nblsyms = 0;
+    long storedbits = 0, fixedbits = 0, dynamicbits = 0;
+    int nstored = ds->inpos - ds->blockstart, i = 0;
+    /* --- fixed codes --- */
+    for (i = 0; i < NLITLEN; i++)
+        fixlitlens[i] = (i < 144 ? 8 : (i < 256 ? 9 : (i < 280 ? 7 : 8)));
+    for (i = 0; i < NDIST; i++) fixdistlens[i] = 5;
+    /* --- dynamic codes, and run-length coded lengths to send them --- */
+    ds->litfreq[ENDBLOCK] = 1;
+    buildlengths(ds->litfreq, NLITLEN - 2, MAXBITS, litlens);
+    litlens[NLITLEN-2] = litlens[NLITLEN-1] = 0;
+    buildlengths(ds->distfreq, NDIST, MAXBITS, distlens);
+    while (nlit > 257 && litlens[nlit-1] == 0) nlit--;
+    while (ndist > 1 && distlens[ndist-1] == 0) ndist--;
+    memcpy((void *)alllens, (void *)litlens, nlit);
+    memcpy((void *)(alllens + nlit), (void *)distlens, ndist);
+    memset((void *)blfreq, 0, sizeof(blfreq));
+    for (i = 0; i < nlit + ndist; ) {
+        int len = alllens[i], run = 1;
+        while (i + run < nlit + ndist && alllens[i+run] == len) run++;
+        if (len == 0 && run >= 3) {     /* run of zeros */
+            int n = (run > 138 ? 138 : run);
+            blsym[nblsyms] = (n >= 11 ? 18 : 17);
+            blextra[nblsyms++] = (unsigned char)(n - (n >= 11 ? 11 : 3));
+            i += n;
+        } else if (len != 0 && run >= 4) { /* length, then repeats of it */
+            int n = (run - 1 > 6 ? 6 : run - 1);
+            blsym[nblsyms] = (unsigned char)len;
+            blextra[nblsyms++] = 0;
+            blsym[nblsyms] = 16;
+            blextra[nblsyms++] = (unsigned char)(n - 3);
+            i += 1 + n;
+        } else {                        /* just this length */
+            blsym[nblsyms] = (unsigned char)len;
+            blextra[nblsyms++] = 0;
+            i++;
+        }
+    } /* --- end-of-for(i) --- */
+    for (i = 0; i < nblsyms; i++) blfreq[blsym[i]]++;
+    buildlengths(blfreq, NBLCODES, MAXBLBITS, bllens);
+    while (nbl > 4 && bllens[blorder[nbl-1]] == 0) nbl--;
+    /* --- size of each kind of block --- */
+    dynamicbits = 3 + 5 + 5 + 4 + 3 * nbl + symbolbits(ds, litlens, distlens);
+    for (i = 0; i < nblsyms; i++)
+        dynamicbits += bllens[blsym[i]] +
+                       (blsym[i] == 16 ? 2 : (blsym[i] == 17 ? 3 : (blsym[i] == 18 ? 7 : 0)));
+    fixedbits = 3 + symbolbits(ds, fixlitlens, fixdistlens);
+    storedbits = (long)(nstored / 65535 + 1) * (3 + 7 + 32) + 8L * nstored;
+    /* --- emit block --- */
+    if (ds->level == PNG_STORED
+            || (storedbits <= fixedbits && storedbits <= dynamicbits))
+        putstored(ds, isfinal);
+    else if (fixedbits <= dynamicbits) {
+        buildcodes(fixlitlens, NLITLEN, litcodes);
+        buildcodes(fixdistlens, NDIST, distcodes);
+        putbits(ds, (isfinal ? 1 : 0) | (1 << 1), 3); /* BTYPE=01 */
+        putsymbols(ds, fixlitlens, litcodes, fixdistlens, distcodes);
+    } else {
+        buildcodes(litlens, NLITLEN, litcodes);
+        buildcodes(distlens, NDIST, distcodes);
+        buildcodes(bllens, NBLCODES, blcodes);
+        putbits(ds, (isfinal ? 1 : 0) | (2 << 1), 3); /* BTYPE=10 */
+        putbits(ds, nlit - 257, 5);
+        putbits(ds, ndist - 1, 5);
+        putbits(ds, nbl - 4, 4);
+        for (i = 0; i < nbl; i++) putbits(ds, bllens[blorder[i]], 3);
+        for (i = 0; i < nblsyms; i++) {
+            int sym = blsym[i];
+            putbits(ds, blcodes[sym], bllens[sym]);
+            if (sym >= 16)
+                putbits(ds, blextra[i], (sym == 16 ? 2 : (sym == 17 ? 3 : 7)));
+        }
+        putsymbols(ds, litlens, litcodes, distlens, distcodes);
+    }
+    /* --- start next block --- */
+    ds->blockstart = ds->inpos;
+    ds->nsyms = 0;
+    memset((void *)ds->litfreq, 0, sizeof(ds->litfreq));
+    memset((void *)ds->distfreq, 0, sizeof(ds->distfreq));
+} /* --- end-of-function flushblock() --- */
+
+
+/* ==========================================================================
+ * Function:    addsymbol ( ds, lit, length, dist )
+ * Purpose:     Adds a literal byte lit (if dist is 0) or a length,dist
+ *              match to the current block, flushing it when it's full
+ * ======================================================================= */
+/* --- entry point --- */
+static void addsymbol(deflatestate *ds, int lit, int length, int dist)
+{
+    if (dist == 0) {                    /* literal */
+        ds->symlit[ds->nsyms] = (unsigned short)lit;
+        ds->litfreq[lit]++;
+        ds->inpos++;
+    } else {                            /* match */
+        ds->symlit[ds->nsyms] = (unsigned short)(256 + length - MINMATCH);
+        ds->litfreq[257 + lencode(length)]++;
+        ds->distfreq[distcode(dist)]++;
+        ds->inpos += length;
+    }
+    ds->symdist[ds->nsyms++] = (unsigned short)dist;
+    if (ds->nsyms >= MAXSYMS) flushblock(ds, 0);
+} /* --- end-of-function addsymbol() --- */
+
+
+/* ==========================================================================
+ * Function:    insertmatch ( ds, pos )
+ * Purpose:     Adds in[pos] to its hash chain, returning the previous
+ *              chain head (1+its in[] index, or 0 if none)
+ * ======================================================================= */
+/* --- entry point --- */
+static int insertmatch(deflatestate *ds, int pos)
+{
+    const unsigned char *p = ds->in + pos;
+    int shift = (ds->hbits + MINMATCH - 1) / MINMATCH,
+        hash = (((int)p[0] << (2 * shift)) ^ ((int)p[1] << shift) ^ p[2])
+               & ((1 << ds->hbits) - 1),
+        chainhead = ds->head[hash];
+    ds->prev[pos & WMASK] = chainhead;
+    ds->head[hash] = pos + 1;
+    return (chainhead);
+} /* --- end-of-function insertmatch() --- */
+
+
+/* ==========================================================================
+ * Function:    longestmatch ( ds, pos, chainhead, minlen, dist )
+ * Purpose:     Searches the hash chain starting at chainhead for the
+ *              longest earlier string matching in[pos...]
+ * --------------------------------------------------------------------------
+ * Arguments:   ds (I)      deflatestate * to compressor
+ *              pos (I)     int containing in[] index to be matched
+ *              chainhead (I) int returned by insertmatch(ds,pos)
+ *              minlen (I)  int containing length to be beaten
+ *              dist (O)    int * returning distance back to match
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     length of match, or 0 if none is
+ *                          longer than minlen
+ * ======================================================================= */
+/* --- entry point --- */
+static int longestmatch(deflatestate *ds, int pos, int chainhead,
+                        int minlen, int *dist)
+{
+    const unsigned char *in = ds->in, *p = ds->in + pos;
+    int maxlen = ds->nin - pos, best = minlen,
+        nchain = levels[ds->level].chain, nice = levels[ds->level].nice,
+        cand = chainhead - 1;
+    if (maxlen > MAXMATCH) maxlen = MAXMATCH;
+    if (best >= maxlen) return (0);
+    if (minlen >= levels[ds->level].good) nchain >>= 2; /* good enough */
+    while (cand >= 0 && pos - cand <= WSIZE && nchain-- > 0) {
+        const unsigned char *q = in + cand;
+        if (q[best] == p[best] && q[best-1] == p[best-1]
+                && q[0] == p[0] && q[1] == p[1]) {
+            int len = 2;
+            while (len + 8 <= maxlen) { /* 8 bytes at a time */
+                uint64_t qword, pword;
+                memcpy((void *)&qword, (const void *)(q + len), 8);
+                memcpy((void *)&pword, (const void *)(p + len), 8);
+                if (qword != pword) break;
+                len += 8;
+            }
+            while (len < maxlen && q[len] == p[len]) len++;
+            if (len > best) {           /* new longest match */
+                best = len;
+                *dist = pos - cand;
+                if (len >= nice || len >= maxlen) break;
+            }
+        }
+        if (ds->prev[cand & WMASK] - 1 >= cand) break; /* slot reused */
+        cand = ds->prev[cand & WMASK] - 1;
+    } /* --- end-of-while(cand>=0) --- */
+    return (best > minlen ? best : 0);
+} /* --- end-of-function longestmatch() --- */
+
+
+/* ==========================================================================
+ * Function:    png_deflate ( in, nin, level, out )
+ * Purpose:     Compresses in[] as a zlib stream (RFC 1950),
+ *              for a png IDAT chunk
+ * --------------------------------------------------------------------------
+ * Arguments:   in (I)      unsigned char * to nin bytes to compress
+ *              nin (I)     int containing #bytes in in[]
+ *              level (I)   int containing compression level,
+ *                          PNG_STORED=0...PNG_BESTLEVEL=9,
+ *                          or -1 for PNG_DEFAULTLEVEL
+ *              out (O)     unsigned char ** returning malloc()'ed
+ *                          zlib stream, which caller must free()
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #bytes in *out, or 0 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o Levels 1-3 take the first match found, and 4-9 also
+ *              look for a longer one at the next byte, searching
+ *              longer hash chains as level increases, like zlib.
+ *            o The hash table is sized to the input, so small images
+ *              don't pay for clearing a 32K-entry table.
+ * ======================================================================= */
+/* --- entry point --- */
+int png_deflate(const unsigned char *in, int nin, int level,
+                unsigned char **out)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    deflatestate *ds = NULL;
+    unsigned long adlera = 1, adlerb = 0;
+    int nout = 0, pos = 0, flevel = 0, i = 0;
+    /* ------------------------------------------------------------
+    initialization
+    ------------------------------------------------------------ */
+    if (out == NULL) goto end_of_job;
+    *out = NULL;
+    if (in == NULL || nin < 0) goto end_of_job;
+    if (level < 0) level = PNG_DEFAULTLEVEL;
+    if (level > PNG_BESTLEVEL) level = PNG_BESTLEVEL;
+    if ((ds = (deflatestate *)malloc(sizeof(deflatestate))) == NULL)
+        goto end_of_job;
+    memset((void *)ds, 0, sizeof(deflatestate));
+    ds->in = in;
+    ds->nin = nin;
+    ds->level = level;
+    ds->maxout = nin / 2 + 64;
+    if ((ds->out = (unsigned char *)malloc(ds->maxout)) == NULL)
+        goto end_of_job;
+    if (level != PNG_STORED) {          /* hash chains for matching */
+        for (ds->hbits = 8; ds->hbits < MAXHBITS; ds->hbits++)
+            if ((1 << ds->hbits) >= nin) break;
+        if ((ds->head = (int *)calloc(1 << ds->hbits, sizeof(int))) == NULL
+                || (ds->prev = (int *)malloc((nin < WSIZE ? nin + 1 : WSIZE)
+                                             * sizeof(int))) == NULL)
+            goto end_of_job;
+    }
+    /* --- zlib header: deflate, 32K window, and a level hint --- */
+    flevel = (level <= 1 ? 0 : (level <= 5 ? 1 : (level == 6 ? 2 : 3)));
+    putbyte(ds, 0x78);
+    putbyte(ds, (flevel << 6) + 31 - ((0x78 * 256 + (flevel << 6)) % 31));
+    /* ------------------------------------------------------------
+    find matches and emit blocks
+    ------------------------------------------------------------ */
+    if (level == PNG_STORED)            /* no compression */
+        ds->inpos = nin;
+    else if (levels[level].lazy == 0) { /* greedy: take first match */
+        while (pos < nin) {
+            int length = 0, dist = 0;
+            if (pos + MINMATCH <= nin) {
+                length = longestmatch(ds, pos, insertmatch(ds, pos),
+                                      MINMATCH - 1, &dist);
+                if (length == MINMATCH && dist > TOOFAR) length = 0;
+            }
+            if (length == 0) {          /* literal */
+                addsymbol(ds, ds->in[pos], 0, 0);
+                pos++;
+            } else {                    /* match, and hash what it covers */
+                addsymbol(ds, 0, length, dist);
+                for (i = 1; i < length; i++)
+                    if (pos + i + MINMATCH <= nin) insertmatch(ds, pos + i);
+                pos += length;
+            }
+        } /* --- end-of-while(pos<nin) --- */
+    } else {                            /* lazy: maybe match at next byte */
+        int prevlength = 0, prevdist = 0, isprev = 0;
+        while (pos < nin) {
+            int length = 0, dist = 0;
+            if (pos + MINMATCH <= nin) {
+                int chainhead = insertmatch(ds, pos);
+                if (prevlength < levels[level].lazy)
+                    length = longestmatch(ds, pos, chainhead,
+                                          (prevlength > MINMATCH - 1 ?
+                                           prevlength : MINMATCH - 1), &dist);
+                if (length == MINMATCH && dist > TOOFAR) length = 0;
+            }
+            if (prevlength >= MINMATCH && length <= prevlength) {
+                /* --- previous byte's match is better --- */
+                int end = pos - 1 + prevlength;
+                addsymbol(ds, 0, prevlength, prevdist);
+                for (i = pos + 1; i < end; i++)
+                    if (i + MINMATCH <= nin) insertmatch(ds, i);
+                pos = end;
+                prevlength = isprev = 0;
+            } else {
+                /* --- previous byte is a literal, try this one --- */
+                if (isprev) addsymbol(ds, ds->in[pos-1], 0, 0);
+                prevlength = length;
+                prevdist = dist;
+                isprev = 1;
+                pos++;
+            }
+        } /* --- end-of-while(pos<nin) --- */
+        if (isprev) addsymbol(ds, ds->in[pos-1], 0, 0);
+    }
+    flushblock(ds, 1);
+    alignbits(ds);
+    /* --- zlib trailer: adler32 of in[], msb first --- */
+    for (pos = 0; pos < nin; ) {
+        int n = (nin - pos > 5552 ? 5552 : nin - pos); /* no overflow */
+        for (i = 0; i < n; i++) {
+            adlera += in[pos++];
+            adlerb += adlera;
+        }
+        adlera %= 65521;
+        adlerb %= 65521;
+    }
+    putbyte(ds, (int)(adlerb >> 8));
+    putbyte(ds, (int)(adlerb & 0xff));
+    putbyte(ds, (int)(adlera >> 8));
+    putbyte(ds, (int)(adlera & 0xff));
+    if (ds->isfailed) goto end_of_job;
+    /* --- hand zlib stream to caller --- */
+    *out = ds->out;
+    ds->out = NULL;
+    nout = ds->nout;
+    /* ------------------------------------------------------------
+    free working storage and return
+    ------------------------------------------------------------ */
+end_of_job:
+    if (ds != NULL) {
+        if (ds->out != NULL) free((void *)ds->out);
+        if (ds->head != NULL) free((void *)ds->head);
+        if (ds->prev != NULL) free((void *)ds->prev);
+        free((void *)ds);
+    }
+    return (nout);
+} /* --- end-of-function png_deflate() --- */
+
+
+/* ==========================================================================
+ * Function:    pngbytes ( fp, buffer, buffer_size, nbytes, bytes, n, crc )
+ * Purpose:     Appends n bytes to fp, or to buffer if fp is NULL,
+ *              and updates a running png crc
+ * --------------------------------------------------------------------------
+ * Arguments:   fp (I)      FILE * to open output file,
+ *                          or NULL to write to buffer
+ *              buffer (O)  unsigned char * to output buffer
+ *              buffer_size (I) int containing #bytes in buffer
+ *              nbytes (I/O) int * to #bytes already written,
+ *                          incremented by n
+ *              bytes (I)   unsigned char * to n bytes to be written
+ *              n (I)       int containing #bytes to be written
+ *              crc (I/O)   unsigned long * to crc, or NULL
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1 if completed successfully,
+ *                          or 0 otherwise (for any error).
+ * --------------------------------------------------------------------------
+ * Notes:     o Like pbmpgm_write() in output.c, a full buffer isn't
+ *              an error, nbytes just keeps counting.
+ * ======================================================================= */
+/* --- entry point --- */
+static int pngbytes(FILE *fp, unsigned char *buffer, int buffer_size,
+                    int *nbytes, const unsigned char *bytes, int n,
+                    unsigned long *crc)
+{
+    int i = 0;
+    if (crc != NULL)                    /* crc 4 bits at a time */
+        for (i = 0; i < n; i++) {
+            unsigned long c = *crc ^ bytes[i];
+            c = (c >> 4) ^ crcnibble[c & 0xf];
+            *crc = (c >> 4) ^ crcnibble[c & 0xf];
+        }
+    if (fp != NULL) {                   /* write to open file */
+        if (n > 0 && fwrite(bytes, 1, n, fp) != (size_t)n) return (0);
+    } else if (buffer != NULL && n > 0) { /* or to memory buffer */
+        if (*nbytes + n <= buffer_size)
+            memcpy(buffer + *nbytes, bytes, n);
+    }
+    *nbytes += n;
+    return (1);
+} /* --- end-of-function pngbytes() --- */
+
+
+/* ==========================================================================
+ * Function:    pngchunk ( fp, buffer, buffer_size, nbytes, type, data, n )
+ * Purpose:     Appends a png chunk: length, type, data and crc
+ * --------------------------------------------------------------------------
+ * Arguments:   (see pngbytes() for fp through nbytes)
+ *              type (I)    char * to 4-character chunk type, e.g., "IHDR"
+ *              data (I)    unsigned char * to n bytes of chunk data
+ *              n (I)       int containing #bytes of data
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1 if completed successfully,
+ *                          or 0 otherwise (for any error).
+ * ======================================================================= */
+/* --- entry point --- */
+static int pngchunk(FILE *fp, unsigned char *buffer, int buffer_size,
+                    int *nbytes, const char *type, const unsigned char *data,
+                    int n)
+{
+    unsigned char header[8], trailer[4];
+    unsigned long crc = 0xffffffffUL;
+    header[0] = (unsigned char)((n >> 24) & 0xff);
+    header[1] = (unsigned char)((n >> 16) & 0xff);
+    header[2] = (unsigned char)((n >> 8) & 0xff);
+    header[3] = (unsigned char)(n & 0xff);
+    memcpy((void *)(header + 4), (void *)type, 4);
+    if (!pngbytes(fp, buffer, buffer_size, nbytes, header, 4, NULL)
+            || !pngbytes(fp, buffer, buffer_size, nbytes, header + 4, 4, &crc)
+            || !pngbytes(fp, buffer, buffer_size, nbytes, data, n, &crc))
+        return (0);
+    crc ^= 0xffffffffUL;
+    trailer[0] = (unsigned char)((crc >> 24) & 0xff);
+    trailer[1] = (unsigned char)((crc >> 16) & 0xff);
+    trailer[2] = (unsigned char)((crc >> 8) & 0xff);
+    trailer[3] = (unsigned char)(crc & 0xff);
+    return (pngbytes(fp, buffer, buffer_size, nbytes, trailer, 4, NULL));
+} /* --- end-of-function pngchunk() --- */
+
+
+/* ==========================================================================
+ * Function:    pngfilter ( type, row, prior, n, bpp, filtered )
+ * Purpose:     Applies png filter type 0...4 to one row
+ * --------------------------------------------------------------------------
+ * Arguments:   type (I)    int containing 0=None, 1=Sub, 2=Up,
+ *                          3=Average or 4=Paeth
+ *              row (I)     unsigned char * to n bytes of this row
+ *              prior (I)   unsigned char * to n bytes of the row above
+ *                          (all 0 for the first row)
+ *              n (I)       int containing #bytes in row
+ *              bpp (I)     int containing #bytes per pixel, at least 1
+ *              filtered (O) unsigned char * returning type,
+ *                          followed by n filtered bytes
+ * --------------------------------------------------------------------------
+ * Returns:     ( long )    sum of filtered bytes taken as signed,
+ *                          the usual heuristic for picking a type
+ * ======================================================================= */
+/* --- entry point --- */
+static long pngfilter(int type, const unsigned char *row,
+                      const unsigned char *prior, int n, int bpp,
+                      unsigned char *filtered)
+{
+    long sum = 0;
+    int i = 0;
+    *filtered++ = (unsigned char)type;
+    for (i = 0; i < n; i++) {
+        int a = (i >= bpp ? row[i-bpp] : 0),    /* left */
+            b = prior[i],                       /* above */
+            c = (i >= bpp ? prior[i-bpp] : 0),  /* above left */
+            pred = 0;
+        switch (type) {
+        default:
+            break;
+        case 1:
+            pred = a;
+            break;
+        case 2:
+            pred = b;
+            break;
+        case 3:
+            pred = (a + b) / 2;
+            break;
+        case 4: {                       /* nearest of a, b, c to a+b-c */
+            int pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - 2 * c);
+            pred = (pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+        }
+        break;
+        } /* --- end-of-switch(type) --- */
+        filtered[i] = (unsigned char)((row[i] - pred) & 0xff);
+        sum += (filtered[i] < 128 ? filtered[i] : 256 - filtered[i]);
+    } /* --- end-of-for(i) --- */
+    return (sum);
+} /* --- end-of-function pngfilter() --- */
+
+
+/* ==========================================================================
+ * Function:    png_write ( image, level, fp, buffer, buffer_size )
+ * Purpose:     Writes image as a png file to fp, or to buffer
+ *              if fp is NULL
+ * --------------------------------------------------------------------------
+ * Arguments:   image (I)   pngimage * to image, with its pixels,
+ *                          color type, bit depth and palette
+ *              level (I)   int containing deflate level 0...9,
+ *                          or -1 for PNG_DEFAULTLEVEL
+ *              fp (I)      FILE * to open output file,
+ *                          or NULL to write to buffer instead
+ *              buffer (O)  void * to output buffer (used if fp==NULL)
+ *              buffer_size (I) int containing #bytes in buffer
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     total #bytes written,
+ *                          or 0 for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o fp isn't closed, that's up to the caller.
+ *            o If the image doesn't fit in buffer, the #bytes it needs
+ *              is still returned (and is greater than buffer_size).
+ *            o Rows are unpacked from image->pixels one byte per
+ *              sample, or from 1-bit lsb-first rows if isbits,
+ *              and repacked msb-first at image->bitdepth.
+ *            o An opaque PNG_PALETTE whose colors are exactly
+ *              the grays of its bit depth, e.g., just black
+ *              and white, is written as PNG_GRAY without a PLTE.
+ *              Otherwise a tRNS chunk gives each index its alpha,
+ *              omitting trailing opaque ones.
+ *            o 8-bit gray and gray-alpha rows each get the filter
+ *              whose output has the smallest sum, and the others
+ *              get none, as the png specification recommends.
+ * ======================================================================= */
+/* --- entry point --- */
+int png_write(const pngimage *image, int level, FILE *fp,
+              void *buffer, int buffer_size)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    static const unsigned char signature[8] =
+        { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    unsigned char ihdr[13], plte[3*256], trns[256];
+    unsigned char *raw = NULL, *zdata = NULL, *rows = NULL, *filtered = NULL;
+    int colortype = 0, bitdepth = 0, nchannels = 1, maxval = 0,
+        isinverted = 0,             /* gray is max-index if true */
+        nalpha = 0,                 /* #tRNS entries */
+        rowbytes = 0, bpp = 1, nraw = 0, nz = 0,
+        nbytes = 0, isokay = 0, irow = 0, i = 0;
+    /* ------------------------------------------------------------
+    check image, and decide how it's written
+    ------------------------------------------------------------ */
+    if (image == NULL || image->pixels == NULL) goto end_of_job;
+    if (image->width < 1 || image->height < 1) goto end_of_job;
+    colortype = image->colortype;
+    bitdepth = image->bitdepth;
+    if (bitdepth != 1 && bitdepth != 2 && bitdepth != 4 && bitdepth != 8)
+        goto end_of_job;
+    if (image->isbits && bitdepth != 1) goto end_of_job;
+    maxval = (1 << bitdepth) - 1;
+    switch (colortype) {
+    default:
+        goto end_of_job;
+    case PNG_GRAY:
+        break;
+    case PNG_GRAYALPHA:
+        if (bitdepth != 8 || image->isbits) goto end_of_job;
+        nchannels = 2;
+        break;
+    case PNG_PALETTE:
+        if (image->ncolors < 1 || image->ncolors > maxval + 1) goto end_of_job;
+        for (i = 0; i < image->ncolors; i++) /* #alphas up to last <255 */
+            if (image->alpha[i] != 255) nalpha = i + 1;
+        if (nalpha == 0 && image->ncolors == maxval + 1) {
+            /* --- see if palette is ascending or descending grays --- */
+            int isup = 1, isdown = 1;
+            for (i = 0; i <= maxval; i++) {
+                const unsigned char *rgb = image->palette[i];
+                int up = (255 * i) / maxval, down = 255 - up;
+                if (rgb[0] != rgb[1] || rgb[0] != rgb[2]) isup = isdown = 0;
+                if (rgb[0] != up) isup = 0;
+                if (rgb[0] != down) isdown = 0;
+            }
+            if (isup || isdown) {       /* write as gray instead */
+                colortype = PNG_GRAY;
+                isinverted = isdown;
+            }
+        }
+        break;
+    } /* --- end-of-switch(colortype) --- */
+    rowbytes = (image->width * nchannels * bitdepth + 7) / 8;
+    bpp = (nchannels * bitdepth + 7) / 8;
+    nraw = image->height * (1 + rowbytes);
+    if ((raw = (unsigned char *)malloc(nraw)) == NULL
+            || (rows = (unsigned char *)calloc(2, rowbytes)) == NULL
+            || (filtered = (unsigned char *)malloc(1 + rowbytes)) == NULL)
+        goto end_of_job;
+    /* ------------------------------------------------------------
+    pack and filter each row
+    ------------------------------------------------------------ */
+    for (irow = 0; irow < image->height; irow++) {
+        const unsigned char *pixels = image->pixels + (long)irow * image->stride;
+        unsigned char *row = rows + (irow % 2) * rowbytes,   /* this row */
+                      *prior = rows + ((irow + 1) % 2) * rowbytes, /* above */
+                      *out = raw + irow * (1 + rowbytes);
+        if (image->isbits) {            /* reverse bits in each byte */
+            for (i = 0; i < rowbytes; i++) {
+                int byte = pixels[i];
+                row[i] = (unsigned char)((revnibble[byte & 0xf] << 4)
+                                         | revnibble[byte >> 4]);
+                if (isinverted) row[i] ^= 0xff;
+            }
+            if (image->width % 8 != 0)  /* clear bits past last pixel */
+                row[rowbytes-1] &= (unsigned char)(0xff << (8 - image->width % 8));
+        } else if (bitdepth == 8) {     /* already one sample per byte */
+            for (i = 0; i < rowbytes; i++)
+                row[i] = (unsigned char)(isinverted ? maxval - pixels[i] : pixels[i]);
+        } else {                        /* pack samples msb first */
+            int nsamples = image->width * nchannels, pixperbyte = 8 / bitdepth;
+            memset((void *)row, 0, rowbytes);
+            for (i = 0; i < nsamples; i++) {
+                int val = pixels[i] & maxval;
+                if (isinverted) val = maxval - val;
+                row[i/pixperbyte] |= (unsigned char)
+                    (val << (8 - bitdepth * (1 + i % pixperbyte)));
+            }
+        }
+        if (bitdepth < 8 || colortype == PNG_PALETTE) /* no filtering */
+            pngfilter(0, row, prior, rowbytes, bpp, out);
+        else {                          /* smallest of five filters */
+            long sum = 0, minsum = (-1);
+            int type = 0;
+            for (type = 0; type <= 4; type++)
+                if ((sum = pngfilter(type, row, prior, rowbytes, bpp, filtered))
+                        < minsum || minsum < 0) {
+                    minsum = sum;
+                    memcpy((void *)out, (void *)filtered, 1 + rowbytes);
+                }
+        }
+    } /* --- end-of-for(irow) --- */
+    /* --- compress filtered rows --- */
+    if ((nz = png_deflate(raw, nraw, level, &zdata)) <= 0) goto end_of_job;
+    /* ------------------------------------------------------------
+    write signature and chunks
+    ------------------------------------------------------------ */
+    for (i = 0; i < 4; i++) {           /* width, height, msb first */
+        ihdr[i]   = (unsigned char)((image->width >> (24 - 8 * i)) & 0xff);
+        ihdr[4+i] = (unsigned char)((image->height >> (24 - 8 * i)) & 0xff);
+    }
+    ihdr[8]  = (unsigned char)bitdepth;
+    ihdr[9]  = (unsigned char)colortype;
+    ihdr[10] = ihdr[11] = ihdr[12] = 0; /* deflate, adaptive, no interlace */
+    if (!pngbytes(fp, buffer, buffer_size, &nbytes, signature, 8, NULL)
+            || !pngchunk(fp, buffer, buffer_size, &nbytes, "IHDR", ihdr, 13))
+        goto end_of_job;
+    if (colortype == PNG_PALETTE) {
+        for (i = 0; i < image->ncolors; i++) {
+            memcpy((void *)(plte + 3 * i), (void *)image->palette[i], 3);
+            trns[i] = image->alpha[i];
+        }
+        if (!pngchunk(fp, buffer, buffer_size, &nbytes, "PLTE", plte,
+                      3 * image->ncolors))
+            goto end_of_job;
+        if (nalpha > 0)
+            if (!pngchunk(fp, buffer, buffer_size, &nbytes, "tRNS", trns, nalpha))
+                goto end_of_job;
+    }
+    if (!pngchunk(fp, buffer, buffer_size, &nbytes, "IDAT", zdata, nz)
+            || !pngchunk(fp, buffer, buffer_size, &nbytes, "IEND", NULL, 0))
+        goto end_of_job;
+    isokay = 1;
+    /* ------------------------------------------------------------
+    free working storage and return #bytes written, or 0=failed
+    ------------------------------------------------------------ */
+end_of_job:
+    if (raw != NULL) free((void *)raw);
+    if (rows != NULL) free((void *)rows);
+    if (filtered != NULL) free((void *)filtered);
+    if (zdata != NULL) free((void *)zdata);
+    return (isokay ? nbytes : 0);
+} /* --- end-of-function png_write() --- */
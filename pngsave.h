@@ -0,0 +1,36 @@
+#ifndef PNGSAVE_H
+#define PNGSAVE_H
+
+#include <stdio.h>
+
+/* --- color types (same numbers as in the png IHDR chunk) --- */
+#define PNG_GRAY      (0)       /* gray, 1,2,4 or 8 bits */
+#define PNG_PALETTE   (3)       /* PLTE index, 1,2,4 or 8 bits */
+#define PNG_GRAYALPHA (4)       /* gray and alpha, 8 bits each */
+
+/* --- deflate compression levels --- */
+#define PNG_STORED     (0)      /* stored blocks, no compression */
+#define PNG_DEFAULTLEVEL (6)    /* like zlib's default */
+#define PNG_BESTLEVEL  (9)      /* slowest, smallest */
+
+typedef struct pngimage_struct
+{
+    int   width, height;        /* #pixels wide, high */
+    int   colortype;            /* PNG_GRAY, _PALETTE or _GRAYALPHA */
+    int   bitdepth;             /* 1,2,4 or 8 bits per sample */
+    const unsigned char *pixels; /* top row first */
+    int   stride;               /* #bytes from one row to the next */
+    int   isbits;               /* true if rows are packed 1-bit,
+                                 * lsb first (i.e., a mimeTeX bitmap),
+                                 * else one byte per sample */
+    int   ncolors;              /* #PLTE entries for PNG_PALETTE */
+    unsigned char palette[256][3]; /* r,g,b for each index */
+    unsigned char alpha[256];   /* 0=transparent...255=opaque */
+} pngimage; /* --- end-of-pngimage_struct --- */
+
+int png_deflate(const unsigned char *in, int nin, int level,
+                unsigned char **out);
+int png_write(const pngimage *image, int level, FILE *fp,
+              void *buffer, int buffer_size);
+
+#endif /* PNGSAVE_H */
@@ -25,10 +25,208 @@
 #include <config.h>
 #endif /* HAVE_CONFIG_H */
 
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include "mimetex_priv.h"
 
+/* --- local functions used before they're defined --- */
+static int rastsmashedge(mimetex_ctx *mctx, subraster *sp1, int *lastcol1,
+                         subraster *sp2, const edgeprofile *edges2);
+
+
+/* ==========================================================================
+ * Function:    new_arena ( )
+ * Purpose: Allocation and constructor for an arena, from which
+ *      new_raster() and new_subraster() bump-allocate whenever
+ *      mctx->arena points to it.
+ * --------------------------------------------------------------------------
+ * Arguments:   none
+ * --------------------------------------------------------------------------
+ * Returns: ( mimetex_arena * ) ptr to empty arena,
+ *              or NULL for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o Memory is only obtained when the first raster is,
+ *      and thereafter a block at a time, each twice the size of the last.
+ *        o delete_raster() and delete_subraster() don't free arena
+ *      memory (except the most recent allocation, which they give back);
+ *      it's all released at once by reset_arena().
+ * ======================================================================= */
+/* --- entry point --- */
+mimetex_arena *new_arena(void)
+{
+    mimetex_arena *ap = (mimetex_arena *)malloc(sizeof(mimetex_arena));
+    if (ap != NULL)                      /* malloc succeeded */
+        ap->blocks = ap->current = (arenablock *)NULL; /* no blocks yet */
+    return (ap);
+} /* --- end-of-function new_arena() --- */
+
+
+/* ==========================================================================
+ * Function:    reset_arena ( ap )
+ * Purpose: Releases everything allocated from ap at once,
+ *      keeping its first blocks for reuse by the next render.
+ * --------------------------------------------------------------------------
+ * Arguments:   ap (I)      ptr to mimetex_arena to be reset
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error).
+ * --------------------------------------------------------------------------
+ * Notes:     o every raster and subraster allocated from ap is invalid
+ *      afterwards; use subrastkeep() for any that must outlive it.
+ *        o blocks beyond the first ARENAKEEP bytes are freed,
+ *      so one huge render doesn't pin its memory forever.
+ * ======================================================================= */
+/* --- entry point --- */
+int reset_arena(mimetex_arena *ap)
+{
+    arenablock *bp = NULL, *next = NULL;   /* block being reset, next one */
+    size_t  nkept = 0;                     /* #bytes in blocks kept so far */
+    if (ap == NULL) return (0);            /* no arena to reset */
+    for (bp = ap->blocks; bp != NULL; bp = bp->next) {
+        bp->used = bp->last = 0;             /* all memory free again */
+        nkept += bp->size;                   /* and keep it */
+        if (bp->next != NULL                 /* have more blocks */
+                &&   nkept + bp->next->size > ARENAKEEP) { /* beyond the limit */
+            for (next = bp->next; next != NULL; next = bp->next) {
+                bp->next = next->next;           /* unlink */
+                free((void *)next);
+            }                                  /* and free it */
+        }
+    } /* --- end-of-for(bp) --- */
+    ap->current = ap->blocks;              /* start over with first block */
+    return (1);
+} /* --- end-of-function reset_arena() --- */
+
+
+/* ==========================================================================
+ * Function:    delete_arena ( ap )
+ * Purpose: Destructor for arena, freeing all its blocks.
+ * --------------------------------------------------------------------------
+ * Arguments:   ap (I)      ptr to mimetex_arena to be deleted
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error).
+ * --------------------------------------------------------------------------
+ * Notes:
+ * ======================================================================= */
+/* --- entry point --- */
+int delete_arena(mimetex_arena *ap)
+{
+    arenablock *bp = NULL;                 /* block being freed */
+    if (ap != NULL) {                      /* can't free null ptr */
+        while ((bp = ap->blocks) != NULL) {  /* free every block */
+            ap->blocks = bp->next;
+            free((void *)bp);
+        }
+        free((void *)ap);
+    }                     /* and the arena itself */
+    return (1);
+} /* --- end-of-function delete_arena() --- */
+
+
+/* ==========================================================================
+ * Function:    arena_alloc ( ap, nbytes )
+ * Purpose: bump-allocates nbytes from ap, adding a block if needed
+ * --------------------------------------------------------------------------
+ * Arguments:   ap (I)      ptr to mimetex_arena to allocate from
+ *      nbytes (I)  size_t containing #bytes wanted
+ * --------------------------------------------------------------------------
+ * Returns: ( void * )      ptr to ARENAALIGN-aligned memory,
+ *              or NULL for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o block memory starts right after the arenablock header,
+ *      whose size is rounded up to ARENAALIGN
+ * ======================================================================= */
+/* --- entry point --- */
+#define ARENAHEADER ((sizeof(arenablock)+ARENAALIGN-1)/ARENAALIGN*ARENAALIGN)
+static void *arena_alloc(mimetex_arena *ap, size_t nbytes)
+{
+    arenablock *bp = ap->current;          /* block to allocate from */
+    size_t  size = ARENABLOCK;             /* #bytes for a new block */
+    /* --- round up so the next allocation stays aligned --- */
+    nbytes = (nbytes + ARENAALIGN - 1) / ARENAALIGN * ARENAALIGN;
+    /* --- find a block with room, reusing blocks kept by reset_arena() --- */
+    while (bp != NULL && bp->size - bp->used < nbytes) {
+        if (bp->next == NULL) {              /* no more blocks */
+            size = 2 * bp->size;               /* so double the last one */
+            break;
+        }
+        bp = bp->next;
+    }                       /* try next block */
+    if (bp == NULL || bp->size - bp->used < nbytes) { /* need a new block */
+        arenablock *newbp = NULL;
+        if (size < nbytes) size = nbytes;    /* big enough for request */
+        if ((newbp = (arenablock *)malloc(ARENAHEADER + size)) == NULL)
+            return (NULL);                     /* malloc failed */
+        newbp->next = NULL;
+        newbp->size = size;
+        newbp->used = newbp->last = 0;
+        if (bp == NULL) ap->blocks = newbp;  /* first block */
+        else bp->next = newbp;               /* or append after last block */
+        bp = newbp;
+    }
+    /* --- bump-allocate --- */
+    ap->current = bp;                      /* earlier blocks are full */
+    bp->last = bp->used;                   /* remember for arena_free() */
+    bp->used += nbytes;
+    return ((void *)((char *)bp + ARENAHEADER + bp->last));
+} /* --- end-of-function arena_alloc() --- */
+
+
+/* ==========================================================================
+ * Function:    arena_block ( ap, ptr )
+ * Purpose: finds the block of ap that ptr was allocated from
+ * --------------------------------------------------------------------------
+ * Arguments:   ap (I)      ptr to mimetex_arena, or NULL
+ *      ptr (I)     void * to memory to be looked up
+ * --------------------------------------------------------------------------
+ * Returns: ( arenablock * ) ptr to block containing ptr,
+ *              or NULL if it's malloc()'ed memory.
+ * --------------------------------------------------------------------------
+ * Notes:     o blocks double in size, so there are only a few to check
+ * ======================================================================= */
+/* --- entry point --- */
+static arenablock *arena_block(mimetex_arena *ap, void *ptr)
+{
+    arenablock *bp = NULL;                 /* block that may contain ptr */
+    char    *mem = NULL;                   /* memory in that block */
+    if (ap == NULL) return (NULL);         /* no arena */
+    for (bp = ap->blocks; bp != NULL; bp = bp->next) {
+        mem = (char *)bp + ARENAHEADER;
+        if ((char *)ptr >= mem && (char *)ptr < mem + bp->used) /* found */
+            return (bp);
+        if (bp == ap->current) break;        /* later blocks are empty */
+    } /* --- end-of-for(bp) --- */
+    return (NULL);
+} /* --- end-of-function arena_block() --- */
+
+
+/* ==========================================================================
+ * Function:    arena_free ( ap, ptr )
+ * Purpose: checks whether ptr was allocated from ap,
+ *      giving its memory back if it was the most recent allocation
+ * --------------------------------------------------------------------------
+ * Arguments:   ap (I)      ptr to mimetex_arena, or NULL
+ *      ptr (I)     void * to memory being freed
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if ptr belongs to ap (and mustn't be free()'d),
+ *              or 0 if it's malloc()'ed memory.
+ * --------------------------------------------------------------------------
+ * Notes:
+ * ======================================================================= */
+/* --- entry point --- */
+static int arena_free(mimetex_arena *ap, void *ptr)
+{
+    arenablock *bp = arena_block(ap, ptr); /* block containing ptr */
+    if (bp == NULL) return (0);            /* not arena memory */
+    if (bp == ap->current                  /* most recent allocation */
+            &&   (char *)ptr == (char *)bp + ARENAHEADER + bp->last)
+        bp->used = bp->last;                 /* so undo it */
+    return (1);
+} /* --- end-of-function arena_free() --- */
+
+
 /* ==========================================================================
  * Function:    new_raster ( width, height, pixsz )
  * Purpose: Allocation and constructor for raster.
@@ -44,7 +242,11 @@
  * Returns: ( raster * )    ptr to allocated and initialized
  *              raster struct, or NULL for any error.
  * --------------------------------------------------------------------------
- * Notes:
+ * Notes:     o bitmap rows are padded to BITSTRIDE bits,
+ *      i.e., pixel irow,icol is at PIXDEX(rp,irow,icol)
+ *        o if mctx->arena isn't NULL, the raster struct and
+ *      its pixmap (if no bigger than ARENAMAXALLOC) are allocated
+ *      together from it, and live until reset_arena()
  * ======================================================================= */
 /* --- entry point --- */
 raster  *new_raster(mimetex_ctx *mctx, int width, int height, int pixsz)
@@ -56,14 +258,21 @@ raster  *new_raster(mimetex_ctx *mctx, int width, int height, int pixsz)
     raster  *rp = (raster *)NULL;
     /* raster pixel map to be malloced */
     pixbyte *pixmap = NULL;
+    /* #pixels per row, padded to BITSTRIDE bits for a bitmap */
+    int stride = rowstride(width, pixsz);
     /* #bytes needed for pixmap */
-    int nbytes = pixsz * bitmapsz(width, height);
+    int nbytes = pixsz * bitmapsz(stride, height);
+    /* fail if width*height too big */
+    int istoobig = (pixsz * bitmapsz(width, height) > pixsz * maxraster);
     /* pixmap filler */
     int filler = (mctx->isstring ? ' ' : 0);
     /* in case pixmap malloc() fails */
     int delete_raster();
     /* padding bytes */
     int npadding = 0;
+    /* true to allocate from mctx->arena */
+    int isarena = (mctx->arena != NULL && nbytes > 0 && !istoobig
+                   && nbytes <= ARENAMAXALLOC);
     /* ------------------------------------------------------------
     allocate and initialize raster struct and embedded bitmap
     ------------------------------------------------------------ */
@@ -72,6 +281,22 @@ raster  *new_raster(mimetex_ctx *mctx, int width, int height, int pixsz)
                 width, height, pixsz);
         fflush(mctx->msgfp);
     }
+    /* --- render-scoped raster, with its pixmap right after it --- */
+    if (isarena) {
+        if ((rp = (raster *)arena_alloc(mctx->arena, sizeof(raster) + nbytes))
+                == (raster *)NULL)             /* couldn't get a block */
+            /* return error to caller */
+            goto end_of_job;
+        rp->width = width;
+        rp->height = height;
+        rp->format = 1;
+        rp->pixsz = pixsz;
+        rp->stride = stride;
+        rp->pixmap = pixmap = (pixbyte *)(rp + 1);
+        memset((void *)pixmap, filler, nbytes);
+        *pixmap = (pixbyte)0;
+        goto end_of_job;
+    } /* --- end-of-if(isarena) --- */
     /* --- allocate and initialize raster struct --- */
     /* malloc raster struct */
     rp = (raster *)malloc(sizeof(raster));
@@ -91,6 +316,8 @@ raster  *new_raster(mimetex_ctx *mctx, int width, int height, int pixsz)
     rp->format = 1;
     /* store #bits per pixel */
     rp->pixsz = pixsz;
+    /* and #pixels per row of pixmap */
+    rp->stride = stride;
     /* init bitmap as null ptr */
     rp->pixmap = (pixbyte *)NULL;
     /* --- allocate and initialize bitmap array --- */
@@ -99,7 +326,7 @@ raster  *new_raster(mimetex_ctx *mctx, int width, int height, int pixsz)
                 nbytes);
         fflush(mctx->msgfp);
     }
-    if (nbytes > 0 && nbytes <= pixsz*maxraster)  /* fail if width*height too big*/
+    if (nbytes > 0 && !istoobig)     /* fail if width*height too big*/
         /*bytes for width*height bits*/
         pixmap = (pixbyte *)malloc(nbytes + npadding);
     if (mctx->msgfp != NULL && mctx->msglevel >= 9999) {
@@ -144,7 +371,8 @@ end_of_job:
  * Returns: ( int )     1 if completed successfully,
  *              or 0 otherwise (for any error).
  * --------------------------------------------------------------------------
- * Notes:
+ * Notes:     o a raster allocated from mctx->arena is left
+ *      for reset_arena() to release
  * ======================================================================= */
 /* --- entry point --- */
 int delete_raster(mimetex_ctx *mctx, raster *rp)
@@ -152,7 +380,8 @@ int delete_raster(mimetex_ctx *mctx, raster *rp)
     /* ------------------------------------------------------------
     free raster bitmap and struct
     ------------------------------------------------------------ */
-    if (rp != (raster *)NULL) {      /* can't free null ptr */
+    if (rp != (raster *)NULL         /* can't free null ptr */
+            &&   !arena_free(mctx->arena, (void *)rp)) { /* nor arena memory */
         if (rp->pixmap != (pixbyte *)NULL)     /* can't free null ptr */
             /* free pixmap within raster */
             free((void *)rp->pixmap);
@@ -291,6 +520,101 @@ raster  *rastref(mimetex_ctx *mctx, raster *rp, int axis)
 } /* --- end-of-function rastref() --- */
 
 
+/* ---
+ * 64 pixels of a bitmap, as a word whose bit i is pixel i
+ * ------------------------------------------------------- */
+#define GET_UINT64(n,b,i)                                       \
+  { (n) = ( (uint64_t) (b)[(i)    ]       )                     \
+        | ( (uint64_t) (b)[(i) + 1] <<  8 )                     \
+        | ( (uint64_t) (b)[(i) + 2] << 16 )                     \
+        | ( (uint64_t) (b)[(i) + 3] << 24 )                     \
+        | ( (uint64_t) (b)[(i) + 4] << 32 )                     \
+        | ( (uint64_t) (b)[(i) + 5] << 40 )                     \
+        | ( (uint64_t) (b)[(i) + 6] << 48 )                     \
+        | ( (uint64_t) (b)[(i) + 7] << 56 ); }
+#define PUT_UINT64(n,b,i)                                       \
+  { (b)[(i)    ] = (pixbyte) ( (n)       );                     \
+    (b)[(i) + 1] = (pixbyte) ( (n) >>  8 );                     \
+    (b)[(i) + 2] = (pixbyte) ( (n) >> 16 );                     \
+    (b)[(i) + 3] = (pixbyte) ( (n) >> 24 );                     \
+    (b)[(i) + 4] = (pixbyte) ( (n) >> 32 );                     \
+    (b)[(i) + 5] = (pixbyte) ( (n) >> 40 );                     \
+    (b)[(i) + 6] = (pixbyte) ( (n) >> 48 );                     \
+    (b)[(i) + 7] = (pixbyte) ( (n) >> 56 ); }
+
+/* ==========================================================================
+ * Function:    rastputbits ( dst, dbit, src, sbit, nbits, isopaque )
+ * Purpose: Overlays nbits consecutive pixels of bitmap src,
+ *      starting at its sbit-th pixel, onto bitmap dst,
+ *      starting at its dbit-th pixel
+ * --------------------------------------------------------------------------
+ * Arguments:   dst (I/O)   pixbyte * to target bitmap pixmap
+ *      dbit (I)    int containing first target pixel, >=0
+ *      src (I)     pixbyte * to source bitmap pixmap
+ *      sbit (I)    int containing first source pixel, >=0
+ *      nbits (I)   int containing #pixels to overlay
+ *      isopaque (I)    int containing false (zero) to allow
+ *              original 1-bits of dst to "show through"
+ *              0-bits of src.
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully
+ * --------------------------------------------------------------------------
+ * Notes:     o Moves 64 pixels per operation once dbit reaches a byte
+ *      boundary, so rastput() does one call per scan line
+ *      rather than one getpixel()/setpixel() per pixel.
+ *        o Never reads src or writes dst beyond the given pixels'
+ *      bytes, so both may be exactly pixmapsz() bytes long.
+ * ======================================================================= */
+/* --- entry point --- */
+static int rastputbits(pixbyte *dst, int dbit, const pixbyte *src, int sbit,
+                       int nbits, int isopaque)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* first src byte, and bit offset within it */
+    const pixbyte *sbyte = NULL;
+    int shift = 0;
+    /* ------------------------------------------------------------
+    leading pixels, one at a time, until dst is byte-aligned
+    ------------------------------------------------------------ */
+    for (; nbits > 0 && (dbit & 7) != 0; nbits--, dbit++, sbit++)
+        if (getlongbit(src, sbit)) setlongbit(dst, dbit);
+        else if (isopaque) unsetlongbit(dst, dbit);
+    /* ------------------------------------------------------------
+    64 pixels at a time, then 8 at a time
+    ------------------------------------------------------------ */
+    for (; nbits >= 64; nbits -= 64, dbit += 64, sbit += 64) {
+        uint64_t word = 0, dword = 0;
+        sbyte = src + (sbit >> 3);
+        shift = sbit & 7;
+        GET_UINT64(word, sbyte, 0);
+        if (shift != 0)              /* src pixels straddle a 9th byte */
+            word = (word >> shift) | ((uint64_t)sbyte[8] << (64 - shift));
+        if (!isopaque) {             /* let dst 1-bits show through */
+            GET_UINT64(dword, dst, dbit >> 3);
+            word |= dword;
+        }
+        PUT_UINT64(word, dst, dbit >> 3);
+    } /* --- end-of-for(nbits>=64) --- */
+    for (; nbits >= 8; nbits -= 8, dbit += 8, sbit += 8) {
+        int byte = 0;
+        sbyte = src + (sbit >> 3);
+        shift = sbit & 7;
+        byte = (shift == 0 ? sbyte[0] :   /* src pixels straddle 2nd byte */
+                (sbyte[0] >> shift) | (sbyte[1] << (8 - shift)));
+        if (!isopaque) byte |= dst[dbit >> 3];
+        dst[dbit >> 3] = (pixbyte)byte;
+    } /* --- end-of-for(nbits>=8) --- */
+    /* ------------------------------------------------------------
+    trailing pixels, one at a time
+    ------------------------------------------------------------ */
+    for (; nbits > 0; nbits--, dbit++, sbit++)
+        if (getlongbit(src, sbit)) setlongbit(dst, dbit);
+        else if (isopaque) unsetlongbit(dst, dbit);
+    return (1);
+} /* --- end-of-function rastputbits() --- */
+
 /* ==========================================================================
  * Function:    rastput ( target, source, top, left, isopaque )
  * Purpose: Overlays source onto target,
@@ -307,7 +631,10 @@ raster  *rastref(mimetex_ctx *mctx, raster *rp, int axis)
  * Returns: ( int )     1 if completed successfully,
  *              or 0 otherwise (for any error).
  * --------------------------------------------------------------------------
- * Notes:
+ * Notes:     o A bitmap source onto a bitmap target is overlaid
+ *      a scan line at a time by rastputbits().
+ *        o Source pixels beyond target's right edge "wrap"
+ *      onto its next row, as if target's rows weren't padded.
  * ======================================================================= */
 /* --- entry point --- */
 int rastput(mimetex_ctx *mctx, raster *target, raster *source,
@@ -330,6 +657,38 @@ int rastput(mimetex_ctx *mctx, raster *target, raster *source,
     if (isstrict && (top < 0 || left < 0))   /* args fail strict test */
         /* so just return error */
         isokay = 0;
+    else if (source->pixsz == 1 && target->pixsz == 1 /* bitmap onto bitmap */
+             && !isstrict                       /* pixels may "wrap" */
+             && (mctx->msgfp == NULL || mctx->msglevel < 9999)) /*no per-pixel msgs*/
+        for (irow = 0; irow < source->height; irow++) { /* for each scan line */
+            /* first target and source pixel, #pixels in scan line */
+            int sbit = PIXDEX(source, irow, 0), nbits = source->width;
+            /* tpix counts pixels across target rows, so they "wrap" */
+            tpix = (top + irow) * target->width + left;
+            if (tpix < 0) {            /* skip pixels before target */
+                int nskip = min2(-tpix, nbits);
+                tpix += nskip;
+                sbit += nskip;
+                nbits -= nskip;
+            }
+            if (nbits > 0 && tpix + nbits > ntpix) { /* bounds check failed */
+                /* reset okay flag */
+                isokay = 0;
+                /* abort if error is fatal */
+                if (isfatal) goto end_of_job;
+                /* or just put pixels that fit */
+                nbits = max2(0, ntpix - tpix);
+            }
+            while (nbits > 0) {        /* overlay source scan line on target */
+                /* #pixels that fit in tpix's target row */
+                int nrow = min2(nbits, twidth - tpix % twidth);
+                rastputbits(target->pixmap, PIXDEX(target, tpix / twidth, tpix % twidth),
+                            source->pixmap, sbit, nrow, isopaque);
+                tpix += nrow;           /* rest "wraps" to next target row */
+                sbit += nrow;
+                nbits -= nrow;
+            } /* --- end-of-while(nbits>0) --- */
+        } /* --- end-of-for(irow) --- */
     else
         for (irow = 0; irow < source->height; irow++) { /* for each scan line */
             /*first target pixel (-1)*/
@@ -355,7 +714,7 @@ int rastput(mimetex_ctx *mctx, raster *target, raster *source,
                 }               /*or just go on to next row*/
                 if (tpix >= 0)               /* bounds check okay */
                     if (svalue != 0 || isopaque) {      /*got dark or opaque source*/
-                        setpixel(target, irow + top, icol + left, svalue);
+                        setpixel(target, tpix / twidth, tpix % twidth, svalue);
                     }/*overlay source on targ*/
             } /* --- end-of-for(icol) --- */
         } /* --- end-of-for(irow) --- */
@@ -482,49 +841,55 @@ end_of_job:
 
 
 /* ==========================================================================
- * Function:    rastcat ( sp1, sp2, isfree )
- * Purpose: "Concatanates" subrasters sp1||sp2, leaving both unchanged
- *      and returning a newly-allocated subraster.
- *      Frees/deletes input sp1 and/or sp2 depending on value
- *      of isfree (0=none, 1=sp1, 2=sp2, 3=both).
+ * Function:    rastcatlayout ( sp1, lastcol1, sp2, edges2, sp, toprow,
+ *          leftcol, isopaque )
+ * Purpose: Lays out sp1||sp2 for rastcat() without touching pixels,
+ *      returning the composite's envelope and where sp1 and sp2
+ *      are to be overlaid within it.
  * --------------------------------------------------------------------------
  * Arguments:   sp1 (I)     subraster *  to left-hand subraster
+ *      lastcol1 (I)    int * to rightmost set col in each row
+ *              of sp1, or NULL to find them from sp1's pixels
  *      sp2 (I)     subraster *  to right-hand subraster
- *      isfree (I)  int containing 1=free sp1 before return,
- *              2=free sp2, 3=free both, 0=free none.
+ *      edges2 (I)  edgeprofile * to edges of sp2's image,
+ *              or NULL to find them from sp2's pixels
+ *      sp (O)      subraster *  returning composite's type, symdef,
+ *              baseline and size, and whose image returns
+ *              its width, height and pixsz (pixmap untouched)
+ *      toprow (O)  int[2] returning top row of sp1, sp2
+ *      leftcol (O) int[2] returning left col of sp1, sp2,
+ *              or string offsets of sp1, sp2 if mctx->isstring
+ *      isopaque (O)    int * returning true if sp2 is overlaid opaque
  * --------------------------------------------------------------------------
- * Returns: ( subraster * ) pointer to constructed subraster sp1||sp2
- *              or  NULL for any error
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error).
  * --------------------------------------------------------------------------
- * Notes:
+ * Notes:     o Consumes mctx->isnocatspace and mctx->blanksymspace,
+ *      and advances mctx->fraccenterline, just as rastcat() does.
  * ======================================================================= */
 /* --- entry point --- */
-subraster *rastcat(mimetex_ctx *mctx, subraster *sp1, subraster *sp2, int isfree)
+static int rastcatlayout(mimetex_ctx *mctx, subraster *sp1, int *lastcol1,
+                         subraster *sp2, const edgeprofile *edges2,
+                         subraster *sp, int *toprow,
+                         int *leftcol, int *isopaque)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
-    /* returned subraster */
-    subraster *sp = (subraster *)NULL;
-    /* new concatted raster */
-    raster  *rp = (raster *)NULL;
-    /* in case isfree non-zero */
     int base1   = sp1->baseline,    /*baseline for left-hand subraster*/
         height1 = (sp1->image)->height, /* height for left-hand subraster */
         width1  = (sp1->image)->width,  /* width for left-hand subraster */
         pixsz1  = (sp1->image)->pixsz,  /* pixsz for left-hand subraster */
-        type1   = sp1->type,        /* image type for left-hand */
+        type1   = (sp1->type == GLYPHRASTER ? IMAGERASTER : sp1->type), /*left*/
         base2   = sp2->baseline,    /*baseline for right-hand subraster*/
         height2 = (sp2->image)->height, /* height for right-hand subraster */
         width2  = (sp2->image)->width,  /* width for right-hand subraster */
         pixsz2  = (sp2->image)->pixsz,  /* pixsz for right-hand subraster */
-        type2   = sp2->type; /* image type for right-hand */
+        type2   = (sp2->type == GLYPHRASTER ? IMAGERASTER : sp2->type); /*right*/
     /*concatted sp1||sp2 composite*/
     int height = 0, width = 0, pixsz = 0, base = 0;
     int issmash = (mctx->smashmargin != 0 ? 1 : 0), /* true to "squash" sp1||sp2 */
-        isopaque = (issmash ? 0 : 1),   /* not oppaque if smashing */
-        rastsmash(), isblank = 0, nsmash = 0, /* #cols to smash */
-        oldsmashmargin = mctx->smashmargin,   /* save original mctx->smashmargin */
+        isblank = 0, nsmash = 0, /* #cols to smash */
         oldblanksymspace = mctx->blanksymspace, /* save original mctx->blanksymspace */
         oldnocatspace = mctx->isnocatspace; /* save original mctx->isnocatspace */
     mathchardef *symdef1 = sp1->symdef, /*mathchardef of last left-hand char*/
@@ -578,7 +943,7 @@ subraster *rastcat(mimetex_ctx *mctx, subraster *sp1, subraster *sp2, int isfree
     if (!mctx->isstring && !isfrac) {
         /* don't smash strings or \frac's */
         if (issmash) {              /* raster smash wanted */
-            int  maxsmash = rastsmash(mctx, sp1, sp2), /* calculate max smash space */
+            int  maxsmash = rastsmashedge(mctx, sp1, lastcol1, sp2, edges2), /* max smash */
                             /* init margin without delta */
                             margin = mctx->smashmargin;
             if ((1 && smash1 && smash2)       /* concatanating two chars */
@@ -644,24 +1009,14 @@ subraster *rastcat(mimetex_ctx *mctx, subraster *sp1, subraster *sp2, int isfree
         fflush(mctx->msgfp);
     }            /* flush mctx->msgfp buffer */
     /* ------------------------------------------------------------
-    allocate concatted composite subraster
+    return composite envelope and placement of sp1, sp2 within it
     ------------------------------------------------------------ */
-    /* --- allocate returned subraster (and then initialize it) --- */
-    if (mctx->msgfp != NULL && mctx->msglevel >= 9999) {
-        fprintf(mctx->msgfp, "rastcat> calling new_subraster(%d,%d,%d)\n",
-                width, height, pixsz);
-        fflush(mctx->msgfp);
-    }
-    if ((sp = new_subraster(mctx, width, height, pixsz)) /* allocate new subraster */
-            == (subraster *)NULL) {         /* failed */
-        if (mctx->msgfp != NULL && mctx->msglevel >= 1) { /* report failure */
-            fprintf(mctx->msgfp, "rastcat> new_subraster(%d,%d,%d) failed\n",
-                    width, height, pixsz);
-            fflush(mctx->msgfp);
-        }
-        goto end_of_job;
-    }          /* failed, so quit */
-    /* --- initialize subraster parameters --- */
+    /* --- composite dimensions --- */
+    (sp->image)->width  = width;
+    (sp->image)->height = height;
+    (sp->image)->pixsz  = pixsz;
+    (sp->image)->stride = rowstride(width, pixsz);
+    /* --- composite parameters --- */
     /* sp->type = (!mctx->isstring?STRINGRASTER:ASCIISTRING); */  /*concatted string*/
     if (!mctx->isstring)
         sp->type = /*type2;*//*(type1==type2?type2:IMAGERASTER);*/
@@ -680,6 +1035,106 @@ subraster *rastcat(mimetex_ctx *mctx, subraster *sp1, subraster *sp2, int isfree
     if (isblank)                 /* need to propagate mctx->blanksignal */
         /* may not be completely safe??? */
         sp->type = mctx->blanksignal;
+    /* --- placement of sp1, sp2 --- */
+    if (!mctx->isstring) {
+        int  fracbase = (isfrac ?     /* baseline for punc after \frac */
+                         /*adjust baseline or use original*/
+                         max2(mctx->fraccenterline, base2) : base);
+        /* left-hand plus any residual smash space */
+        toprow[0]  = base - base1;
+        leftcol[0] = max2(0, nsmash - width1);
+        /* right-hand minus any smashed space */
+        toprow[1]  = fracbase - base2;
+        leftcol[1] = max2(0, width1 + space - nsmash);
+        /* not opaque if smashing */
+        *isopaque  = (issmash ? 0 : 1);
+        if (1 && type1 == FRACRASTER  /* we're done with \frac image */
+                &&   type2 != FRACRASTER)        /* unless we have \frac\frac */
+            /* so reset centerline signal */
+            mctx->fraccenterline = NOVALUE;
+        if (mctx->fraccenterline != NOVALUE)    /* sp2 is a fraction */
+            mctx->fraccenterline += (base - base2);
+    }  /* so adjust its centerline */
+    else {
+        /* offsets of left and right strings */
+        toprow[0] = toprow[1] = 0;
+        leftcol[0] = 0;
+        leftcol[1] = width1 - 1 + space;
+        *isopaque  = 1;
+    }
+    /* back to caller, 1=okay */
+    return (1);
+} /* --- end-of-function rastcatlayout() --- */
+
+
+/* ==========================================================================
+ * Function:    rastcat ( sp1, sp2, isfree )
+ * Purpose: "Concatanates" subrasters sp1||sp2, leaving both unchanged
+ *      and returning a newly-allocated subraster.
+ *      Frees/deletes input sp1 and/or sp2 depending on value
+ *      of isfree (0=none, 1=sp1, 2=sp2, 3=both).
+ * --------------------------------------------------------------------------
+ * Arguments:   sp1 (I)     subraster *  to left-hand subraster
+ *      sp2 (I)     subraster *  to right-hand subraster
+ *      isfree (I)  int containing 1=free sp1 before return,
+ *              2=free sp2, 3=free both, 0=free none.
+ * --------------------------------------------------------------------------
+ * Returns: ( subraster * ) pointer to constructed subraster sp1||sp2
+ *              or  NULL for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o Layout is done by rastcatlayout(), which hlist_cat()
+ *      shares to concatenate without painting.
+ * ======================================================================= */
+/* --- entry point --- */
+subraster *rastcat(mimetex_ctx *mctx, subraster *sp1, subraster *sp2, int isfree)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* returned subraster */
+    subraster *sp = (subraster *)NULL;
+    /* new concatted raster */
+    raster  *rp = (raster *)NULL;
+    /* composite envelope and dimensions from rastcatlayout() */
+    subraster layout;
+    raster  dims;
+    /* placement of sp1, sp2 in composite */
+    int toprow[2], leftcol[2], isopaque = 1;
+    /* in case isfree non-zero */
+    int width1  = (sp1->image)->width,  /* width for left-hand subraster */
+        width2  = (sp2->image)->width,  /* width for right-hand subraster */
+        oldsmashmargin = mctx->smashmargin; /* save original mctx->smashmargin */
+    /* ------------------------------------------------------------
+    lay out concatted composite subraster
+    ------------------------------------------------------------ */
+    /* composite dimensions returned here */
+    layout.image = &dims;
+    if (!rastcatlayout(mctx, sp1, NULL, sp2, NULL, &layout, toprow, leftcol,
+                       &isopaque))
+        goto end_of_job;
+    /* ------------------------------------------------------------
+    allocate concatted composite subraster
+    ------------------------------------------------------------ */
+    /* --- allocate returned subraster (and then initialize it) --- */
+    if (mctx->msgfp != NULL && mctx->msglevel >= 9999) {
+        fprintf(mctx->msgfp, "rastcat> calling new_subraster(%d,%d,%d)\n",
+                dims.width, dims.height, dims.pixsz);
+        fflush(mctx->msgfp);
+    }
+    if ((sp = new_subraster(mctx, dims.width, dims.height, dims.pixsz)) /* allocate new subraster */
+            == (subraster *)NULL) {         /* failed */
+        if (mctx->msgfp != NULL && mctx->msglevel >= 1) { /* report failure */
+            fprintf(mctx->msgfp, "rastcat> new_subraster(%d,%d,%d) failed\n",
+                    dims.width, dims.height, dims.pixsz);
+            fflush(mctx->msgfp);
+        }
+        goto end_of_job;
+    }          /* failed, so quit */
+    /* --- initialize subraster parameters --- */
+    sp->type = layout.type;
+    sp->symdef = layout.symdef;
+    sp->baseline = layout.baseline;
+    sp->size = layout.size;
     /* --- extract raster from subraster --- */
     /* raster allocated in subraster */
     rp = sp->image;
@@ -691,8 +1146,8 @@ subraster *rastcat(mimetex_ctx *mctx, subraster *sp1, subraster *sp2, int isfree
         fflush(mctx->msgfp);
     }            /* flush mctx->msgfp buffer */
     if (!mctx->isstring) {
-        rastput(mctx, rp, sp1->image, base - base1,/* overlay left-hand */
-                max2(0, nsmash - width1), 1);/* plus any residual smash space */
+        rastput(mctx, rp, sp1->image, toprow[0],/* overlay left-hand */
+                leftcol[0], 1);/* plus any residual smash space */
     } else {
         /*init left string*/
         memcpy(rp->pixmap, (sp1->image)->pixmap, width1 - 1);
@@ -703,22 +1158,12 @@ subraster *rastcat(mimetex_ctx *mctx, subraster *sp1, subraster *sp2, int isfree
         fflush(mctx->msgfp);
     }            /* flush mctx->msgfp buffer */
     if (!mctx->isstring) {
-        int  fracbase = (isfrac ?     /* baseline for punc after \frac */
-                         /*adjust baseline or use original*/
-                         max2(mctx->fraccenterline, base2) : base);
-        rastput(mctx, rp, sp2->image, fracbase - base2, /* overlay right-hand */
+        rastput(mctx, rp, sp2->image, toprow[1], /* overlay right-hand */
                 /* minus any smashed space */
-                max2(0, width1 + space - nsmash), isopaque);
-        if (1 && type1 == FRACRASTER  /* we're done with \frac image */
-                &&   type2 != FRACRASTER)        /* unless we have \frac\frac */
-            /* so reset centerline signal */
-            mctx->fraccenterline = NOVALUE;
-        if (mctx->fraccenterline != NOVALUE)    /* sp2 is a fraction */
-            mctx->fraccenterline += (base - base2);
-    }  /* so adjust its centerline */
-    else {
-        strcpy((char *)(rp->pixmap) + width1 - 1 + space, (char *)((sp2->image)->pixmap));
-        ((char *)(rp->pixmap))[width1+width2+space-2] = '\000';
+                leftcol[1], isopaque);
+    } else {
+        strcpy((char *)(rp->pixmap) + leftcol[1], (char *)((sp2->image)->pixmap));
+        ((char *)(rp->pixmap))[leftcol[1] + width2 - 1] = '\000';
     } /*null-term*/
     if (mctx->msgfp != NULL && mctx->msglevel >= 9999) {
         /* display composite raster */
@@ -746,6 +1191,523 @@ end_of_job:
 } /* --- end-of-function rastcat() --- */
 
 
+/* ==========================================================================
+ * Function:    rastedges ( rp, firstcol, lastcol )
+ * Purpose: Finds the leftmost and rightmost set pixels in each row of rp
+ * --------------------------------------------------------------------------
+ * Arguments:   rp (I)      raster *  to bitmap whose rows are scanned
+ *      firstcol (O)    int * returning leftmost set col in each
+ *              of rp's rows, or -1 for empty rows,
+ *              or NULL if not wanted
+ *      lastcol (O) int * returning rightmost set col in each
+ *              of rp's rows, or -1 for empty rows,
+ *              or NULL if not wanted
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #non-empty rows
+ * --------------------------------------------------------------------------
+ * Notes:     o padded bitmap rows start on a word boundary, so empty
+ *      stretches are skipped 64 pixels at a time, and the first
+ *      (or last) set pixel is then found within its byte.
+ * ======================================================================= */
+/* --- entry point --- */
+static int rastedges(const raster *rp, int *firstcol, int *lastcol)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* row,col indexes, #non-empty rows */
+    int irow = 0, icol = 0, nrows = 0;
+    int width = rp->width,          /* #pixels in each row */
+        nbytes = (width + 7) / 8,   /* #bytes holding them */
+        lastmask = 0xff >> (8 * nbytes - width); /* pixels in last byte */
+    /* true to scan words rather than pixels */
+    int ispadded = (rp->pixsz == 1 && rp->stride > 0);
+    /* ------------------------------------------------------------
+    scan each row from the left, and then from the right
+    ------------------------------------------------------------ */
+    for (irow = 0; irow < rp->height; irow++) {
+        /* signal empty row */
+        int first = (-1), last = (-1);
+        if (ispadded) {               /* word-aligned bitmap row */
+            const pixbyte *row = bitmaprow(rp, irow);
+            int ibyte = 0, byte = 0;  /* row[] index, its masked value */
+            uint64_t word = 0;        /* 8 bytes of row[] */
+            for (ibyte = 0; ibyte < nbytes; ibyte++) {
+                if (ibyte % 8 == 0 && ibyte + 8 <= nbytes) { /* at a whole word */
+                    memcpy((void *)&word, (const void *)(row + ibyte), 8);
+                    if (word == 0) {
+                        ibyte += 7;
+                        continue;
+                    }
+                }                       /* skip empty word */
+                byte = row[ibyte] & (ibyte == nbytes - 1 ? lastmask : 0xff);
+                if (byte != 0) {        /* found leftmost non-empty byte */
+                    for (icol = 0; !get1bit(byte, icol); icol++) ;
+                    first = 8 * ibyte + icol;
+                    break;
+                }
+            } /* --- end-of-for(ibyte) --- */
+            if (first >= 0)           /* row isn't empty */
+                for (ibyte = nbytes - 1; ; ibyte--) {
+                    if (ibyte % 8 == 7 && ibyte - 7 > first / 8) { /* whole word */
+                        memcpy((void *)&word, (const void *)(row + ibyte - 7), 8);
+                        if (word == 0) {
+                            ibyte -= 7;
+                            continue;
+                        }
+                    }                     /* skip empty word */
+                    byte = row[ibyte] & (ibyte == nbytes - 1 ? lastmask : 0xff);
+                    if (byte != 0) {      /* found rightmost non-empty byte */
+                        for (icol = 7; !get1bit(byte, icol); icol--) ;
+                        last = 8 * ibyte + icol;
+                        break;
+                    }
+                } /* --- end-of-for(ibyte) --- */
+        } /* --- end-of-if(ispadded) --- */
+        else {                        /* bytemap, scanned a pixel at a time */
+            for (icol = 0; icol < width; icol++)
+                if (getpixel(rp, irow, icol) != 0) {
+                    first = icol;
+                    break;
+                }
+            for (icol = width - 1; first >= 0 && icol >= 0; icol--)
+                if (getpixel(rp, irow, icol) != 0) {
+                    last = icol;
+                    break;
+                }
+        }
+        if (firstcol != NULL) firstcol[irow] = first;
+        if (lastcol != NULL) lastcol[irow] = last;
+        if (first >= 0) nrows++;
+    } /* --- end-of-for(irow) --- */
+    return (nrows);
+} /* --- end-of-function rastedges() --- */
+
+
+/* ==========================================================================
+ * Function:    new_edgeprofile ( rp )
+ * Purpose: Allocation and constructor for the edge profile of rp
+ * --------------------------------------------------------------------------
+ * Arguments:   rp (I)      raster *  to bitmap whose edges are wanted
+ * --------------------------------------------------------------------------
+ * Returns: ( edgeprofile * ) ptr to rp's edge profile,
+ *              or NULL for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o describes rp's pixels as they are now, so it's only
+ *      attached to subrasters (sp->edges) whose image is never
+ *      modified, i.e., glyphs in the glyph cache.
+ *        o allocated from mctx->arena if there is one
+ * ======================================================================= */
+/* --- entry point --- */
+edgeprofile *new_edgeprofile(mimetex_ctx *mctx, const raster *rp)
+{
+    /* #bytes for edgeprofile struct followed by firstcol[], lastcol[] */
+    size_t  nbytes = sizeof(edgeprofile) + 2 * (rp->height + 1) * sizeof(int);
+    edgeprofile *ep = (edgeprofile *)(mctx->arena != NULL ?
+                                      arena_alloc(mctx->arena, nbytes) : malloc(nbytes));
+    if (ep != NULL) {                    /* allocate succeeded */
+        ep->image = rp;
+        ep->height = rp->height;
+        ep->firstcol = (int *)(ep + 1);
+        ep->lastcol = ep->firstcol + (rp->height + 1);
+        ep->nrows = rastedges(rp, ep->firstcol, ep->lastcol);
+    }
+    return (ep);
+} /* --- end-of-function new_edgeprofile() --- */
+
+
+/* ==========================================================================
+ * Function:    delete_edgeprofile ( ep )
+ * Purpose: Destructor for edge profile
+ * --------------------------------------------------------------------------
+ * Arguments:   ep (I)      ptr to edgeprofile to be deleted
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error).
+ * --------------------------------------------------------------------------
+ * Notes:     o an edge profile allocated from mctx->arena is left
+ *      for reset_arena() to release
+ * ======================================================================= */
+/* --- entry point --- */
+int delete_edgeprofile(mimetex_ctx *mctx, edgeprofile *ep)
+{
+    if (ep != NULL                        /* can't free null ptr */
+            &&   !arena_free(mctx->arena, (void *)ep)) /* nor arena memory */
+        free((void *)ep);
+    return (1);
+} /* --- end-of-function delete_edgeprofile() --- */
+
+
+/* ==========================================================================
+ * Function:    new_hlist ( sp )
+ * Purpose: Starts an hlist, i.e., a row of terms concatenated by
+ *      hlist_cat() as rastcat(sp,term,1) would, whose pixels
+ *      are painted only when hlist_box() is called.
+ * --------------------------------------------------------------------------
+ * Arguments:   sp (I)      subraster *  to leftmost term, which
+ *              the hlist takes over (don't free it)
+ * --------------------------------------------------------------------------
+ * Returns: ( hlist * ) ptr to newly-allocated hlist,
+ *              or NULL for any error (sp is freed).
+ * --------------------------------------------------------------------------
+ * Notes:     o rasterize() builds its expression in an hlist, so
+ *      that a long row of terms costs its total area rather
+ *      than one full copy of the left part per term.
+ * ======================================================================= */
+/* --- entry point --- */
+hlist *new_hlist(mimetex_ctx *mctx, subraster *sp)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* hlist returned to caller */
+    hlist   *hp = (hlist *)NULL;
+    /* ------------------------------------------------------------
+    allocate hlist, and adopt sp as its (already painted) composite
+    ------------------------------------------------------------ */
+    /* nothing to start with */
+    if (sp == NULL) goto end_of_job;
+    if ((hp = (hlist *)malloc(sizeof(hlist))) == NULL) { /* malloc failed */
+        /* so free sp as promised */
+        delete_subraster(mctx, sp);
+        goto end_of_job;
+    }
+    /* --- composite envelope is sp's --- */
+    memcpy((void *)&(hp->box), (void *)sp, sizeof(subraster));
+    hp->box.image = &(hp->dims);
+    if (sp->image != NULL)           /* composite dimensions are sp's */
+        memcpy((void *)&(hp->dims), (void *)(sp->image), sizeof(raster));
+    else
+        memset((void *)&(hp->dims), 0, sizeof(raster));
+    /* pixels are kept in painted */
+    hp->dims.pixmap = NULL;
+    hp->painted = sp;
+    /* --- no items until hlist_cat() needs them --- */
+    hp->rowshift = hp->colshift = 0;
+    hp->nitems = hp->maxitems = 0;
+    hp->items = (hlistitem *)NULL;
+    hp->lastcol = (int *)NULL;
+    hp->maxrows = 0;
+    /* found from painted pixels when needed */
+    hp->islastcol = 0;
+end_of_job:
+    return (hp);
+} /* --- end-of-function new_hlist() --- */
+
+
+/* ==========================================================================
+ * Function:    hlist_unpaint ( hp )
+ * Purpose: Turns hp's painted composite back into hp's only item,
+ *      so that further terms can be placed beside it
+ * --------------------------------------------------------------------------
+ * Arguments:   hp (I/O)    hlist *  whose painted composite is released
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error).
+ * --------------------------------------------------------------------------
+ * Notes:     o
+ * ======================================================================= */
+/* --- entry point --- */
+static int hlist_unpaint(mimetex_ctx *mctx, hlist *hp)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* painted composite */
+    subraster *sp = hp->painted;
+    /* ------------------------------------------------------------
+    release painted composite into a single item
+    ------------------------------------------------------------ */
+    /* nothing painted */
+    if (sp == NULL) return (1);
+    if (hp->maxitems < 1) {          /* first item */
+        if ((hp->items = (hlistitem *)malloc(16 * sizeof(hlistitem))) == NULL)
+            return (0);
+        hp->maxitems = 16;
+    }
+    /* --- painted pixels are now owned by the item --- */
+    hp->items[0].image = sp->image;
+    hp->items[0].isowned = 1;
+    hp->items[0].toprow = hp->items[0].leftcol = 0;
+    hp->items[0].nrows = (sp->image == NULL ? 0 : (sp->image)->height);
+    hp->nitems = 1;
+    hp->rowshift = hp->colshift = 0;
+    /* free envelope only */
+    sp->image = NULL;
+    delete_subraster(mctx, sp);
+    hp->painted = NULL;
+    return (1);
+} /* --- end-of-function hlist_unpaint() --- */
+
+
+/* ==========================================================================
+ * Function:    hlist_cat ( hp, sp )
+ * Purpose: Concatenates hp||sp exactly as rastcat(hp,sp,1) would,
+ *      but only records where sp goes, leaving sp unchanged.
+ * --------------------------------------------------------------------------
+ * Arguments:   hp (I/O)    hlist *  to left-hand terms
+ *      sp (I)      subraster *  to right-hand term
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error), in which case
+ *              hp should be deleted.
+ * --------------------------------------------------------------------------
+ * Notes:     o rastsmash() works from lastcol[], the composite's right
+ *      edge, which is kept up to date as terms are placed,
+ *      and sp's edges, which are scanned once (or, for glyphs,
+ *      come from the glyph cache).
+ *        o sp2 is only overlaid opaque when not smashing, and then
+ *      it lies entirely to the right of everything placed
+ *      earlier, so painting items transparently in turn gives
+ *      rastcat()'s pixels.
+ *        o ascii strings, bytemaps, and debugging output at
+ *      msglevel>=99 are concatenated eagerly with rastcat().
+ * ======================================================================= */
+/* --- entry point --- */
+int hlist_cat(mimetex_ctx *mctx, hlist *hp, subraster *sp)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* composite envelope and dimensions from rastcatlayout() */
+    subraster layout;
+    raster  dims;
+    /* eagerly concatenated composite */
+    subraster *leftsp = NULL, *catsp = NULL;
+    /* item for sp */
+    hlistitem *item = NULL;
+    /* edges of sp, cached or scanned (and freed at end_of_job) */
+    const edgeprofile *edges2 = NULL;
+    edgeprofile *found2 = NULL;
+    /* placement of composite, sp in new composite */
+    int toprow[2], leftcol[2], isopaque = 1;
+    int irow = 0, height1 = 0, status = 0;
+    int isdefer = (!mctx->isstring      /* not an ascii string */
+                   && hp->dims.pixsz == 1 && (sp->image)->pixsz == 1 /* bitmaps */
+                   && (mctx->msgfp == NULL || mctx->msglevel < 99));
+    /* ------------------------------------------------------------
+    concatenate eagerly if we can't defer painting
+    ------------------------------------------------------------ */
+    if (!isdefer) {
+        /* --- paint what we have, and rastcat() sp onto it --- */
+        if ((leftsp = hlist_subraster(mctx, hp)) == NULL) goto end_of_job;
+        catsp = rastcat(mctx, leftsp, sp, 0);
+        delete_subraster(mctx, leftsp);
+        if (catsp == NULL) goto end_of_job;
+        /* --- composite is now catsp --- */
+        memcpy((void *)&(hp->box), (void *)catsp, sizeof(subraster));
+        hp->box.image = &(hp->dims);
+        memcpy((void *)&(hp->dims), (void *)(catsp->image), sizeof(raster));
+        hp->dims.pixmap = NULL;
+        hp->painted = catsp;
+        hp->islastcol = 0;
+        status = 1;
+        goto end_of_job;
+    } /* --- end-of-if(!isdefer) --- */
+    /* ------------------------------------------------------------
+    make sure we have the composite's right edge, and room for sp
+    ------------------------------------------------------------ */
+    height1 = hp->dims.height;
+    if (!hp->islastcol) {            /* right edge not yet known */
+        if (hp->maxrows < height1) {   /* need more room */
+            int *lastcol = (int *)realloc(hp->lastcol, height1 * sizeof(int));
+            if (lastcol == NULL) goto end_of_job;
+            hp->lastcol = lastcol;
+            hp->maxrows = height1;
+        }
+        if (hlist_box(mctx, hp) == NULL) goto end_of_job;
+        rastedges((hp->painted)->image, NULL, hp->lastcol);
+        hp->islastcol = 1;
+    }
+    /* --- painted composite becomes an item --- */
+    if (!hlist_unpaint(mctx, hp)) goto end_of_job;
+    if (hp->nitems >= hp->maxitems) { /* need more items */
+        int maxitems = (hp->maxitems < 16 ? 16 : 2 * hp->maxitems);
+        hlistitem *items = (hlistitem *)realloc(hp->items, maxitems * sizeof(hlistitem));
+        if (items == NULL) goto end_of_job;
+        hp->items = items;
+        hp->maxitems = maxitems;
+    }
+    /* --- item keeps its own copy of sp's pixels, unless they're static --- */
+    item = &(hp->items[hp->nitems]);
+    item->isowned = (sp->type != CHARASTER && sp->type != GLYPHRASTER);
+    item->image = (item->isowned ? rastcpy(mctx, sp->image) : sp->image);
+    if (item->image == NULL) goto end_of_job;
+    /* --- edges of sp --- */
+    if ((edges2 = subrastedges(sp)) == NULL) { /* not a cached glyph */
+        if ((found2 = new_edgeprofile(mctx, sp->image)) == NULL) {
+            if (item->isowned) delete_raster(mctx, item->image);
+            goto end_of_job;
+        }
+        edges2 = found2;
+    }
+    /* ------------------------------------------------------------
+    lay out hp||sp, and place sp
+    ------------------------------------------------------------ */
+    layout.image = &dims;
+    if (!rastcatlayout(mctx, &(hp->box), hp->lastcol, sp, edges2, &layout,
+                       toprow, leftcol, &isopaque)) {
+        if (item->isowned) delete_raster(mctx, item->image);
+        goto end_of_job;
+    }
+    /* --- grow right edge to composite height --- */
+    if (hp->maxrows < dims.height) {
+        int *lastcol = (int *)realloc(hp->lastcol, dims.height * sizeof(int));
+        if (lastcol == NULL) {
+            if (item->isowned) delete_raster(mctx, item->image);
+            goto end_of_job;
+        }
+        hp->lastcol = lastcol;
+        hp->maxrows = dims.height;
+    }
+    /* --- shift earlier items by composite's placement --- */
+    hp->rowshift += toprow[0];
+    hp->colshift += leftcol[0];
+    memmove(hp->lastcol + toprow[0], hp->lastcol, height1 * sizeof(int));
+    for (irow = 0; irow < dims.height; irow++)
+        if (irow < toprow[0] || irow >= toprow[0] + height1)
+            /* row outside old composite */
+            hp->lastcol[irow] = (-1);
+        else if (hp->lastcol[irow] >= 0)
+            hp->lastcol[irow] += leftcol[0];
+    /* --- place sp, keeping only rows inside composite --- */
+    item->toprow  = toprow[1] - hp->rowshift;
+    item->leftcol = leftcol[1] - hp->colshift;
+    item->nrows   = max2(0, min2((sp->image)->height, dims.height - toprow[1]));
+    for (irow = 0; irow < item->nrows; irow++)
+        if (edges2->lastcol[irow] >= 0) /* row of sp isn't empty */
+            hp->lastcol[toprow[1] + irow] = max2(hp->lastcol[toprow[1] + irow],
+                                                 leftcol[1] + edges2->lastcol[irow]);
+    hp->nitems++;
+    /* --- composite envelope --- */
+    hp->box.type = layout.type;
+    hp->box.symdef = layout.symdef;
+    hp->box.baseline = layout.baseline;
+    hp->box.size = layout.size;
+    hp->dims.width = dims.width;
+    hp->dims.height = dims.height;
+    hp->dims.pixsz = dims.pixsz;
+    status = 1;
+end_of_job:
+    delete_edgeprofile(mctx, found2);
+    return (status);
+} /* --- end-of-function hlist_cat() --- */
+
+
+/* ==========================================================================
+ * Function:    hlist_box ( hp )
+ * Purpose: Paints hp's items into the composite subraster that
+ *      rastcat() would have returned
+ * --------------------------------------------------------------------------
+ * Arguments:   hp (I)      hlist *  to be painted
+ * --------------------------------------------------------------------------
+ * Returns: ( subraster * ) ptr to composite, which still belongs
+ *              to hp and is only valid until the next hlist_cat(),
+ *              or NULL for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o Repeated calls without hlist_cat() don't repaint.
+ * ======================================================================= */
+/* --- entry point --- */
+subraster *hlist_box(mimetex_ctx *mctx, hlist *hp)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* painted composite */
+    subraster *sp = NULL;
+    /* item rows lying inside composite */
+    raster  rows;
+    int iitem = 0, wasstring = mctx->isstring;
+    /* ------------------------------------------------------------
+    paint items, unless already painted
+    ------------------------------------------------------------ */
+    if (hp == NULL) goto end_of_job;
+    if ((sp = hp->painted) != NULL) goto end_of_job;
+    /* --- items were laid out as bitmaps, not ascii strings --- */
+    mctx->isstring = 0;
+    sp = new_subraster(mctx, hp->dims.width, hp->dims.height, hp->dims.pixsz);
+    mctx->isstring = wasstring;
+    if (sp == NULL) goto end_of_job;
+    sp->type = hp->box.type;
+    sp->symdef = hp->box.symdef;
+    sp->baseline = hp->box.baseline;
+    sp->size = hp->box.size;
+    for (iitem = 0; iitem < hp->nitems; iitem++) {
+        hlistitem *item = &(hp->items[iitem]);
+        if (item->nrows < 1) continue; /* clipped away entirely */
+        memcpy((void *)&rows, (void *)(item->image), sizeof(raster));
+        rows.height = item->nrows;
+        rastput(mctx, sp->image, &rows, item->toprow + hp->rowshift,
+                item->leftcol + hp->colshift, 0);
+        if (item->isowned)             /* no longer needed */
+            delete_raster(mctx, item->image);
+    } /* --- end-of-for(iitem) --- */
+    hp->nitems = 0;
+    hp->painted = sp;
+end_of_job:
+    return (sp);
+} /* --- end-of-function hlist_box() --- */
+
+
+/* ==========================================================================
+ * Function:    hlist_subraster ( hp )
+ * Purpose: Paints hp and hands its composite over to the caller
+ * --------------------------------------------------------------------------
+ * Arguments:   hp (I/O)    hlist *  to be painted, which is left empty
+ * --------------------------------------------------------------------------
+ * Returns: ( subraster * ) ptr to composite, which the caller
+ *              must delete_subraster(), or NULL for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o
+ * ======================================================================= */
+/* --- entry point --- */
+subraster *hlist_subraster(mimetex_ctx *mctx, hlist *hp)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* painted composite */
+    subraster *sp = hlist_box(mctx, hp);
+    /* ------------------------------------------------------------
+    detach composite from hp
+    ------------------------------------------------------------ */
+    if (sp != NULL)
+        hp->painted = NULL;
+    return (sp);
+} /* --- end-of-function hlist_subraster() --- */
+
+
+/* ==========================================================================
+ * Function:    delete_hlist ( hp )
+ * Purpose: Deallocates an hlist, its items and any painted composite
+ * --------------------------------------------------------------------------
+ * Arguments:   hp (I)      ptr to hlist struct to be deleted.
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully,
+ *              or 0 otherwise (for any error).
+ * --------------------------------------------------------------------------
+ * Notes:
+ * ======================================================================= */
+/* --- entry point --- */
+int delete_hlist(mimetex_ctx *mctx, hlist *hp)
+{
+    /* item index */
+    int iitem = 0;
+    if (hp != (hlist *)NULL) {           /* can't free null ptr */
+        for (iitem = 0; iitem < hp->nitems; iitem++)
+            if (hp->items[iitem].isowned)  /* our copy of item's pixels */
+                delete_raster(mctx, hp->items[iitem].image);
+        if (hp->items != NULL) free((void *)hp->items);
+        if (hp->lastcol != NULL) free((void *)hp->lastcol);
+        delete_subraster(mctx, hp->painted);
+        /* and free hlist struct itself */
+        free((void *)hp);
+    } /* --- end-of-if(hp!=NULL) --- */
+    /* back to caller, 1=okay 0=failed */
+    return (1);
+} /* --- end-of-function delete_hlist() --- */
+
+
 /* ==========================================================================
  * Function:    rastack ( sp1, sp2, base, space, iscenter, isfree )
  * Purpose: Stack subrasters sp2 atop sp1, leaving both unchanged
@@ -958,6 +1920,39 @@ end_of_job:
  * ======================================================================= */
 /* --- entry point --- */
 int rastsmash(mimetex_ctx *mctx, subraster *sp1, subraster *sp2)
+{
+    /* find sp1's right edge from its pixels */
+    return (rastsmashedge(mctx, sp1, NULL, sp2, NULL));
+} /* --- end-of-function rastsmash() --- */
+
+
+/* ==========================================================================
+ * Function:    rastsmashedge ( sp1, lastcol1, sp2, edges2 )
+ * Purpose: rastsmash() for an sp1 whose right edge, or an sp2 whose
+ *      left edge, may already be known
+ * --------------------------------------------------------------------------
+ * Arguments:   sp1 (I)     subraster *  to left-hand raster
+ *      lastcol1 (I)    int * to rightmost set col in each row
+ *              of sp1 (-1 if empty), or NULL to find them
+ *              from sp1's pixels
+ *      sp2 (I)     subraster *  to right-hand raster
+ *      edges2 (I)  edgeprofile * to edges of sp2's image,
+ *              or NULL to find them from sp2's pixels
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     max #pixels we can smash sp1||sp2,
+ *              or "mctx->blanksignal" if sp2 intentionally blank,
+ *              or 0 for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o sp1's pixels aren't looked at when lastcol1 is given,
+ *      so sp1 may be an hlist's unpainted box.
+ *        o glyphs carry their edges (see subrastedges()), so only
+ *      other images are ever scanned, by rastedges().
+ *        o There's no height limit.  Images taller than 1023 rows
+ *      (once left unsmashed) are smashed like any others.
+ * ======================================================================= */
+/* --- entry point --- */
+static int rastsmashedge(mimetex_ctx *mctx, subraster *sp1, int *lastcol1,
+                         subraster *sp2, const edgeprofile *edges2)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
@@ -968,16 +1963,17 @@ int rastsmash(mimetex_ctx *mctx, subraster *sp1, subraster *sp2)
         height1 = (sp1->image)->height, /* height for left-hand subraster */
         width1  = (sp1->image)->width,  /* width for left-hand subraster */
         base2   = sp2->baseline,    /*baseline for right-hand subraster*/
-        height2 = (sp2->image)->height, /* height for right-hand subraster */
-        width2  = (sp2->image)->width; /* width for right-hand subraster */
+        height2 = (sp2->image)->height; /* height for right-hand subraster */
     int base = max2(base1, base2),  /* max ascenders - 1 above baseline*/
         top1 = base - base1, top2 = base - base2, /* top irow indexes for sp1, sp2 */
-        bot1 = top1 + height1 - 1, bot2 = top2 + height2 - 1, /* bot irow indexes */
-        height = max2(bot1, bot2) + 1; /* total height */
-    /* row,col indexes */
-    int irow1 = 0, irow2 = 0, icol = 0;
-    int firstcol1[1025], nfirst1 = 0, /* 1st sp1 col containing set pixel*/
-        firstcol2[1025], nfirst2 = 0; /* 1st sp2 col containing set pixel*/
+        bot1 = top1 + height1 - 1, bot2 = top2 + height2 - 1; /* bot irow indexes */
+    /* row indexes */
+    int irow1 = 0, irow2 = 0;
+    int *firstcol2 = NULL, nfirst2 = 0, /* 1st sp2 col containing set pixel*/
+        nfirst1 = 0;            /* #sp1 rows containing set pixels */
+    /* cached edges of sp1, edges scanned here (and freed at end_of_job) */
+    const edgeprofile *edges1 = subrastedges(sp1);
+    int *found1 = NULL, *found2 = NULL;
     /* min separation (s=x+y) */
     int smin = 9999, xmin = 9999, ymin = 9999;
     /* ------------------------------------------------------------
@@ -988,29 +1984,23 @@ int rastsmash(mimetex_ctx *mctx, subraster *sp1, subraster *sp2)
     if (mctx->isstring) goto end_of_job;
     /* don't smash in text mode */
     if (0 && istextmode) goto end_of_job;
-    /* don't try to smash huge image */
-    if (height > 1023) goto end_of_job;
     if (sp2->type == mctx->blanksignal)        /*mctx->blanksignal was propagated to us*/
         /* don't smash intentional blank */
         goto end_of_job;
-    /* --- init firstcol1[], firstcol2[] --- */
-    for (irow1 = 0; irow1 < height; irow1++) /* for each row */
-        /* signal empty rows */
-        firstcol1[irow1] = firstcol2[irow1] = mctx->blanksignal;
-    /* --- set firstcol2[] indicating left edge of sp2 --- */
-    for (irow2 = top2; irow2 <= bot2; irow2++) {
-        /* for each row inside sp2 */
-        for (icol = 0; icol < width2; icol++) {
-             /* find first non-empty col in row */
-            if (getpixel(sp2->image, irow2 - top2, icol) != 0) {
-                /* found a set pixel */
-                /* icol is #cols from left edge */
-                firstcol2[irow2] = icol;
-                /* bump #rows containing set pixels*/
-                nfirst2++;
-                break;
-            } /* and go on to next row */
-        }
+    /* --- firstcol2[] indicating left edge of sp2 --- */
+    if (edges2 == NULL)              /* not given */
+        /* so use sp2's own, if it's a glyph */
+        edges2 = subrastedges(sp2);
+    if (edges2 != NULL) {            /* left edge already known */
+        firstcol2 = edges2->firstcol;
+        nfirst2 = edges2->nrows;
+    } else {
+        if ((found2 = (int *)(mctx->arena != NULL ? /* scan sp2's pixels */
+                              arena_alloc(mctx->arena, (height2 + 1) * sizeof(int)) :
+                              malloc((height2 + 1) * sizeof(int)))) == NULL)
+            goto end_of_job;
+        firstcol2 = found2;
+        nfirst2 = rastedges(sp2->image, firstcol2, NULL);
     }
     if (nfirst2 < 1) {           /*right-hand sp2 is completely blank*/
         /* signal intentional blanks */
@@ -1021,20 +2011,21 @@ int rastsmash(mimetex_ctx *mctx, subraster *sp1, subraster *sp2)
     if (sp1->type == mctx->blanksignal)        /*mctx->blanksignal was propagated to us*/
         /* don't smash intentional blank */
         goto end_of_job;
-    /* --- set firstcol1[] indicating right edge of sp1 --- */
-    for (irow1 = top1; irow1 <= bot1; irow1++) {
-        /* for each row inside sp1 */
-        for (icol = width1 - 1; icol >= 0; icol--) {
-            /* find last non-empty col in row */
-            if (getpixel(sp1->image, irow1 - top1, icol) != 0) {
-                /* found a set pixel */
-                /* save #cols from right edge */
-                firstcol1[irow1] = (width1 - 1) - icol;
-                /* bump #rows containing set pixels*/
-                nfirst1++;
-                break;
-            } /* and go on to next row */
-        }
+    /* --- lastcol1[] indicating right edge of sp1 --- */
+    if (lastcol1 != NULL)            /* right edge already known */
+        for (irow1 = 0; irow1 < height1; irow1++)
+            /* count non-empty rows */
+            nfirst1 += (lastcol1[irow1] >= 0);
+    else if (edges1 != NULL) {       /* sp1 is a glyph */
+        lastcol1 = edges1->lastcol;
+        nfirst1 = edges1->nrows;
+    } else {
+        if ((found1 = (int *)(mctx->arena != NULL ? /* scan sp1's pixels */
+                              arena_alloc(mctx->arena, (height1 + 1) * sizeof(int)) :
+                              malloc((height1 + 1) * sizeof(int)))) == NULL)
+            goto end_of_job;
+        lastcol1 = found1;
+        nfirst1 = rastedges(sp1->image, NULL, lastcol1);
     }
     if (nfirst1 < 1)             /*left-hand sp1 is completely blank*/
         /* don't smash intentional blanks */
@@ -1044,12 +2035,14 @@ int rastsmash(mimetex_ctx *mctx, subraster *sp1, subraster *sp2)
     ------------------------------------------------------------ */
     for (irow2 = top2; irow2 <= bot2; irow2++) { /* check each row inside sp2 */
         /* #cols to first set pixel */
-        int margin1, margin2 = firstcol2[irow2];
-        if (margin2 != mctx->blanksignal) {   /* irow2 not an empty/blank row */
+        int margin2 = firstcol2[irow2 - top2];
+        if (margin2 >= 0) {           /* irow2 not an empty/blank row */
             for (irow1 = max2(irow2 - smin, top1); ; irow1++)
                 /* upper bound check */
                 if (irow1 > min2(irow2 + smin, bot1)) break;
-                else if ((margin1 = firstcol1[irow1]) != mctx->blanksignal) { /*have non-blank row*/
+                else if (lastcol1[irow1 - top1] >= 0) { /*have non-blank row*/
+                    /* #cols from right edge */
+                    int margin1 = (width1 - 1) - lastcol1[irow1 - top1];
                     /* deltas */
                     int dx = (margin1 + margin2), dy = absval(irow2 - irow1), ds = dx + dy;
                     /* min unchanged */
@@ -1060,8 +2053,8 @@ int rastsmash(mimetex_ctx *mctx, subraster *sp1, subraster *sp2)
                     xmin = dx;
                     /* set new min */
                     ymin = dy;
-                } /* --- end-of-if(margin1!=mctx->blanksignal) --- */
-        } /* --- end-of-if(margin2!=mctx->blanksignal) --- */
+                } /* --- end-of-if(lastcol1[]>=0) --- */
+        } /* --- end-of-if(margin2>=0) --- */
         /* can't smash */
         if (smin < 2) goto end_of_job;
     } /* --- end-of-for(irow2) --- */
@@ -1072,6 +2065,11 @@ int rastsmash(mimetex_ctx *mctx, subraster *sp1, subraster *sp2)
     Back to caller with #pixels to smash sp1||sp2
     ------------------------------------------------------------ */
 end_of_job:
+    /* --- free scanned edges, most recent first --- */
+    if (found1 != NULL && !arena_free(mctx->arena, (void *)found1))
+        free((void *)found1);
+    if (found2 != NULL && !arena_free(mctx->arena, (void *)found2))
+        free((void *)found2);
     /* --- debugging output --- */
     if (mctx->msgfp != NULL && mctx->msglevel >= 99) { /* display for debugging */
         fprintf(mctx->msgfp, "rastsmash> nsmash=%d, mctx->smashmargin=%d\n",
@@ -1087,7 +2085,7 @@ end_of_job:
     }
     /* back with #smash pixels */
     return (nsmash);
-} /* --- end-of-function rastsmash() --- */
+} /* --- end-of-function rastsmashedge() --- */
 
 
 /* ==========================================================================
@@ -1206,6 +2204,8 @@ end_of_job:
  *              or NULL for any error.
  * --------------------------------------------------------------------------
  * Notes:     o if width or height <=0, embedded raster not allocated
+ *        o allocated from mctx->arena if there is one,
+ *      see new_raster()
  * ======================================================================= */
 /* --- entry point --- */
 subraster *new_subraster(mimetex_ctx *mctx, int width, int height, int pixsz)
@@ -1232,7 +2232,9 @@ subraster *new_subraster(mimetex_ctx *mctx, int width, int height, int pixsz)
     }
     /* --- allocate subraster struct --- */
     /* malloc subraster struct */
-    sp = (subraster *)malloc(sizeof(subraster));
+    sp = (subraster *)(mctx->arena != NULL ?
+                       arena_alloc(mctx->arena, sizeof(subraster)) :
+                       malloc(sizeof(subraster)));
     if (sp == (subraster *)NULL)         /* malloc failed */
         /* return error to caller */
         goto end_of_job;
@@ -1249,6 +2251,8 @@ subraster *new_subraster(mimetex_ctx *mctx, int width, int height, int pixsz)
     sp->toprow = sp->leftcol = (-1);
     /*ptr to bitmap image of subraster*/
     sp->image = (raster *)NULL;
+    /* no cached edge profile */
+    sp->edges = (edgeprofile *)NULL;
     /* ------------------------------------------------------------
     allocate raster and embed it in subraster, and return to caller
     ------------------------------------------------------------ */
@@ -1295,12 +2299,14 @@ int delete_subraster(mimetex_ctx *mctx, subraster *sp)
     ------------------------------------------------------------ */
     /* to delete embedded raster */
     if (sp != (subraster *)NULL) {       /* can't free null ptr */
-        if (sp->type != CHARASTER)         /* not static character data */
+        if (sp->type != CHARASTER          /* not static character data */
+                &&   sp->type != GLYPHRASTER)     /* nor shared decoded char */
             if (sp->image != NULL)       /*raster allocated within subraster*/
                 /* so free embedded raster */
                 delete_raster(mctx, sp->image);
         /* and free subraster struct itself*/
-        free((void *)sp);
+        if (!arena_free(mctx->arena, (void *)sp))
+            free((void *)sp);
     } /* --- end-of-if(sp!=NULL) --- */
     /* back to caller, 1=okay 0=failed */
     return (1);
@@ -1370,6 +2376,7 @@ subraster *subrastcpy(mimetex_ctx *mctx, subraster *sp)
         newsp->type = mctx->blanksignal;
         break;
     case IMAGERASTER:
+    case GLYPHRASTER:
     default:
         newsp->type = IMAGERASTER;
         break;
@@ -1381,5 +2388,43 @@ end_of_job:
 } /* --- end-of-function subrastcpy() --- */
 
 
+/* ==========================================================================
+ * Function:    subrastkeep ( sp )
+ * Purpose: lets sp escape mctx->arena, e.g., to outlive
+ *      the render it was rasterized by
+ * --------------------------------------------------------------------------
+ * Arguments:   sp (I)      ptr to subraster struct to be kept
+ * --------------------------------------------------------------------------
+ * Returns: ( subraster * ) sp itself if it's already malloc()'ed,
+ *              or a malloc()'ed copy of it (sp then belongs
+ *              to the arena, as before), or NULL for any error.
+ * --------------------------------------------------------------------------
+ * Notes:     o delete the returned subraster with delete_subraster()
+ *      as usual, whether or not mctx->arena has been reset by then
+ * ======================================================================= */
+/* --- entry point --- */
+subraster *subrastkeep(mimetex_ctx *mctx, subraster *sp)
+{
+    /* arena sp may have come from */
+    mimetex_arena *arena = mctx->arena;
+    /* malloc()'ed copy of sp */
+    subraster *keepsp = sp;
+    /* --- check whether sp or its image is in the arena --- */
+    if (sp == NULL || arena == NULL) goto end_of_job;
+    if (arena_block(arena, (void *)sp) == NULL /* malloc()'ed envelope */
+            && (sp->image == NULL           /* without image */
+                || sp->type == CHARASTER     /* or with a static one */
+                || sp->type == GLYPHRASTER   /* or cached one */
+                || arena_block(arena, (void *)(sp->image)) == NULL)) /* or malloc()'ed */
+        goto end_of_job;
+    /* --- copy it with the arena out of the way --- */
+    mctx->arena = (mimetex_arena *)NULL;
+    keepsp = subrastcpy(mctx, sp);
+    mctx->arena = arena;
+end_of_job:
+    return (keepsp);
+} /* --- end-of-function subrastkeep() --- */
+
+
 
 
@@ -212,7 +212,8 @@ subraster *accent_subraster(mimetex_ctx *mctx, int accent, int width, int height
                 !=  NULL) {             /* succeeded */
             /* "extract" raster with bitmap */
             rp = accsp->image;
-            free((void *)accsp);
+            accsp->image = NULL;
+            delete_subraster(mctx, accsp);
         }    /* and free subraster "envelope" */
         break;
         /* --- tilde request --- */
@@ -226,7 +227,8 @@ subraster *accent_subraster(mimetex_ctx *mctx, int accent, int width, int height
                 /* "extract" raster with bitmap */
                 rp = sp->image;
                 /* and free subraster "envelope" */
-                free((void *)sp);
+                sp->image = NULL;
+                delete_subraster(mctx, sp);
                 mctx->leftsymdef = NULL;
             }      /* so \tilde{x}^2 works properly */
         break;
@@ -324,7 +326,7 @@ subraster *arrow_subraster(mimetex_ctx *mctx, int width, int height, int pixsz,
                 if (ipix >= 0) {                  /* bounds check */
                     if (pixsz == 1)              /* have a bitmap */
                         /*turn on arrowhead bit*/
-                        setlongbit((arrowsp->image)->pixmap, ipix);
+                        setlongbit((arrowsp->image)->pixmap, PACKDEX(arrowsp->image, ipix));
                     else
                     /* should have a bytemap */
                         if (pixsz == 8)             /* check pixsz for bytemap */
@@ -341,7 +343,7 @@ subraster *arrow_subraster(mimetex_ctx *mctx, int width, int height, int pixsz,
                 if (ipix < npix) {            /* bounds check */
                     if (pixsz == 1)              /* have a bitmap */
                         /*turn on arrowhead bit*/
-                        setlongbit((arrowsp->image)->pixmap, ipix);
+                        setlongbit((arrowsp->image)->pixmap, PACKDEX(arrowsp->image, ipix));
                     else
                     /* should have a bytemap */
                         if (pixsz == 8)             /* check pixsz for bytemap */
@@ -424,7 +426,7 @@ subraster *uparrow_subraster(mimetex_ctx *mctx, int width, int height, int pixsz
                 if (ipix < npix) {            /* bounds check */
                     if (pixsz == 1)              /* have a bitmap */
                         /*turn on arrowhead bit*/
-                        setlongbit((arrowsp->image)->pixmap, ipix);
+                        setlongbit((arrowsp->image)->pixmap, PACKDEX(arrowsp->image, ipix));
                     else
                     /* should have a bytemap */
                         if (pixsz == 8)             /* check pixsz for bytemap */
@@ -439,7 +441,7 @@ subraster *uparrow_subraster(mimetex_ctx *mctx, int width, int height, int pixsz
                 if (ipix > 0) {           /* bounds check */
                     if (pixsz == 1)              /* have a bitmap */
                         /*turn on arrowhead bit*/
-                        setlongbit((arrowsp->image)->pixmap, ipix);
+                        setlongbit((arrowsp->image)->pixmap, PACKDEX(arrowsp->image, ipix));
                     else
                     /* should have a bytemap */
                         if (pixsz == 8)             /* check pixsz for bytemap */
@@ -543,7 +545,7 @@ int rule_raster(mimetex_ctx *mctx, raster *rp, int top, int left,
                     if (isdraw) {                  /*and we're drawing this bit*/
                         if (rp->pixsz == 1)              /* have a bitmap */
                             /* so turn on bit in line */
-                            setlongbit(rp->pixmap, ipix);
+                            setlongbit(rp->pixmap, PACKDEX(rp, ipix));
                         else
                         /* should have a bytemap */
                             if (rp->pixsz == 8)             /* check pixsz for bytemap */
@@ -680,7 +682,7 @@ int line_raster(mimetex_ctx *mctx, raster *rp, int row0, int col0,
             /* turn on pixel in line */
                 if (rp->pixsz == 1)              /* have a pixel bitmap */
                     /* so turn on bit in line */
-                    setlongbit(rp->pixmap, ipix);
+                    setlongbit(rp->pixmap, PACKDEX(rp, ipix));
                 else
                 /* should have a bytemap */
                     if (rp->pixsz == 8)             /* check pixsz for bytemap */
@@ -1463,7 +1465,8 @@ int type_raster(mimetex_ctx *mctx, raster *rp, FILE *fp)
     display ascii dump of bitmap image (in segments if display_width < rp->width)
     ------------------------------------------------------------ */
     if (rp->format == 2          /* input is .gf-formatted */
-            ||   rp->format == 3)
+            ||   rp->format == 3
+            ||   rp->stride == 0)    /* or packed texfonts.h bitmap */
         /* so convert it for display */
         bitmaprp = gftobitmap(mctx, rp);
     if (bitmaprp != NULL)            /* if we have image for display */
@@ -1484,7 +1487,7 @@ int type_raster(mimetex_ctx *mctx, raster *rp, FILE *fp)
                 /* --- allocations and declarations --- */
                 int ipix,               /* pixmap[] index for this scan */
                 /*first pixmap[] pixel in this scan*/
-                lopix = irow * rp->width + locol;
+                lopix = PIXDEX(bitmaprp, irow, locol);
                 /* --- set chars in scanline[] based on pixels in rp->pixmap[] --- */
                 for (ipix = 0; ipix < scan_width; ipix++) /* set each char */
                     if (bitmaprp->pixsz == 1)      /*' '=0 or '*'=1 to display bitmap*/
@@ -1504,8 +1507,7 @@ int type_raster(mimetex_ctx *mctx, raster *rp, FILE *fp)
     /* ------------------------------------------------------------
     Back to caller with 1=okay, 0=failed.
     ------------------------------------------------------------ */
-    if (rp->format == 2          /* input was .gf-format */
-            ||   rp->format == 3)
+    if (bitmaprp != rp)              /* input was .gf-format or packed */
         if (bitmaprp != NULL)          /* and we converted it for display */
             /* no longer needed, so free it */
             delete_raster(mctx, bitmaprp);
@@ -1517,15 +1519,17 @@ int type_raster(mimetex_ctx *mctx, raster *rp, FILE *fp)
  * Function:    gftobitmap ( gf )
  * Purpose: convert .gf-like pixmap to bitmap image
  * --------------------------------------------------------------------------
- * Arguments:   gf (I)      raster * to struct in .gf-format
+ * Arguments:   gf (I)      raster * to struct in .gf-format,
+ *              or to a packed texfonts.h bitmap
  * --------------------------------------------------------------------------
  * Returns: ( raster * )    image-format raster * if successful,
  *              or NULL for any error.
  * --------------------------------------------------------------------------
- * Notes:     o
+ * Notes:     o the returned bitmap's rows are padded to BITSTRIDE,
+ *      like every other new_raster() bitmap
  * ======================================================================= */
 /* --- entry point --- */
-raster  *gftobitmap(mimetex_ctx *mctx, raster *gf)
+raster  *gftobitmap(mimetex_ctx *mctx, const raster *gf)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
@@ -1548,6 +1552,17 @@ raster  *gftobitmap(mimetex_ctx *mctx, raster *gf)
     if (gf == NULL) goto end_of_job;
     /* 2 or 3 */
     format = gf->format;
+    /* --- packed bitmap just needs its rows padded --- */
+    if (format == 1 && gf->pixsz == 1 && gf->stride == 0) {
+        int irow = 0, icol = 0;
+        if ((rp = new_raster(mctx, gf->width, gf->height, 1)) == NULL)
+            goto end_of_job;
+        for (irow = 0, ibit = 0; irow < gf->height; irow++)
+            for (icol = 0; icol < gf->width; icol++, ibit++)
+                if (getlongbit(gf->pixmap, ibit))
+                    setlongbit(rp->pixmap, PIXDEX(rp, irow, icol));
+        goto end_of_job;
+    }
     /* invalid raster format */
     if (format != 2 && format != 3) goto end_of_job;
     /*pixsz is really #counts in pixmap*/
@@ -1590,9 +1605,9 @@ raster  *gftobitmap(mimetex_ctx *mctx, raster *gf)
             if (ibit >= totbits) goto end_of_job;
             for (irepeat = 0; irepeat <= nrepeats; irepeat++)
                 if (bitval == 1) {        /* set pixel */
-                    setlongbit(rp->pixmap, (ibit + irepeat*width));
+                    setlongbit(rp->pixmap, PACKDEX(rp, (ibit + irepeat*width)));
                 } else {          /* clear pixel */
-                    unsetlongbit(rp->pixmap, (ibit + irepeat*width));
+                    unsetlongbit(rp->pixmap, PACKDEX(rp, (ibit + irepeat*width)));
                 }
             /* count another repeated bit */
             if (nrepeats > 0) wbits++;
@@ -1648,6 +1663,8 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
     /* display debugging output */
     subraster *sp = NULL, *prevsp = NULL, /* raster for current, prev char */
               *expraster = (subraster *)NULL; /* raster returned to caller */
+    /* atoms concatenated so far */
+    hlist   *exphlist = (hlist *)NULL;
     /* current font family */
     int family = fontinfo[mctx->fontnum].family;
     int isleftscript = 0,       /* true if left-hand term scripted */
@@ -1655,8 +1672,6 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
                                      /* true if preceding delim scripted*/
                                      wasdelimscript = 0;
     /*int   pixsz = 1;*/            /*default #bits per pixel, 1=bitmap*/
-    /* detex token for error message */
-    char    *strdetex();
     /* --- global values saved/restored at each recursive iteration --- */
     int wasstring = mctx->isstring,       /* initial mctx->isstring mode flag */
         wasdisplaystyle = mctx->isdisplaystyle, /*initial displaystyle mode flag*/
@@ -1669,8 +1684,8 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
         oldisexplicitsmash = mctx->isexplicitsmash, /* initial mctx->isexplicitsmash */
         oldisscripted = mctx->isscripted, /* initial mctx->isscripted */
         *oldworkingparam = mctx->workingparam; /* initial working parameter */
-    subraster *oldworkingbox = mctx->workingbox,  /* initial working box */
-              *oldleftexpression = mctx->leftexpression; /*left half rasterized so far*/
+    subraster *oldworkingbox = mctx->workingbox;  /* initial working box */
+    hlist   *oldlefthlist = mctx->lefthlist; /*left half rasterized so far*/
     double  oldunitlength = mctx->unitlength; /* initial mctx->unitlength */
     mathchardef *oldleftsymdef = mctx->leftsymdef; /* init oldleftsymdef */
     /* ------------------------------------------------------------
@@ -1679,7 +1694,7 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
     /* wind up one more recursion level*/
     mctx->recurlevel++;
     /* no leading left half yet */
-    mctx->leftexpression = NULL;
+    mctx->lefthlist = NULL;
     /* reset replaceleft flag */
     mctx->isreplaceleft = 0;
     /* reset \frac baseline signal */
@@ -1719,8 +1734,8 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
         family = fontinfo[mctx->fontnum].family;
         if (family == CYR10)       /* may have cyrillic \= ligature */
             if ((symdef = get_ligature(mctx, expression, family)) /*check for any ligature*/
-                    >=    0)                 /* got some ligature */
-                if (memcmp(symdef->symbol, "\\=", 2) == 0) /* starts with \= */
+                    !=    NULL)              /* got some ligature */
+                if (strncmp(symdef->symbol, "\\=", 2) == 0) /* starts with \= */
                     /* signal \= ligature */
                     mctx->isligature = 1;
         /* --- get next character/token or subexpression --- */
@@ -1823,7 +1838,7 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
                             /* init error message token */
                             strcpy(literal, "{\\rm~[");
                             /* detex the token */
-                            strcat(literal, strdetex(chartoken, 0));
+                            strcat(literal, strdetex(mctx, chartoken, 0));
                             strcat(literal, "?]}");
                         } /* add closing ? and brace */
                         /* rasterize literal token */
@@ -1894,13 +1909,13 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
         }         /* flush mctx->msgfp buffer */
         /* --- accumulate atom or parenthesized subexpression --- */
         if (natoms < 1             /* nothing previous to concat */
-                ||   expraster == NULL        /* or previous was complete error */
+                ||   exphlist == NULL         /* or previous was complete error */
                 ||   mctx->isreplaceleft) {         /* or we're replacing previous */
-            if (1 && expraster != NULL)    /* probably replacing left */
+            if (1 && exphlist != NULL)     /* probably replacing left */
                 /* so first free original left */
-                delete_subraster(mctx, expraster);
+                delete_hlist(mctx, exphlist);
             /* copy static CHARASTER or left */
-            expraster = subrastcpy(mctx, sp);
+            exphlist = new_hlist(mctx, subrastcpy(mctx, sp));
             mctx->isreplaceleft = 0;
         }      /* reset replacement flag */
         else
@@ -1913,8 +1928,11 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
                     mctx->isdelimscript = 0;
                     if (!mctx->isexplicitsmash) mctx->smashmargin = 0;
                 } /* signal no smash wanted */
-                /* concat new term, free previous */
-                expraster = rastcat(mctx, expraster, sp, 1);
+                /* concat new term (painted when needed) */
+                if (!hlist_cat(mctx, exphlist, sp)) {
+                    delete_hlist(mctx, exphlist);
+                    exphlist = NULL;
+                }
                 mctx->smashmargin = prevsmashmargin;
             }    /* restore current smash margin */
         /* free prev (if not a CHARASTER) */
@@ -1922,7 +1940,7 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
         /* current becomes previous */
         prevsp = sp;
         /* left half rasterized so far */
-        mctx->leftexpression = expraster;
+        mctx->lefthlist = exphlist;
         /* --- bump count --- */
         /* bump #atoms count */
         natoms++;
@@ -1933,6 +1951,11 @@ subraster *rasterize(mimetex_ctx *mctx, char *expression, int size)
 end_of_job:
     /* free last (if not a CHARASTER) */
     delete_subraster(mctx, prevsp);
+    /* --- paint atoms concatenated so far --- */
+    if (exphlist != NULL) {          /* i.e., if natoms>0 */
+        expraster = hlist_subraster(mctx, exphlist);
+        delete_hlist(mctx, exphlist);
+    }
     /* --- debugging output --- */
     if (mctx->msgfp != NULL && mctx->msglevel >= 999) { /* display raster for debugging */
         fprintf(mctx->msgfp, "rasterize> Final recursion level=%d, atom#%d...\n",
@@ -1979,8 +2002,8 @@ end_of_job:
     mctx->workingparam = oldworkingparam;
     /* working box reset */
     mctx->workingbox = oldworkingbox;
-    /* mctx->leftexpression reset */
-    mctx->leftexpression = oldleftexpression;
+    /* mctx->lefthlist reset */
+    mctx->lefthlist = oldlefthlist;
     /* mctx->leftsymdef reset */
     mctx->leftsymdef = oldleftsymdef;
     /* mctx->unitlength reset */
@@ -1992,6 +2015,27 @@ end_of_job:
 } /* --- end-of-function rasterize() --- */
 
 
+/* ==========================================================================
+ * Function:    get_leftexpression ( )
+ * Purpose: returns the left half of the expression rasterize()
+ *      has concatenated so far, for handlers that need it
+ * --------------------------------------------------------------------------
+ * Arguments:   none
+ * --------------------------------------------------------------------------
+ * Returns: ( subraster * ) ptr to left half, which belongs to
+ *              rasterize() and mustn't be freed or kept past the
+ *              handler's return, or NULL if there's none.
+ * --------------------------------------------------------------------------
+ * Notes:     o The left half is only painted when asked for.
+ * ======================================================================= */
+/* --- entry point --- */
+subraster *get_leftexpression(mimetex_ctx *mctx)
+{
+    /* painted left half, or NULL */
+    return (hlist_box(mctx, mctx->lefthlist));
+} /* --- end-of-function get_leftexpression() --- */
+
+
 /* ==========================================================================
  * Function:    rastparen ( subexpr, size, basesp )
  * Purpose: parentheses handler, returns a subraster corresponding to
@@ -2054,7 +2098,7 @@ subraster *rastparen(mimetex_ctx *mctx, char **subexpr, int size, subraster *bas
     /* null-terminate before right} */
     noparens[explen-(1+isescape)] = '\000';
     /* and then squeeze out left{ */
-    strcpy(noparens, noparens + (1 + isescape));
+    strsqueeze(noparens, 1 + isescape);
     /* --- rasterize it --- */
     if ((sp = rasterize(mctx, noparens, size)) /*rasterize "interior" of expression*/
             /* quit if failed */
@@ -2097,9 +2141,9 @@ subraster *rastparen(mimetex_ctx *mctx, char **subexpr, int size, subraster *bas
         /* if failed, free subraster */
         delete_subraster(mctx, sp);
         /*free left-paren subraster envelope*/
-        if (lp != NULL) free((void *)lp);
+        if (lp != NULL) delete_subraster(mctx, lp);
         /*and right-paren subraster envelope*/
-        if (rp != NULL) free((void *)rp);
+        if (rp != NULL) delete_subraster(mctx, rp);
         /* signal error to caller */
         sp = (subraster *)NULL;
         goto end_of_job;
@@ -2187,8 +2231,8 @@ subraster *rastlimits(mimetex_ctx *mctx, char **expression, int size, subraster
         exprptr = texchar(mctx, exprptr, limtoken);
     if (*limtoken != '\000')         /* have token */
         if ((toklen = strlen(limtoken)) >= 3)   /* which may be \[no]limits */
-            if (memcmp("\\limits", limtoken, toklen) == 0    /* may be \limits */
-                    ||   memcmp("\\nolimits", limtoken, toklen) == 0) /* or may be \nolimits */
+            if (strncmp("\\limits", limtoken, toklen) == 0   /* may be \limits */
+                    ||   strncmp("\\nolimits", limtoken, toklen) == 0) /* or may be \nolimits */
                 if ((tokdef = get_symdef(mctx, limtoken))   /* look up token to be sure */
                         !=   NULL) {             /* found token in table */
                     if (strcmp("\\limits", tokdef->symbol) == 0)   /* found \limits */
@@ -2398,7 +2442,7 @@ subraster *rastscripts(mimetex_ctx *mctx, char **expression, int size, subraster
     /* --- get height and baseline of base, and descender of base and sub --- */
     if (basesp == (subraster *)NULL)     /* no base symbol for scripts */
         /* try using left side thus far */
-        basesp = mctx->leftexpression;
+        basesp = get_leftexpression(mctx);
     if (basesp != (subraster *)NULL) {   /* we have base symbol for scripts */
         /* height of base symbol */
         baseht   = (basesp->image)->height;
@@ -2630,7 +2674,7 @@ subraster *rastleft(mimetex_ctx *mctx, char **expression, int size, subraster *b
     int istextleft = 0, istextright = 0;
     /* --- recognized delimiters --- */
     /* tex delimiters */
-    static  char left[16] = "\\left", right[16] = "\\right";
+    char    left[16] = "\\left", right[16] = "\\right";
     static  char *ldelims[] = {
         "unused", ".",           /* 1   for \left., \right. */
         "(", ")",           /* 2,3 for \left(, \right) */
@@ -2784,7 +2828,7 @@ subraster *rastleft(mimetex_ctx *mctx, char **expression, int size, subraster *b
             margin += opmargin;
             if (*ldelim == '\\')       /* have leading escape */
                 /* squeeze it out */
-                strcpy(ldelim, ldelim + 1);
+                strsqueeze(ldelim, 1);
             break;
         }              /* no need to check rest of table */
     /* --- xlate delimiters and check for textstyle --- */
@@ -2876,9 +2920,9 @@ subraster *rastleft(mimetex_ctx *mctx, char **expression, int size, subraster *b
         if ((lp == NULL && !isleftdot)      /* check that we got left( */
                 || (rp == NULL && !isrightdot)) {  /* and right) if needed */
             /* free \left-delim subraster */
-            if (lp != NULL) free((void *)lp);
+            if (lp != NULL) delete_subraster(mctx, lp);
             /* and \right-delim subraster */
-            if (rp != NULL) free((void *)rp);
+            if (rp != NULL) delete_subraster(mctx, rp);
             if (0) {
                 /* if failed, free subraster */
                 delete_subraster(mctx, sp);
@@ -2986,7 +3030,7 @@ subraster *rastmiddle(mimetex_ctx *mctx, char **expression, int size, subraster
     initialization
     ------------------------------------------------------------ */
     /* expressn preceding 1st \middle */
-    subsp[0] = mctx->leftexpression;
+    subsp[0] = get_leftexpression(mctx);
     /* set first null */
     subsp[1] = NULL;
     /* ------------------------------------------------------------
@@ -3016,6 +3060,8 @@ subraster *rastmiddle(mimetex_ctx *mctx, char **expression, int size, subraster
         /* --- get subexpression between \delim and next \middle --- */
         /* no subexpresion yet */
         subsp[ndelims] = NULL;
+        /* nor delim after it (loop below reads delim[ndelims]) */
+        *(delim[ndelims]) = '\000';
         if (*exprptr == '\000')        /* end-of-expression after \delim */
             /* so we have all subexpressions */
             break;
@@ -3055,7 +3101,7 @@ subraster *rastmiddle(mimetex_ctx *mctx, char **expression, int size, subraster
                 sp = subsp[idelim];
                 if (idelim == 0)
                     sp = subrastcpy(mctx, sp);
-            } /* or copy mctx->leftexpression */
+            } /* or copy left expression */
             else sp = rastcat(mctx, sp, subsp[idelim], (idelim > 0 ? 3 : 1));
         } /* or concat it */
         /* --- now construct delimiter --- */
@@ -3124,8 +3170,6 @@ subraster *rastflags(mimetex_ctx *mctx, char **expression, int size, subraster *
         valuelen = 0; /* strlen(valuearg) */
     /*convert ascii {valuearg} to double*/
     double  dblvalue = (-99.), strtod();
-    /* \displaystyle set at mctx->recurlevel */
-    static  int displaystylelevel = (-99);
     /* ------------------------------------------------------------
     set flag or value
     ------------------------------------------------------------ */
@@ -3146,7 +3190,7 @@ subraster *rastflags(mimetex_ctx *mctx, char **expression, int size, subraster *
         /* set string/image mode */
     case ISDISPLAYSTYLE:          /* set \displaystyle mode */
         /* \displaystyle set at mctx->recurlevel */
-        displaystylelevel = mctx->recurlevel;
+        mctx->displaystylelevel = mctx->recurlevel;
         mctx->isdisplaystyle = value;
         break;
     case ISOPAQUE:
@@ -3193,10 +3237,10 @@ subraster *rastflags(mimetex_ctx *mctx, char **expression, int size, subraster *
                     if (!isthischar(*valuearg, "?")) { /*leading ? is query for value*/
                         /* leading + or - */
                         isdelta = isthischar(*valuearg, "+-");
-                        if (memcmp(valuearg, "--", 2) == 0) { /* leading -- signals...*/
+                        if (strncmp(valuearg, "--", 2) == 0) { /* leading -- signals...*/
                             /* ...not delta */
                             isdelta = 0;
-                            strcpy(valuearg, valuearg + 1);
+                            strsqueeze(valuearg, 1);
                         }
                         switch (flag) {         /* convert to double or int */
                         default:
@@ -3241,14 +3285,14 @@ subraster *rastflags(mimetex_ctx *mctx, char **expression, int size, subraster *
                 if (mctx->isdisplaystyle == 1  /* displaystyle enabled but not set*/
                         || (1 && mctx->isdisplaystyle == 2) /* displaystyle enabled and set */
                         || (0 && mctx->isdisplaystyle == 0))/*\textstyle disabled displaystyle*/
-                    if (displaystylelevel != mctx->recurlevel)   /*respect \displaystyle*/
+                    if (mctx->displaystylelevel != mctx->recurlevel)   /*respect \displaystyle*/
                         if (!mctx->ispreambledollars)  {   /* respect $$...$$'s */
                             if (mctx->fontsize >= mctx->displaysize)
                                 /* forced */
                                 mctx->isdisplaystyle = 2;
                             else mctx->isdisplaystyle = 1;
                         }
-                /*displaystylelevel = (-99);*/
+                /*mctx->displaystylelevel = (-99);*/
             } /* reset \displaystyle level */
             else {              /* embed font size in expression */
                 /* convert size */
@@ -3446,22 +3490,24 @@ subraster *rastspace(mimetex_ctx *mctx, char **expression, int size, subraster *
     first check for negative space
     ------------------------------------------------------------ */
     if (width < 0) {             /* have negative hspace */
-        if (mctx->leftexpression != (subraster *)NULL)   /* can't backspace */
+        /* left half to be backspaced */
+        subraster *leftsp = get_leftexpression(mctx);
+        if (leftsp != (subraster *)NULL)   /* can't backspace */
             if ((spacesp = new_subraster(mctx, 0, 0, 0)) /* get new subraster for backspace */
                     !=   NULL) {              /* and if we succeed... */
                 /*#pixels wanted,actually backspaced*/
                 int nback = (-width), pback;
-                if ((bp = backspace_raster(mctx, mctx->leftexpression->image, nback, &pback, minspace, 0))
+                if ((bp = backspace_raster(mctx, leftsp->image, nback, &pback, minspace, 0))
                         !=    NULL) {            /* and if backspace succeeds... */
                     /* save backspaced image */
                     spacesp->image = bp;
-                    /*spacesp->type = mctx->leftexpression->type;*/ /* copy original type */
+                    /*spacesp->type = leftsp->type;*/ /* copy original type */
                     /* need to propagate blanks */
                     spacesp->type = mctx->blanksignal;
                     /* copy original font size */
-                    spacesp->size = mctx->leftexpression->size;
+                    spacesp->size = leftsp->size;
                     /* and baseline */
-                    spacesp->baseline = mctx->leftexpression->baseline;
+                    spacesp->baseline = leftsp->baseline;
                     /* wanted more than we got */
                     mctx->blanksymspace += -(nback - pback);
                     mctx->isreplaceleft = 1;
@@ -3479,9 +3525,11 @@ subraster *rastspace(mimetex_ctx *mctx, char **expression, int size, subraster *
     ------------------------------------------------------------ */
     if (isfill               /* called as \hfill{} */
             &&   !isheight) {           /* parameter conflict */
-        if (mctx->leftexpression != NULL)   /* if we have left half */
+        /* left half, if we have one */
+        subraster *leftsp = get_leftexpression(mctx);
+        if (leftsp != NULL)   /* if we have left half */
             /*reduce left width from total*/
-            width -= (mctx->leftexpression->image)->width;
+            width -= (leftsp->image)->width;
         if ((rightsp = rasterize(mctx, *expression, size)) /* rasterize right half */
                 != NULL)                 /* succeeded */
             width -= (rightsp->image)->width;
@@ -3559,6 +3607,8 @@ subraster *rastnewline(mimetex_ctx *mctx, char **expression, int size, subraster
     subraster *newlsp = NULL;
     /*rasterize right half of expression*/
     subraster *rightsp = NULL;
+    /* left half rasterized so far */
+    subraster *leftsp = NULL;
     char spacexpr[129]/*, *xptr=spacexpr*/; /*for \\[vspace]*/
     /* convert ascii param to double */
     /* #pixels between lines */
@@ -3576,7 +3626,7 @@ subraster *rastnewline(mimetex_ctx *mctx, char **expression, int size, subraster
         vspace = iround(mctx->unitlength * strtod(spacexpr, NULL));
     } /* --- end-of-if(*(*expression)=='[') --- */
     /* nothing preceding \\ */
-    if (mctx->leftexpression == NULL) goto end_of_job;
+    if ((leftsp = get_leftexpression(mctx)) == NULL) goto end_of_job;
     /* ------------------------------------------------------------
     rasterize right half of expression and stack left half above it
     ------------------------------------------------------------ */
@@ -3585,9 +3635,9 @@ subraster *rastnewline(mimetex_ctx *mctx, char **expression, int size, subraster
             /* quit if failed */
             == NULL) goto end_of_job;
     /* --- stack left half above it --- */
-    /*newlsp = rastack(rightsp,mctx->leftexpression,1,vspace,0,3);*//*right under left*/
+    /*newlsp = rastack(rightsp,leftsp,1,vspace,0,3);*//*right under left*/
     /*right under left*/
-    newlsp = rastack(mctx, rightsp, mctx->leftexpression, 1, vspace, 0, 1);
+    newlsp = rastack(mctx, rightsp, leftsp, 1, vspace, 0, 1);
     /* --- back to caller --- */
 end_of_job:
     if (newlsp != NULL) {          /* returning entire expression */
@@ -4818,8 +4868,6 @@ subraster *rastbegin(mimetex_ctx *mctx, char **expression, int size, subraster *
     int nbegins = 0;
     /* #chars in environ, subexpr */
     int envlen = 0, sublen = 0;
-    /* \begin...\end nesting level */
-    static  int blevel = 0;
     static  char *mdelims[] = {
         NULL, NULL, NULL, NULL,
         "()", "[]", "{}", "||", "==",   /* for pbBvVmatrix */
@@ -4865,14 +4913,14 @@ subraster *rastbegin(mimetex_ctx *mctx, char **expression, int size, subraster *
     ------------------------------------------------------------ */
     /* --- first bump nesting level --- */
     /* count \begin...\begin...'s */
-    blevel++;
+    mctx->blevel++;
     /* --- \begin must be followed by {type_of_environment} --- */
     exprptr = texsubexpr(mctx, *expression, subexpr, 0, "{", "}", 0, 0);
     /* no environment given */
     if (*subexpr == '\000') goto end_of_job;
     while ((delims = strchr(subexpr, '*')) != NULL) /* have environment* */
         /* treat it as environment */
-        strcpy(delims, delims + 1);
+        strsqueeze(delims, 1);
     /* --- look up environment in our table --- */
     for (ienviron = 0; ; ienviron++)     /* search table till NULL */
         if (environs[ienviron] == NULL)    /* found NULL before match */
@@ -4880,7 +4928,7 @@ subraster *rastbegin(mimetex_ctx *mctx, char **expression, int size, subraster *
             goto end_of_job;
         else
         /* see if we have an exact match */
-            if (memcmp(environs[ienviron], subexpr, strlen(subexpr)) == 0) /*match*/
+            if (strncmp(environs[ienviron], subexpr, strlen(subexpr)) == 0) /*match*/
                 /* leave loop with ienviron index */
                 break;
     /* --- accumulate any additional params for this environment --- */
@@ -5019,7 +5067,7 @@ subraster *rastbegin(mimetex_ctx *mctx, char **expression, int size, subraster *
     change nested \begin...\end to {\begin...\end} so \array{} can handle them
     ------------------------------------------------------------ */
     if (nbegins > 0)             /* have nested begins */
-        if (blevel < 2) {           /* only need to do this once */
+        if (mctx->blevel < 2) {           /* only need to do this once */
             /* start at beginning of subexpr */
             begptr = subexpr;
             while ((begptr = strstr(begptr, begtoken)) != NULL) { /* have \begin{...} */
@@ -5100,7 +5148,7 @@ subraster *rastbegin(mimetex_ctx *mctx, char **expression, int size, subraster *
     sp = rasterize(mctx, subexpr, size);
 end_of_job:
     /* decrement \begin nesting level */
-    blevel--;
+    mctx->blevel--;
     /* back to caller with sp or NULL */
     return (sp);
 } /* --- end-of-function rastbegin() --- */
@@ -5217,43 +5265,13 @@ subraster *rastarray(mimetex_ctx *mctx, char **expression, int size, subraster *
         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
         0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
     };
-    /* --- propagate global values across arrays --- */
-    static int gjustify[65] = {
-        /* -1,0,+1 = l,c,r */
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-    };
-    static int gcolwidth[65] = {
-        /*widest tokn in col*/
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-    };
-    static int growheight[65] = {
-        /* "highest" in row */
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-    };
-    static int gfixcolsize[65] = {
-        /*1=fixed col width*/
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-    };
-    static int gfixrowsize[65] = {
-        /*1=fixed row height*/
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-    },
-    growcenter[65] = {
-        /*true = vcenter row*/
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
-    };
+    /* --- propagate global values across arrays (kept in mctx) --- */
+    int *gjustify = mctx->gjustify,    /* -1,0,+1 = l,c,r */
+        *gcolwidth = mctx->gcolwidth,  /*widest tokn in col*/
+        *growheight = mctx->growheight, /* "highest" in row */
+        *gfixcolsize = mctx->gfixcolsize, /*1=fixed col width*/
+        *gfixrowsize = mctx->gfixrowsize, /*1=fixed row height*/
+        *growcenter = mctx->growcenter; /*true = vcenter row*/
     int rowglobal = 0, colglobal = 0,   /* true to set global values */
         rowpropagate = 0, colpropagate = 0; /* true if propagating values */
     int irow, nrows = 0, icol, ncols[65], /*#rows in array, #cols in each row*/
@@ -5576,7 +5594,7 @@ subraster *rastarray(mimetex_ctx *mctx, char **expression, int size, subraster *
                             /* extra vspace before this row */
                             vrowspace[nrows] = len;
                             /* flush [len] from token */
-                            strcpy(token, tokptr);
+                            strsqueeze(token, tokptr - token);
                             tokptr = token;
                             skipwhite(tokptr);
                         }
@@ -5588,10 +5606,10 @@ subraster *rastarray(mimetex_ctx *mctx, char **expression, int size, subraster *
                 /* length of first char */
                 hltoklen = strlen(hltoken);
                 if (hltoklen >= minhltoklen) {     /*token must be at least \hl or \hd*/
-                    if (memcmp(hlchar, hltoken, hltoklen) == 0) /* we have an \hline */
+                    if (strncmp(hlchar, hltoken, hltoklen) == 0) /* we have an \hline */
                         /* bump \hline count for row */
                         hline[nrows] += 1;
-                    else if (memcmp(hdchar, hltoken, hltoklen) == 0) /*we have an \hdash*/
+                    else if (strncmp(hdchar, hltoken, hltoklen) == 0) /*we have an \hdash*/
                         hline[nrows] = (-1);
                 }   /* set \hdash flag for row */
                 if (hline[nrows] != 0) {       /* \hline or \hdash prefixes token */
@@ -5605,7 +5623,7 @@ subraster *rastarray(mimetex_ctx *mctx, char **expression, int size, subraster *
                     } /* ignore entire row at eox */
                     else
                     /* token contains more than \hline */
-                        strcpy(token, tokptr);
+                        strsqueeze(token, tokptr - token);
                 } /* so flush \hline from token */
             } /* --- end-of-if(ncols[nrows]==0) --- */
             /* --- rasterize completed token --- */
@@ -6010,7 +6028,7 @@ subraster *rastpicture(mimetex_ctx *mctx, char **expression, int size, subraster
         if (*putptr != '\000') {       /*check for put data after preamble*/
             /* --- first squeeze preamble out of put expression --- */
             /* squeeze out preamble */
-            if (*pream != '\000') strcpy(putexpr, putptr);
+            if (*pream != '\000') strsqueeze(putexpr, putptr - putexpr);
             /* --- interpret x,y --- */
             if ((multptr = strchr(putexpr, ';')) != NULL) /*semicolon signals multiput*/
                 /* replace semicolon by '\0' */
@@ -7208,7 +7226,7 @@ subraster *rasttoday(mimetex_ctx *mctx, char **expression, int size, subraster *
     /* rasterize timestamp as text */
     strcpy(today, "\\text{");
     /* get timestamp */
-    strcat(today, timestamp(tzdelta, ifmt));
+    strcat(today, timestamp(mctx, tzdelta, ifmt));
     /* terminate \text{} braces */
     strcat(today, "}");
     /* rasterize timestamp */
@@ -7299,7 +7317,7 @@ subraster *rastcalendar(mimetex_ctx *mctx, char **expression, int size, subraste
         fprintf(mctx->msgfp, "rastcalendar> year=%d, month=%d, day=%d\n",
                 year, month, day);
     /* get calendar string */
-    calstr = calendar(year, month, day);
+    calstr = calendar(mctx, year, month, day);
     /* rasterize calendar string */
     calendarsp = rasterize(mctx, calstr, size);
     /* --- return calendar raster to caller --- */
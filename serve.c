@@ -0,0 +1,1067 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Purpose:     mimetex --serve and --http, i.e., a long-running mimeTeX
+ *              that renders requests arriving on a unix or tcp socket
+ *              (see serve.h for the protocols), so fonts, symbol tables
+ *              and contexts are set up once rather than once per image.
+ *
+ * Functions:   serve_run(config)       listens and renders until killed
+ *
+ * Notes:     o One thread waits on epoll for connections and requests,
+ *              and hands each connection with a complete request to
+ *              a pool of worker threads, each with its own mimetex_ctx
+ *              (and arena and gif string table).  A connection is
+ *              registered EPOLLONESHOT, so exactly one thread owns it
+ *              at any time, and its requests are answered in order.
+ *            o Out of file descriptors, a new connection is accepted
+ *              on a spare one and closed at once, rather than left
+ *              to make epoll report listenfd forever.  If even that
+ *              fails, listenfd leaves epoll for a second.
+ *            o A connection waiting in epoll is closed if it sends no
+ *              new request for IDLETIMEOUT secs, or doesn't finish
+ *              sending one within READTIMEOUT secs of starting it.
+ *            o A reply not taken by the client within WRITETIMEOUT ms,
+ *              in all, closes its connection, so a slow reader ties up
+ *              a worker for no longer than that.
+ *            o What a request means (unescaping, \input permissions,
+ *              referer checks, etc) is up to the caller's SERVEFUNC,
+ *              i.e., main().  Here, an http request is just parsed for
+ *              its query string, Host:, Referer: and Connection:.
+ *            o Needs pthreads and epoll.  Elsewhere, serve_run() just
+ *              says so and fails.
+ *
+ ****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mimetex.h"
+#include "serve.h"
+
+#if defined(HAVE_PTHREAD_H) && defined(HAVE_SYS_EPOLL_H)
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "gifsave.h"
+
+/* --- server parameters --- */
+#define MAXFRAME     (4+MAXEXPRSZ)  /* longest request, with its length */
+#define MAXHTTPHEAD  (MAXEXPRSZ+16384) /* longest http request line+headers */
+#define MAXINBUF     (2*MAXHTTPHEAD) /* most unhandled bytes per connection */
+#define MAXREPLYHEAD (512)          /* room for reply headers before image */
+#define READSZ       (16384)        /* initial input buffer */
+#define MAXEVENTS    (64)           /* epoll_wait() events at a time */
+#define LISTENQUEUE  (256)          /* listen() backlog */
+#define WORKERSTACK  (8*1048576)    /* rasterize() recurses deeply */
+#define WRITETIMEOUT (30000)        /* ms a client may take to read a reply */
+#define IDLETIMEOUT  (60)           /* secs a connection may wait idle */
+#define READTIMEOUT  (30)           /* secs a client may take to send one */
+#define DEFAULTHOST  "127.0.0.1"    /* if address is just a port */
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0              /* SIGPIPE is ignored anyway */
+#endif
+
+/* --- one client connection --- */
+typedef struct serveconn_struct
+{
+    int   fd;                   /* connected socket */
+    int   iseof;                /* true after client stopped sending */
+    unsigned char *in;          /* bytes read but not yet answered */
+    int   nin, maxin;           /* #bytes in in[], #bytes allocated */
+    time_t reqstart;            /* when in[]'s partial request began */
+    int   isarmed;              /* true while waiting in epoll */
+    time_t deadline;            /* closed if still waiting at this time */
+    struct serveconn_struct *nextjob; /* next in job queue */
+    struct serveconn_struct *prev, *next; /* in list of all connections */
+} serveconn; /* --- end-of-serveconn_struct --- */
+
+/* --- everything shared by serve_run() and its workers --- */
+typedef struct servestate_struct
+{
+    serveconfig *config;        /* as given to serve_run() */
+    int   listenfd, epollfd;    /* listening socket, epoll instance */
+    int   sparefd;              /* reserved, for accept() at EMFILE */
+    time_t listenpaused;        /* when listenfd left epoll, or 0 */
+    char  *unixpath;            /* socket file to remove, or NULL */
+    pthread_mutex_t lock;       /* protects everything below */
+    pthread_cond_t isjob;       /* signalled when a job is queued */
+    serveconn *firstjob, *lastjob; /* connections with a request */
+    serveconn *conns;           /* all open connections */
+    int   isstopping;           /* true to stop the workers */
+} servestate; /* --- end-of-servestate_struct --- */
+
+/* --- one worker thread --- */
+typedef struct serveworker_struct
+{
+    servestate *state;          /* shared state */
+    pthread_t thread;           /* thread running workerthread() */
+    mimetex_ctx mctx;           /* copy of config->mctx */
+    char  *query;               /* MAXEXPRSZ+1 bytes for one request */
+    char  *head;                /* MAXHTTPHEAD+1 bytes for http headers */
+    unsigned char *reply;       /* MAXREPLYHEAD+MAXGIFSZ bytes */
+} serveworker; /* --- end-of-serveworker_struct --- */
+
+/* --- set by SIGINT or SIGTERM --- */
+static volatile sig_atomic_t isinterrupted = 0;
+
+
+/* ==========================================================================
+ * Function:    onsignal ( sig )
+ * Purpose:     SIGINT/SIGTERM handler, asks serve_run() to stop
+ * ======================================================================= */
+/* --- entry point --- */
+static void onsignal(int sig)
+{
+    isinterrupted = 1;
+} /* --- end-of-function onsignal() --- */
+
+
+/* ==========================================================================
+ * Function:    putbe32 ( p, value ), getbe32 ( p )
+ * Purpose:     Stores or fetches a 4-byte big-endian integer
+ * ======================================================================= */
+/* --- entry point --- */
+static void putbe32(unsigned char *p, long value)
+{
+    p[0] = (unsigned char)((value >> 24) & 0xff);
+    p[1] = (unsigned char)((value >> 16) & 0xff);
+    p[2] = (unsigned char)((value >> 8) & 0xff);
+    p[3] = (unsigned char)(value & 0xff);
+} /* --- end-of-function putbe32() --- */
+/* --- entry point --- */
+static unsigned long getbe32(const unsigned char *p)
+{
+    return (((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+            | ((unsigned long)p[2] << 8) | (unsigned long)p[3]);
+} /* --- end-of-function getbe32() --- */
+
+
+/* ==========================================================================
+ * Function:    httphead ( in, nin )
+ * Purpose:     Finds the blank line ending an http request's headers
+ * --------------------------------------------------------------------------
+ * Arguments:   in (I)      unsigned char * to start of request
+ *              nin (I)     int containing #bytes at in
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #bytes of request line and headers, including
+ *                          the blank line, or -1 if not all there yet
+ * ======================================================================= */
+/* --- entry point --- */
+static int httphead(const unsigned char *in, int nin)
+{
+    int i = 0;
+    for (i = 0; i < nin - 1; i++)
+        if (in[i] == '\n') {            /* \n\n or \n\r\n ends headers */
+            if (in[i+1] == '\n') return (i + 2);
+            if (in[i+1] == '\r' && i + 2 < nin && in[i+2] == '\n') return (i + 3);
+        }
+    return (-1);
+} /* --- end-of-function httphead() --- */
+
+
+/* ==========================================================================
+ * Function:    httpfield ( head, nhead, name, nvalue )
+ * Purpose:     Finds an http header's value
+ * --------------------------------------------------------------------------
+ * Arguments:   head (I)    char * to request line and headers,
+ *                          not necessarily null-terminated
+ *              nhead (I)   int containing #bytes at head
+ *              name (I)    char * to header name, e.g., "Host"
+ *              nvalue (O)  int * returning #chars of value
+ * --------------------------------------------------------------------------
+ * Returns:     ( char * )  first char of value, with leading and
+ *                          trailing blanks excluded, or NULL if no
+ *                          such header
+ * ======================================================================= */
+/* --- entry point --- */
+static char *httpfield(char *head, int nhead, char *name, int *nvalue)
+{
+    int nname = strlen(name), iline = 0, iend = 0;
+    /* --- skip the request line, then check each header line --- */
+    for (iline = 0; iline < nhead && head[iline] != '\n'; iline++) ;
+    for (iline++; iline < nhead; iline = iend + 1) {
+        for (iend = iline; iend < nhead && head[iend] != '\n'; iend++) ;
+        if (iend - iline > nname && head[iline+nname] == ':'
+                && strncasecmp(head + iline, name, nname) == 0) {
+            int ivalue = iline + nname + 1;
+            while (ivalue < iend && isspace((unsigned char)head[ivalue])) ivalue++;
+            while (iend > ivalue && isspace((unsigned char)head[iend-1])) iend--;
+            *nvalue = iend - ivalue;
+            return (head + ivalue);
+        }
+    } /* --- end-of-for(iline) --- */
+    return (NULL);
+} /* --- end-of-function httpfield() --- */
+
+
+/* ==========================================================================
+ * Function:    getframe ( conn, offset, ishttp )
+ * Purpose:     Checks whether conn->in[] holds a complete request
+ *              starting at offset
+ * --------------------------------------------------------------------------
+ * Arguments:   conn (I)    serveconn * to connection
+ *              offset (I)  int containing offset of request in conn->in[]
+ *              ishttp (I)  true for an http request, false for a
+ *                          length-prefixed query string
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #bytes of the whole request (4+length, or
+ *                          http headers+body), -1 if incomplete,
+ *                          -2 if too long or unreadable
+ * ======================================================================= */
+/* --- entry point --- */
+static int getframe(serveconn *conn, int offset, int ishttp)
+{
+    int navail = conn->nin - offset, nhead = 0, nvalue = 0;
+    unsigned long nquery = 0;
+    char *value = NULL;
+    if (!ishttp) {                      /* 4-byte length, then query */
+        if (navail < 4) return (-1);
+        if ((nquery = getbe32(conn->in + offset)) > MAXEXPRSZ) return (-2);
+        if ((unsigned long)(navail - 4) < nquery) return (-1);
+        return (4 + (int)nquery);
+    }
+    /* --- http headers, then Content-Length: bytes of (ignored) body --- */
+    if ((nhead = httphead(conn->in + offset, min2(navail, MAXHTTPHEAD))) < 0)
+        return (navail > MAXHTTPHEAD ? -2 : -1);
+    if (httpfield((char *)conn->in + offset, nhead, "Transfer-Encoding", &nvalue)
+            != NULL) return (-2);       /* no chunked bodies */
+    if ((value = httpfield((char *)conn->in + offset, nhead, "Content-Length",
+                           &nvalue)) != NULL) {
+        long nbody = 0;
+        for (; nvalue > 0; value++, nvalue--) {
+            if (!isdigit((unsigned char)*value)) return (-2);
+            if ((nbody = 10 * nbody + (*value - '0')) > MAXINBUF - nhead)
+                return (-2);
+        }
+        nhead += (int)nbody;
+    }
+    return (navail < nhead ? -1 : nhead);
+} /* --- end-of-function getframe() --- */
+
+
+/* ==========================================================================
+ * Function:    queuejob ( state, conn ), nextjob ( state )
+ * Purpose:     Appends a connection holding a request to the job queue,
+ *              or waits for the first one (NULL when stopping)
+ * ======================================================================= */
+/* --- entry point --- */
+static void queuejob(servestate *state, serveconn *conn)
+{
+    pthread_mutex_lock(&state->lock);
+    conn->nextjob = NULL;
+    if (state->lastjob == NULL) state->firstjob = conn;
+    else state->lastjob->nextjob = conn;
+    state->lastjob = conn;
+    pthread_cond_signal(&state->isjob);
+    pthread_mutex_unlock(&state->lock);
+} /* --- end-of-function queuejob() --- */
+/* --- entry point --- */
+static serveconn *nextjob(servestate *state)
+{
+    serveconn *conn = NULL;
+    pthread_mutex_lock(&state->lock);
+    while (state->firstjob == NULL && !state->isstopping)
+        pthread_cond_wait(&state->isjob, &state->lock);
+    if (!state->isstopping) {           /* take first job */
+        conn = state->firstjob;
+        if ((state->firstjob = conn->nextjob) == NULL) state->lastjob = NULL;
+    }
+    pthread_mutex_unlock(&state->lock);
+    return (conn);
+} /* --- end-of-function nextjob() --- */
+
+
+/* ==========================================================================
+ * Function:    closeconn ( state, conn ), freeconn ( conn )
+ * Purpose:     Closes and frees a connection (the caller must own it,
+ *              i.e., it isn't armed and isn't queued), or frees one
+ *              already taken out of state->conns
+ * ======================================================================= */
+/* --- entry point --- */
+static void freeconn(serveconn *conn)
+{
+    close(conn->fd);                    /* also removes it from epoll */
+    free((void *)conn->in);
+    free((void *)conn);
+} /* --- end-of-function freeconn() --- */
+/* --- entry point --- */
+static void closeconn(servestate *state, serveconn *conn)
+{
+    pthread_mutex_lock(&state->lock);
+    if (conn->prev != NULL) conn->prev->next = conn->next;
+    else state->conns = conn->next;
+    if (conn->next != NULL) conn->next->prev = conn->prev;
+    pthread_mutex_unlock(&state->lock);
+    freeconn(conn);
+} /* --- end-of-function closeconn() --- */
+
+
+/* ==========================================================================
+ * Function:    armconn ( state, conn, op )
+ * Purpose:     Gives a connection (back) to epoll, to wait for
+ *              (the rest of) its next request, with a deadline
+ * --------------------------------------------------------------------------
+ * Arguments:   state (I/O) servestate * to server
+ *              conn (I/O)  serveconn * to connection, owned by caller
+ *              op (I)      EPOLL_CTL_ADD for a new connection,
+ *                          else EPOLL_CTL_MOD
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=armed, 0=failed (caller still owns conn)
+ * --------------------------------------------------------------------------
+ * Notes:     o Once armed, conn belongs to the epoll thread, which
+ *              may close it at its deadline (see closestale()).
+ *              So isarmed is set, and epoll_ctl() called, under
+ *              state->lock, which closestale() also holds.
+ * ======================================================================= */
+/* --- entry point --- */
+static int armconn(servestate *state, serveconn *conn, int op)
+{
+    struct epoll_event ev;
+    int isarmed = 0;
+    memset((void *)&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLONESHOT;
+    ev.data.ptr = (void *)conn;
+    pthread_mutex_lock(&state->lock);
+    conn->deadline = (conn->nin > 0 ? conn->reqstart + READTIMEOUT
+                      : time(NULL) + IDLETIMEOUT);
+    conn->isarmed = 1;
+    if (epoll_ctl(state->epollfd, op, conn->fd, &ev) == 0) isarmed = 1;
+    else conn->isarmed = 0;
+    pthread_mutex_unlock(&state->lock);
+    return (isarmed);
+} /* --- end-of-function armconn() --- */
+
+
+/* ==========================================================================
+ * Function:    closestale ( state, now )
+ * Purpose:     Closes every connection still waiting in epoll
+ *              past its deadline
+ * --------------------------------------------------------------------------
+ * Arguments:   state (I/O) servestate * to server
+ *              now (I)     time_t containing current time
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #connections closed
+ * --------------------------------------------------------------------------
+ * Notes:     o Only the epoll thread calls this, between epoll_wait()'s,
+ *              so no event for a closed connection is pending.
+ * ======================================================================= */
+/* --- entry point --- */
+static int closestale(servestate *state, time_t now)
+{
+    serveconn *conn = NULL, *next = NULL, *stale = NULL;
+    int nclosed = 0;
+    /* --- take them out of state->conns --- */
+    pthread_mutex_lock(&state->lock);
+    for (conn = state->conns; conn != NULL; conn = next) {
+        next = conn->next;
+        if (!conn->isarmed || conn->deadline > now) continue;
+        if (conn->prev != NULL) conn->prev->next = conn->next;
+        else state->conns = conn->next;
+        if (conn->next != NULL) conn->next->prev = conn->prev;
+        conn->isarmed = 0;
+        conn->nextjob = stale;          /* unused while armed */
+        stale = conn;
+    }
+    pthread_mutex_unlock(&state->lock);
+    /* --- and close them --- */
+    for (conn = stale; conn != NULL; conn = next) {
+        next = conn->nextjob;
+        freeconn(conn);
+        nclosed++;
+    }
+    return (nclosed);
+} /* --- end-of-function closestale() --- */
+
+
+/* ==========================================================================
+ * Function:    newconn ( state, fd )
+ * Purpose:     Sets up a just-accepted connection and registers it
+ *              with epoll
+ * --------------------------------------------------------------------------
+ * Arguments:   state (I/O) servestate * to server
+ *              fd (I)      int containing accepted socket
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0=failed (and fd closed)
+ * ======================================================================= */
+/* --- entry point --- */
+static int newconn(servestate *state, int fd)
+{
+    serveconn *conn = NULL;
+    int one = 1;
+    /* --- nonblocking, and don't delay small replies --- */
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if ((conn = (serveconn *)calloc(1, sizeof(serveconn))) == NULL
+            || (conn->in = (unsigned char *)malloc(READSZ)) == NULL) {
+        if (conn != NULL) free((void *)conn);
+        close(fd);
+        return (0);
+    }
+    conn->fd = fd;
+    conn->maxin = READSZ;
+    /* --- link it into the list of connections --- */
+    pthread_mutex_lock(&state->lock);
+    if ((conn->next = state->conns) != NULL) conn->next->prev = conn;
+    state->conns = conn;
+    pthread_mutex_unlock(&state->lock);
+    /* --- and wait for its first request --- */
+    if (!armconn(state, conn, EPOLL_CTL_ADD)) {
+        closeconn(state, conn);
+        return (0);
+    }
+    return (1);
+} /* --- end-of-function newconn() --- */
+
+
+/* ==========================================================================
+ * Function:    acceptconns ( state )
+ * Purpose:     Accepts every pending connection on state->listenfd
+ * --------------------------------------------------------------------------
+ * Arguments:   state (I/O) servestate * to server
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #connections accepted
+ * --------------------------------------------------------------------------
+ * Notes:     o At EMFILE or ENFILE, state->sparefd is closed to accept
+ *              (and close) one connection, and then reopened, so the
+ *              listen queue drains instead of epoll_wait() spinning.
+ *              Without a spare, listenfd is taken out of epoll,
+ *              and serve_run() puts it back a second later.
+ * ======================================================================= */
+/* --- entry point --- */
+static int acceptconns(servestate *state)
+{
+    struct epoll_event ev;
+    int fd = (-1), naccepted = 0;
+    while (1) {
+        if ((fd = accept(state->listenfd, NULL, NULL)) >= 0) {
+            naccepted += newconn(state, fd);
+            continue;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) continue;
+        if (errno != EMFILE && errno != ENFILE) break; /* EAGAIN, i.e., done */
+        /* --- out of fds, so shed a client using the spare --- */
+        if (state->sparefd >= 0) {
+            close(state->sparefd);
+            fd = accept(state->listenfd, NULL, NULL);
+            if (fd >= 0) close(fd);
+            state->sparefd = open("/dev/null", O_RDONLY);
+            if (fd >= 0) continue;      /* and see if there are more */
+        }
+        /* --- no spare, so stop listening for a while --- */
+        memset((void *)&ev, 0, sizeof(ev));
+        ev.data.ptr = NULL;
+        if (epoll_ctl(state->epollfd, EPOLL_CTL_MOD, state->listenfd, &ev) == 0)
+            state->listenpaused = time(NULL);
+        break;
+    } /* --- end-of-while(1) --- */
+    return (naccepted);
+} /* --- end-of-function acceptconns() --- */
+
+
+/* ==========================================================================
+ * Function:    readconn ( conn, ishttp )
+ * Purpose:     Reads whatever a readable connection has sent
+ * --------------------------------------------------------------------------
+ * Arguments:   conn (I/O)  serveconn * to connection
+ *              ishttp (I)  true for http requests
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1 if conn->in[] now holds a complete request
+ *                          (or a bad one, for a worker to answer),
+ *                          0 if not yet, -1 if conn should be closed
+ * ======================================================================= */
+/* --- entry point --- */
+static int readconn(serveconn *conn, int ishttp)
+{
+    int nread = 0;
+    while (conn->nin < MAXINBUF) {
+        /* --- make room to read into --- */
+        if (conn->nin >= conn->maxin) {
+            int maxin = min2(2 * conn->maxin, MAXINBUF);
+            unsigned char *in = (unsigned char *)realloc(conn->in, maxin);
+            if (in == NULL) return (-1);
+            conn->in = in;
+            conn->maxin = maxin;
+        }
+        nread = read(conn->fd, conn->in + conn->nin, conn->maxin - conn->nin);
+        if (nread > 0) {
+            if (conn->nin == 0) conn->reqstart = time(NULL); /* new request */
+            conn->nin += nread;
+            continue;
+        }
+        if (nread == 0) { conn->iseof = 1; break; }  /* client is done */
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break; /* read it all */
+        return (-1);                    /* connection error */
+    } /* --- end-of-while(conn->nin<MAXINBUF) --- */
+    if (getframe(conn, 0, ishttp) != -1) return (1); /* have a request */
+    return (conn->iseof ? -1 : 0);      /* quit in mid-request, or wait */
+} /* --- end-of-function readconn() --- */
+
+
+/* ==========================================================================
+ * Function:    writeall ( fd, buffer, nbytes )
+ * Purpose:     Sends nbytes to a nonblocking socket, waiting as needed
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0=failed or timed out
+ * --------------------------------------------------------------------------
+ * Notes:     o WRITETIMEOUT bounds the whole send, not each wait,
+ *              so a client reading a byte at a time can't hold
+ *              the calling worker indefinitely.
+ * ======================================================================= */
+/* --- entry point --- */
+static int writeall(int fd, const unsigned char *buffer, int nbytes)
+{
+    int nsent = 0, nwrite = 0;
+    long msleft = 0;                    /* till WRITETIMEOUT expires */
+    struct timespec now, deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += WRITETIMEOUT / 1000;
+    deadline.tv_nsec += (WRITETIMEOUT % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    while (nsent < nbytes) {
+        nwrite = send(fd, buffer + nsent, nbytes - nsent, MSG_NOSIGNAL);
+        if (nwrite > 0) { nsent += nwrite; continue; }
+        if (nwrite < 0 && errno == EINTR) continue;
+        if (nwrite < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            struct pollfd pfd;          /* wait for room in socket buffer */
+            pfd.fd = fd;
+            pfd.events = POLLOUT;
+            pfd.revents = 0;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            msleft = (long)(deadline.tv_sec - now.tv_sec) * 1000L
+                     + (deadline.tv_nsec - now.tv_nsec) / 1000000L;
+            if (msleft > 0 && poll(&pfd, 1, (int)msleft) > 0) continue;
+        }
+        return (0);                     /* error, or client stalled */
+    } /* --- end-of-while(nsent<nbytes) --- */
+    return (1);
+} /* --- end-of-function writeall() --- */
+
+
+/* ==========================================================================
+ * Function:    renderreq ( worker, req )
+ * Purpose:     Renders req->query into worker->reply, leaving
+ *              MAXREPLYHEAD bytes in front of the image for headers
+ * --------------------------------------------------------------------------
+ * Arguments:   worker (I)  serveworker * to this worker
+ *              req (I/O)   servereq * whose query, referer and host
+ *                          are set, and whose reply fields are returned
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     #bytes of image, 0 if failed
+ * ======================================================================= */
+/* --- entry point --- */
+static int renderreq(serveworker *worker, servereq *req)
+{
+    serveconfig *config = worker->state->config;
+    req->options = config->options;
+    req->cache = config->cache;
+    req->image = worker->reply + MAXREPLYHEAD;
+    req->maxbytes = MAXGIFSZ;
+    req->nbytes = 0;
+    req->valign = (-9999);
+    req->maxage = (-1);
+    if (config->render(&worker->mctx, req) <= 0
+            || req->nbytes > req->maxbytes)
+        req->nbytes = 0;                /* failed */
+    return (req->nbytes);
+} /* --- end-of-function renderreq() --- */
+
+
+/* ==========================================================================
+ * Function:    answerframe ( worker, conn, offset, nframe )
+ * Purpose:     Answers one length-prefixed request
+ * --------------------------------------------------------------------------
+ * Arguments:   worker (I)  serveworker * to this worker
+ *              conn (I)    serveconn * to connection
+ *              offset (I)  int containing offset of request in conn->in[]
+ *              nframe (I)  int containing getframe()'s result
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1 to keep the connection, 0 to close it
+ * ======================================================================= */
+/* --- entry point --- */
+static int answerframe(serveworker *worker, serveconn *conn, int offset, int nframe)
+{
+    unsigned char *reply = worker->reply + MAXREPLYHEAD - SERVEHEADSZ;
+    servereq req;
+    if (nframe < 4) return (0);         /* request too long */
+    memcpy(worker->query, conn->in + offset + 4, nframe - 4);
+    worker->query[nframe-4] = '\000';
+    req.query = worker->query;
+    req.referer = req.host = NULL;
+    renderreq(worker, &req);
+    putbe32(reply, req.nbytes);
+    putbe32(reply + 4, req.valign);
+    return (writeall(conn->fd, reply, SERVEHEADSZ + req.nbytes));
+} /* --- end-of-function answerframe() --- */
+
+
+/* ==========================================================================
+ * Function:    answerhttp ( worker, conn, offset, nframe )
+ * Purpose:     Answers one http request, GET /?query or HEAD /?query
+ * --------------------------------------------------------------------------
+ * Arguments:   worker (I)  serveworker * to this worker
+ *              conn (I)    serveconn * to connection
+ *              offset (I)  int containing offset of request in conn->in[]
+ *              nframe (I)  int containing getframe()'s result
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1 to keep the connection, 0 to close it
+ * --------------------------------------------------------------------------
+ * Notes:     o The path is ignored, and the query string is passed on
+ *              still escaped, exactly like a CGI QUERY_STRING.
+ *              Except /stats returns the image cache's counters.
+ *            o Connections are kept alive as per http/1.0 and 1.1,
+ *              except after a malformed request.
+ *            o An http/1.1 request without Host: is malformed.
+ * ======================================================================= */
+/* --- entry point --- */
+static int answerhttp(serveworker *worker, serveconn *conn, int offset, int nframe)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    char  *head = worker->head, *line = NULL, *save = NULL;
+    char  *method = NULL, *target = NULL, *version = NULL, *query = NULL;
+    char  *host = NULL, *referer = NULL, *connection = NULL;
+    int   nhead = 0, nhost = 0, nreferer = 0, nconnection = 0, npath = 0, i = 0;
+    int   status = 200, iskeepalive = 0, ishead = 0, nreply = 0, nbody = 0;
+    char  reply[MAXREPLYHEAD], *reason = "OK", *type = "image/gif";
+    unsigned char *start = NULL;
+    servereq req;
+    /* ------------------------------------------------------------
+    parse the request line and the headers we care about
+    ------------------------------------------------------------ */
+    if (nframe < 0) { status = 400; goto emit_reply; }
+    nhead = httphead(conn->in + offset, nframe);
+    memcpy(head, conn->in + offset, nhead);
+    head[nhead] = '\000';
+    /* --- find headers first, then null-terminate their values --- */
+    host = httpfield(head, nhead, "Host", &nhost);
+    referer = httpfield(head, nhead, "Referer", &nreferer);
+    connection = httpfield(head, nhead, "Connection", &nconnection);
+    if (host != NULL) host[nhost] = '\000';
+    if (referer != NULL) referer[nreferer] = '\000';
+    if (connection != NULL) connection[nconnection] = '\000';
+    /* --- request line is  method target version --- */
+    if ((line = strchr(head, '\n')) != NULL) *line = '\000';
+    method = strtok_r(head, " \t\r", &save);
+    target = strtok_r(NULL, " \t\r", &save);
+    version = strtok_r(NULL, " \t\r", &save);
+    if (method == NULL || target == NULL || version == NULL
+            || strncmp(version, "HTTP/", 5) != 0) { status = 400; goto emit_reply; }
+    if (strncmp(version, "HTTP/1.", 7) != 0) { status = 505; goto emit_reply; }
+    if (host == NULL && strcmp(version, "HTTP/1.0") != 0) /* rfc 7230 5.4 */
+        { status = 400; goto emit_reply; }
+    /* --- http/1.1 keeps connections alive unless told otherwise --- */
+    iskeepalive = (strcmp(version, "HTTP/1.0") != 0);
+    if (connection != NULL) {
+        for (i = 0; i < nconnection; i++)
+            connection[i] = tolower((unsigned char)connection[i]);
+        if (strstr(connection, "close") != NULL) iskeepalive = 0;
+        else if (strstr(connection, "keep-alive") != NULL) iskeepalive = 1;
+    }
+    ishead = (strcmp(method, "HEAD") == 0);
+    if (!ishead && strcmp(method, "GET") != 0) { status = 405; goto emit_reply; }
+    /* ------------------------------------------------------------
+    render the query string, truncated as main() truncates QUERY_STRING
+    ------------------------------------------------------------ */
+    query = strchr(target, '?');
+    npath = (query == NULL ? strlen(target) : (int)(query - target));
+    if (npath == 6 && memcmp(target, "/stats", 6) == 0) { /* not an image */
+        imgcachestats stats;
+        imgcache_stats(worker->state->config->cache, &stats);
+        req.nbytes = sprintf((char *)worker->reply + MAXREPLYHEAD,
+                             "hits %ld\nmisses %ld\ncoalesced %ld\n"
+                             "evictions %ld\nentries %ld\nbytes %ld\n"
+                             "maxbytes %ld\n",
+                             stats.nhits, stats.nmisses, stats.ncoalesced,
+                             stats.nevictions, stats.nentries, stats.nbytes,
+                             stats.maxbytes);
+        req.valign = (-9999);
+        req.maxage = 0;
+        type = "text/plain";
+        goto emit_reply;
+    }
+    strncpy(worker->query, (query == NULL ? "" : query + 1), MAXEXPRSZ);
+    worker->query[MAXEXPRSZ] = '\000';
+    req.query = worker->query;
+    req.host = host;
+    req.referer = referer;
+    if (renderreq(worker, &req) < 1) status = 500;
+    switch (req.options.format) {
+    case MIMETEX_PBM: type = "image/x-portable-bitmap"; break;
+    case MIMETEX_PGM: type = "image/x-portable-graymap"; break;
+    case MIMETEX_PNG: type = "image/png"; break;
+    }
+    /* ------------------------------------------------------------
+    emit headers, and image unless HEAD or error
+    ------------------------------------------------------------ */
+emit_reply:
+    switch (status) {
+    case 400: reason = "Bad Request"; iskeepalive = 0; break;
+    case 405: reason = "Method Not Allowed"; break;
+    case 500: reason = "Internal Server Error"; break;
+    case 505: reason = "HTTP Version Not Supported"; iskeepalive = 0; break;
+    }
+    nreply = sprintf(reply, "HTTP/1.1 %d %s\r\n", status, reason);
+    if (status == 200) {
+        if (req.maxage >= 0)
+            nreply += sprintf(reply + nreply, "Cache-Control: max-age=%d\r\n", req.maxage);
+        nreply += sprintf(reply + nreply, "Content-Length: %d\r\n", req.nbytes);
+        if (abs(req.valign) < 999)      /* as for a CGI reply */
+            nreply += sprintf(reply + nreply, "Vertical-Align: %d\r\n", req.valign);
+        nreply += sprintf(reply + nreply, "Content-Type: %s\r\n", type);
+        if (!ishead) nbody = req.nbytes;
+    } else {
+        if (status == 405)
+            nreply += sprintf(reply + nreply, "Allow: GET, HEAD\r\n");
+        nreply += sprintf(reply + nreply, "Content-Length: 0\r\n");
+    }
+    nreply += sprintf(reply + nreply, "Connection: %s\r\n\r\n",
+                      (iskeepalive ? "keep-alive" : "close"));
+    /* --- headers go just in front of the image, for one write --- */
+    start = worker->reply + MAXREPLYHEAD - nreply;
+    memcpy(start, reply, nreply);
+    if (!writeall(conn->fd, start, nreply + nbody)) iskeepalive = 0;
+    return (iskeepalive);
+} /* --- end-of-function answerhttp() --- */
+
+
+/* ==========================================================================
+ * Function:    workerthread ( arg )
+ * Purpose:     Worker thread: answers every complete request on each
+ *              connection it's handed, then gives the connection back
+ *              to epoll (or closes it)
+ * --------------------------------------------------------------------------
+ * Arguments:   arg (I)     serveworker * to this worker
+ * --------------------------------------------------------------------------
+ * Returns:     ( void * )  NULL, when serve_run() stops
+ * ======================================================================= */
+/* --- entry point --- */
+static void *workerthread(void *arg)
+{
+    serveworker *worker = (serveworker *)arg;
+    servestate *state = worker->state;
+    serveconfig *config = state->config;
+    serveconn *conn = NULL;
+    while ((conn = nextjob(state)) != NULL) {
+        int offset = 0, nframe = 0, isokay = 1;
+        /* --- answer each complete request, in order --- */
+        while (isokay && (nframe = getframe(conn, offset, config->ishttp)) != -1) {
+            isokay = (config->ishttp ? answerhttp(worker, conn, offset, nframe)
+                      : answerframe(worker, conn, offset, nframe));
+            if (nframe < 0) isokay = 0; /* bad request, now answered */
+            else offset += nframe;
+        } /* --- end-of-while(getframe()!=-1) --- */
+        /* --- keep any partial request for next time --- */
+        if (offset > 0) {
+            memmove(conn->in, conn->in + offset, conn->nin - offset);
+            if ((conn->nin -= offset) > 0) conn->reqstart = time(NULL);
+        }
+        /* --- and wait for more, unless client is done --- */
+        if (isokay && !conn->iseof)
+            if (armconn(state, conn, EPOLL_CTL_MOD))
+                continue;               /* conn belongs to epoll again */
+        closeconn(state, conn);
+    } /* --- end-of-while(nextjob()!=NULL) --- */
+    return (NULL);
+} /* --- end-of-function workerthread() --- */
+
+
+/* ==========================================================================
+ * Function:    openlistener ( state, address )
+ * Purpose:     Creates state->listenfd, listening on address
+ * --------------------------------------------------------------------------
+ * Arguments:   state (O)   servestate * whose listenfd and unixpath are set
+ *              address (I) char * to unix socket path (containing a /),
+ *                          or [host:]port, with host 127.0.0.1 by default,
+ *                          or * for all interfaces
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     1=okay, 0=failed
+ * --------------------------------------------------------------------------
+ * Notes:     o An existing socket file at the unix path, presumably
+ *              left by a previous server, is removed.
+ * ======================================================================= */
+/* --- entry point --- */
+static int openlistener(servestate *state, char *address)
+{
+    int fd = (-1), one = 1;
+    if (isempty(address)) return (0);
+    if (strchr(address, '/') != NULL) {  /* unix socket */
+        struct sockaddr_un sun;
+        struct stat st;
+        if (strlen(address) >= sizeof(sun.sun_path)) return (0);
+        memset((void *)&sun, 0, sizeof(sun));
+        sun.sun_family = AF_UNIX;
+        strcpy(sun.sun_path, address);
+        if (stat(address, &st) == 0 && S_ISSOCK(st.st_mode))
+            unlink(address);            /* stale socket from last time */
+        if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) return (0);
+        if (bind(fd, (struct sockaddr *)&sun, sizeof(sun)) != 0
+                || listen(fd, LISTENQUEUE) != 0) {
+            close(fd);
+            return (0);
+        }
+        state->unixpath = address;
+    } else {                            /* tcp [host:]port */
+        char host[256] = DEFAULTHOST, *port = address, *colon = NULL;
+        struct addrinfo hints, *addrs = NULL, *ap = NULL;
+        if ((colon = strrchr(address, ':')) != NULL) {
+            int nhost = (int)(colon - address);
+            if (nhost >= (int)sizeof(host)) return (0);
+            memcpy(host, address, nhost);
+            host[nhost] = '\000';
+            port = colon + 1;
+            if (*host == '[' && lastchar(host) == ']') { /* [ipv6] */
+                host[strlen(host) - 1] = '\000';
+                strsqueeze(host, 1);
+            }
+        }
+        memset((void *)&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        hints.ai_flags = AI_PASSIVE;
+        if (getaddrinfo((strcmp(host, "*") == 0 || *host == '\000' ? NULL : host),
+                        port, &hints, &addrs) != 0) return (0);
+        for (ap = addrs; ap != NULL; ap = ap->ai_next) { /* first that works */
+            if ((fd = socket(ap->ai_family, ap->ai_socktype, ap->ai_protocol)) < 0)
+                continue;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, ap->ai_addr, ap->ai_addrlen) == 0
+                    && listen(fd, LISTENQUEUE) == 0) break;
+            close(fd);
+            fd = (-1);
+        }
+        freeaddrinfo(addrs);
+        if (fd < 0) return (0);
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    state->listenfd = fd;
+    return (1);
+} /* --- end-of-function openlistener() --- */
+
+
+/* ==========================================================================
+ * Function:    serve_run ( config )
+ * Purpose:     Listens on config->address, and renders requests
+ *              with config->render() until SIGINT or SIGTERM
+ * --------------------------------------------------------------------------
+ * Arguments:   config (I)  serveconfig * to address, #workers, etc
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )     0 after a signal, 1 if it couldn't start
+ * --------------------------------------------------------------------------
+ * Notes:     o Each worker copies config->mctx, so set colors,
+ *              aaalgorithm, etc, there first.  config->mctx->msgfp
+ *              (if msglevel>=1) gets a line when the server starts.
+ *            o Call mimetex_warm_glyphs() first to decode all fonts
+ *              before the first request.
+ * ======================================================================= */
+/* --- entry point --- */
+int serve_run(serveconfig *config)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    servestate state;
+    serveworker *workers = NULL;
+    int nworkers = 0, nstarted = 0, iworker = 0, ievent = 0, nevents = 0;
+    int status = 1;                     /* 1 until we're up and running */
+    struct epoll_event ev, events[MAXEVENTS];
+    time_t now = 0, lastsweep = 0;      /* closestale() once a second */
+    struct sigaction sa;
+    pthread_attr_t attr;
+    /* ------------------------------------------------------------
+    initialization
+    ------------------------------------------------------------ */
+    memset((void *)&state, 0, sizeof(state));
+    state.config = config;
+    state.listenfd = state.epollfd = state.sparefd = (-1);
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.isjob, NULL);
+    if (config == NULL || config->mctx == NULL || config->render == NULL)
+        goto end_of_job;
+    nworkers = max2(1, min2(config->nworkers, SERVEMAXWORKERS));
+    /* --- listening socket, and epoll instance watching it --- */
+    if (!openlistener(&state, config->address)) {
+        fprintf(stderr, "mimetex> can't listen on %s\n",
+                (config->address == NULL ? "(null)" : config->address));
+        goto end_of_job;
+    }
+    if ((state.epollfd = epoll_create(MAXEVENTS)) < 0) goto end_of_job;
+    state.sparefd = open("/dev/null", O_RDONLY); /* see acceptconns() */
+    memset((void *)&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;                 /* NULL signals listenfd */
+    if (epoll_ctl(state.epollfd, EPOLL_CTL_ADD, state.listenfd, &ev) != 0)
+        goto end_of_job;
+    /* --- each worker's context and buffers --- */
+    if ((workers = (serveworker *)calloc(nworkers, sizeof(serveworker))) == NULL)
+        goto end_of_job;
+    for (iworker = 0; iworker < nworkers; iworker++) {
+        serveworker *worker = &workers[iworker];
+        worker->state = &state;
+        memcpy((void *)&worker->mctx, (void *)config->mctx, sizeof(mimetex_ctx));
+        if ((worker->mctx.arena = new_arena()) == NULL
+                || (worker->mctx.gifstrtab = GIF_CreateStrtab()) == NULL
+                || (worker->query = (char *)malloc(MAXEXPRSZ + 1)) == NULL
+                || (worker->head = (char *)malloc(MAXHTTPHEAD + 1)) == NULL
+                || (worker->reply = (unsigned char *)malloc(MAXREPLYHEAD + MAXGIFSZ))
+                == NULL) goto end_of_job;
+    }
+    /* --- SIGPIPE from a vanished client mustn't kill us --- */
+    memset((void *)&sa, 0, sizeof(sa));
+    sa.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &sa, NULL);
+    sa.sa_handler = onsignal;           /* no SA_RESTART, to wake epoll */
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    /* --- start workers --- */
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, WORKERSTACK);
+    for (nstarted = 0; nstarted < nworkers; nstarted++)
+        if (pthread_create(&workers[nstarted].thread, &attr, workerthread,
+                           (void *)&workers[nstarted]) != 0) break;
+    pthread_attr_destroy(&attr);
+    if (nstarted < 1) goto end_of_job;
+    status = 0;                         /* up and running */
+    if (config->mctx->msgfp != NULL && config->mctx->msglevel >= 1) {
+        fprintf(config->mctx->msgfp, "mimetex> serving %s%s with %d workers\n",
+                (config->ishttp ? "http on " : ""), config->address, nstarted);
+        fflush(config->mctx->msgfp);
+    }
+    /* ------------------------------------------------------------
+    accept connections and read requests until signalled
+    ------------------------------------------------------------ */
+    while (!isinterrupted) {
+        /* --- timeout just in case a signal arrives before we wait --- */
+        if ((nevents = epoll_wait(state.epollfd, events, MAXEVENTS, 1000)) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (ievent = 0; ievent < nevents; ievent++) {
+            serveconn *conn = (serveconn *)events[ievent].data.ptr;
+            if (conn == NULL) {         /* new connection(s) */
+                acceptconns(&state);
+                continue;
+            }
+            pthread_mutex_lock(&state.lock);
+            conn->isarmed = 0;          /* it's ours until re-armed */
+            pthread_mutex_unlock(&state.lock);
+            switch (readconn(conn, config->ishttp)) {   /* request from a connection */
+            case 1:                     /* complete request */
+                queuejob(&state, conn);
+                break;
+            case 0:                     /* partial request, wait for rest */
+                if (!armconn(&state, conn, EPOLL_CTL_MOD))
+                    closeconn(&state, conn);
+                break;
+            default:                    /* client gone, or error */
+                closeconn(&state, conn);
+                break;
+            } /* --- end-of-switch(readconn()) --- */
+        } /* --- end-of-for(ievent) --- */
+        /* --- close connections idle (or stalled mid-request) too long --- */
+        if ((now = time(NULL)) != lastsweep) {
+            closestale(&state, now);
+            lastsweep = now;
+            if (state.listenpaused != 0 && now > state.listenpaused) {
+                memset((void *)&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN;    /* listen again */
+                ev.data.ptr = NULL;
+                if (epoll_ctl(state.epollfd, EPOLL_CTL_MOD, state.listenfd, &ev) == 0)
+                    state.listenpaused = 0;
+            }
+        }
+    } /* --- end-of-while(!isinterrupted) --- */
+    /* ------------------------------------------------------------
+    stop workers, close connections, and free everything
+    ------------------------------------------------------------ */
+end_of_job:
+    pthread_mutex_lock(&state.lock);
+    state.isstopping = 1;
+    pthread_cond_broadcast(&state.isjob);
+    pthread_mutex_unlock(&state.lock);
+    for (iworker = 0; iworker < nstarted; iworker++)
+        pthread_join(workers[iworker].thread, NULL);
+    if (status == 0 && config->cache != NULL
+            && config->mctx->msgfp != NULL && config->mctx->msglevel >= 1) {
+        imgcachestats stats;
+        imgcache_stats(config->cache, &stats);
+        fprintf(config->mctx->msgfp, "mimetex> cache: %ld hits, %ld misses, "
+                "%ld coalesced, %ld evictions, %ld images in %ld of %ld bytes\n",
+                stats.nhits, stats.nmisses, stats.ncoalesced, stats.nevictions,
+                stats.nentries, stats.nbytes, stats.maxbytes);
+        fflush(config->mctx->msgfp);
+    }
+    while (state.conns != NULL)         /* idle or still-queued */
+        closeconn(&state, state.conns);
+    if (workers != NULL) {
+        for (iworker = 0; iworker < nworkers; iworker++) {
+            serveworker *worker = &workers[iworker];
+            if (worker->mctx.arena != NULL) delete_arena(worker->mctx.arena);
+            if (worker->mctx.gifstrtab != NULL)
+                GIF_DestroyStrtab(worker->mctx.gifstrtab);
+            if (worker->query != NULL) free((void *)worker->query);
+            if (worker->head != NULL) free((void *)worker->head);
+            if (worker->reply != NULL) free((void *)worker->reply);
+        }
+        free((void *)workers);
+    }
+    if (state.epollfd >= 0) close(state.epollfd);
+    if (state.listenfd >= 0) close(state.listenfd);
+    if (state.sparefd >= 0) close(state.sparefd);
+    if (state.unixpath != NULL) unlink(state.unixpath);
+    pthread_cond_destroy(&state.isjob);
+    pthread_mutex_destroy(&state.lock);
+    return (status);
+} /* --- end-of-function serve_run() --- */
+
+#else /* --- no pthreads or epoll --- */
+
+/* --- entry point --- */
+int serve_run(serveconfig *config)
+{
+    fprintf(stderr, "mimetex> --serve and --http need pthreads and epoll\n");
+    return (1);
+} /* --- end-of-function serve_run() --- */
+
+#endif /* HAVE_PTHREAD_H && HAVE_SYS_EPOLL_H */
@@ -0,0 +1,60 @@
+#ifndef SERVE_H
+#define SERVE_H
+
+#include "mimetex.h"
+#include "imgcache.h"
+
+/* ---
+ * mimetex --serve protocol, on a unix or tcp stream socket:
+ *   request:  4-byte big-endian length n, then n bytes of query string
+ *             (exactly what a browser would send as QUERY_STRING)
+ *   reply:    4-byte big-endian length m, 4-byte big-endian Vertical-Align
+ *             (-9999 if none), then m bytes of image (m=0 if it failed)
+ * A client may send any number of requests on one connection,
+ * and replies come back in the same order.
+ * Or, with serveconfig.ishttp, requests are http/1.1  GET /?query
+ * (or HEAD), with keep-alive and pipelining, and replies carry
+ * Cache-Control:, Content-Length:, Vertical-Align: and Content-Type:.
+ * GET /stats instead returns serveconfig.cache's counters as text/plain.
+ * --------------------------------------------------------------------- */
+#define SERVEHEADSZ (8)         /* #bytes of reply preceding the image */
+#define SERVEWORKERS (4)        /* #render threads if not specified */
+#define SERVEMAXWORKERS (256)   /* max #render threads */
+
+/* --- one request, as passed to the SERVEFUNC rendering it --- */
+typedef struct servereq_struct
+{
+    /* --- request (set by serve_run()) --- */
+    char  *query;               /* null-terminated query string, which
+                                 * may be edited in place, and has room
+                                 * for MAXEXPRSZ+1 bytes */
+    mimetex_options options;    /* size, format, as given to serve_run() */
+    char  *referer;             /* http Referer:, or NULL */
+    char  *host;                /* http Host:, or NULL */
+    imgcache *cache;            /* finished images, or NULL */
+    /* --- reply (set by the SERVEFUNC) --- */
+    unsigned char *image;       /* buffer for the rendered image */
+    int   maxbytes;             /* #bytes available in image[] */
+    int   nbytes;               /* #bytes of image, or 0 if failed */
+    int   valign;               /* Vertical-Align:, or -9999 */
+    int   maxage;               /* Cache-Control: max-age, or -1 */
+} servereq; /* --- end-of-servereq_struct --- */
+/* --- renders req->query into req->image, returns req->nbytes --- */
+typedef int (*SERVEFUNC)(mimetex_ctx *mctx, servereq *req);
+
+/* --- how serve_run() listens, and what it does with requests --- */
+typedef struct serveconfig_struct
+{
+    char  *address;             /* unix socket path (containing a /),
+                                 * or [host:]port (host=127.0.0.1) */
+    int   ishttp;               /* true for http, false for framed */
+    int   nworkers;             /* #render threads */
+    mimetex_ctx *mctx;          /* copied for each worker thread */
+    mimetex_options options;    /* copied to each servereq */
+    imgcache *cache;            /* passed to each servereq, or NULL */
+    SERVEFUNC render;           /* renders each request */
+} serveconfig; /* --- end-of-serveconfig_struct --- */
+
+int serve_run(serveconfig *config);
+
+#endif /* SERVE_H */
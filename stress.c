@@ -0,0 +1,335 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Program:     stress  [-h htmlfile]  [-f corpusfile]  [-t threads]
+ *              [-n passes]  [-g format]
+ *
+ * Purpose:     Checks that mimetex_render() is reentrant and deterministic,
+ *              by rendering a corpus of expressions once on the main
+ *              thread, then again on several threads at once, each with
+ *              its own mimetex_ctx, and comparing every image with the
+ *              main thread's.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Command-line Arguments:
+ *              --- args can be in any order ---
+ *              -h htmlfile     mimetex.html whose <img src=mimetex.cgi?...>
+ *                              examples are rendered
+ *                              (defaults to mimetex.html)
+ *              -f corpusfile   file with one more expression per line
+ *              -t threads      #threads rendering at once (default 8)
+ *              -n passes       #times each thread renders the corpus,
+ *                              starting at a different expression
+ *                              each time (default 2)
+ *              -g format       0=gif, 1=pbm, 2=pgm, 4=png (default 0)
+ *
+ * Output:      A line on stderr for each expression whose image differs
+ *              from the main thread's (first difference only), and
+ *              a summary line on stdout:
+ *                expressions=n threads=n passes=n renders=n mismatches=n
+ *
+ * Exits:       0=every image identical,  1=some mismatch or error
+ *
+ * Source:      stress.c
+ *
+ ****************************************************************************/
+
+/* --------------------------------------------------------------------------
+standard headers, program parameters, global data and macros
+-------------------------------------------------------------------------- */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+/* --- standard headers --- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+/* --- application headers --- */
+#include "mimetex.h"
+#include "gifsave.h"
+#include "corpus.h"
+
+/* --- parameters either -D defined on cc line, or defaulted here --- */
+#ifndef HTMLFILE
+#define HTMLFILE "mimetex.html"     /* expressions to render */
+#endif
+#ifndef NTHREADS
+#define NTHREADS 8                  /* #threads rendering at once */
+#endif
+#ifndef NPASSES
+#define NPASSES 2                   /* #times each thread renders corpus */
+#endif
+#define MAXTHREADS (256)
+
+/* -------------------------------------------------------------------------
+expressions to be rendered, with the main thread's images
+-------------------------------------------------------------------------- */
+typedef struct stressexpr_struct
+{
+    char  *expression;        /* malloc'ed copy of expression */
+    unsigned char *image;     /* malloc'ed main thread image, or NULL */
+    int   nbytes;             /* #bytes in image, 0 if render failed */
+    int   ismismatch;         /* true once a thread's image differed */
+} stressexpr; /* --- end-of-stressexpr_struct --- */
+
+typedef struct stressthread_struct
+{
+    pthread_t thread;         /* the thread */
+    int   ithread;            /* its index, for its starting expression */
+    long  nrenders;           /* #renders it did */
+    int   isokay;             /* false if it couldn't set up */
+} stressthread; /* --- end-of-stressthread_struct --- */
+
+static stressexpr *exprs = NULL;    /* corpus */
+static int nexprs = 0, maxexprs = 0;
+static int npasses = NPASSES, nthreads = NTHREADS, format = MIMETEX_GIF;
+static int nmismatches = 0;
+static pthread_mutex_t mismatchlock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/* ==========================================================================
+ * Function:    addexpr ( expression )
+ * Purpose:     Adds a copy of expression to the corpus
+ *              (the CORPUSFUNC for corpus_html() and corpus_lines())
+ * --------------------------------------------------------------------------
+ * Arguments:   expression (I)  char * to null-terminated expression
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if added, or 0 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o Empty expressions, duplicates, and \today and \calendar
+ *              (which render the current time) are ignored (and return 1).
+ * ======================================================================= */
+/* --- entry point --- */
+static int addexpr(char *expression)
+{
+    char *copy = NULL;
+    int iexpr = 0;
+    if (expression == NULL || *expression == '\000') return (1);
+    if (strstr(expression, "\\today") != NULL     /* changes with the time */
+            ||   strstr(expression, "\\calendar") != NULL) return (1);
+    for (iexpr = 0; iexpr < nexprs; iexpr++)
+        if (strcmp(exprs[iexpr].expression, expression) == 0) return (1);
+    if (nexprs >= maxexprs) {           /* need more room */
+        int newmax = (maxexprs < 64 ? 64 : 2 * maxexprs);
+        stressexpr *newexprs = (stressexpr *)realloc(exprs,
+                                  newmax * sizeof(stressexpr));
+        if (newexprs == NULL) return (0);
+        exprs = newexprs;
+        maxexprs = newmax;
+    }
+    if ((copy = (char *)malloc(strlen(expression) + 1)) == NULL) return (0);
+    strcpy(copy, expression);
+    memset((void *)&exprs[nexprs], 0, sizeof(stressexpr));
+    exprs[nexprs].expression = copy;
+    nexprs++;
+    return (1);
+} /* --- end-of-function addexpr() --- */
+
+
+/* ==========================================================================
+ * Function:    newctx ( mctx )
+ * Purpose:     Sets up mctx as a server's worker would,
+ *              with its own arena and gif string table
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         1 if set up, or 0 for any error
+ * ======================================================================= */
+/* --- entry point --- */
+static int newctx(mimetex_ctx *mctx)
+{
+    if (mimetex_ctx_init(mctx)) return (0);
+    if ((mctx->arena = new_arena()) == NULL) return (0);
+    if ((mctx->gifstrtab = GIF_CreateStrtab()) == NULL) {
+        delete_arena(mctx->arena);
+        return (0);
+    }
+    return (1);
+} /* --- end-of-function newctx() --- */
+
+
+/* ==========================================================================
+ * Function:    stressrender ( arg )
+ * Purpose:     pthread_create() entry point, renders the corpus npasses
+ *              times and compares each image with the main thread's
+ * --------------------------------------------------------------------------
+ * Arguments:   arg (I/O)       void * to this thread's stressthread
+ * --------------------------------------------------------------------------
+ * Returns:     ( void * )      NULL
+ * --------------------------------------------------------------------------
+ * Notes:     o Each thread starts at a different expression every pass,
+ *              so different expressions are rendered at the same time.
+ * ======================================================================= */
+/* --- entry point --- */
+static void *stressrender(void *arg)
+{
+    stressthread *st = (stressthread *)arg;
+    mimetex_ctx mctx;
+    mimetex_options opts = { NORMALSIZE, MIMETEX_GIF, 1 };
+    mimetex_image image;
+    unsigned char *buffer = NULL;
+    int ipass = 0, i = 0;
+    opts.format = format;
+    if (!newctx(&mctx)) goto end_of_job;
+    if ((buffer = (unsigned char *)malloc(MAXGIFSZ)) == NULL) goto end_of_job;
+    st->isokay = 1;
+    for (ipass = 0; ipass < npasses; ipass++)
+        for (i = 0; i < nexprs; i++) {
+            int iexpr = (i + (st->ithread + ipass * nthreads) * 7) % nexprs;
+            stressexpr *ep = &exprs[iexpr];
+            int nbytes = mimetex_render(&mctx, ep->expression, &opts,
+                                        buffer, MAXGIFSZ, &image);
+            st->nrenders++;
+            if (nbytes == ep->nbytes
+                    && (nbytes < 1 || memcmp(buffer, ep->image, nbytes) == 0))
+                continue;               /* identical */
+            pthread_mutex_lock(&mismatchlock);
+            nmismatches++;
+            if (!ep->ismismatch)        /* first difference only */
+                fprintf(stderr, "mismatch #%d (thread %d, %d bytes, not %d):"
+                        " %s\n", iexpr + 1, st->ithread, nbytes, ep->nbytes,
+                        ep->expression);
+            ep->ismismatch = 1;
+            pthread_mutex_unlock(&mismatchlock);
+        } /* --- end-of-for(i) --- */
+end_of_job:
+    if (buffer != NULL) free((void *)buffer);
+    if (st->isokay) {
+        delete_arena(mctx.arena);
+        GIF_DestroyStrtab(mctx.gifstrtab);
+    }
+    return (NULL);
+} /* --- end-of-function stressrender() --- */
+
+
+/* ==========================================================================
+ * Function:    main ( argc, argv )
+ * Purpose:     Loads the corpus, renders it on the main thread,
+ *              then on nthreads threads at once, and reports mismatches
+ * ======================================================================= */
+/* --- entry point --- */
+int main(int argc, char *argv[])
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    static stressthread threads[MAXTHREADS];
+    mimetex_ctx mctx;
+    mimetex_options opts = { NORMALSIZE, MIMETEX_GIF, 1 };
+    mimetex_image image;
+    unsigned char *buffer = NULL;
+    char *htmlfile = HTMLFILE, *corpusfile = NULL;
+    int argnum = 0, iexpr = 0, ithread = 0, isokay = 1;
+    long nrenders = 0;
+    /* ------------------------------------------------------------
+    interpret command-line arguments
+    ------------------------------------------------------------ */
+    while (argc > ++argnum) {
+        char flag = (*argv[argnum] == '-' ? argv[argnum][1] : '\000');
+        char *value = (argnum + 1 < argc ? argv[argnum+1] : NULL);
+        switch (flag) {
+        default:
+            fprintf(stderr, "Usage: %s [-h htmlfile] [-f corpusfile]"
+                    " [-t threads] [-n passes] [-g format]\n", argv[0]);
+            return (1);
+        case 'h':
+        case 'f':
+        case 't':
+        case 'n':
+        case 'g':
+            if (value == NULL) {
+                fprintf(stderr, "%s: -%c needs a value\n", argv[0], flag);
+                return (1);
+            }
+            argnum++;
+            if (flag == 'h') htmlfile = value;
+            if (flag == 'f') corpusfile = value;
+            if (flag == 't') nthreads = atoi(value);
+            if (flag == 'n') npasses = atoi(value);
+            if (flag == 'g') format = atoi(value);
+            break;
+        } /* --- end-of-switch(flag) --- */
+    } /* --- end-of-while(argc>++argnum) --- */
+    if (nthreads < 1) nthreads = 1;
+    if (nthreads > MAXTHREADS) nthreads = MAXTHREADS;
+    if (npasses < 1) npasses = 1;
+    opts.format = format;
+    /* ------------------------------------------------------------
+    load corpus
+    ------------------------------------------------------------ */
+    if (corpus_html(htmlfile, addexpr) < 0)
+        fprintf(stderr, "%s: can't read %s\n", argv[0], htmlfile);
+    if (corpusfile != NULL)
+        if (corpus_lines(corpusfile, addexpr) < 0) {
+            fprintf(stderr, "%s: can't read %s\n", argv[0], corpusfile);
+            return (1);
+        }
+    if (nexprs < 1) {
+        fprintf(stderr, "%s: no expressions to render\n", argv[0]);
+        return (1);
+    }
+    /* ------------------------------------------------------------
+    render each expression on the main thread
+    ------------------------------------------------------------ */
+    if (!newctx(&mctx)
+            || (buffer = (unsigned char *)malloc(MAXGIFSZ)) == NULL) {
+        fprintf(stderr, "%s: can't set up context\n", argv[0]);
+        return (1);
+    }
+    for (iexpr = 0; iexpr < nexprs; iexpr++) {
+        stressexpr *ep = &exprs[iexpr];
+        ep->nbytes = mimetex_render(&mctx, ep->expression, &opts,
+                                    buffer, MAXGIFSZ, &image);
+        if (ep->nbytes > 0) {
+            if ((ep->image = (unsigned char *)malloc(ep->nbytes)) == NULL) {
+                fprintf(stderr, "%s: can't allocate image\n", argv[0]);
+                return (1);
+            }
+            memcpy(ep->image, buffer, ep->nbytes);
+        }
+    } /* --- end-of-for(iexpr) --- */
+    /* ------------------------------------------------------------
+    render them again on nthreads threads at once
+    ------------------------------------------------------------ */
+    for (ithread = 0; ithread < nthreads; ithread++) {
+        threads[ithread].ithread = ithread;
+        if (pthread_create(&threads[ithread].thread, NULL, stressrender,
+                           (void *)&threads[ithread]) != 0) {
+            fprintf(stderr, "%s: can't create thread %d\n", argv[0], ithread);
+            nthreads = ithread;
+            isokay = 0;
+            break;
+        }
+    }
+    for (ithread = 0; ithread < nthreads; ithread++) {
+        pthread_join(threads[ithread].thread, NULL);
+        if (!threads[ithread].isokay) isokay = 0;
+        nrenders += threads[ithread].nrenders;
+    }
+    printf("expressions=%d threads=%d passes=%d renders=%ld mismatches=%d\n",
+           nexprs, nthreads, npasses, nrenders, nmismatches);
+    free((void *)buffer);
+    delete_arena(mctx.arena);
+    GIF_DestroyStrtab(mctx.gifstrtab);
+    return (isokay && nmismatches == 0 ? 0 : 1);
+} /* --- end-of-function main() --- */
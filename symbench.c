@@ -0,0 +1,189 @@
+/****************************************************************************
+ *
+ * Copyright(c) 2002-2009, John Forkosh Associates, Inc. All rights reserved.
+ *           http://www.forkosh.com   mailto: john@forkosh.com
+ * --------------------------------------------------------------------------
+ * This file is part of mimeTeX, which is free software. You may redistribute
+ * and/or modify it under the terms of the GNU General Public License,
+ * version 3 or later, as published by the Free Software Foundation.
+ *      MimeTeX is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY, not even the implied warranty of MERCHANTABILITY.
+ * See the GNU General Public License for specific details.
+ *      By using mimeTeX, you warrant that you have read, understood and
+ * agreed to these terms and conditions, and that you possess the legal
+ * right and ability to enter into this agreement and to use mimeTeX
+ * in accordance with it.
+ *      Your mimetex.zip distribution file should contain the file COPYING,
+ * an ascii text copy of the GNU General Public License, version 3.
+ * If not, point your browser to  http://www.gnu.org/licenses/
+ * or write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330,  Boston, MA 02111-1307 USA.
+ * --------------------------------------------------------------------------
+ *
+ * Program:     symbench  [-n passes]
+ *
+ * Purpose:     Times get_symdef() symbol lookups, by looking up every
+ *              symtables[] symbol, each of its leading substrings
+ *              (e.g., \gam for \gamma), and a name that misses (\gammaz),
+ *              over and over, and reports the cost of one lookup.
+ *
+ * --------------------------------------------------------------------------
+ *
+ * Command-line Arguments:
+ *              -n passes       #timed passes through all the names
+ *                              (default 50)
+ *
+ * Output:      One line on stdout:
+ *                names=n passes=n p50_us=x min_us=x per_sec=n
+ *              where p50_us and min_us are the median and fastest pass's
+ *              microseconds per lookup, and per_sec is lookups per second
+ *              at the median.
+ *
+ * Exits:       0=success,  1=some error
+ *
+ * Source:      symbench.c
+ *
+ ****************************************************************************/
+
+/* --------------------------------------------------------------------------
+standard headers, program parameters, global data and macros
+-------------------------------------------------------------------------- */
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+/* --- standard headers --- */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+/* --- application headers --- */
+#include "mimetex.h"
+
+/* --- parameters either -D defined on cc line, or defaulted here --- */
+#ifndef NPASSES
+#define NPASSES 50                  /* timed passes through all names */
+#endif
+
+/* --- names to look up --- */
+static char **names = NULL;         /* malloc'ed array of names */
+static char *namebuff = NULL;       /* malloc'ed names themselves */
+static int nnames = 0;              /* #names */
+
+
+/* ==========================================================================
+ * Function:    loadnames ( )
+ * Purpose:     Lists every symtables[] symbol, each of its leading
+ *              substrings, and a miss for each, in names[]
+ * --------------------------------------------------------------------------
+ * Arguments:   none
+ * --------------------------------------------------------------------------
+ * Returns:     ( int )         #names, or 0 for any error
+ * ======================================================================= */
+/* --- entry point --- */
+static int loadnames(void)
+{
+    mathchardef *symdef = NULL;
+    char *nameptr = NULL;
+    int nbytes = 0, itable = 0;
+    /* --- room for each symbol, its leading substrings, and a miss --- */
+    for (itable = 0; symtables[itable].table != NULL; itable++)
+        for (symdef = symtables[itable].table; symdef->symbol != NULL; symdef++) {
+            int len = strlen(symdef->symbol);
+            nnames += len + 1;
+            nbytes += (len + 1) * (len + 2);
+        }
+    if (nnames < 1
+            || (names = (char **)malloc(nnames * sizeof(char *))) == NULL
+            || (namebuff = (char *)malloc(nbytes)) == NULL)
+        return (nnames = 0);
+    /* --- e.g., \gamma, \gamm, \gam, \ga, \g, \ and \gammaz --- */
+    nnames = 0;
+    nameptr = namebuff;
+    for (itable = 0; symtables[itable].table != NULL; itable++)
+        for (symdef = symtables[itable].table; symdef->symbol != NULL; symdef++) {
+            int len = strlen(symdef->symbol), sublen = 0;
+            for (sublen = len; sublen >= 1; sublen--) {
+                memcpy(nameptr, symdef->symbol, sublen);
+                nameptr[sublen] = '\000';
+                names[nnames++] = nameptr;
+                nameptr += sublen + 1;
+            }
+            sprintf(nameptr, "%sz", symdef->symbol);
+            names[nnames++] = nameptr;
+            nameptr += len + 2;
+        }
+    return (nnames);
+} /* --- end-of-function loadnames() --- */
+
+
+/* ==========================================================================
+ * Function:    cmpdouble ( a, b )
+ * Purpose:     qsort() comparison for ascending doubles
+ * ======================================================================= */
+/* --- entry point --- */
+static int cmpdouble(const void *a, const void *b)
+{
+    double da = *(const double *)a, db = *(const double *)b;
+    return (da < db ? -1 : (da > db ? 1 : 0));
+} /* --- end-of-function cmpdouble() --- */
+
+
+/* ==========================================================================
+ * Function:    main ( argc, argv )
+ * Purpose:     Times npasses passes through names[], after one untimed
+ *              pass (which builds any index get_symdef() keeps)
+ * ======================================================================= */
+/* --- entry point --- */
+int main(int argc, char *argv[])
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    mimetex_ctx mctx;
+    struct timespec t0, t1;
+    double *usecs = NULL, p50 = 0.0;
+    int npasses = NPASSES, argnum = 0, ipass = 0, iname = 0;
+    /* ------------------------------------------------------------
+    interpret command-line arguments
+    ------------------------------------------------------------ */
+    while (argc > ++argnum) {
+        if (strcmp(argv[argnum], "-n") == 0 && argnum + 1 < argc)
+            npasses = atoi(argv[++argnum]);
+        else {
+            fprintf(stderr, "Usage: %s [-n passes]\n", argv[0]);
+            return (1);
+        }
+    }
+    if (npasses < 1) npasses = 1;
+    /* ------------------------------------------------------------
+    time the passes
+    ------------------------------------------------------------ */
+    if (mimetex_ctx_init(&mctx) || loadnames() < 1
+            || (usecs = (double *)malloc(npasses * sizeof(double))) == NULL) {
+        fprintf(stderr, "%s: can't set up\n", argv[0]);
+        return (1);
+    }
+    for (iname = 0; iname < nnames; iname++)    /* warm up */
+        get_symdef(&mctx, names[iname]);
+    for (ipass = 0; ipass < npasses; ipass++) {
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (iname = 0; iname < nnames; iname++)
+            get_symdef(&mctx, names[iname]);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        usecs[ipass] = ((double)(t1.tv_sec - t0.tv_sec) * 1.0e6
+                        + (double)(t1.tv_nsec - t0.tv_nsec) / 1.0e3)
+                       / (double)nnames;
+    }
+    /* ------------------------------------------------------------
+    report per-lookup latency
+    ------------------------------------------------------------ */
+    qsort((void *)usecs, npasses, sizeof(double), cmpdouble);
+    p50 = usecs[npasses / 2];
+    printf("names=%d passes=%d p50_us=%.4f min_us=%.4f per_sec=%.0f\n",
+           nnames, npasses, p50, usecs[0], (p50 > 0.0 ? 1.0e6 / p50 : 0.0));
+    free((void *)usecs);
+    free((void *)names);
+    free((void *)namebuff);
+    return (0);
+} /* --- end-of-function main() --- */
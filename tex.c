@@ -48,18 +48,18 @@
  * Returns: ( char * )  ptr to "cleaned" copy of s
  *              or "" (empty string) for any error.
  * --------------------------------------------------------------------------
- * Notes:     o The returned pointer addresses a static buffer,
+ * Notes:     o The returned pointer addresses mctx->detexbuff,
  *      so don't call strdetex() again until you're finished
  *      with output from the preceding call.
  * ======================================================================= */
 /* --- entry point --- */
-char    *strdetex(char *s, int mode)
+char    *strdetex(mimetex_ctx *mctx, char *s, int mode)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* copy of s with no math chars */
-    static  char sbuff[4096];
+    char    *sbuff = mctx->detexbuff;
     /* replace _ with -, etc */
     int strreplace();
     /* ------------------------------------------------------------
@@ -469,7 +469,7 @@ char    *texsubexpr(mimetex_ctx *mctx, char *expression, char *subexpr, int maxs
         gotescape = 1;
     /* --- check for \left...\right --- */
     if (gotescape)               /* begins with \ */
-        if (memcmp(expression + 1, "left", 4))      /* and followed by left */
+        if (strncmp(expression + 1, "left", 4))      /* and followed by left */
             if (strchr(left, 'l') != NULL)         /* caller wants \left's */
                 if (strtexchr(expression, "\\left") == expression) { /*expression=\left...*/
                     char *pright = texleft(mctx, expression, subexpr, maxsubsz, /* find ...\right*/
@@ -632,7 +632,7 @@ char    *texleft(mimetex_ctx *mctx, char *expression, char *subexpr, int maxsubs
     /* locate matching \right */
     char *pright = expression;
     /* tex delimiters */
-    static  char left[16] = "\\left", right[16] = "\\right";
+    char    left[16] = "\\left", right[16] = "\\right";
     /* #chars between \left...\right */
     int sublen = 0;
     /* ------------------------------------------------------------
@@ -970,7 +970,7 @@ char    *preamble(mimetex_ctx *mctx, char *expression, int *size, char *subexpr)
                         /*set flag showing font size present*/
                         isfontsize = 1;
                         /*leading size param gone*/
-                        if (comma != NULL) strcpy(pretext, comma + 1);
+                        if (comma != NULL) strsqueeze(pretext, comma + 1 - pretext);
                     } /* --- end-of-if(comma!=NULL||etc) --- */
                     /* --- copy any preamble params following size to caller's subexpr --- */
                     if (comma != NULL || !isfontsize)    /*preamb contains params past size*/
@@ -1022,6 +1022,244 @@ end_of_job:
 } /* --- end-of-function preamble() --- */
 
 
+/* ---
+ * prefix trie of mimeprep()'s symbols[] table, shared by all contexts
+ * ------------------------------------------------------------------- */
+typedef struct prepnode_struct {
+    int     kid;                    /* first child node, or 0 if none */
+    int     next;                   /* next sibling node, or 0 if none */
+    int     ch;                     /* char labelling edge to this node */
+    int     isymbol;                /* symbols[] whose key ends here, or -1 */
+} prepnode; /* --- end-of-prepnode_struct --- */
+typedef struct preptrie_struct {
+    int     nsymbols;               /* #symbols[] entries */
+    int     nnodes, maxnodes;       /* #nodes[] used, and allocated */
+    int     kids[256];              /* first node for each leading char */
+    prepnode *nodes;                /* trie nodes (nodes[0] unused) */
+    int     *samekey;               /* next symbols[] with the same key */
+    char    *isalways;              /* true for symbols[] without a key */
+} preptrie; /* --- end-of-preptrie_struct --- */
+static preptrie *symbolstrie = NULL;
+
+/* ==========================================================================
+ * Function:    new_preptrie ( nsymbols, maxnodes )
+ * Purpose: Allocates an empty preptrie for nsymbols keys whose
+ *      total length is at most maxnodes-1 chars
+ * --------------------------------------------------------------------------
+ * Arguments:   nsymbols (I)    int containing #symbols[] entries
+ *      maxnodes (I)    int containing #nodes to allocate
+ * --------------------------------------------------------------------------
+ * Returns: ( preptrie * )  ptr to allocated preptrie,
+ *              or NULL for any error
+ * --------------------------------------------------------------------------
+ * Notes:
+ * ======================================================================= */
+/* --- entry point --- */
+static preptrie *new_preptrie(int nsymbols, int maxnodes)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* trie returned to caller */
+    preptrie *trie = (preptrie *)malloc(sizeof(preptrie));
+    /* ------------------------------------------------------------
+    allocate and initialize trie
+    ------------------------------------------------------------ */
+    if (trie == NULL) goto end_of_job;
+    trie->nsymbols = nsymbols;
+    trie->nnodes = 1;
+    trie->maxnodes = maxnodes;
+    memset((void *)trie->kids, 0, sizeof(trie->kids));
+    trie->nodes = (prepnode *)malloc(maxnodes * sizeof(prepnode));
+    trie->samekey = (int *)malloc((nsymbols + 1) * sizeof(int));
+    trie->isalways = (char *)calloc(nsymbols + 1, sizeof(char));
+    if (trie->nodes == NULL || trie->samekey == NULL || trie->isalways == NULL) {
+        if (trie->nodes != NULL) free((void *)trie->nodes);
+        if (trie->samekey != NULL) free((void *)trie->samekey);
+        if (trie->isalways != NULL) free((void *)trie->isalways);
+        free((void *)trie);
+        trie = NULL;
+    }
+end_of_job:
+    return (trie);
+} /* --- end-of-function new_preptrie() --- */
+
+/* ==========================================================================
+ * Function:    preptrie_add ( trie, key, isymbol )
+ * Purpose: Adds symbols[isymbol] to trie under key
+ * --------------------------------------------------------------------------
+ * Arguments:   trie (I/O)  preptrie * to which key is added
+ *      key (I)     char * to null-terminated key, or NULL
+ *              if symbols[isymbol] must always be searched for
+ *      isymbol (I) int containing symbols[] index for key
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if key added, or 0 for any error
+ * --------------------------------------------------------------------------
+ * Notes:     o key must be a literal substring of every match of
+ *      symbols[isymbol], so that preptrie_scan() never misses one.
+ * ======================================================================= */
+/* --- entry point --- */
+static int preptrie_add(preptrie *trie, char *key, int isymbol)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    unsigned char *pkey = (unsigned char *)key;
+    /* head of current node's child list */
+    int *kids = NULL, inode = 0;
+    /* ------------------------------------------------------------
+    walk (or grow) path to key
+    ------------------------------------------------------------ */
+    trie->samekey[isymbol] = (-1);
+    if (key == NULL || *key == '\000') {  /* no key to look for */
+        trie->isalways[isymbol] = 1;       /* so always search for symbol */
+        return (1);
+    }
+    for (kids = &(trie->kids[*pkey]); *pkey; pkey++) {
+        for (inode = *kids; inode != 0; inode = trie->nodes[inode].next)
+            if (trie->nodes[inode].ch == *pkey) break;
+        if (inode == 0) {          /* no child for this char yet */
+            prepnode *node = NULL;
+            if (trie->nnodes >= trie->maxnodes) return (0);
+            node = &(trie->nodes[inode = trie->nnodes++]);
+            node->kid = 0;
+            node->next = *kids;
+            node->ch = *pkey;
+            node->isymbol = (-1);
+            *kids = inode;
+        }
+        kids = &(trie->nodes[inode].kid);
+    } /* --- end-of-for(pkey) --- */
+    /* --- chain symbol onto any others with the same key --- */
+    trie->samekey[isymbol] = trie->nodes[inode].isymbol;
+    trie->nodes[inode].isymbol = isymbol;
+    return (1);
+} /* --- end-of-function preptrie_add() --- */
+
+/* ==========================================================================
+ * Function:    preptrie_scan ( trie, string, present )
+ * Purpose: Flags every symbols[] entry whose key occurs in string
+ * --------------------------------------------------------------------------
+ * Arguments:   trie (I)    preptrie * of symbols[] keys
+ *      string (I)  char * to null-terminated string to be scanned
+ *      present (O) char * to trie->nsymbols flags returning
+ *              true for symbols[] that may occur in string
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     #symbols[] flagged
+ * --------------------------------------------------------------------------
+ * Notes:     o One pass over string, walking the trie from each char,
+ *      instead of one strstr() over string per symbols[] entry.
+ * ======================================================================= */
+/* --- entry point --- */
+static int preptrie_scan(preptrie *trie, char *string, char *present)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    unsigned char *pstring = (unsigned char *)string, *pmatch = NULL;
+    int inode = 0, isymbol = 0, npresent = 0;
+    /* ------------------------------------------------------------
+    flag keyless symbols, then walk trie from each char of string
+    ------------------------------------------------------------ */
+    for (isymbol = 0; isymbol < trie->nsymbols; isymbol++)
+        npresent += (present[isymbol] = trie->isalways[isymbol]);
+    for (; *pstring; pstring++)
+        for (pmatch = pstring, inode = trie->kids[*pmatch];
+                inode != 0 && *pmatch; ) {
+            prepnode *node = &(trie->nodes[inode]);
+            if (node->ch != *pmatch) {     /* try next sibling */
+                inode = node->next;
+                continue;
+            }
+            for (isymbol = node->isymbol; isymbol >= 0;
+                    isymbol = trie->samekey[isymbol])
+                if (!present[isymbol]) {   /* flag every symbol with this key */
+                    present[isymbol] = 1;
+                    npresent++;
+                }
+            inode = node->kid;              /* down to next char */
+            pmatch++;
+        } /* --- end-of-for(pstring,pmatch) --- */
+    return (npresent);
+} /* --- end-of-function preptrie_scan() --- */
+
+
+/* ==========================================================================
+ * Function:    delete_preptrie ( trie )
+ * Purpose: Deallocates a preptrie
+ * --------------------------------------------------------------------------
+ * Arguments:   trie (I)    preptrie * to be deleted
+ * --------------------------------------------------------------------------
+ * Returns: ( int )     1 if completed successfully
+ * --------------------------------------------------------------------------
+ * Notes:
+ * ======================================================================= */
+/* --- entry point --- */
+static int delete_preptrie(preptrie *trie)
+{
+    if (trie != NULL) {
+        free((void *)trie->nodes);
+        free((void *)trie->samekey);
+        free((void *)trie->isalways);
+        free((void *)trie);
+    }
+    return (1);
+} /* --- end-of-function delete_preptrie() --- */
+
+/* ==========================================================================
+ * Function:    preptrie_key ( htmlsym, args, key )
+ * Purpose: Returns the literal substring that every match of
+ *      a mimeprep() symbols[] entry must contain
+ * --------------------------------------------------------------------------
+ * Arguments:   htmlsym (I) char * to symbols[].html
+ *      args (I)    char * to symbols[].args
+ *      key (O)     char * to buffer of at least 2 chars, returning
+ *              the key for strwstr()-matched symbols
+ * --------------------------------------------------------------------------
+ * Returns: ( char * )  ptr to key, or NULL if there's none
+ * --------------------------------------------------------------------------
+ * Notes:     o strstr()-matched symbols are their own key.
+ *        o strwstr()-matched symbols ("embed" args followed by
+ *      whitespace chars) may match with any whitespace, so only
+ *      their first non-white char is a key, and only if it isn't
+ *      a letter matched case-insensitively.
+ * ======================================================================= */
+/* --- entry point --- */
+static char *preptrie_key(char *htmlsym, char *args, char *key)
+{
+    /* ------------------------------------------------------------
+    Allocations and Declarations
+    ------------------------------------------------------------ */
+    /* strwstr() whitespace and case-sensitivity */
+    char whitespace[256], *pwhite = NULL;
+    int iscase = 1;
+    /* ------------------------------------------------------------
+    symbol matched by strstr() is its own key
+    ------------------------------------------------------------ */
+    /* (mimeprep() skips WHITESPACE, a subset of WHITEMATH) */
+    htmlsym += strspn(htmlsym, WHITEMATH);
+    if (args == NULL || strncmp(args, "embed", 5) != 0 || strlen(args) < 7)
+        return (htmlsym);
+    /* ------------------------------------------------------------
+    symbol matched by strwstr() is keyed on its first non-white char
+    ------------------------------------------------------------ */
+    /* --- whitespace as interpreted by strwstr() --- */
+    strninit(whitespace, args + 6, 255);
+    iscase = (strchr(whitespace, 'i') == NULL && strchr(whitespace, 'I') == NULL);
+    while ((pwhite = strpbrk(whitespace, "iI")) != NULL) /* squeeze out i,I */
+        strsqueeze(pwhite, 1);
+    if (*whitespace == '\000')           /* white just had i,I */
+        strcpy(whitespace, WHITEMATH);
+    /* --- first char that must match literally --- */
+    key[0] = htmlsym[strspn(htmlsym, whitespace)];
+    key[1] = '\000';
+    if (key[0] == '\000'                 /* symbol is all whitespace */
+            || (!iscase && isalpha((int)key[0]))) /* or matches either case */
+        return (NULL);
+    return (key);
+} /* --- end-of-function preptrie_key() --- */
+
+
 /* ==========================================================================
  * Function:    mimeprep ( expression )
  * Purpose: preprocessor for mimeTeX input, e.g.,
@@ -1062,6 +1300,9 @@ char *mimeprep(mimetex_ctx *mctx, char *expression)
                  isymbol = 0;
     /* true to xlate \left and \right */
     int xlateleft = 0;
+    /* symbols[] trie, and flags for symbols[] in expression */
+    preptrie *trie = NULL;
+    char    *present = NULL, triekey[2];
     /* ---
      * comments
      * -------- */
@@ -1375,7 +1616,7 @@ char *mimeprep(mimetex_ctx *mctx, char *expression)
                     /* replace entire comment by ~ */
                     *leftptr = '~';
                     /* and squeeze out comment */
-                    strcpy(leftptr + 1, tokptr);
+                    strsqueeze(leftptr + 1, tokptr - (leftptr + 1));
                     goto next_comment;
                 }     /* stop looking for rightcomment */
         /* --- no rightcomment after opening leftcomment --- */
@@ -1389,6 +1630,30 @@ next_comment:
         expptr = leftptr + 1;
     } /* --- end-of-while(leftptr!=NULL) --- */
     /* ------------------------------------------------------------
+    find symbols[] that may occur in expression (building trie first time)
+    ------------------------------------------------------------ */
+    if ((trie = loadshared(&symbolstrie)) == NULL) {
+        /* #symbols[], and bound on #trie nodes */
+        int nsymbols = 0, maxnodes = 1, isok = 1;
+        for (nsymbols = 0; symbols[nsymbols].html != NULL; nsymbols++)
+            maxnodes += strlen(symbols[nsymbols].html);
+        if ((trie = new_preptrie(nsymbols, maxnodes)) != NULL) {
+            for (isymbol = 0; isymbol < nsymbols; isymbol++)
+                isok &= preptrie_add(trie, preptrie_key(symbols[isymbol].html,
+                                     symbols[isymbol].args, triekey), isymbol);
+            if (!isok) {                /* trie incomplete, so don't use it */
+                delete_preptrie(trie);
+                trie = NULL;
+            } else if (!publishshared(&symbolstrie, trie)) { /* another thread beat us */
+                delete_preptrie(trie);
+                trie = loadshared(&symbolstrie);
+            }
+        }
+    } /* --- end-of-if(trie==NULL) --- */
+    if (trie != NULL)                    /* no trie means search for every symbol */
+        if ((present = (char *)malloc(trie->nsymbols + 1)) != NULL)
+            preptrie_scan(trie, expression, present);
+    /* ------------------------------------------------------------
     run thru table, converting all occurrences of each macro to its expansion
     ------------------------------------------------------------ */
     for (isymbol = 0; (htmlsym = symbols[isymbol].html) != NULL; isymbol++) {
@@ -1415,6 +1680,10 @@ next_comment:
         int iarg, nargs = 0;
         /* whitespace chars for strwstr() */
         char  wstrwhite[99];
+        /* #occurrences of symbol replaced */
+        int   nxlated = 0;
+        if (present != NULL && !present[isymbol]) /* symbol not in expression */
+            continue;
         /*skip any bogus leading whitespace*/
         skipwhite(htmlsym);
         /* reset length of html token */
@@ -1603,7 +1872,7 @@ next_comment:
                     sprintf(argsignal, "#%d", iarg);
                     while ((argsigptr = strstr(argval, argsignal)) != NULL) /* #1...#9 */
                         /*can't be in argval*/
-                        strcpy(argsigptr, argsigptr + strlen(argsignal));
+                        strsqueeze(argsigptr, strlen(argsignal));
                     while ((argsigptr = strstr(abuff, argsignal)) != NULL) /* #1...#9 */
                         /*replaced by argval*/
                         strchange(strlen(argsignal), argsigptr, argval);
@@ -1614,7 +1883,11 @@ next_comment:
             /*replace macro or html symbol*/
             strchange(escapelen, tokptr, abuff);
             expptr = tokptr + strlen(abuff); /*resume search after macro / html*/
+            nxlated++;
         } /* --- end-of-while(tokptr!=NULL) --- */
+        /* --- expansion may have introduced symbols further down the table --- */
+        if (nxlated > 0 && present != NULL)
+            preptrie_scan(trie, expression, present);
     } /* --- end-of-for(isymbol) --- */
     /* ------------------------------------------------------------
     convert \left( to \(  and  \right) to \),  etc.
@@ -1636,7 +1909,7 @@ next_comment:
             while ((tokptr = strstr(expptr, lrstr)) != NULL) { /* found \left or \right */
                 if (isthischar(*(tokptr + lrlen), braces)) { /* followed by a 1-char brace*/
                     /* so squeeze out "left" or "right"*/
-                    strcpy(tokptr + 1, tokptr + lrlen);
+                    strsqueeze(tokptr + 1, lrlen - 1);
                     expptr = tokptr + 2;
                 }        /* and resume search past brace */
                 else {              /* may be a "long" brace like \| */
@@ -1645,9 +1918,9 @@ next_comment:
                     for (isymbol = 0; (lrsym = lrfrom[isymbol]) != NULL; isymbol++) {
                         /* #chars in delim, e.g., 2 for \| */
                         int symlen = strlen(lrsym);
-                        if (memcmp(tokptr + lrlen, lrsym, symlen) == 0) { /* found long delim*/
+                        if (strncmp(tokptr + lrlen, lrsym, symlen) == 0) { /* found long delim*/
                             /* squeeze out delim */
-                            strcpy(tokptr + 1, tokptr + lrlen + symlen - 1);
+                            strsqueeze(tokptr + 1, lrlen + symlen - 2);
                             /* last char now 1-char delim*/
                             *(tokptr + 1) = *(lrto[isymbol]);
                             /* resume search past 1-char delim*/
@@ -1720,7 +1993,7 @@ next_comment:
                 arg[rightlen+1] = '\000';
                 if (isthischar(*arg, WHITEMATH))  /* 1st char was mandatory space */
                     /* so squeeze it out */
-                    strcpy(arg, arg + 1);
+                    strsqueeze(arg, 1);
                 /* concatanate right-arg} */
                 strcat(command, arg);
                 /* add close delim if needed*/
@@ -1739,6 +2012,7 @@ next_comment:
         fprintf(mctx->msgfp, "mimeprep> expression=\"\"%s\"\"\n", expression);
         fflush(mctx->msgfp);
     }
+    if (present != NULL) free((void *)present);
     return (expression);
 } /* --- end-of-function mimeprep() --- */
 
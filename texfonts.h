@@ -75,7 +75,7 @@ font sizes 0-7 for cmr10
  * mf '\mode=eighthre;  input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr83 --- */
-static	chardef  cmr83[] =
+static	const chardef  cmr83[] =
    {
       /* --- pixel bitmap for cmr83 char#0 \Gamma --- */
       {   0, 1561,                      /* character number, location */
@@ -726,7 +726,7 @@ static	chardef  cmr83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr100 --- */
-static	chardef  cmr100[] =
+static	const chardef  cmr100[] =
    {
       /* --- pixel bitmap for cmr100 char#0 \Gamma --- */
       {   0,51662,                      /* character number, location */
@@ -1386,7 +1386,7 @@ static	chardef  cmr100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr118 --- */
-static	chardef  cmr118[] =
+static	const chardef  cmr118[] =
    {
       /* --- pixel bitmap for cmr118 char#0 \Gamma --- */
       {   0,52128,                      /* character number, location */
@@ -2072,7 +2072,7 @@ static	chardef  cmr118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr131 --- */
-static	chardef  cmr131[] =
+static	const chardef  cmr131[] =
    {
       /* --- pixel bitmap for cmr131 char#0 \Gamma --- */
       {   0,53384,                      /* character number, location */
@@ -2790,7 +2790,7 @@ static	chardef  cmr131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr160 --- */
-static	chardef  cmr160[] =
+static	const chardef  cmr160[] =
    {
       /* --- pixel bitmap for cmr160 char#0 \Gamma --- */
       {   0,53842,                      /* character number, location */
@@ -3534,7 +3534,7 @@ static	chardef  cmr160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr180 --- */
-static	chardef  cmr180[] =
+static	const chardef  cmr180[] =
    {
       /* --- pixel bitmap for cmr180 char#0 \Gamma --- */
       {   0,54233,                      /* character number, location */
@@ -4303,7 +4303,7 @@ static	chardef  cmr180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr210 --- */
-static	chardef  cmr210[] =
+static	const chardef  cmr210[] =
    {
       /* --- pixel bitmap for cmr210 char#0 \Gamma --- */
       {   0,54819,                      /* character number, location */
@@ -5119,7 +5119,7 @@ static	chardef  cmr210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input cmr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmr250 --- */
-static	chardef  cmr250[] =
+static	const chardef  cmr250[] =
    {
       /* --- pixel bitmap for cmr250 char#0 \Gamma --- */
       {   0,55643,                      /* character number, location */
@@ -5990,7 +5990,7 @@ font sizes 0-7 for cmmi10
  * mf '\mode=eighthre;  input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi83 --- */
-static	chardef  cmmi83[] =
+static	const chardef  cmmi83[] =
    {
       /* --- pixel bitmap for cmmi83 char#0 \Gamma --- */
       {   0, 1597,                      /* character number, location */
@@ -6641,7 +6641,7 @@ static	chardef  cmmi83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi100 --- */
-static	chardef  cmmi100[] =
+static	const chardef  cmmi100[] =
    {
       /* --- pixel bitmap for cmmi100 char#0 \Gamma --- */
       {   0,52525,                      /* character number, location */
@@ -7295,7 +7295,7 @@ static	chardef  cmmi100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi118 --- */
-static	chardef  cmmi118[] =
+static	const chardef  cmmi118[] =
    {
       /* --- pixel bitmap for cmmi118 char#0 \Gamma --- */
       {   0,53147,                      /* character number, location */
@@ -7984,7 +7984,7 @@ static	chardef  cmmi118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi131 --- */
-static	chardef  cmmi131[] =
+static	const chardef  cmmi131[] =
    {
       /* --- pixel bitmap for cmmi131 char#0 \Gamma --- */
       {   0,53970,                      /* character number, location */
@@ -8736,7 +8736,7 @@ static	chardef  cmmi131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi160 --- */
-static	chardef  cmmi160[] =
+static	const chardef  cmmi160[] =
    {
       /* --- pixel bitmap for cmmi160 char#0 \Gamma --- */
       {   0,54633,                      /* character number, location */
@@ -9502,7 +9502,7 @@ static	chardef  cmmi160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi180 --- */
-static	chardef  cmmi180[] =
+static	const chardef  cmmi180[] =
    {
       /* --- pixel bitmap for cmmi180 char#0 \Gamma --- */
       {   0,55074,                      /* character number, location */
@@ -10316,7 +10316,7 @@ static	chardef  cmmi180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi210 --- */
-static	chardef  cmmi210[] =
+static	const chardef  cmmi210[] =
    {
       /* --- pixel bitmap for cmmi210 char#0 \Gamma --- */
       {   0,55957,                      /* character number, location */
@@ -11196,7 +11196,7 @@ static	chardef  cmmi210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input cmmi10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmi250 --- */
-static	chardef  cmmi250[] =
+static	const chardef  cmmi250[] =
    {
       /* --- pixel bitmap for cmmi250 char#0 \Gamma --- */
       {   0,56859,                      /* character number, location */
@@ -12138,7 +12138,7 @@ font sizes 0-7 for cmmib10
  * mf '\mode=eighthre;  input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib83 --- */
-static	chardef  cmmib83[] =
+static	const chardef  cmmib83[] =
    {
       /* --- pixel bitmap for cmmib83 char#0 \Gamma --- */
       {   0, 1593,                      /* character number, location */
@@ -12790,7 +12790,7 @@ static	chardef  cmmib83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib100 --- */
-static	chardef  cmmib100[] =
+static	const chardef  cmmib100[] =
    {
       /* --- pixel bitmap for cmmib100 char#0 \Gamma --- */
       {   0,52539,                      /* character number, location */
@@ -13455,7 +13455,7 @@ static	chardef  cmmib100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib118 --- */
-static	chardef  cmmib118[] =
+static	const chardef  cmmib118[] =
    {
       /* --- pixel bitmap for cmmib118 char#0 \Gamma --- */
       {   0,53816,                      /* character number, location */
@@ -14153,7 +14153,7 @@ static	chardef  cmmib118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib131 --- */
-static	chardef  cmmib131[] =
+static	const chardef  cmmib131[] =
    {
       /* --- pixel bitmap for cmmib131 char#0 \Gamma --- */
       {   0,53849,                      /* character number, location */
@@ -14881,7 +14881,7 @@ static	chardef  cmmib131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib160 --- */
-static	chardef  cmmib160[] =
+static	const chardef  cmmib160[] =
    {
       /* --- pixel bitmap for cmmib160 char#0 \Gamma --- */
       {   0,54473,                      /* character number, location */
@@ -15661,7 +15661,7 @@ static	chardef  cmmib160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib180 --- */
-static	chardef  cmmib180[] =
+static	const chardef  cmmib180[] =
    {
       /* --- pixel bitmap for cmmib180 char#0 \Gamma --- */
       {   0,55047,                      /* character number, location */
@@ -16488,7 +16488,7 @@ static	chardef  cmmib180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib210 --- */
-static	chardef  cmmib210[] =
+static	const chardef  cmmib210[] =
    {
       /* --- pixel bitmap for cmmib210 char#0 \Gamma --- */
       {   0,56674,                      /* character number, location */
@@ -17373,7 +17373,7 @@ static	chardef  cmmib210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input cmmib10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmmib250 --- */
-static	chardef  cmmib250[] =
+static	const chardef  cmmib250[] =
    {
       /* --- pixel bitmap for cmmib250 char#0 \Gamma --- */
       {   0,57268,                      /* character number, location */
@@ -18329,7 +18329,7 @@ font sizes 0-7 for cmsy10
  * mf '\mode=eighthre;  input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy83 --- */
-static	chardef  cmsy83[] =
+static	const chardef  cmsy83[] =
    {
       /* --- pixel bitmap for cmsy83 char#0 - --- */
       {   0,  943,                      /* character number, location */
@@ -18981,7 +18981,7 @@ static	chardef  cmsy83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy100 --- */
-static	chardef  cmsy100[] =
+static	const chardef  cmsy100[] =
    {
       /* --- pixel bitmap for cmsy100 char#0 - --- */
       {   0,20118,                      /* character number, location */
@@ -19650,7 +19650,7 @@ static	chardef  cmsy100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy118 --- */
-static	chardef  cmsy118[] =
+static	const chardef  cmsy118[] =
    {
       /* --- pixel bitmap for cmsy118 char#0 - --- */
       {   0,20576,                      /* character number, location */
@@ -20358,7 +20358,7 @@ static	chardef  cmsy118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy131 --- */
-static	chardef  cmsy131[] =
+static	const chardef  cmsy131[] =
    {
       /* --- pixel bitmap for cmsy131 char#0 - --- */
       {   0,20854,                      /* character number, location */
@@ -21091,7 +21091,7 @@ static	chardef  cmsy131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy160 --- */
-static	chardef  cmsy160[] =
+static	const chardef  cmsy160[] =
    {
       /* --- pixel bitmap for cmsy160 char#0 - --- */
       {   0,21432,                      /* character number, location */
@@ -21882,7 +21882,7 @@ static	chardef  cmsy160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy180 --- */
-static	chardef  cmsy180[] =
+static	const chardef  cmsy180[] =
    {
       /* --- pixel bitmap for cmsy180 char#0 - --- */
       {   0,21798,                      /* character number, location */
@@ -22713,7 +22713,7 @@ static	chardef  cmsy180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy210 --- */
-static	chardef  cmsy210[] =
+static	const chardef  cmsy210[] =
    {
       /* --- pixel bitmap for cmsy210 char#0 - --- */
       {   0,22190,                      /* character number, location */
@@ -23602,7 +23602,7 @@ static	chardef  cmsy210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input cmsy10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmsy250 --- */
-static	chardef  cmsy250[] =
+static	const chardef  cmsy250[] =
    {
       /* --- pixel bitmap for cmsy250 char#0 - --- */
       {   0,22600,                      /* character number, location */
@@ -24571,7 +24571,7 @@ font sizes 0-7 for cmex10
  * mf '\mode=eighthre;  input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex83 --- */
-static	chardef  cmex83[] =
+static	const chardef  cmex83[] =
    {
       /* --- pixel bitmap for cmex83 char#0 \big( --- */
       {   0,   35,                      /* character number, location */
@@ -25267,7 +25267,7 @@ static	chardef  cmex83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex100 --- */
-static	chardef  cmex100[] =
+static	const chardef  cmex100[] =
    {
       /* --- pixel bitmap for cmex100 char#0 \big( --- */
       {   0,  635,                      /* character number, location */
@@ -26008,7 +26008,7 @@ static	chardef  cmex100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex118 --- */
-static	chardef  cmex118[] =
+static	const chardef  cmex118[] =
    {
       /* --- pixel bitmap for cmex118 char#0 \big( --- */
       {   0,  635,                      /* character number, location */
@@ -26789,7 +26789,7 @@ static	chardef  cmex118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex131 --- */
-static	chardef  cmex131[] =
+static	const chardef  cmex131[] =
    {
       /* --- pixel bitmap for cmex131 char#0 \big( --- */
       {   0,  661,                      /* character number, location */
@@ -27599,7 +27599,7 @@ static	chardef  cmex131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex160 --- */
-static	chardef  cmex160[] =
+static	const chardef  cmex160[] =
    {
       /* --- pixel bitmap for cmex160 char#0 \big( --- */
       {   0,  661,                      /* character number, location */
@@ -28461,7 +28461,7 @@ static	chardef  cmex160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex180 --- */
-static	chardef  cmex180[] =
+static	const chardef  cmex180[] =
    {
       /* --- pixel bitmap for cmex180 char#0 \big( --- */
       {   0,  661,                      /* character number, location */
@@ -29364,7 +29364,7 @@ static	chardef  cmex180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex210 --- */
-static	chardef  cmex210[] =
+static	const chardef  cmex210[] =
    {
       /* --- pixel bitmap for cmex210 char#0 \big( --- */
       {   0,  661,                      /* character number, location */
@@ -30368,7 +30368,7 @@ static	chardef  cmex210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input cmex10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for cmex250 --- */
-static	chardef  cmex250[] =
+static	const chardef  cmex250[] =
    {
       /* --- pixel bitmap for cmex250 char#0 \big( --- */
       {   0,  661,                      /* character number, location */
@@ -31492,7 +31492,7 @@ font sizes 0-7 for bbold10
  * mf '\mode=eighthre;  input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold83 --- */
-static	chardef  bbold83[] =
+static	const chardef  bbold83[] =
    {
       /* --- pixel bitmap for bbold83 char#0 \Gamma --- */
       {   0,   35,                      /* character number, location */
@@ -32143,7 +32143,7 @@ static	chardef  bbold83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold100 --- */
-static	chardef  bbold100[] =
+static	const chardef  bbold100[] =
    {
       /* --- pixel bitmap for bbold100 char#0 \Gamma --- */
       {   0,  246,                      /* character number, location */
@@ -32794,7 +32794,7 @@ static	chardef  bbold100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold118 --- */
-static	chardef  bbold118[] =
+static	const chardef  bbold118[] =
    {
       /* --- pixel bitmap for bbold118 char#0 \Gamma --- */
       {   0,  246,                      /* character number, location */
@@ -33454,7 +33454,7 @@ static	chardef  bbold118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold131 --- */
-static	chardef  bbold131[] =
+static	const chardef  bbold131[] =
    {
       /* --- pixel bitmap for bbold131 char#0 \Gamma --- */
       {   0,  246,                      /* character number, location */
@@ -34145,7 +34145,7 @@ static	chardef  bbold131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold160 --- */
-static	chardef  bbold160[] =
+static	const chardef  bbold160[] =
    {
       /* --- pixel bitmap for bbold160 char#0 \Gamma --- */
       {   0,  246,                      /* character number, location */
@@ -34884,7 +34884,7 @@ static	chardef  bbold160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold180 --- */
-static	chardef  bbold180[] =
+static	const chardef  bbold180[] =
    {
       /* --- pixel bitmap for bbold180 char#0 \Gamma --- */
       {   0,  246,                      /* character number, location */
@@ -35664,7 +35664,7 @@ static	chardef  bbold180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold210 --- */
-static	chardef  bbold210[] =
+static	const chardef  bbold210[] =
    {
       /* --- pixel bitmap for bbold210 char#0 \Gamma --- */
       {   0,  246,                      /* character number, location */
@@ -36501,7 +36501,7 @@ static	chardef  bbold210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input bbold10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for bbold250 --- */
-static	chardef  bbold250[] =
+static	const chardef  bbold250[] =
    {
       /* --- pixel bitmap for bbold250 char#0 \Gamma --- */
       {   0,  246,                      /* character number, location */
@@ -37404,7 +37404,7 @@ font sizes 0-7 for rsfs10
  * mf '\mode=eighthre;  input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs83 --- */
-static	chardef  rsfs83[] =
+static	const chardef  rsfs83[] =
    {
       /* --- pixel bitmap for rsfs83 char#65 A --- */
       {  65,   35,                      /* character number, location */
@@ -37551,7 +37551,7 @@ static	chardef  rsfs83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs100 --- */
-static	chardef  rsfs100[] =
+static	const chardef  rsfs100[] =
    {
       /* --- pixel bitmap for rsfs100 char#65 A --- */
       {  65, 1279,                      /* character number, location */
@@ -37718,7 +37718,7 @@ static	chardef  rsfs100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs118 --- */
-static	chardef  rsfs118[] =
+static	const chardef  rsfs118[] =
    {
       /* --- pixel bitmap for rsfs118 char#65 A --- */
       {  65, 1279,                      /* character number, location */
@@ -37893,7 +37893,7 @@ static	chardef  rsfs118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs131 --- */
-static	chardef  rsfs131[] =
+static	const chardef  rsfs131[] =
    {
       /* --- pixel bitmap for rsfs131 char#65 A --- */
       {  65, 1331,                      /* character number, location */
@@ -38080,7 +38080,7 @@ static	chardef  rsfs131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs160 --- */
-static	chardef  rsfs160[] =
+static	const chardef  rsfs160[] =
    {
       /* --- pixel bitmap for rsfs160 char#65 A --- */
       {  65, 1331,                      /* character number, location */
@@ -38288,7 +38288,7 @@ static	chardef  rsfs160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs180 --- */
-static	chardef  rsfs180[] =
+static	const chardef  rsfs180[] =
    {
       /* --- pixel bitmap for rsfs180 char#65 A --- */
       {  65, 1331,                      /* character number, location */
@@ -38514,7 +38514,7 @@ static	chardef  rsfs180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs210 --- */
-static	chardef  rsfs210[] =
+static	const chardef  rsfs210[] =
    {
       /* --- pixel bitmap for rsfs210 char#65 A --- */
       {  65, 1305,                      /* character number, location */
@@ -38767,7 +38767,7 @@ static	chardef  rsfs210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input rsfs10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for rsfs250 --- */
-static	chardef  rsfs250[] =
+static	const chardef  rsfs250[] =
    {
       /* --- pixel bitmap for rsfs250 char#65 A --- */
       {  65, 1331,                      /* character number, location */
@@ -39077,7 +39077,7 @@ font sizes 0-7 for stmary10
  * mf '\mode=eighthre;  input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary83 --- */
-static	chardef  stmary83[] =
+static	const chardef  stmary83[] =
    {
       /* --- pixel bitmap for stmary83 char#0 \shortleftarrow --- */
       {   0,   35,                      /* character number, location */
@@ -39733,7 +39733,7 @@ static	chardef  stmary83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary100 --- */
-static	chardef  stmary100[] =
+static	const chardef  stmary100[] =
    {
       /* --- pixel bitmap for stmary100 char#0 \shortleftarrow --- */
       {   0,  922,                      /* character number, location */
@@ -40407,7 +40407,7 @@ static	chardef  stmary100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary118 --- */
-static	chardef  stmary118[] =
+static	const chardef  stmary118[] =
    {
       /* --- pixel bitmap for stmary118 char#0 \shortleftarrow --- */
       {   0,  922,                      /* character number, location */
@@ -41118,7 +41118,7 @@ static	chardef  stmary118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary131 --- */
-static	chardef  stmary131[] =
+static	const chardef  stmary131[] =
    {
       /* --- pixel bitmap for stmary131 char#0 \shortleftarrow --- */
       {   0,  948,                      /* character number, location */
@@ -41846,7 +41846,7 @@ static	chardef  stmary131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary160 --- */
-static	chardef  stmary160[] =
+static	const chardef  stmary160[] =
    {
       /* --- pixel bitmap for stmary160 char#0 \shortleftarrow --- */
       {   0,  948,                      /* character number, location */
@@ -42630,7 +42630,7 @@ static	chardef  stmary160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary180 --- */
-static	chardef  stmary180[] =
+static	const chardef  stmary180[] =
    {
       /* --- pixel bitmap for stmary180 char#0 \shortleftarrow --- */
       {   0,  948,                      /* character number, location */
@@ -43452,7 +43452,7 @@ static	chardef  stmary180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary210 --- */
-static	chardef  stmary210[] =
+static	const chardef  stmary210[] =
    {
       /* --- pixel bitmap for stmary210 char#0 \shortleftarrow --- */
       {   0,  948,                      /* character number, location */
@@ -44323,7 +44323,7 @@ static	chardef  stmary210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input stmary10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for stmary250 --- */
-static	chardef  stmary250[] =
+static	const chardef  stmary250[] =
    {
       /* --- pixel bitmap for stmary250 char#0 \shortleftarrow --- */
       {   0,  948,                      /* character number, location */
@@ -45279,7 +45279,7 @@ font sizes 0-7 for wncyr10
  * mf '\mode=eighthre;  input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr83 --- */
-static	chardef  wncyr83[] =
+static	const chardef  wncyr83[] =
    {
       /* --- pixel bitmap for wncyr83 char#0 Nj --- */
       {   0, 1901,                      /* character number, location */
@@ -45932,7 +45932,7 @@ static	chardef  wncyr83[] =
  * mf '\mode=preview; mag=magstep(-17.87427405946994351363); input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr100 --- */
-static	chardef  wncyr100[] =
+static	const chardef  wncyr100[] =
    {
       /* --- pixel bitmap for wncyr100 char#0 Nj --- */
       {   0,59858,                      /* character number, location */
@@ -46599,7 +46599,7 @@ static	chardef  wncyr100[] =
  * mf '\mode=preview; mag=magstep(-16.96645799324018499600); input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr118 --- */
-static	chardef  wncyr118[] =
+static	const chardef  wncyr118[] =
    {
       /* --- pixel bitmap for wncyr118 char#0 Nj --- */
       {   0,61782,                      /* character number, location */
@@ -47292,7 +47292,7 @@ static	chardef  wncyr118[] =
  * mf '\mode=preview; mag=magstep(-16.39322518098640003469); input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr131 --- */
-static	chardef  wncyr131[] =
+static	const chardef  wncyr131[] =
    {
       /* --- pixel bitmap for wncyr131 char#0 Nj --- */
       {   0,62020,                      /* character number, location */
@@ -47997,7 +47997,7 @@ static	chardef  wncyr131[] =
  * mf '\mode=preview; mag=magstep(-15.29639112828755784636); input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr160 --- */
-static	chardef  wncyr160[] =
+static	const chardef  wncyr160[] =
    {
       /* --- pixel bitmap for wncyr160 char#0 Nj --- */
       {   0,62562,                      /* character number, location */
@@ -48754,7 +48754,7 @@ static	chardef  wncyr160[] =
  * mf '\mode=preview; mag=magstep(-14.65037297372839890542); input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr180 --- */
-static	chardef  wncyr180[] =
+static	const chardef  wncyr180[] =
    {
       /* --- pixel bitmap for wncyr180 char#0 Nj --- */
       {   0,63058,                      /* character number, location */
@@ -49544,7 +49544,7 @@ static	chardef  wncyr180[] =
  * mf '\mode=preview; mag=magstep(-13.80488502080647873125); input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr210 --- */
-static	chardef  wncyr210[] =
+static	const chardef  wncyr210[] =
    {
       /* --- pixel bitmap for wncyr210 char#0 Nj --- */
       {   0,63722,                      /* character number, location */
@@ -50379,7 +50379,7 @@ static	chardef  wncyr210[] =
  * mf '\mode=preview; mag=magstep(-12.84858895680446863032); input wncyr10'
  * --------------------------------------------------------------------- */
 /* --- fontdef for wncyr250 --- */
-static	chardef  wncyr250[] =
+static	const chardef  wncyr250[] =
    {
       /* --- pixel bitmap for wncyr250 char#0 Nj --- */
       {   0,64786,                      /* character number, location */
@@ -45,7 +45,7 @@
  * Notes:     o
  * ======================================================================= */
 /* --- entry point --- */
-char *dbltoa(double dblval, int npts)
+char *dbltoa(mimetex_ctx *mctx, double dblval, int npts)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
@@ -53,7 +53,7 @@ char *dbltoa(double dblval, int npts)
     double  floor();
 
     /* buffer returned to caller */
-    static  char finval[256];
+    char    *finval = mctx->dblbuff;
     /* table of ascii decimal digits */
     static  char digittbl[32] = "0123456789*";
     /* ptr to next char being converted*/
@@ -254,17 +254,17 @@ int emit_string(FILE *fp, int col1, char *string, char *comment)
  * Notes:     o
  * ======================================================================= */
 /* --- entry point --- */
-char    *calendar(int year, int month, int day)
+char    *calendar(mimetex_ctx *mctx, int year, int month, int day)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* calendar returned to caller */
-    static char calbuff[4096];
+    char    *calbuff = mctx->calbuff;
     /* binary value returned by time() */
     time_t  time_val = (time_t)(0);
-    /* interpret time_val */
-    struct tm *tmstruct = (struct tm *)NULL, *localtime();
+    /* interpret time_val (reentrant localtime_r() fills tmbuff) */
+    struct tm tmbuff, *tmstruct = (struct tm *)NULL;
     /* today (emphasize today's dd) */
     int yy = 0, mm = 0, dd = 0;
     /* day-of-week for idd=1...31 */
@@ -277,7 +277,7 @@ char    *calendar(int year, int month, int day)
         "May", "June", "July", "August", "September", "October",
         "November", "December", "?"
     };
-    static  int modays[] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31, 0 };
+    int     modays[] = { 0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31, 0 };
     /* ------------------------------------------------------------
     initialization
     ------------------------------------------------------------ */
@@ -285,7 +285,7 @@ char    *calendar(int year, int month, int day)
     /* get date and time */
     time((time_t *)(&time_val));
     /* interpret time_val */
-    tmstruct = localtime((time_t *)(&time_val));
+    tmstruct = localtime_r((time_t *)(&time_val), &tmbuff);
     /* current four-digit year */
     yy  =  1900 + (int)(tmstruct->tm_year);
     /* current month, 1-12 */
@@ -393,18 +393,18 @@ char    *calendar(int year, int month, int day)
  * Notes:     o
  * ======================================================================= */
 /* --- entry point --- */
-char *timestamp(int tzdelta, int ifmt)
+char *timestamp(mimetex_ctx *mctx, int tzdelta, int ifmt)
 {
     /* ------------------------------------------------------------
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* date:time buffer back to caller */
-    static  char timebuff[256];
+    char    *timebuff = mctx->timebuff;
     /*long  time_val = 0L;*/        /* binary value returned by time() */
     /* binary value returned by time() */
     time_t  time_val = (time_t)(0);
-    /* interpret time_val */
-    struct tm *tmstruct = (struct tm *)NULL, *localtime();
+    /* interpret time_val (reentrant localtime_r() fills tmbuff) */
+    struct tm tmbuff, *tmstruct = (struct tm *)NULL;
     int year = 0, hour = 0, ispm = 1,      /* adjust year, and set am/pm hour */
         month = 0, day = 0; /* adjust day and month for delta  */
     static  char *daynames[] = {
@@ -425,7 +425,7 @@ char *timestamp(int tzdelta, int ifmt)
     /* get date and time */
     time((time_t *)(&time_val));
     /* interpret time_val */
-    tmstruct = localtime((time_t *)(&time_val));
+    tmstruct = localtime_r((time_t *)(&time_val), &tmbuff);
     /* --- extract fields --- */
     /* local copy of year,  0=1900 */
     year  = (int)(tmstruct->tm_year);
@@ -511,7 +511,7 @@ int tzadjust(int tzdelta, int *year, int *month, int *day, int *hour)
     /*dereference args*/
     int yy = *year, mm = *month, dd = *day, hh = *hour;
     /* --- calendar data --- */
-    static  int modays[] = {
+    int     modays[] = {
         0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31, 0
     };
     /* ------------------------------------------------------------
@@ -667,7 +667,7 @@ int daynumber(int year, int month, int day)
  *      to wrap lines at linelen.  Any \\'s in the input copy
  *      are removed first.  If (and only if) the input s contains
  *      a terminating \\ then so does the returned copy.
- *        o The returned pointer addresses a static buffer,
+ *        o The returned pointer addresses mctx->wrapbuff,
  *      so don't call strwrap() again until you're finished
  *      with output from the preceding call.
  *        o Modified for mimetex from original version written
@@ -681,7 +681,7 @@ char    *strwrap(mimetex_ctx *mctx, char *s, int linelen, int tablen)
     Allocations and Declarations
     ------------------------------------------------------------ */
     /* line-wrapped copy of s */
-    static  char sbuff[4096];
+    char    *sbuff = mctx->wrapbuff;
     /* ptr to start of current line*/
     char    *sol = sbuff;
     /* tab string */
@@ -856,8 +856,8 @@ char    *strchange(int nfirst, char *from, char *to)
     shift from left or right to accommodate replacement of its nfirst chars by to
     ------------------------------------------------------------ */
     if (tolen < nfirst)              /* shift left is easy */
-        /* because memory doesn't overlap */
-        strcpy(from, from + nshift);
+        /* (memory overlaps, so not strcpy()) */
+        strsqueeze(from, nshift);
     if (tolen > nfirst) {            /* need more room at start of from */
         /* ptr to null terminating from */
         char *pfrom = from + strlen(from);
@@ -1021,10 +1021,10 @@ char    *strwstr(mimetex_ctx *mctx, char *string, char *substr, char *white, int
             strcpy(whitespace, white);
             while ((pwhite = strchr(whitespace, 'i')) != NULL) /* have an embedded i */
                 /* so squeeze it out */
-                strcpy(pwhite, pwhite + 1);
+                strsqueeze(pwhite, 1);
             while ((pwhite = strchr(whitespace, 'I')) != NULL) /* have an embedded I */
                 /* so squeeze it out */
-                strcpy(pwhite, pwhite + 1);
+                strsqueeze(pwhite, 1);
             if (*whitespace == '\000')        /* caller's white just had i,I */
                 strcpy(whitespace, WHITEMATH);
         }    /* so revert back to default */
@@ -1238,7 +1238,8 @@ char x2c(char *what)
  * Returns: ( int )     1 if completed successfully,
  *              or 0 otherwise (for any error).
  * --------------------------------------------------------------------------
- * Notes:
+ * Notes:     o bitmaps are dumped packed, i.e., without the padding
+ *      at the end of each row of rp->pixmap
  * ======================================================================= */
 /* --- entry point --- */
 int hex_bitmap(raster *rp, FILE *fp, int col1, int isstr)
@@ -1248,7 +1249,10 @@ int hex_bitmap(raster *rp, FILE *fp, int col1, int isstr)
     ------------------------------------------------------------ */
     int ibyte,              /* pixmap[ibyte] index */
     /*#bytes in bitmap or .gf-formatted*/
-    nbytes = pixbytes(rp);
+    nbytes = (rp->format == 1 ? rp->pixsz * bitmapsz(rp->width, rp->height)
+              : pixbytes(rp));
+    /* true to pack padded bitmap rows */
+    int ispadded = (rp->format == 1 && rp->pixsz == 1 && rp->stride > 0);
     /* col1 leading blanks */
     char    stub[64] = "                                ";
     int linewidth = 64,         /* (roughly) rightmost column */
@@ -1271,14 +1275,23 @@ int hex_bitmap(raster *rp, FILE *fp, int col1, int isstr)
     /* opening " before first line */
     if (isstr) fprintf(fp, "\"");
     for (ibyte = 0; ibyte < nbytes; ibyte++) { /* one byte at a time */
+        /* byte to be displayed */
+        int byte = (rp->pixmap)[ibyte], ibit = 0;
+        if (ispadded)              /* gather its 8 pixels from padded rows */
+            for (byte = 0, ibit = 0; ibit < 8; ibit++) {
+                int ipix = 8 * ibyte + ibit;  /* pixel# counting row after row */
+                if (ipix < rp->width * rp->height
+                        &&   getlongbit(rp->pixmap, PACKDEX(rp, ipix)))
+                    set1bit(byte, ibit);
+            }
         /* --- display a byte as hex char or number, depending on isstr --- */
         if (isstr)                 /* string format wanted */
             /*print byte as hex char*/
-            fprintf(fp, "\\x%02x", (rp->pixmap)[ibyte]);
+            fprintf(fp, "\\x%02x", byte);
         else
         /* comma-separated format wanted */
             /*print byte as hex number*/
-            fprintf(fp, "0x%02x", (rp->pixmap)[ibyte]);
+            fprintf(fp, "0x%02x", byte);
         /* --- add a separator and newline, etc, as necessary --- */
         if (ibyte < nbytes - 1) {  /* not the last byte yet */
             /* follow hex number with comma */